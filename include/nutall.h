@@ -15,13 +15,21 @@ extern "C" {
 #include "nutarray.h"
 #include "nutcommon.h"
 #include "nutdeque.h"
+#include "nutexecutor.h"
 #include "nuthashset.h"
 #include "nuthashtable.h"
+#include "nutchashtable.h"
+#include "nutfrozentable.h"
 #include "nutlist.h"
+#include "nutmpmcqueue.h"
 #include "nutpqueue.h"
 #include "nutqueue.h"
+#include "nutsegarray.h"
 #include "nutslist.h"
+#include "nutsortedarray.h"
+#include "nutspscring.h"
 #include "nutstack.h"
+#include "nuttemplate.h"
 #include "nuttreeset.h"
 #include "nuttreetable.h"
 
@@ -7,6 +7,7 @@ extern "C" {
 
 
 #include "nutcommon.h"
+#include "nutexecutor.h"
 
 /**
  * A dynamic array that expands automatically as elements are
@@ -29,6 +30,14 @@ typedef struct nut_array_conf_s {
      * The rate at which the buffer expands (capacity * exp_factor). */
     float  exp_factor;
 
+    /**
+     * Size of an element in bytes if the Array stores its elements by
+     * value, or 0 for an Array of void pointers. A value array holds its
+     * elements contiguously and is accessed through the *_value functions.
+     * The functions that take or return elements as void pointers must
+     * only be used on pointer arrays. */
+    size_t element_size;
+
     /**
      * Memory allocators used to allocate the Array structure and the
      * underlying data buffers. */
@@ -37,6 +46,15 @@ typedef struct nut_array_conf_s {
     void  (*mem_free)   (void *block);
 } ArrayConf;
 
+/**
+ * Memory for an Array created with nut_array_new_static(). Its contents are
+ * private; it only gives the structure its size and alignment, so that it
+ * can be placed in static or stack memory.
+ */
+typedef struct nut_array_static_s {
+    void *reserved[10];
+} ArrayStatic;
+
 /**
  * Array iterator structure. Used to iterate over the elements of
  * the array in an ascending order. The iterator also supports
@@ -74,6 +92,7 @@ typedef struct nut_array_zip_iter_s {
 
 NutState  nut_array_new             (Array **out);
 NutState  nut_array_new_conf        (ArrayConf const * const conf, Array **out);
+NutState  nut_array_new_static      (void **buffer, size_t capacity, ArrayStatic *storage, Array **out);
 void      nut_array_conf_init       (ArrayConf *conf);
 
 void      nut_array_destroy         (Array *ar);
@@ -81,12 +100,15 @@ void      nut_array_destroy_cb      (Array *ar, void (*cb) (void*));
 
 NutState  nut_array_add             (Array *ar, void *element);
 NutState  nut_array_add_at          (Array *ar, void *element, size_t index);
+NutState  nut_array_add_all         (Array *ar, const void *elements, size_t n);
+NutState  nut_array_add_all_at      (Array *ar, const void *elements, size_t n, size_t index);
 NutState  nut_array_replace_at      (Array *ar, void *element, size_t index, void **out);
 NutState  nut_array_swap_at         (Array *ar, size_t index1, size_t index2);
 
 NutState  nut_array_remove          (Array *ar, void *element, void **out);
 NutState  nut_array_remove_at       (Array *ar, size_t index, void **out);
 NutState  nut_array_remove_last     (Array *ar, void **out);
+NutState  nut_array_remove_range    (Array *ar, size_t b, size_t e);
 void      nut_array_remove_all      (Array *ar);
 void      nut_array_remove_all_free (Array *ar);
 
@@ -99,6 +121,7 @@ NutState  nut_array_copy_deep       (Array *ar, void *(*cp) (void*), Array **out
 
 void      nut_array_reverse         (Array *ar);
 NutState  nut_array_trim_capacity   (Array *ar);
+NutState  nut_array_reserve         (Array *ar, size_t capacity);
 
 size_t    nut_array_contains        (Array *ar, void *element);
 size_t    nut_array_contains_value  (Array *ar, void *element, int (*cmp) (const void*, const void*));
@@ -107,6 +130,8 @@ size_t    nut_array_capacity        (Array *ar);
 
 NutState  nut_array_index_of        (Array *ar, void *element, size_t *index);
 void      nut_array_sort            (Array *ar, int (*cmp) (const void*, const void*));
+NutState  nut_array_sort_radix32    (Array *ar, uint32_t (*key) (const void*));
+NutState  nut_array_sort_radix64    (Array *ar, uint64_t (*key) (const void*));
 
 void      nut_array_map             (Array *ar, void (*fn) (void*));
 void      nut_array_reduce          (Array *ar, void (*fn) (void*, void*, void*), void *result);
@@ -114,6 +139,12 @@ void      nut_array_reduce          (Array *ar, void (*fn) (void*, void*, void*)
 NutState  nut_array_filter_mut      (Array *ar, bool (*predicate) (const void*));
 NutState  nut_array_filter          (Array *ar, bool (*predicate) (const void*), Array **out);
 
+NutState  nut_array_sort_par        (Array *ar, int (*cmp) (const void*, const void*), Executor *ex);
+void      nut_array_map_par         (Array *ar, void (*fn) (void*), Executor *ex);
+NutState  nut_array_reduce_par      (Array *ar, void (*fn) (void*, void*, void*), void *result,
+                                     size_t result_size, Executor *ex);
+NutState  nut_array_filter_par      (Array *ar, bool (*predicate) (const void*), Array **out, Executor *ex);
+
 void      nut_array_iter_init       (ArrayIter *iter, Array *ar);
 NutState  nut_array_iter_next       (ArrayIter *iter, void **out);
 NutState  nut_array_iter_remove     (ArrayIter *iter, void **out);
@@ -131,6 +162,16 @@ size_t        nut_array_zip_iter_index  (ArrayZipIter *iter);
 
 const void* const* nut_array_get_buffer(Array *ar);
 
+NutState  nut_array_add_value       (Array *ar, const void *value);
+NutState  nut_array_add_value_at    (Array *ar, const void *value, size_t index);
+NutState  nut_array_get_value_at    (Array *ar, size_t index, void *out);
+NutState  nut_array_remove_value_at (Array *ar, size_t index, void *out);
+void      nut_array_sort_values     (Array *ar, int (*cmp) (const void*, const void*));
+void      nut_array_map_values      (Array *ar, void (*fn) (void*));
+void      nut_array_filter_values_mut(Array *ar, bool (*pred) (const void*));
+NutState  nut_array_filter_values   (Array *ar, bool (*pred) (const void*), Array **out);
+size_t    nut_array_element_size    (Array *ar);
+
 
 #define ARRAY_FOREACH(val, array, body)         \
     {                                           \
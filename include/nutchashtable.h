@@ -0,0 +1,93 @@
+#ifndef __NUTCHASHTABLE_H__
+#define __NUTCHASHTABLE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "nutcommon.h"
+#include "nuthashtable.h"
+#include <stdbool.h>
+
+/**
+ * A thread safe unordered key-value map. The buckets of the table are
+ * guarded by a fixed number of lock stripes, so that operations on keys
+ * that fall into different stripes proceed in parallel. The table grows
+ * one bucket at a time while holding only the stripe of that bucket, so a
+ * resize never stalls the whole table.
+ *
+ * The entries are plain TableEntry structures and the keys are hashed with
+ * the HashTable hash functions.
+ */
+typedef struct chashtable_s CHashTable;
+
+/**
+ * CHashTable configuration object. Used to initialize a new CHashTable
+ * with specific values.
+ */
+typedef struct chashtable_conf_s {
+    /**
+     * The load factor determines how the underlying
+     * table array grows. */
+    float    load_factor;
+
+    /**
+     * The initial capacity of the table array. The capacity is never
+     * smaller than the number of stripes. */
+    size_t   initial_capacity;
+
+    /**
+     * The number of lock stripes, rounded up to a power of two. More
+     * stripes mean less contention at the cost of one mutex per stripe. */
+    size_t   stripes;
+
+    /**
+     * Length of the key or -1 if the key length is
+     * variable */
+    int      key_length;
+
+    /**
+     * The hash seed passed to the hash function for
+     * extra 'randomness'.*/
+    uint32_t hash_seed;
+
+    /**
+     * Hash function used for hashing table keys */
+    size_t (*hash)        (const void *key, int l, uint32_t seed);
+
+    /**
+     * The key comparator function */
+    int    (*key_compare) (const void *key1, const void *key2);
+
+    /**
+     * Memory allocators used to allocate the CHashTable structure
+     * and for all internal memory allocations. The allocators must
+     * be thread safe. */
+    void  *(*mem_alloc)   (size_t size);
+    void  *(*mem_calloc)  (size_t blocks, size_t size);
+    void   (*mem_free)    (void *block);
+} CHashTableConf;
+
+
+void      nut_chashtable_conf_init      (CHashTableConf *conf);
+NutState  nut_chashtable_new            (CHashTable **out);
+NutState  nut_chashtable_new_conf       (CHashTableConf const * const conf, CHashTable **out);
+
+void      nut_chashtable_destroy        (CHashTable *table);
+NutState  nut_chashtable_add            (CHashTable *table, void *key, void *val);
+NutState  nut_chashtable_get            (CHashTable *table, void *key, void **out);
+NutState  nut_chashtable_remove         (CHashTable *table, void *key, void **out);
+bool      nut_chashtable_contains_key   (CHashTable *table, void *key);
+
+size_t    nut_chashtable_size           (CHashTable *table);
+size_t    nut_chashtable_capacity       (CHashTable *table);
+
+void      nut_chashtable_foreach        (CHashTable *table, void (*op) (const void *, void *));
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
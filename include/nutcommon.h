@@ -25,10 +25,20 @@
 #define FORCE_INLINE inline __attribute__((always_inline))
 
 
+/* Share counts of the buffers that copy on write containers share between
+ * their copies. The copies may be released from different threads. */
+#define NUT_REF_GET(refs) __atomic_load_n((refs), __ATOMIC_ACQUIRE)
+#define NUT_REF_INC(refs) ((void) __atomic_fetch_add((refs), 1, __ATOMIC_RELAXED))
+#define NUT_REF_DEC(refs) __atomic_sub_fetch((refs), 1, __ATOMIC_ACQ_REL)
+
+
 
 int nut_common_cmp_str(const void *key1, const void *key2);
 int nut_common_cmp_ptr(const void *key1, const void *key2);
 
+size_t nut_common_ptr_count(void * const *buffer, size_t n, const void *ptr);
+size_t nut_common_ptr_find (void * const *buffer, size_t n, const void *ptr);
+
 
 #define NUT_CMP_STRING  nut_common_cmp_str
 #define NUT_CMP_POINTER nut_common_cmp_ptr
@@ -7,7 +7,10 @@ extern "C" {
 
 
 
+/* Define OS_POSIX to build against the host port (pthreads) instead of FreeRTOS */
+#ifndef OS_POSIX
 #define OS_FREERTOS  1
+#endif
 
 
 
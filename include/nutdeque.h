@@ -31,8 +31,24 @@ typedef struct nut_deque_conf_s {
     void *(*mem_alloc)  (size_t size);
     void *(*mem_calloc) (size_t blocks, size_t size);
     void  (*mem_free)   (void *block);
+
+    /**
+     * Optional reallocator for the data buffer, or NULL. With it the buffer
+     * grows and shrinks in place and only the elements that wrap around the
+     * end of the buffer are moved. Without it a new buffer is allocated and
+     * all the elements are copied. */
+    void *(*mem_realloc) (void *block, size_t size);
 } DequeConf;
 
+/**
+ * Memory for a Deque created with nut_deque_new_static(). Its contents are
+ * private; it only gives the structure its size and alignment, so that it
+ * can be placed in static or stack memory.
+ */
+typedef struct nut_deque_static_s {
+    void *reserved[11];
+} DequeStatic;
+
 /**
  * Deque iterator object. Used to iterate over the elements of
  * a deque in an ascending order. The iterator also supports
@@ -67,6 +83,7 @@ typedef struct nut_deque_zip_iter_s {
 
 NutState  nut_deque_new             (Deque **deque);
 NutState  nut_deque_new_conf        (DequeConf const * const conf, Deque **deque);
+NutState  nut_deque_new_static      (void **buffer, size_t capacity, DequeStatic *storage, Deque **out);
 void          nut_deque_conf_init       (DequeConf *conf);
 
 void          nut_deque_destroy         (Deque *deque);
@@ -76,12 +93,15 @@ NutState  nut_deque_add             (Deque *deque, void *element);
 NutState  nut_deque_add_first       (Deque *deque, void *element);
 NutState  nut_deque_add_last        (Deque *deque, void *element);
 NutState  nut_deque_add_at          (Deque *deque, void *element, size_t index);
+NutState  nut_deque_add_all         (Deque *deque, void * const *elements, size_t n);
+NutState  nut_deque_add_all_at      (Deque *deque, void * const *elements, size_t n, size_t index);
 NutState  nut_deque_replace_at      (Deque *deque, void *element, size_t index, void **out);
 
 NutState  nut_deque_remove          (Deque *deque, void *element, void **out);
 NutState  nut_deque_remove_at       (Deque *deque, size_t index, void **out);
 NutState  nut_deque_remove_first    (Deque *deque, void **out);
 NutState  nut_deque_remove_last     (Deque *deque, void **out);
+NutState  nut_deque_remove_range    (Deque *deque, size_t b, size_t e);
 void          nut_deque_remove_all      (Deque *deque);
 void          nut_deque_remove_all_cb   (Deque *deque, void (*cb) (void*));
 
@@ -94,6 +114,7 @@ NutState  nut_deque_copy_deep       (Deque const * const deque, void *(*cp) (voi
 
 void          nut_deque_reverse         (Deque *deque);
 NutState  nut_deque_trim_capacity   (Deque *deque);
+NutState  nut_deque_reserve         (Deque *deque, size_t capacity);
 
 size_t        nut_deque_contains        (Deque const * const deque, const void *element);
 size_t        nut_deque_contains_value  (Deque const * const deque, const void *element, int (*cmp)(const void*, const void*));
@@ -123,6 +144,14 @@ size_t        nut_deque_zip_iter_index  (DequeZipIter *iter);
 
 const void* const* nut_deque_get_buffer (Deque const * const deque);
 
+size_t        nut_deque_peek_spans      (Deque const * const deque, void * const **span1, size_t *n1, void * const **span2, size_t *n2);
+NutState  nut_deque_consume         (Deque *deque, size_t n);
+NutState  nut_deque_reserve_spans   (Deque *deque, size_t n, void ***span1, size_t *n1, void ***span2, size_t *n2);
+NutState  nut_deque_commit          (Deque *deque, size_t n);
+NutState  nut_deque_consume_last    (Deque *deque, size_t n);
+NutState  nut_deque_reserve_spans_first (Deque *deque, size_t n, void ***span1, size_t *n1, void ***span2, size_t *n2);
+NutState  nut_deque_commit_first    (Deque *deque, size_t n);
+
 
 #define DEQUE_FOREACH(val, deque, body)                                 \
     {                                                                   \
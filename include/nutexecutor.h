@@ -0,0 +1,46 @@
+#ifndef __NUTEXECUTOR_H__
+#define __NUTEXECUTOR_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "nutconf.h"
+#include "nutcommon.h"
+
+/**
+ * An executor runs a batch of independent tasks, possibly in parallel. It
+ * is the backend of the parallel bulk operations such as
+ * nut_array_sort_par(). A port can plug in its own executor by filling in
+ * this structure, usually as the first member of a larger one.
+ */
+typedef struct nut_executor_s Executor;
+
+struct nut_executor_s {
+    /**
+     * The number of threads that run tasks, including the thread that
+     * calls run. Used to decide how finely the work is split. */
+    size_t workers;
+
+    /**
+     * Calls task(arg, i) once for every i in [0, tasks) and returns when all
+     * of the calls have returned. The calls may run concurrently and in any
+     * order. A task must not call run on the same executor. */
+    void (*run) (Executor *ex, size_t tasks, void (*task) (void *arg, size_t i), void *arg);
+};
+
+
+Executor *nut_executor_serial       (void);
+
+#ifdef OS_POSIX
+NutState  nut_executor_pool_new     (size_t threads, Executor **out);
+void      nut_executor_pool_destroy (Executor *ex);
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
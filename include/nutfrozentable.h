@@ -0,0 +1,46 @@
+#ifndef __NUTFROZENTABLE_H__
+#define __NUTFROZENTABLE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "nutcommon.h"
+#include "nuthashtable.h"
+#include <stdbool.h>
+
+/**
+ * An immutable key-value map built from a HashTable. The keys are placed
+ * with a minimal perfect hash, so a lookup hashes the key once, reads one
+ * displacement and probes exactly one slot.
+ *
+ * The whole table is a single flat block of memory that contains no
+ * pointers (unless the values themselves are stored as pointers). The block
+ * can be written out with nut_frozentable_data() and used again in place,
+ * for example from flash, with nut_frozentable_from_data(). The block uses
+ * the byte order of the machine that built it.
+ *
+ * Keys are stored and compared by content: either key_length bytes, or
+ * a NUL terminated string if the table was created with
+ * KEY_LENGTH_VARIABLE.
+ */
+typedef struct frozen_table_s FrozenTable;
+
+
+NutState  nut_hashtable_freeze          (HashTable *table, size_t value_size, FrozenTable **out);
+void      nut_frozentable_destroy       (FrozenTable *table);
+
+NutState  nut_frozentable_get           (const FrozenTable *table, const void *key, void **out);
+bool      nut_frozentable_contains_key  (const FrozenTable *table, const void *key);
+size_t    nut_frozentable_size          (const FrozenTable *table);
+
+const void *nut_frozentable_data        (const FrozenTable *table, size_t *size);
+NutState  nut_frozentable_from_data     (const void *data, size_t size, const FrozenTable **out);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
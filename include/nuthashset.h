@@ -13,12 +13,15 @@ extern "C" {
 /**
  * An unordered set. The lookup, deletion, and insertion are
  * performed in amortized constant time and in the worst case
- * in amortized linear time.
+ * in amortized linear time. The elements are stored with their
+ * hashes in a single open addressing array.
  */
 typedef struct nut_hashset_s HashSet;
 
 /**
- * HashSet configuration object.
+ * HashSet configuration object. The set always uses open addressing,
+ * so the layout, rehash_step and slab_entries fields are ignored and
+ * the load factor is capped at 0.875.
  */
 typedef HashTableConf HashSetConf;
 
@@ -26,9 +29,19 @@ typedef HashTableConf HashSetConf;
  * HashSet iterator structure. Used to iterate over the elements
  * of the HashSet. The iterator also supports operations for safely
  * removing elements during iteration.
+ *
+ * @note This structure should only be modified through the iterator functions.
  */
 typedef struct nut_hashset_iter_s {
-    HashTableIter iter;
+    HashSet *set;
+
+    /**
+     * Slot of the last returned element */
+    size_t   index;
+
+    /**
+     * Slot of the next element, or the capacity if there is none */
+    size_t   next;
 } HashSetIter;
 
 void          nut_hashset_conf_init     (HashSetConf *conf);
@@ -47,6 +60,14 @@ size_t        nut_hashset_capacity      (HashSet *set);
 
 void          nut_hashset_foreach       (HashSet *set, void (*op) (const void*));
 
+NutState  nut_hashset_union         (HashSet *set1, HashSet *set2, HashSet **out);
+NutState  nut_hashset_union_mut     (HashSet *set, HashSet *other);
+NutState  nut_hashset_intersection  (HashSet *set1, HashSet *set2, HashSet **out);
+NutState  nut_hashset_intersection_mut(HashSet *set, HashSet *other);
+NutState  nut_hashset_difference    (HashSet *set1, HashSet *set2, HashSet **out);
+void      nut_hashset_difference_mut(HashSet *set, HashSet *other);
+bool      nut_hashset_is_subset     (HashSet *set, HashSet *other);
+
 void          nut_hashset_iter_init     (HashSetIter *iter, HashSet *set);
 NutState  nut_hashset_iter_next     (HashSetIter *iter, void **out);
 NutState  nut_hashset_iter_remove   (HashSetIter *iter, void **out);
@@ -59,6 +59,19 @@ typedef struct hashtable_iter {
     TableEntry *next_entry;
 } HashTableIter;
 
+/**
+ * HashTable storage layout.
+ *
+ * HASHTABLE_CHAINED keeps a bucket array of separately allocated entry
+ * chains. HASHTABLE_OPEN stores the entries inline in a single slot array
+ * and probes it in groups of control bytes, so that an insert does not
+ * allocate and a lookup stays within a few cache lines.
+ */
+typedef enum hashtable_layout_e {
+    HASHTABLE_CHAINED = 0,
+    HASHTABLE_OPEN    = 1
+} HashTableLayout;
+
 /**
  * HashTable configuration object. Used to initialize a new HashTable
  * with specific values.
@@ -85,6 +98,26 @@ typedef struct hashtable_conf_s {
      * extra 'randomness'.*/
     uint32_t hash_seed;
 
+    /**
+     * The storage layout of the table. The open addressing layout
+     * caps the load factor at 0.875. */
+    HashTableLayout layout;
+
+    /**
+     * The number of buckets that are migrated by each add, get and
+     * remove while the chained table is being resized. If 0, the whole
+     * table is rehashed at once when it grows. Otherwise the old and the
+     * new bucket array coexist until the migration is complete, which
+     * bounds the latency of a single operation. */
+    size_t   rehash_step;
+
+    /**
+     * The number of entries allocated at once by the chained table.
+     * Entries are carved out of these slabs and removed entries are
+     * recycled, while the slabs themselves are only freed by
+     * remove_all and destroy. If 0, each entry is allocated on its own. */
+    size_t   slab_entries;
+
     /**
      * Hash function used for hashing table keys */
     size_t (*hash)        (const void *key, int l, uint32_t seed);
@@ -109,12 +142,21 @@ NutState  nut_hashtable_new_conf        (HashTableConf const * const conf, HashT
 void      nut_hashtable_destroy         (HashTable *table);
 NutState  nut_hashtable_add             (HashTable *table, void *key, void *val);
 NutState  nut_hashtable_get             (HashTable *table, void *key, void **out);
+size_t    nut_hashtable_get_batch       (HashTable *table, void **keys, size_t n,
+                                         void **out, NutState *status);
 NutState  nut_hashtable_remove          (HashTable *table, void *key, void **out);
 void      nut_hashtable_remove_all      (HashTable *table);
 bool      nut_hashtable_contains_key    (HashTable *table, void *key);
 
+size_t    nut_hashtable_hash_key        (HashTable *table, const void *key);
+NutState  nut_hashtable_add_hashed      (HashTable *table, void *key, void *val, size_t hash);
+NutState  nut_hashtable_get_hashed      (HashTable *table, void *key, size_t hash, void **out);
+NutState  nut_hashtable_remove_hashed   (HashTable *table, void *key, size_t hash, void **out);
+bool      nut_hashtable_contains_key_hashed(HashTable *table, void *key, size_t hash);
+
 size_t    nut_hashtable_size            (HashTable *table);
 size_t    nut_hashtable_capacity        (HashTable *table);
+int       nut_hashtable_key_length      (HashTable *table);
 
 NutState  nut_hashtable_get_keys        (HashTable *table, Array **out);
 NutState  nut_hashtable_get_values      (HashTable *table, Array **out);
@@ -122,6 +164,8 @@ NutState  nut_hashtable_get_values      (HashTable *table, Array **out);
 size_t    nut_hashtable_hash_string     (const void *key, int len, uint32_t seed);
 size_t    nut_hashtable_hash            (const void *key, int len, uint32_t seed);
 size_t    nut_hashtable_hash_ptr        (const void *key, int len, uint32_t seed);
+size_t    nut_hashtable_hash_wy         (const void *key, int len, uint32_t seed);
+size_t    nut_hashtable_hash_crc32      (const void *key, int len, uint32_t seed);
 
 void      nut_hashtable_foreach_key     (HashTable *table, void (*op) (const void *));
 void      nut_hashtable_foreach_value   (HashTable *table, void (*op) (void *));
@@ -145,6 +189,15 @@ NutState  nut_hashtable_iter_remove     (HashTableIter *iter, void **out);
 #define STRING_HASH  nut_hashtable_hash_string
 #define POINTER_HASH nut_hashtable_hash_ptr
 
+/**
+ * Seeded, length aware hashes. Both accept KEY_LENGTH_VARIABLE for
+ * NUL terminated string keys. The hash does not depend on the byte order,
+ * but it is returned as a size_t, so it is only stable between targets
+ * with the same size_t width; 32-bit targets get the low half of the 64bit
+ * hash. */
+#define FAST_HASH    nut_hashtable_hash_wy
+#define CRC32_HASH   nut_hashtable_hash_crc32
+
 
 #ifdef __cplusplus
 }
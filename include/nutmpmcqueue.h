@@ -0,0 +1,74 @@
+#ifndef __NUTMPMCQUEUE_H__
+#define __NUTMPMCQUEUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "nutcommon.h"
+
+/**
+ * A fixed capacity, lock-free FIFO queue for any number of producers and
+ * consumers. Every slot carries a sequence number that tells whether it is
+ * free for the producer of the current lap or full for its consumer, so a
+ * thread claims a slot with a single compare-and-swap on the shared index
+ * and then owns it without a lock. Producers only contend with producers and
+ * consumers with consumers.
+ *
+ * nut_mpmcqueue_enqueue() and nut_mpmcqueue_poll() never block and behave
+ * like nut_queue_enqueue() and nut_queue_poll(), except that the queue does
+ * not grow. If the queue is created with the blocking option,
+ * nut_mpmcqueue_enqueue_wait() and nut_mpmcqueue_poll_wait() put the caller
+ * to sleep on a port semaphore until there is room or an element. The queue
+ * never allocates after it has been created.
+ *
+ * The target must provide an atomic compare-and-swap on a word.
+ */
+typedef struct nut_mpmcqueue_s MpmcQueue;
+
+/**
+ * MpmcQueue configuration structure. Used to initialize a new MpmcQueue
+ * with specific values.
+ */
+typedef struct nut_mpmcqueue_conf_s {
+    /**
+     * The number of elements the queue can hold. Rounded up to a power of
+     * two. */
+    size_t capacity;
+
+    /**
+     * Whether nut_mpmcqueue_enqueue_wait() and nut_mpmcqueue_poll_wait()
+     * may sleep. Without it they do not wait and the queue needs no
+     * semaphores. */
+    bool   blocking;
+
+    /**
+     * Memory allocators used to allocate the MpmcQueue structure and its
+     * slots. */
+    void *(*mem_alloc)  (size_t size);
+    void *(*mem_calloc) (size_t blocks, size_t size);
+    void  (*mem_free)   (void *block);
+} MpmcQueueConf;
+
+
+void      nut_mpmcqueue_conf_init    (MpmcQueueConf *conf);
+NutState  nut_mpmcqueue_new          (size_t capacity, MpmcQueue **out);
+NutState  nut_mpmcqueue_new_conf     (MpmcQueueConf const * const conf, MpmcQueue **out);
+void      nut_mpmcqueue_destroy      (MpmcQueue *queue);
+
+NutState  nut_mpmcqueue_enqueue      (MpmcQueue *queue, void *element);
+NutState  nut_mpmcqueue_enqueue_wait (MpmcQueue *queue, void *element);
+
+NutState  nut_mpmcqueue_poll         (MpmcQueue *queue, void **out);
+NutState  nut_mpmcqueue_poll_wait    (MpmcQueue *queue, void **out);
+
+size_t    nut_mpmcqueue_size         (MpmcQueue *queue);
+size_t    nut_mpmcqueue_capacity     (MpmcQueue *queue);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
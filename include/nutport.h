@@ -23,9 +23,143 @@ typedef struct _NutAlloc NutAlloc;
 #include "FreeRTOS.h"
 #include "queue.h"
 #include "task.h"
+#include "semphr.h"
 #include "cmsis_os.h"
 #endif
 
+#ifdef OS_POSIX
+#include <pthread.h>
+#endif
+
+
+/**
+ * Mutex used by the thread safe containers. It maps to a FreeRTOS mutex
+ * semaphore or to a pthread mutex on the host port. A FreeRTOS mutex must
+ * not be taken from an interrupt handler.
+ */
+#if defined(OS_FREERTOS)
+
+typedef SemaphoreHandle_t NutMutex;
+
+static inline bool nut_mutex_init(NutMutex *m)
+{
+    *m = xSemaphoreCreateMutex();
+    return *m != NULL;
+}
+
+static inline void nut_mutex_destroy(NutMutex *m)
+{
+    vSemaphoreDelete(*m);
+}
+
+static inline void nut_mutex_lock(NutMutex *m)
+{
+    xSemaphoreTake(*m, portMAX_DELAY);
+}
+
+static inline bool nut_mutex_trylock(NutMutex *m)
+{
+    return xSemaphoreTake(*m, 0) == pdTRUE;
+}
+
+static inline void nut_mutex_unlock(NutMutex *m)
+{
+    xSemaphoreGive(*m);
+}
+
+#elif defined(OS_POSIX)
+
+typedef pthread_mutex_t NutMutex;
+
+static inline bool nut_mutex_init(NutMutex *m)
+{
+    return pthread_mutex_init(m, NULL) == 0;
+}
+
+static inline void nut_mutex_destroy(NutMutex *m)
+{
+    pthread_mutex_destroy(m);
+}
+
+static inline void nut_mutex_lock(NutMutex *m)
+{
+    pthread_mutex_lock(m);
+}
+
+static inline bool nut_mutex_trylock(NutMutex *m)
+{
+    return pthread_mutex_trylock(m) == 0;
+}
+
+static inline void nut_mutex_unlock(NutMutex *m)
+{
+    pthread_mutex_unlock(m);
+}
+
+#endif
+
+
+/**
+ * Counting semaphore used to put the threads of the blocking containers to
+ * sleep. It maps to a FreeRTOS counting semaphore, whose count saturates at
+ * max, or to a POSIX semaphore on the host port.
+ */
+#if defined(OS_FREERTOS)
+
+typedef SemaphoreHandle_t NutSem;
+
+static inline bool nut_sem_init(NutSem *s, unsigned max)
+{
+    *s = xSemaphoreCreateCounting(max, 0);
+    return *s != NULL;
+}
+
+static inline void nut_sem_destroy(NutSem *s)
+{
+    vSemaphoreDelete(*s);
+}
+
+static inline void nut_sem_wait(NutSem *s)
+{
+    xSemaphoreTake(*s, portMAX_DELAY);
+}
+
+static inline void nut_sem_post(NutSem *s)
+{
+    xSemaphoreGive(*s);
+}
+
+#elif defined(OS_POSIX)
+
+#include <semaphore.h>
+#include <errno.h>
+
+typedef sem_t NutSem;
+
+static inline bool nut_sem_init(NutSem *s, unsigned max)
+{
+    (void) max;
+    return sem_init(s, 0, 0) == 0;
+}
+
+static inline void nut_sem_destroy(NutSem *s)
+{
+    sem_destroy(s);
+}
+
+static inline void nut_sem_wait(NutSem *s)
+{
+    while (sem_wait(s) != 0 && errno == EINTR)
+        ;
+}
+
+static inline void nut_sem_post(NutSem *s)
+{
+    sem_post(s);
+}
+
+#endif
+
 
 
 #ifdef __cplusplus
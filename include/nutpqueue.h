@@ -53,6 +53,7 @@ void          nut_pqueue_destroy         (PQueue *pqueue);
 void          nut_pqueue_destroy_cb      (PQueue *pqueue, void (*cb) (void*));
 
 NutState  nut_pqueue_push            (PQueue *pqueue, void *element);
+NutState  nut_pqueue_push_all        (PQueue *pqueue, void * const *elements, size_t n);
 NutState  nut_pqueue_top             (PQueue *pqueue, void **out);
 NutState  nut_pqueue_pop             (PQueue *pqueue, void **out);
 
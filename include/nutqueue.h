@@ -20,6 +20,16 @@ typedef struct nut_queue_s Queue;
  */
 typedef DequeConf QueueConf;
 
+/**
+ * Memory for a Queue created with nut_queue_new_static(). Its contents are
+ * private; it only gives the structure its size and alignment, so that it
+ * can be placed in static or stack memory.
+ */
+typedef struct nut_queue_static_s {
+    DequeStatic deque;
+    void       *reserved[5];
+} QueueStatic;
+
 /**
  * Queue iterator object. Used to iterate over the elements of a
  * queue in an ascending order.
@@ -42,6 +52,7 @@ typedef struct nut_queue_zip_iter_s {
 void         nut_queue_conf_init       (QueueConf *conf);
 NutState nut_queue_new             (Queue **q);
 NutState nut_queue_new_conf        (QueueConf const * const conf, Queue **q);
+NutState nut_queue_new_static      (void **buffer, size_t capacity, QueueStatic *storage, Queue **q);
 void         nut_queue_destroy         (Queue *queue);
 void         nut_queue_destroy_cb      (Queue *queue, void (*cb) (void*));
 
@@ -49,6 +60,11 @@ NutState nut_queue_peek            (Queue const * const queue, void **out);
 NutState nut_queue_poll            (Queue *queue, void **out);
 NutState nut_queue_enqueue         (Queue *queue, void *element);
 
+size_t       nut_queue_peek_spans      (Queue const * const queue, void * const **span1, size_t *n1, void * const **span2, size_t *n2);
+NutState nut_queue_consume         (Queue *queue, size_t n);
+NutState nut_queue_reserve_spans   (Queue *queue, size_t n, void ***span1, size_t *n1, void ***span2, size_t *n2);
+NutState nut_queue_commit          (Queue *queue, size_t n);
+
 size_t       nut_queue_size            (Queue const * const queue);
 void         nut_queue_foreach         (Queue *queue, void (*op) (void*));
 
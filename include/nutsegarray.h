@@ -0,0 +1,122 @@
+#ifndef __NUTSEGARRAY_H__
+#define __NUTSEGARRAY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "nutcommon.h"
+
+/**
+ * A segmented array that stores its elements in fixed size chunks, which
+ * are reached through a small directory of chunk pointers. It offers the
+ * same interface as Array with constant time indexed access, but it grows
+ * by allocating one more chunk instead of reallocating and copying the
+ * whole buffer. Elements are therefore never moved by growth: the address
+ * of a slot stays valid until an insertion or a removal in front of it
+ * shifts the elements, or until its chunk is released by
+ * nut_segarray_trim_capacity().
+ */
+typedef struct nut_segarray_s SegArray;
+
+/**
+ * SegArray configuration structure. Used to initialize a new SegArray
+ * with specific values.
+ */
+typedef struct nut_segarray_conf_s {
+    /**
+     * The number of elements for which chunks are allocated up front */
+    size_t capacity;
+
+    /**
+     * The number of elements per chunk. Rounded up to a power of two. */
+    size_t chunk_size;
+
+    /**
+     * Size of an element in bytes if the SegArray stores its elements by
+     * value, or 0 for a SegArray of void pointers. Value arrays are
+     * accessed through the *_value functions and nut_segarray_get_slot(). */
+    size_t element_size;
+
+    /**
+     * Memory allocators used to allocate the SegArray structure, the
+     * chunk directory and the chunks. */
+    void *(*mem_alloc)  (size_t size);
+    void *(*mem_calloc) (size_t blocks, size_t size);
+    void  (*mem_free)   (void *block);
+} SegArrayConf;
+
+/**
+ * SegArray iterator structure. Used to iterate over the elements of the
+ * array in an ascending order. The iterator also supports operations for
+ * safely adding and removing elements during iteration.
+ */
+typedef struct nut_segarray_iter_s {
+    /**
+     * The array associated with this iterator */
+    SegArray *sa;
+
+    /**
+     * The current position of the iterator.*/
+    size_t    index;
+
+    /**
+     * Set to true if the last returned element was removed. */
+    bool      last_removed;
+} SegArrayIter;
+
+
+void      nut_segarray_conf_init       (SegArrayConf *conf);
+NutState  nut_segarray_new             (SegArray **out);
+NutState  nut_segarray_new_conf        (SegArrayConf const * const conf, SegArray **out);
+
+void      nut_segarray_destroy         (SegArray *sa);
+void      nut_segarray_destroy_cb      (SegArray *sa, void (*cb) (void*));
+
+NutState  nut_segarray_add             (SegArray *sa, void *element);
+NutState  nut_segarray_add_at          (SegArray *sa, void *element, size_t index);
+NutState  nut_segarray_replace_at      (SegArray *sa, void *element, size_t index, void **out);
+NutState  nut_segarray_swap_at         (SegArray *sa, size_t index1, size_t index2);
+
+NutState  nut_segarray_remove          (SegArray *sa, void *element, void **out);
+NutState  nut_segarray_remove_at       (SegArray *sa, size_t index, void **out);
+NutState  nut_segarray_remove_last     (SegArray *sa, void **out);
+void      nut_segarray_remove_all      (SegArray *sa);
+void      nut_segarray_remove_all_free (SegArray *sa);
+
+NutState  nut_segarray_get_at          (SegArray *sa, size_t index, void **out);
+NutState  nut_segarray_get_last        (SegArray *sa, void **out);
+void     *nut_segarray_get_slot        (SegArray *sa, size_t index);
+
+NutState  nut_segarray_trim_capacity   (SegArray *sa);
+NutState  nut_segarray_reserve         (SegArray *sa, size_t capacity);
+
+size_t    nut_segarray_contains        (SegArray *sa, void *element);
+size_t    nut_segarray_size            (SegArray *sa);
+size_t    nut_segarray_capacity        (SegArray *sa);
+NutState  nut_segarray_index_of        (SegArray *sa, void *element, size_t *index);
+
+void      nut_segarray_map             (SegArray *sa, void (*fn) (void*));
+void      nut_segarray_reduce          (SegArray *sa, void (*fn) (void*, void*, void*), void *result);
+
+void      nut_segarray_iter_init       (SegArrayIter *iter, SegArray *sa);
+NutState  nut_segarray_iter_next       (SegArrayIter *iter, void **out);
+NutState  nut_segarray_iter_remove     (SegArrayIter *iter, void **out);
+NutState  nut_segarray_iter_add        (SegArrayIter *iter, void *element);
+NutState  nut_segarray_iter_replace    (SegArrayIter *iter, void *element, void **out);
+size_t    nut_segarray_iter_index      (SegArrayIter *iter);
+
+NutState  nut_segarray_add_value       (SegArray *sa, const void *value);
+NutState  nut_segarray_add_value_at    (SegArray *sa, const void *value, size_t index);
+NutState  nut_segarray_get_value_at    (SegArray *sa, size_t index, void *out);
+NutState  nut_segarray_remove_value_at (SegArray *sa, size_t index, void *out);
+void      nut_segarray_map_values      (SegArray *sa, void (*fn) (void*));
+size_t    nut_segarray_element_size    (SegArray *sa);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef __NUTSORTEDARRAY_H__
+#define __NUTSORTEDARRAY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "nutcommon.h"
+#include "nutarray.h"
+
+/**
+ * An ordered set stored as a sorted Array of elements. Lookups are binary
+ * searches over one contiguous buffer and every element costs a single
+ * pointer, which makes it a compact and cache friendly alternative to a
+ * TreeSet for data that is read much more often than it is modified.
+ *
+ * New elements are appended to the end of the array and merged into the
+ * sorted part in batches, either when the batch is full or before the next
+ * query. Adding an element that is equal to one already in the set
+ * replaces it.
+ */
+typedef struct nut_sorted_array_s SortedArray;
+
+/**
+ * SortedArray configuration structure. Used to initialize a new
+ * SortedArray with specific values.
+ */
+typedef struct nut_sorted_array_conf_s {
+    /**
+     * The initial capacity of the array */
+    size_t capacity;
+
+    /**
+     * The number of added elements that are collected before they are
+     * merged into the sorted part of the array. */
+    size_t batch;
+
+    /**
+     * The element comparator. Receives the elements themselves. */
+    int  (*cmp)        (const void *e1, const void *e2);
+
+    /**
+     * Memory allocators used to allocate the SortedArray structure and
+     * the underlying buffers. */
+    void *(*mem_alloc)  (size_t size);
+    void *(*mem_calloc) (size_t blocks, size_t size);
+    void  (*mem_free)   (void *block);
+} SortedArrayConf;
+
+
+void      nut_sortedarray_conf_init        (SortedArrayConf *conf);
+NutState  nut_sortedarray_new              (int (*cmp) (const void*, const void*), SortedArray **out);
+NutState  nut_sortedarray_new_conf         (SortedArrayConf const * const conf, SortedArray **out);
+
+void      nut_sortedarray_destroy          (SortedArray *sa);
+void      nut_sortedarray_destroy_cb       (SortedArray *sa, void (*cb) (void*));
+
+NutState  nut_sortedarray_add              (SortedArray *sa, void *element);
+NutState  nut_sortedarray_add_all          (SortedArray *sa, Array *elements);
+void      nut_sortedarray_flush            (SortedArray *sa);
+
+NutState  nut_sortedarray_remove           (SortedArray *sa, const void *element, void **out);
+NutState  nut_sortedarray_remove_at        (SortedArray *sa, size_t index, void **out);
+void      nut_sortedarray_remove_all       (SortedArray *sa);
+
+NutState  nut_sortedarray_get              (SortedArray *sa, const void *element, void **out);
+NutState  nut_sortedarray_get_at           (SortedArray *sa, size_t index, void **out);
+NutState  nut_sortedarray_get_first        (SortedArray *sa, void **out);
+NutState  nut_sortedarray_get_last         (SortedArray *sa, void **out);
+NutState  nut_sortedarray_get_greater_than (SortedArray *sa, const void *element, void **out);
+NutState  nut_sortedarray_get_lesser_than  (SortedArray *sa, const void *element, void **out);
+
+NutState  nut_sortedarray_index_of         (SortedArray *sa, const void *element, size_t *index);
+size_t    nut_sortedarray_lower_bound      (SortedArray *sa, const void *element);
+size_t    nut_sortedarray_upper_bound      (SortedArray *sa, const void *element);
+size_t    nut_sortedarray_range            (SortedArray *sa, const void *from, const void *to, size_t *first);
+
+bool      nut_sortedarray_contains         (SortedArray *sa, const void *element);
+size_t    nut_sortedarray_size             (SortedArray *sa);
+
+const void* const* nut_sortedarray_get_buffer(SortedArray *sa);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
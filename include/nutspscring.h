@@ -0,0 +1,65 @@
+#ifndef __NUTSPSCRING_H__
+#define __NUTSPSCRING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "nutcommon.h"
+
+/**
+ * A fixed capacity, lock-free ring buffer for exactly one producer and one
+ * consumer. Like Deque it keeps its elements in a power of two circular
+ * buffer, but the producer only ever writes the tail index and the consumer
+ * only ever writes the head index, so the two sides never block each other
+ * and need no lock or critical section. Either side may run in an interrupt
+ * handler, which makes it suitable for handing data from an ISR to a task.
+ *
+ * Only nut_spscring_enqueue() and nut_spscring_enqueue_all() may be called
+ * by the producer and only nut_spscring_poll(), nut_spscring_poll_all() and
+ * nut_spscring_peek() by the consumer. The ring never allocates after it
+ * has been created.
+ */
+typedef struct nut_spscring_s SpscRing;
+
+/**
+ * SpscRing configuration structure. Used to initialize a new SpscRing
+ * with specific values.
+ */
+typedef struct nut_spscring_conf_s {
+    /**
+     * The number of elements the ring can hold. Rounded up to a power of
+     * two. */
+    size_t capacity;
+
+    /**
+     * Memory allocators used to allocate the SpscRing structure and its
+     * buffer. */
+    void *(*mem_alloc)  (size_t size);
+    void *(*mem_calloc) (size_t blocks, size_t size);
+    void  (*mem_free)   (void *block);
+} SpscRingConf;
+
+
+void      nut_spscring_conf_init   (SpscRingConf *conf);
+NutState  nut_spscring_new         (size_t capacity, SpscRing **out);
+NutState  nut_spscring_new_conf    (SpscRingConf const * const conf, SpscRing **out);
+void      nut_spscring_destroy     (SpscRing *ring);
+
+NutState  nut_spscring_enqueue     (SpscRing *ring, void *element);
+size_t    nut_spscring_enqueue_all (SpscRing *ring, void * const *elements, size_t n);
+
+NutState  nut_spscring_poll        (SpscRing *ring, void **out);
+size_t    nut_spscring_poll_all    (SpscRing *ring, void **out, size_t n);
+NutState  nut_spscring_peek        (SpscRing *ring, void **out);
+
+size_t    nut_spscring_size        (SpscRing *ring);
+size_t    nut_spscring_capacity    (SpscRing *ring);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
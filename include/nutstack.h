@@ -21,6 +21,16 @@ typedef struct nut_stack_s Stack;
  */
 typedef ArrayConf StackConf;
 
+/**
+ * Memory for a Stack created with nut_stack_new_static(). Its contents are
+ * private; it only gives the structure its size and alignment, so that it
+ * can be placed in static or stack memory.
+ */
+typedef struct nut_stack_static_s {
+    ArrayStatic array;
+    void       *reserved[5];
+} StackStatic;
+
 /**
  * Stack iterator structure. Used to iterate over the elements of
  * the Stack in an ascending order. The iterator also supports
@@ -45,6 +55,7 @@ typedef struct nut_stack_zip_iter_s {
 void          nut_stack_conf_init       (StackConf *conf);
 NutState  nut_stack_new             (Stack **out);
 NutState  nut_stack_new_conf        (StackConf const * const conf, Stack **out);
+NutState  nut_stack_new_static      (void **buffer, size_t capacity, StackStatic *storage, Stack **out);
 void          nut_stack_destroy         (Stack *stack);
 void          nut_stack_destroy_cb      (Stack *stack, void (*cb) (void*));
 
@@ -0,0 +1,828 @@
+#ifndef __NUTTEMPLATE_H__
+#define __NUTTEMPLATE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "nutcommon.h"
+#include "nutmem.h"
+
+/*
+ * Type specialized containers generated at compile time.
+ *
+ * The generic containers call their comparator and hash functions through
+ * function pointers, which the compiler cannot inline. The generators in
+ * this header stamp out a copy of the algorithms for a concrete element
+ * type, with the comparator, hash and equality functions pasted in, so that
+ * they are inlined into the sort loops and the probe sequences.
+ *
+ * The cmp, hash and eq arguments may be functions or function-like macros
+ * that take their operands by value:
+ *
+ *   int    cmp  (T a, T b)   < 0, 0 or > 0
+ *   size_t hash (K k)
+ *   bool   eq   (K a, K b)
+ *
+ * @code
+ * NUT_DEFINE_ARRAY(IntArray, int, NUT_CMP_SCALAR)
+ * NUT_DEFINE_HASHTABLE(IntMap, uint32_t, float, NUT_HASH_U32, NUT_EQ_SCALAR)
+ *
+ * IntArray ar;
+ * IntArray_init(&ar, 16);
+ * IntArray_add(&ar, 42);
+ * IntArray_sort(&ar);
+ * IntArray_destroy(&ar);
+ * @endcode
+ *
+ * The generated containers allocate through nut_mem_malloc() and
+ * nut_mem_free() and report errors with the same NutState codes as the
+ * generic ones.
+ */
+
+/* Three way comparison and equality of scalar values */
+#define NUT_CMP_SCALAR(a, b) (((a) > (b)) - ((a) < (b)))
+#define NUT_EQ_SCALAR(a, b)  ((a) == (b))
+
+/* Integer hashes (murmur3 finalizers) */
+#define NUT_HASH_U32(k) ((size_t) nut_template_mix32((uint32_t) (k)))
+#define NUT_HASH_U64(k) ((size_t) nut_template_mix64((uint64_t) (k)))
+#define NUT_HASH_PTR(k) ((size_t) nut_template_mix64((uint64_t) (uintptr_t) (k)))
+
+static INLINE uint32_t nut_template_mix32(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static INLINE uint64_t nut_template_mix64(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+
+/*******************************************************************************
+ *
+ *
+ *  Sort
+ *
+ *
+ ******************************************************************************/
+
+/* Ranges shorter than this are finished with an insertion sort */
+#define NUT_TEMPLATE_INSERTION_SORT 24
+
+/* Ranges longer than this take the pivot from three medians of three */
+#define NUT_TEMPLATE_NINTHER 128
+
+/* Element moves after which a partial insertion sort gives up */
+#define NUT_TEMPLATE_PARTIAL_INSERTION_LIMIT 8
+
+/**
+ * Defines name_sort(Ctx ctx, T *base, size_t n), a pattern-defeating
+ * quicksort of n elements of type T. The comparator is called as
+ * cmp(ctx, a, b), which lets it use state that is only known at run time.
+ *
+ * Sorted, reverse sorted and mostly sorted ranges as well as ranges with
+ * few distinct values are sorted in close to linear time. Ranges that keep
+ * producing bad partitions are finished with a heapsort, so the worst case
+ * is O(n log n). The sort is not stable.
+ */
+#define NUT_DEFINE_SORT_CTX(name, T, Ctx, cmp)                                 \
+                                                                               \
+static INLINE void name##_swap(T *a, T *b)                                     \
+{                                                                              \
+    T tmp = *a;                                                                \
+    *a    = *b;                                                                \
+    *b    = tmp;                                                               \
+}                                                                              \
+                                                                               \
+static INLINE void name##_sort2(Ctx ctx, T *a, T *b)                           \
+{                                                                              \
+    if (cmp(ctx, *b, *a) < 0)                                                  \
+        name##_swap(a, b);                                                     \
+}                                                                              \
+                                                                               \
+static INLINE void name##_sort3(Ctx ctx, T *a, T *b, T *c)                     \
+{                                                                              \
+    name##_sort2(ctx, a, b);                                                   \
+    name##_sort2(ctx, b, c);                                                   \
+    name##_sort2(ctx, a, b);                                                   \
+}                                                                              \
+                                                                               \
+static INLINE void name##_insertion_sort(Ctx ctx, T *a, size_t n)              \
+{                                                                              \
+    size_t i;                                                                  \
+    for (i = 1; i < n; i++) {                                                  \
+        if (cmp(ctx, a[i], a[i - 1]) < 0) {                                    \
+            T      v = a[i];                                                   \
+            size_t j = i;                                                      \
+            do {                                                               \
+                a[j] = a[j - 1];                                               \
+                j--;                                                           \
+            } while (j > 0 && cmp(ctx, v, a[j - 1]) < 0);                      \
+            a[j] = v;                                                          \
+        }                                                                      \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+/* Insertion sort of a range that has an element no greater than any of its    \
+ * elements right before it, so the inner loop needs no bounds check */        \
+static INLINE void name##_unguarded_insertion_sort(Ctx ctx, T *a, size_t n)    \
+{                                                                              \
+    size_t i;                                                                  \
+    for (i = 1; i < n; i++) {                                                  \
+        if (cmp(ctx, a[i], a[i - 1]) < 0) {                                    \
+            T  v = a[i];                                                       \
+            T *p = a + i;                                                      \
+            do {                                                               \
+                *p = *(p - 1);                                                 \
+                p--;                                                           \
+            } while (cmp(ctx, v, *(p - 1)) < 0);                               \
+            *p = v;                                                            \
+        }                                                                      \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+/* Insertion sort that gives up after a few moves. Returns true if the         \
+ * range ends up sorted */                                                     \
+static INLINE bool name##_partial_insertion_sort(Ctx ctx, T *a, size_t n)      \
+{                                                                              \
+    size_t moves = 0;                                                          \
+    size_t i;                                                                  \
+    for (i = 1; i < n; i++) {                                                  \
+        if (moves > NUT_TEMPLATE_PARTIAL_INSERTION_LIMIT)                      \
+            return false;                                                      \
+        if (cmp(ctx, a[i], a[i - 1]) < 0) {                                    \
+            T      v = a[i];                                                   \
+            size_t j = i;                                                      \
+            do {                                                               \
+                a[j] = a[j - 1];                                               \
+                j--;                                                           \
+            } while (j > 0 && cmp(ctx, v, a[j - 1]) < 0);                      \
+            a[j] = v;                                                          \
+            moves += i - j;                                                    \
+        }                                                                      \
+    }                                                                          \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+static INLINE void name##_sift_down(Ctx ctx, T *a, size_t root, size_t n)      \
+{                                                                              \
+    T v = a[root];                                                             \
+    for (;;) {                                                                 \
+        size_t child = 2 * root + 1;                                           \
+        if (child >= n)                                                        \
+            break;                                                             \
+        if (child + 1 < n && cmp(ctx, a[child], a[child + 1]) < 0)             \
+            child++;                                                           \
+        if (cmp(ctx, v, a[child]) >= 0)                                        \
+            break;                                                             \
+        a[root] = a[child];                                                    \
+        root    = child;                                                       \
+    }                                                                          \
+    a[root] = v;                                                               \
+}                                                                              \
+                                                                               \
+static INLINE void name##_heap_sort(Ctx ctx, T *a, size_t n)                   \
+{                                                                              \
+    size_t i;                                                                  \
+    for (i = n / 2; i > 0; i--)                                                \
+        name##_sift_down(ctx, a, i - 1, n);                                    \
+    for (i = n; i > 1; i--) {                                                  \
+        name##_swap(&a[0], &a[i - 1]);                                         \
+        name##_sift_down(ctx, a, 0, i - 1);                                    \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+/* Partitions around the pivot a[0], putting the elements equal to the         \
+ * pivot to the right. Returns the final position of the pivot and sets        \
+ * *partitioned if no element had to be moved */                               \
+static INLINE size_t name##_partition_right(Ctx ctx, T *a, size_t n,           \
+                                            bool *partitioned)                 \
+{                                                                              \
+    T      pivot = a[0];                                                       \
+    size_t first = 0;                                                          \
+    size_t last  = n;                                                          \
+                                                                               \
+    while (cmp(ctx, a[++first], pivot) < 0)                                    \
+        ;                                                                      \
+    if (first == 1) {                                                          \
+        while (first < last && !(cmp(ctx, a[--last], pivot) < 0))              \
+            ;                                                                  \
+    } else {                                                                   \
+        while (!(cmp(ctx, a[--last], pivot) < 0))                              \
+            ;                                                                  \
+    }                                                                          \
+    *partitioned = first >= last;                                              \
+                                                                               \
+    while (first < last) {                                                     \
+        name##_swap(&a[first], &a[last]);                                      \
+        while (cmp(ctx, a[++first], pivot) < 0)                                \
+            ;                                                                  \
+        while (!(cmp(ctx, a[--last], pivot) < 0))                              \
+            ;                                                                  \
+    }                                                                          \
+    a[0]         = a[first - 1];                                               \
+    a[first - 1] = pivot;                                                      \
+    return first - 1;                                                          \
+}                                                                              \
+                                                                               \
+/* Partitions around the pivot a[0], putting the elements equal to the         \
+ * pivot to the left. Used when the pivot equals the element before the        \
+ * range, in which case everything that goes left is equal to it */            \
+static INLINE size_t name##_partition_left(Ctx ctx, T *a, size_t n)            \
+{                                                                              \
+    T      pivot = a[0];                                                       \
+    size_t first = 0;                                                          \
+    size_t last  = n;                                                          \
+                                                                               \
+    while (cmp(ctx, pivot, a[--last]) < 0)                                     \
+        ;                                                                      \
+    if (last + 1 == n) {                                                       \
+        while (first < last && !(cmp(ctx, pivot, a[++first]) < 0))             \
+            ;                                                                  \
+    } else {                                                                   \
+        while (!(cmp(ctx, pivot, a[++first]) < 0))                             \
+            ;                                                                  \
+    }                                                                          \
+                                                                               \
+    while (first < last) {                                                     \
+        name##_swap(&a[first], &a[last]);                                      \
+        while (cmp(ctx, pivot, a[--last]) < 0)                                 \
+            ;                                                                  \
+        while (!(cmp(ctx, pivot, a[++first]) < 0))                             \
+            ;                                                                  \
+    }                                                                          \
+    a[0]    = a[last];                                                         \
+    a[last] = pivot;                                                           \
+    return last;                                                               \
+}                                                                              \
+                                                                               \
+static void name##_pdqsort_loop(Ctx ctx, T *a, size_t n,                       \
+                                unsigned bad_allowed, bool leftmost)           \
+{                                                                              \
+    for (;;) {                                                                 \
+        if (n < NUT_TEMPLATE_INSERTION_SORT) {                                 \
+            if (leftmost)                                                      \
+                name##_insertion_sort(ctx, a, n);                              \
+            else                                                               \
+                name##_unguarded_insertion_sort(ctx, a, n);                    \
+            return;                                                            \
+        }                                                                      \
+                                                                               \
+        /* Move the pivot to a[0], the median of three or of the               \
+         * medians of three for larger ranges */                               \
+        size_t s2 = n / 2;                                                     \
+        if (n > NUT_TEMPLATE_NINTHER) {                                        \
+            name##_sort3(ctx, &a[0], &a[s2], &a[n - 1]);                       \
+            name##_sort3(ctx, &a[1], &a[s2 - 1], &a[n - 2]);                   \
+            name##_sort3(ctx, &a[2], &a[s2 + 1], &a[n - 3]);                   \
+            name##_sort3(ctx, &a[s2 - 1], &a[s2], &a[s2 + 1]);                 \
+            name##_swap(&a[0], &a[s2]);                                        \
+        } else {                                                               \
+            name##_sort3(ctx, &a[s2], &a[0], &a[n - 1]);                       \
+        }                                                                      \
+                                                                               \
+        /* A pivot equal to the element before the range means the range       \
+         * has many equal elements. Put them all left and skip them */         \
+        if (!leftmost && !(cmp(ctx, a[-1], a[0]) < 0)) {                       \
+            size_t p = name##_partition_left(ctx, a, n);                       \
+            a += p + 1;                                                        \
+            n -= p + 1;                                                        \
+            continue;                                                          \
+        }                                                                      \
+                                                                               \
+        bool   partitioned;                                                    \
+        size_t p      = name##_partition_right(ctx, a, n, &partitioned);       \
+        size_t l_size = p;                                                     \
+        size_t r_size = n - p - 1;                                             \
+                                                                               \
+        if (l_size < n / 8 || r_size < n / 8) {                                \
+            /* Bad partition. Give up after too many of them, otherwise        \
+             * shuffle a few elements to break the pattern */                  \
+            if (--bad_allowed == 0) {                                          \
+                name##_heap_sort(ctx, a, n);                                   \
+                return;                                                        \
+            }                                                                  \
+            if (l_size >= NUT_TEMPLATE_INSERTION_SORT) {                       \
+                name##_swap(&a[0], &a[l_size / 4]);                            \
+                name##_swap(&a[p - 1], &a[p - l_size / 4]);                    \
+                if (l_size > NUT_TEMPLATE_NINTHER) {                           \
+                    name##_swap(&a[1], &a[l_size / 4 + 1]);                    \
+                    name##_swap(&a[2], &a[l_size / 4 + 2]);                    \
+                    name##_swap(&a[p - 2], &a[p - (l_size / 4 + 1)]);          \
+                    name##_swap(&a[p - 3], &a[p - (l_size / 4 + 2)]);          \
+                }                                                              \
+            }                                                                  \
+            if (r_size >= NUT_TEMPLATE_INSERTION_SORT) {                       \
+                name##_swap(&a[p + 1], &a[p + 1 + r_size / 4]);                \
+                name##_swap(&a[n - 1], &a[n - r_size / 4]);                    \
+                if (r_size > NUT_TEMPLATE_NINTHER) {                           \
+                    name##_swap(&a[p + 2], &a[p + 2 + r_size / 4]);            \
+                    name##_swap(&a[p + 3], &a[p + 3 + r_size / 4]);            \
+                    name##_swap(&a[n - 2], &a[n - (1 + r_size / 4)]);          \
+                    name##_swap(&a[n - 3], &a[n - (2 + r_size / 4)]);          \
+                }                                                              \
+            }                                                                  \
+        } else if (partitioned                                                 \
+                   && name##_partial_insertion_sort(ctx, a, l_size)            \
+                   && name##_partial_insertion_sort(ctx, a + p + 1, r_size)) { \
+            /* The range was already (close to) sorted */                      \
+            return;                                                            \
+        }                                                                      \
+                                                                               \
+        name##_pdqsort_loop(ctx, a, l_size, bad_allowed, leftmost);            \
+        a       += p + 1;                                                      \
+        n        = r_size;                                                     \
+        leftmost = false;                                                      \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static INLINE void name##_sort(Ctx ctx, T *a, size_t n)                        \
+{                                                                              \
+    unsigned log = 1;                                                          \
+    size_t   m;                                                                \
+    for (m = n; m > 1; m >>= 1)                                                \
+        log++;                                                                 \
+    name##_pdqsort_loop(ctx, a, n, log, true);                                 \
+}
+
+/**
+ * Defines name_sort(T *base, size_t n), the same sort with a comparator
+ * that is called as cmp(a, b).
+ */
+#define NUT_DEFINE_SORT(name, T, cmp)                                          \
+                                                                               \
+static INLINE int name##_cmp_ctx(void *ctx, T a, T b)                          \
+{                                                                              \
+    (void) ctx;                                                                \
+    return cmp(a, b);                                                          \
+}                                                                              \
+                                                                               \
+NUT_DEFINE_SORT_CTX(name##_ctx, T, void*, name##_cmp_ctx)                      \
+                                                                               \
+static INLINE void name##_sort(T *a, size_t n)                                 \
+{                                                                              \
+    name##_ctx_sort(NULL, a, n);                                               \
+}
+
+
+/*******************************************************************************
+ *
+ *
+ *  Array
+ *
+ *
+ ******************************************************************************/
+
+/* Capacity an array grows to from none, the same as the default of Array */
+#define NUT_TEMPLATE_INITIAL_CAPACITY 8
+
+/*
+ * The functions shared by the array generators. The including generator
+ * defines the struct and name_on_heap(), which tells whether buffer was
+ * allocated by the array and is to be freed with it.
+ */
+#define NUT_TEMPLATE_ARRAY_OPS(name, T, cmp)                                   \
+                                                                               \
+NUT_DEFINE_SORT(name##_elements, T, cmp)                                       \
+                                                                               \
+static INLINE void name##_destroy(name *ar)                                    \
+{                                                                              \
+    if (name##_on_heap(ar))                                                    \
+        nut_mem_free(ar->buffer);                                              \
+    ar->buffer   = NULL;                                                       \
+    ar->size     = 0;                                                          \
+    ar->capacity = 0;                                                          \
+}                                                                              \
+                                                                               \
+static NutState name##_reserve(name *ar, size_t capacity)                      \
+{                                                                              \
+    if (capacity <= ar->capacity)                                              \
+        return NUT_OK;                                                         \
+    if (capacity > NUT_MAX_ELEMENTS / sizeof(T))                               \
+        return NUT_ERR_MAX_CAPACITY;                                           \
+    T *buff = (T*) nut_mem_malloc(capacity * sizeof(T));                       \
+    if (!buff)                                                                 \
+        return NUT_ERR_MALLOC;                                                 \
+    if (ar->size)                                                              \
+        memcpy(buff, ar->buffer, ar->size * sizeof(T));                        \
+    if (name##_on_heap(ar))                                                    \
+        nut_mem_free(ar->buffer);                                              \
+    ar->buffer   = buff;                                                       \
+    ar->capacity = capacity;                                                   \
+    return NUT_OK;                                                             \
+}                                                                              \
+                                                                               \
+/* A destroyed array has no capacity and starts over from a small one */       \
+static INLINE NutState name##_grow(name *ar)                                   \
+{                                                                              \
+    size_t capacity = ar->capacity ? ar->capacity * 2                          \
+                                   : NUT_TEMPLATE_INITIAL_CAPACITY;            \
+    if (capacity <= ar->capacity || capacity > NUT_MAX_ELEMENTS / sizeof(T))   \
+        capacity = NUT_MAX_ELEMENTS / sizeof(T);                               \
+    if (capacity == ar->capacity)                                              \
+        return NUT_ERR_MAX_CAPACITY;                                           \
+    return name##_reserve(ar, capacity);                                       \
+}                                                                              \
+                                                                               \
+static INLINE NutState name##_add(name *ar, T element)                         \
+{                                                                              \
+    if (ar->size >= ar->capacity) {                                            \
+        NutState status = name##_grow(ar);                                     \
+        if (status != NUT_OK)                                                  \
+            return status;                                                     \
+    }                                                                          \
+    ar->buffer[ar->size++] = element;                                          \
+    return NUT_OK;                                                             \
+}                                                                              \
+                                                                               \
+static INLINE NutState name##_add_at(name *ar, T element, size_t index)        \
+{                                                                              \
+    if (index > ar->size)                                                      \
+        return NUT_ERR_OUT_RANGE;                                              \
+    if (ar->size >= ar->capacity) {                                            \
+        NutState status = name##_grow(ar);                                     \
+        if (status != NUT_OK)                                                  \
+            return status;                                                     \
+    }                                                                          \
+    memmove(&ar->buffer[index + 1], &ar->buffer[index],                        \
+            (ar->size - index) * sizeof(T));                                   \
+    ar->buffer[index] = element;                                               \
+    ar->size++;                                                                \
+    return NUT_OK;                                                             \
+}                                                                              \
+                                                                               \
+static INLINE NutState name##_get_at(name *ar, size_t index, T *out)           \
+{                                                                              \
+    if (index >= ar->size)                                                     \
+        return NUT_ERR_OUT_RANGE;                                              \
+    *out = ar->buffer[index];                                                  \
+    return NUT_OK;                                                             \
+}                                                                              \
+                                                                               \
+static INLINE NutState name##_remove_at(name *ar, size_t index, T *out)        \
+{                                                                              \
+    if (index >= ar->size)                                                     \
+        return NUT_ERR_OUT_RANGE;                                              \
+    if (out)                                                                   \
+        *out = ar->buffer[index];                                              \
+    memmove(&ar->buffer[index], &ar->buffer[index + 1],                        \
+            (ar->size - index - 1) * sizeof(T));                               \
+    ar->size--;                                                                \
+    return NUT_OK;                                                             \
+}                                                                              \
+                                                                               \
+static INLINE NutState name##_index_of(name *ar, T element, size_t *index)     \
+{                                                                              \
+    size_t i;                                                                  \
+    for (i = 0; i < ar->size; i++) {                                           \
+        if (cmp(ar->buffer[i], element) == 0) {                                \
+            *index = i;                                                        \
+            return NUT_OK;                                                     \
+        }                                                                      \
+    }                                                                          \
+    return NUT_ERR_OUT_RANGE;                                                  \
+}                                                                              \
+                                                                               \
+static INLINE size_t name##_contains(name *ar, T element)                      \
+{                                                                              \
+    size_t o = 0;                                                              \
+    size_t i;                                                                  \
+    for (i = 0; i < ar->size; i++)                                             \
+        o += cmp(ar->buffer[i], element) == 0;                                 \
+    return o;                                                                  \
+}                                                                              \
+                                                                               \
+static INLINE size_t name##_size(name *ar)                                     \
+{                                                                              \
+    return ar->size;                                                           \
+}                                                                              \
+                                                                               \
+static INLINE void name##_sort(name *ar)                                       \
+{                                                                              \
+    name##_elements_sort(ar->buffer, ar->size);                                \
+}
+
+
+/**
+ * Defines the struct type name, a dynamic array of elements of type T that
+ * stores its elements by value, together with its functions:
+ *
+ *   NutState name_init      (name *ar, size_t capacity)
+ *   void     name_destroy   (name *ar)
+ *   NutState name_reserve   (name *ar, size_t capacity)
+ *   NutState name_add       (name *ar, T element)
+ *   NutState name_add_at    (name *ar, T element, size_t index)
+ *   NutState name_get_at    (name *ar, size_t index, T *out)
+ *   NutState name_remove_at (name *ar, size_t index, T *out)
+ *   NutState name_index_of  (name *ar, T element, size_t *index)
+ *   size_t   name_contains  (name *ar, T element)
+ *   size_t   name_size      (name *ar)
+ *   void     name_sort      (name *ar)
+ *
+ * The array grows by doubling, the same way as Array with its default
+ * expansion factor. A destroyed array is empty and can be added to again.
+ */
+#define NUT_DEFINE_ARRAY(name, T, cmp)                                         \
+                                                                               \
+typedef struct name##_s {                                                      \
+    size_t  size;                                                              \
+    size_t  capacity;                                                          \
+    T      *buffer;                                                            \
+} name;                                                                        \
+                                                                               \
+static INLINE bool name##_on_heap(name *ar)                                    \
+{                                                                              \
+    (void) ar;                                                                 \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+static INLINE NutState name##_init(name *ar, size_t capacity)                  \
+{                                                                              \
+    if (capacity == 0)                                                         \
+        capacity = 1;                                                          \
+    if (capacity > NUT_MAX_ELEMENTS / sizeof(T))                               \
+        return NUT_ERR_INVALID_CAPACITY;                                       \
+    ar->buffer = (T*) nut_mem_malloc(capacity * sizeof(T));                    \
+    if (!ar->buffer)                                                           \
+        return NUT_ERR_MALLOC;                                                 \
+    ar->size     = 0;                                                          \
+    ar->capacity = capacity;                                                   \
+    return NUT_OK;                                                             \
+}                                                                              \
+                                                                               \
+NUT_TEMPLATE_ARRAY_OPS(name, T, cmp)
+
+/**
+ * Defines the struct type name, a dynamic array of elements of type T like
+ * the one of NUT_DEFINE_ARRAY, that keeps its first N elements in a buffer
+ * embedded in the struct. Nothing is allocated until the array outgrows
+ * the embedded buffer, at which point the elements move to the heap, so a
+ * small array declared on the stack or inside another struct costs no
+ * allocation at all and its elements share the cache lines of its header.
+ *
+ * The functions are the same as those of NUT_DEFINE_ARRAY, except that the
+ * initializer takes no capacity:
+ *
+ *   void     name_init      (name *ar)
+ *
+ * While the elements are embedded, buffer points into the struct itself,
+ * so an initialized array must not be copied or moved by value.
+ *
+ * @code
+ * NUT_DEFINE_SMALL_ARRAY(PtrArray8, void*, 8, NUT_CMP_SCALAR)
+ *
+ * PtrArray8 ar;
+ * PtrArray8_init(&ar);
+ * PtrArray8_add(&ar, p);
+ * PtrArray8_destroy(&ar);
+ * @endcode
+ */
+#define NUT_DEFINE_SMALL_ARRAY(name, T, N, cmp)                                \
+                                                                               \
+typedef struct name##_s {                                                      \
+    size_t  size;                                                              \
+    size_t  capacity;                                                          \
+    T      *buffer;                                                            \
+    T       small[N];                                                          \
+} name;                                                                        \
+                                                                               \
+static INLINE bool name##_on_heap(name *ar)                                    \
+{                                                                              \
+    return ar->buffer != ar->small;                                            \
+}                                                                              \
+                                                                               \
+static INLINE void name##_init(name *ar)                                       \
+{                                                                              \
+    ar->buffer   = ar->small;                                                  \
+    ar->size     = 0;                                                          \
+    ar->capacity = N;                                                          \
+}                                                                              \
+                                                                               \
+NUT_TEMPLATE_ARRAY_OPS(name, T, cmp)
+
+
+/*******************************************************************************
+ *
+ *
+ *  HashTable
+ *
+ *
+ ******************************************************************************/
+
+/**
+ * Defines the struct type name, a hash table that maps keys of type K to
+ * values of type V, together with its functions:
+ *
+ *   NutState name_init      (name *t, size_t capacity)
+ *   void     name_destroy   (name *t)
+ *   NutState name_add       (name *t, K key, V val)
+ *   NutState name_get       (name *t, K key, V *out)
+ *   NutState name_remove    (name *t, K key, V *out)
+ *   bool     name_contains  (name *t, K key)
+ *   size_t   name_size      (name *t)
+ *   NutState name_iter_next (name *t, size_t *pos, K *key, V *val)
+ *
+ * The table uses linear probing over a power of two slot array that is
+ * kept at most three quarters full. Every slot has a control byte that is
+ * either 0 for an empty slot or the top bit and 7 bits of the hash, which
+ * rejects most mismatching slots without calling eq. Removal shifts the
+ * following entries back instead of leaving tombstones.
+ *
+ * Iteration starts with *pos set to 0 and ends when name_iter_next()
+ * returns NUT_ITER_END.
+ */
+#define NUT_DEFINE_HASHTABLE(name, K, V, hash, eq)                             \
+                                                                               \
+typedef struct name##_slot_s {                                                 \
+    K key;                                                                     \
+    V value;                                                                   \
+} name##_slot;                                                                 \
+                                                                               \
+typedef struct name##_s {                                                      \
+    size_t       size;                                                         \
+    size_t       capacity;                                                     \
+    uint8_t     *ctrl;                                                         \
+    name##_slot *slots;                                                        \
+} name;                                                                        \
+                                                                               \
+/* Bits 25..31 of the hash folded to 32 bits, so a 32-bit hash such as        \
+ * NUT_HASH_U32 spreads over all tags and the tag stays apart from the low     \
+ * bits that select the slot */                                                \
+static INLINE uint8_t name##_tag(size_t h)                                     \
+{                                                                              \
+    uint32_t f = (uint32_t) h ^ (uint32_t) (h >> 16 >> 16);                    \
+    return (uint8_t) (0x80 | (f >> 25));                                       \
+}                                                                              \
+                                                                               \
+static INLINE NutState name##_alloc(name *t, size_t capacity)                  \
+{                                                                              \
+    t->ctrl  = (uint8_t*) nut_mem_malloc(capacity);                            \
+    t->slots = (name##_slot*) nut_mem_malloc(capacity * sizeof(name##_slot));  \
+    if (!t->ctrl || !t->slots) {                                               \
+        nut_mem_free(t->ctrl);                                                 \
+        nut_mem_free(t->slots);                                                \
+        return NUT_ERR_MALLOC;                                                 \
+    }                                                                          \
+    memset(t->ctrl, 0, capacity);                                              \
+    t->capacity = capacity;                                                    \
+    t->size     = 0;                                                           \
+    return NUT_OK;                                                             \
+}                                                                              \
+                                                                               \
+static INLINE NutState name##_init(name *t, size_t capacity)                   \
+{                                                                              \
+    size_t c = 8;                                                              \
+    while (c < capacity && c < MAX_POW_TWO)                                    \
+        c <<= 1;                                                               \
+    return name##_alloc(t, c);                                                 \
+}                                                                              \
+                                                                               \
+static INLINE void name##_destroy(name *t)                                     \
+{                                                                              \
+    nut_mem_free(t->ctrl);                                                     \
+    nut_mem_free(t->slots);                                                    \
+    t->ctrl     = NULL;                                                        \
+    t->slots    = NULL;                                                        \
+    t->size     = 0;                                                           \
+    t->capacity = 0;                                                           \
+}                                                                              \
+                                                                               \
+/* Returns the slot of the key, or the empty slot where it would go */         \
+static INLINE size_t name##_probe(name *t, K key, size_t h)                    \
+{                                                                              \
+    const size_t  mask = t->capacity - 1;                                      \
+    const uint8_t tag  = name##_tag(h);                                        \
+    size_t        i    = h & mask;                                             \
+    while (t->ctrl[i]) {                                                       \
+        if (t->ctrl[i] == tag && eq(t->slots[i].key, key))                     \
+            return i;                                                          \
+        i = (i + 1) & mask;                                                    \
+    }                                                                          \
+    return i;                                                                  \
+}                                                                              \
+                                                                               \
+static NutState name##_resize(name *t, size_t capacity)                        \
+{                                                                              \
+    name   old = *t;                                                           \
+    size_t i;                                                                  \
+    if (name##_alloc(t, capacity) != NUT_OK) {                                 \
+        *t = old;                                                              \
+        return NUT_ERR_MALLOC;                                                 \
+    }                                                                          \
+    for (i = 0; i < old.capacity; i++) {                                       \
+        if (!old.ctrl[i])                                                      \
+            continue;                                                          \
+        size_t j = hash(old.slots[i].key) & (capacity - 1);                    \
+        while (t->ctrl[j])                                                     \
+            j = (j + 1) & (capacity - 1);                                      \
+        t->ctrl[j]  = old.ctrl[i];                                             \
+        t->slots[j] = old.slots[i];                                            \
+    }                                                                          \
+    t->size = old.size;                                                        \
+    nut_mem_free(old.ctrl);                                                    \
+    nut_mem_free(old.slots);                                                   \
+    return NUT_OK;                                                             \
+}                                                                              \
+                                                                               \
+static INLINE NutState name##_add(name *t, K key, V val)                       \
+{                                                                              \
+    size_t h = hash(key);                                                      \
+    size_t i = name##_probe(t, key, h);                                        \
+    if (t->ctrl[i]) {                                                          \
+        t->slots[i].value = val;                                               \
+        return NUT_OK;                                                         \
+    }                                                                          \
+    if ((t->size + 1) * 4 > t->capacity * 3) {                                 \
+        if (t->capacity >= MAX_POW_TWO)                                        \
+            return NUT_ERR_MAX_CAPACITY;                                       \
+        NutState status = name##_resize(t, t->capacity << 1);                  \
+        if (status != NUT_OK)                                                  \
+            return status;                                                     \
+        i = name##_probe(t, key, h);                                           \
+    }                                                                          \
+    t->ctrl[i]        = name##_tag(h);                                         \
+    t->slots[i].key   = key;                                                   \
+    t->slots[i].value = val;                                                   \
+    t->size++;                                                                 \
+    return NUT_OK;                                                             \
+}                                                                              \
+                                                                               \
+static INLINE NutState name##_get(name *t, K key, V *out)                      \
+{                                                                              \
+    size_t i = name##_probe(t, key, hash(key));                                \
+    if (!t->ctrl[i])                                                           \
+        return NUT_ERR_KEY_NOT_FOUND;                                          \
+    *out = t->slots[i].value;                                                  \
+    return NUT_OK;                                                             \
+}                                                                              \
+                                                                               \
+static INLINE bool name##_contains(name *t, K key)                             \
+{                                                                              \
+    return t->ctrl[name##_probe(t, key, hash(key))] != 0;                      \
+}                                                                              \
+                                                                               \
+static INLINE NutState name##_remove(name *t, K key, V *out)                   \
+{                                                                              \
+    const size_t mask = t->capacity - 1;                                       \
+    size_t       i    = name##_probe(t, key, hash(key));                       \
+    size_t       j    = i;                                                     \
+    if (!t->ctrl[i])                                                           \
+        return NUT_ERR_KEY_NOT_FOUND;                                          \
+    if (out)                                                                   \
+        *out = t->slots[i].value;                                              \
+    /* Shift back the entries whose probe sequence passes through i */        \
+    for (;;) {                                                                 \
+        j = (j + 1) & mask;                                                    \
+        if (!t->ctrl[j])                                                       \
+            break;                                                             \
+        size_t home = hash(t->slots[j].key) & mask;                            \
+        if (((j - home) & mask) >= ((j - i) & mask)) {                         \
+            t->ctrl[i]  = t->ctrl[j];                                          \
+            t->slots[i] = t->slots[j];                                         \
+            i = j;                                                             \
+        }                                                                      \
+    }                                                                          \
+    t->ctrl[i] = 0;                                                            \
+    t->size--;                                                                 \
+    return NUT_OK;                                                             \
+}                                                                              \
+                                                                               \
+static INLINE size_t name##_size(name *t)                                      \
+{                                                                              \
+    return t->size;                                                            \
+}                                                                              \
+                                                                               \
+static INLINE NutState name##_iter_next(name *t, size_t *pos, K *key, V *val)  \
+{                                                                              \
+    size_t i;                                                                  \
+    for (i = *pos; i < t->capacity; i++) {                                     \
+        if (t->ctrl[i]) {                                                      \
+            *key = t->slots[i].key;                                            \
+            *val = t->slots[i].value;                                          \
+            *pos = i + 1;                                                      \
+            return NUT_OK;                                                     \
+        }                                                                      \
+    }                                                                          \
+    *pos = t->capacity;                                                        \
+    return NUT_ITER_END;                                                       \
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
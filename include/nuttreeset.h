@@ -50,6 +50,14 @@ size_t        nut_treeset_size             (TreeSet *set);
 
 void          nut_treeset_foreach          (TreeSet *set, void (*op) (const void*));
 
+NutState  nut_treeset_union            (TreeSet *set1, TreeSet *set2, TreeSet **out);
+NutState  nut_treeset_union_mut        (TreeSet *set, TreeSet *other);
+NutState  nut_treeset_intersection     (TreeSet *set1, TreeSet *set2, TreeSet **out);
+void      nut_treeset_intersection_mut (TreeSet *set, TreeSet *other);
+NutState  nut_treeset_difference       (TreeSet *set1, TreeSet *set2, TreeSet **out);
+void      nut_treeset_difference_mut   (TreeSet *set, TreeSet *other);
+bool      nut_treeset_is_subset        (TreeSet *set, TreeSet *other);
+
 void          nut_treeset_iter_init        (TreeSetIter *iter, TreeSet *set);
 NutState  nut_treeset_iter_next        (TreeSetIter *iter, void **element);
 NutState  nut_treeset_iter_remove      (TreeSetIter *iter, void **out);
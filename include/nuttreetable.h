@@ -84,6 +84,7 @@ NutState  nut_treetable_new_conf         (TreeTableConf const * const conf, Tree
 
 void          nut_treetable_destroy          (TreeTable *table);
 NutState  nut_treetable_add              (TreeTable *table, void *key, void *val);
+NutState  nut_treetable_add_sorted       (TreeTable *table, TreeTableEntry const *entries, size_t n);
 
 NutState  nut_treetable_remove           (TreeTable *table, void *key, void **out);
 void          nut_treetable_remove_all       (TreeTable *table);
@@ -2,6 +2,8 @@
 #include "nutport.h"
 #include "nutmem.h"
 #include "nutarray.h"
+#include "nuttemplate.h"
+#include "nutexecutor.h"
 
 #define DEFAULT_CAPACITY 8
 #define DEFAULT_EXPANSION_FACTOR 2
@@ -10,16 +12,95 @@ struct nut_array_s {
     size_t   size;
     size_t   capacity;
     float    exp_factor;
+
+    /* Size of an element in bytes. Pointer arrays store void* elements,
+     * value arrays store the elements themselves. */
+    size_t   elem_size;
     void   **buffer;
 
-    /*
+    /* Share count of the buffer while it is shared with the copies made by
+     * nut_array_copy_shallow(), or NULL while the array owns it alone */
+    size_t  *refs;
+
+    /* Set if the structure and the buffer are the caller's memory, given to
+     * nut_array_new_static(). Such an array never grows or frees either. */
+    bool     fixed;
+
     void *(*mem_alloc)  (size_t size);
     void *(*mem_calloc) (size_t blocks, size_t size);
     void  (*mem_free)   (void *block);
-     */
 };
 
+_Static_assert(sizeof(Array) <= sizeof(ArrayStatic), "ArrayStatic is too small");
+
+/* Address of the element at index i */
+#define ELEM(ar, i) ((uint8_t*) (ar)->buffer + (size_t) (i) * (ar)->elem_size)
+
 static NutState expand_capacity(Array *ar);
+static NutState ensure_capacity(Array *ar, size_t n);
+static NutState array_new_like (Array *ar, size_t capacity, Array **out);
+static NutState array_unshare  (Array *ar);
+static void     array_release  (Array *ar);
+static void     swap_bytes     (uint8_t *a, uint8_t *b, size_t n);
+
+/* Radix sort digits are one byte wide */
+#define RADIX_BITS    8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_DIGITS  sizeof(uint64_t)
+
+/* An element together with its extracted sort key */
+typedef struct radix_pair_s {
+    uint64_t  key;
+    void     *e;
+} RadixPair;
+
+static NutState radix_pairs_new (Array *ar, RadixPair **out);
+static void     radix_sort      (Array *ar, RadixPair *pairs, size_t key_bytes);
+
+/* nut_array_sort() on the pointer buffer. The comparator gets pointers to
+ * the elements, the same as with qsort(). */
+typedef int (*ArrayCmp) (const void*, const void*);
+
+#define ARRAY_PTR_CMP(cmp, a, b) (cmp)(&(a), &(b))
+
+NUT_DEFINE_SORT_CTX(array_ptr, void*, ArrayCmp, ARRAY_PTR_CMP)
+
+/* Smallest number of elements that is worth a parallel task */
+#define PAR_MIN_CHUNK 4096
+
+/* State shared by the tasks of a parallel operation */
+typedef struct par_job_s {
+    Array   *ar;
+    size_t   chunks;
+
+    /* sort */
+    ArrayCmp cmp;
+    void   **src;
+    void   **dst;
+    size_t   width;
+
+    /* map, reduce and filter */
+    void   (*map)    (void*);
+    void   (*reduce) (void*, void*, void*);
+    bool   (*pred)   (const void*);
+    uint8_t *partial;
+    size_t   partial_size;
+    size_t   step;
+    uint8_t *keep;
+    size_t  *count;
+    Array   *out;
+} ParJob;
+
+static size_t   par_chunks      (Executor *ex, size_t n);
+static size_t   par_bound       (size_t n, size_t chunks, size_t i);
+static void     par_sort_task   (void *job, size_t i);
+static void     par_merge_task  (void *job, size_t i);
+static size_t   par_corank      (ArrayCmp cmp, size_t d, void **a, size_t m, void **b, size_t l);
+static void     par_map_task    (void *job, size_t i);
+static void     par_reduce_task (void *job, size_t i);
+static void     par_combine_task(void *job, size_t i);
+static void     par_count_task  (void *job, size_t i);
+static void     par_gather_task (void *job, size_t i);
 
 
 /**
@@ -64,31 +145,74 @@ NutState nut_array_new_conf(ArrayConf const * const conf, Array **out)
     else
         ex = conf->exp_factor;
 
+    size_t elem_size = conf->element_size ? conf->element_size : sizeof(void*);
+
     /* Needed to avoid an integer overflow on the first resize and
      * to easily check for any future overflows. */
-    if (!conf->capacity || ex >= NUT_MAX_ELEMENTS / conf->capacity)
+    if (!conf->capacity || ex >= (NUT_MAX_ELEMENTS / elem_size) / conf->capacity)
         return NUT_ERR_INVALID_CAPACITY;
 
-    Array *ar = nut_mem_calloc(1, sizeof(Array));
+    Array *ar = conf->mem_calloc(1, sizeof(Array));
 
     if (!ar)
         return NUT_ERR_MALLOC;
 
-    void **buff = nut_mem_alloc(conf->capacity * sizeof(void*));
+    void **buff = conf->mem_alloc(conf->capacity * elem_size);
 
     if (!buff) {
         conf->mem_free(ar);
         return NUT_ERR_MALLOC;
     }
 
+    ar->size       = 0;
     ar->buffer     = buff;
     ar->exp_factor = ex;
- /*
+    ar->elem_size  = elem_size;
     ar->capacity   = conf->capacity;
     ar->mem_alloc  = conf->mem_alloc;
     ar->mem_calloc = conf->mem_calloc;
     ar->mem_free   = conf->mem_free;
-*/
+
+    *out = ar;
+    return NUT_OK;
+}
+
+/**
+ * Creates a new empty pointer Array in caller supplied memory and returns a
+ * status code. Neither the structure nor the buffer is allocated, and the
+ * Array never grows: an addition that does not fit returns
+ * NUT_ERR_MAX_CAPACITY. The memory must outlive the Array, and
+ * nut_array_destroy() only detaches the Array from it.
+ *
+ * Copies, subarrays and filtered arrays made from the Array are ordinary
+ * Arrays on the default allocators.
+ *
+ * @param[in] buffer the buffer of capacity pointers that holds the elements
+ * @param[in] capacity the number of elements the buffer can hold
+ * @param[in] storage the memory in which the Array structure is placed
+ * @param[out] out pointer to where the newly created Array is to be stored
+ *
+ * @return NUT_OK if the creation was successful, or NUT_ERR_INVALID_CAPACITY
+ * if the capacity is 0 or too large.
+ */
+NutState nut_array_new_static(void **buffer, size_t capacity, ArrayStatic *storage, Array **out)
+{
+    if (!capacity || capacity > NUT_MAX_ELEMENTS / sizeof(void*))
+        return NUT_ERR_INVALID_CAPACITY;
+
+    Array *ar = (Array*) storage;
+
+    ar->size       = 0;
+    ar->buffer     = buffer;
+    ar->refs       = NULL;
+    ar->fixed      = true;
+    ar->exp_factor = DEFAULT_EXPANSION_FACTOR;
+    ar->elem_size  = sizeof(void*);
+    ar->capacity   = capacity;
+    ar->mem_alloc  = &nut_mem_malloc;
+    ar->mem_calloc = &nut_mem_calloc;
+    ar->mem_free   = &nut_mem_free;
+
     *out = ar;
     return NUT_OK;
 }
@@ -100,11 +224,12 @@ NutState nut_array_new_conf(ArrayConf const * const conf, Array **out)
  */
 void nut_array_conf_init(ArrayConf *conf)
 {
-    conf->exp_factor = DEFAULT_EXPANSION_FACTOR;
-    conf->capacity   = DEFAULT_CAPACITY;
-    conf->mem_alloc  = &nut_mem_malloc;
-    conf->mem_calloc = &nut_mem_calloc;
-    conf->mem_free   = &nut_mem_free;
+    conf->exp_factor   = DEFAULT_EXPANSION_FACTOR;
+    conf->capacity     = DEFAULT_CAPACITY;
+    conf->element_size = 0;
+    conf->mem_alloc    = &nut_mem_malloc;
+    conf->mem_calloc   = &nut_mem_calloc;
+    conf->mem_free     = &nut_mem_free;
 }
 
 /**
@@ -114,8 +239,11 @@ void nut_array_conf_init(ArrayConf *conf)
  */
 void nut_array_destroy(Array *ar)
 {
-    nut_mem_free(ar->buffer);
-    nut_mem_free(ar);
+    if (ar->fixed)
+        return;
+
+    array_release(ar);
+    ar->mem_free(ar);
 }
 
 /**
@@ -155,6 +283,9 @@ NutState nut_array_add(Array *ar, void *element)
             return status;
     }
 
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
     ar->buffer[ar->size] = element;
     ar->size++;
 
@@ -191,6 +322,9 @@ NutState nut_array_add_at(Array *ar, void *element, size_t index)
             return status;
     }
 
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
     size_t shift = (ar->size - index) * sizeof(void*);
 
     memmove(&(ar->buffer[index + 1]),
@@ -203,6 +337,65 @@ NutState nut_array_add_at(Array *ar, void *element, size_t index)
     return NUT_OK;
 }
 
+/**
+ * Appends n elements to the end of the Array with a single copy. The
+ * elements are laid out the same way as in the buffer of the Array: n
+ * pointers for a pointer array, or n values of element_size bytes for a
+ * value array. The capacity is grown at most once.
+ *
+ * @param[in] ar the array to which the elements are being added
+ * @param[in] elements the elements that are being added
+ * @param[in] n the number of elements
+ *
+ * @return NUT_OK if the elements were successfully added, NUT_ERR_MALLOC if
+ * the memory allocation for the new buffer failed, or NUT_ERR_MAX_CAPACITY
+ * if the array would exceed its maximum capacity.
+ */
+NutState nut_array_add_all(Array *ar, const void *elements, size_t n)
+{
+    return nut_array_add_all_at(ar, elements, n, ar->size);
+}
+
+/**
+ * Inserts n elements into the Array at the specified position by shifting
+ * all subsequent elements by n. The elements are laid out the same way as
+ * in the buffer of the Array. The index may be equal to the size of the
+ * Array, in which case the elements are appended.
+ *
+ * @param[in] ar the array to which the elements are being added
+ * @param[in] elements the elements that are being added
+ * @param[in] n the number of elements
+ * @param[in] index the position in the array at which the first element is
+ *                  being added
+ *
+ * @return NUT_OK if the elements were successfully added, NUT_ERR_OUT_RANGE
+ * if the index was out of range, NUT_ERR_MALLOC if the memory allocation for
+ * the new buffer failed, or NUT_ERR_MAX_CAPACITY if the array would exceed
+ * its maximum capacity.
+ */
+NutState nut_array_add_all_at(Array *ar, const void *elements, size_t n, size_t index)
+{
+    if (index > ar->size)
+        return NUT_ERR_OUT_RANGE;
+
+    NutState status = ensure_capacity(ar, n);
+
+    if (status != NUT_OK)
+        return status;
+
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    memmove(ELEM(ar, index + n),
+            ELEM(ar, index),
+            (ar->size - index) * ar->elem_size);
+
+    memcpy(ELEM(ar, index), elements, n * ar->elem_size);
+    ar->size += n;
+
+    return NUT_OK;
+}
+
 /**
  * Replaces an array element at the specified index and optionally sets the out
  * parameter to the value of the replaced element. The specified index must be
@@ -222,6 +415,9 @@ NutState nut_array_replace_at(Array *ar, void *element, size_t index, void **out
     if (index >= ar->size)
         return NUT_ERR_OUT_RANGE;
 
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
     if (out)
         *out = ar->buffer[index];
 
@@ -230,14 +426,28 @@ NutState nut_array_replace_at(Array *ar, void *element, size_t index, void **out
     return NUT_OK;
 }
 
+/**
+ * Swaps the elements at the specified indices. Both indices must be within
+ * the bounds of the Array.
+ *
+ * @param[in] ar the array whose elements are being swapped
+ * @param[in] index1 index of the first element
+ * @param[in] index2 index of the second element
+ *
+ * @return NUT_OK if the elements were swapped, or NUT_ERR_OUT_RANGE if one
+ * of the indices was out of range.
+ */
 NutState nut_array_swap_at(Array *ar, size_t index1, size_t index2)
 {
-    void *tmp;
-    if(index1 >= ar->size || index2 >= ar->size)
+    if (index1 >= ar->size || index2 >= ar->size)
         return NUT_ERR_OUT_RANGE;
-    tmp = ar->buffer[index1];
-    ar->buffer[index1] = ar->buffer[index2];
-    ar->buffer[index2] = tmp;
+
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    if (index1 != index2)
+        swap_bytes(ELEM(ar, index1), ELEM(ar, index2), ar->elem_size);
+
     return NUT_OK;
 }
 
@@ -261,8 +471,11 @@ NutState nut_array_remove(Array *ar, void *element, void **out)
     if (status == NUT_ERR_OUT_RANGE)
         return NUT_ERR_NOT_FIND;
 
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
     if (index != ar->size - 1) {
-        size_t block_size = (ar->size - index) * sizeof(void*);
+        size_t block_size = (ar->size - index - 1) * sizeof(void*);
 
         memmove(&(ar->buffer[index]),
                 &(ar->buffer[index + 1]),
@@ -294,11 +507,14 @@ NutState nut_array_remove_at(Array *ar, size_t index, void **out)
     if (index >= ar->size)
         return NUT_ERR_OUT_RANGE;
 
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
     if (out)
         *out = ar->buffer[index];
 
     if (index != ar->size - 1) {
-        size_t block_size = (ar->size - index) * sizeof(void*);
+        size_t block_size = (ar->size - index - 1) * sizeof(void*);
 
         memmove(&(ar->buffer[index]),
                 &(ar->buffer[index + 1]),
@@ -325,6 +541,36 @@ NutState nut_array_remove_last(Array *ar, void **out)
     return nut_array_remove_at(ar, ar->size - 1, out);
 }
 
+/**
+ * Removes the elements in the range from index <code>b</code> (inclusive) to
+ * index <code>e</code> (inclusive) by shifting all subsequent elements
+ * down with a single move. The elements themselves are not freed.
+ *
+ * @param[in] ar the array from which the elements are being removed
+ * @param[in] b the beginning index (inclusive) of the range
+ * @param[in] e the end index (inclusive) of the range that must be within
+ *              the bounds of the array and must be greater or equal to the
+ *              beginning index
+ *
+ * @return NUT_OK if the elements were removed, or NUT_ERR_INVALID_RANGE if
+ * the specified index range is invalid.
+ */
+NutState nut_array_remove_range(Array *ar, size_t b, size_t e)
+{
+    if (b > e || e >= ar->size)
+        return NUT_ERR_INVALID_RANGE;
+
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    memmove(ELEM(ar, b),
+            ELEM(ar, e + 1),
+            (ar->size - e - 1) * ar->elem_size);
+
+    ar->size -= e - b + 1;
+    return NUT_OK;
+}
+
 /**
  * Removes all elements from the specified array. This function does not shrink
  * the array capacity.
@@ -346,7 +592,7 @@ void nut_array_remove_all_free(Array *ar)
 {
     size_t i;
     for (i = 0; i < ar->size; i++)
-        nut_mem_free(ar->buffer[i]);
+        ar->mem_free(ar->buffer[i]);
 
     nut_array_remove_all(ar);
 }
@@ -416,14 +662,13 @@ const void * const* nut_array_get_buffer(Array *ar)
  */
 NutState nut_array_index_of(Array *ar, void *element, size_t *index)
 {
-    size_t i;
-    for (i = 0; i < ar->size; i++) {
-        if (ar->buffer[i] == element) {
-            *index = i;
-            return NUT_OK;
-        }
-    }
-    return NUT_ERR_OUT_RANGE;
+    size_t i = nut_common_ptr_find(ar->buffer, ar->size, element);
+
+    if (i == ar->size)
+        return NUT_ERR_OUT_RANGE;
+
+    *index = i;
+    return NUT_OK;
 }
 
 /**
@@ -453,27 +698,17 @@ NutState nut_array_subarray(Array *ar, size_t b, size_t e, Array **out)
     if (b > e || e >= ar->size)
         return NUT_ERR_INVALID_RANGE;
 
-    Array *sub_ar = nut_mem_calloc(1, sizeof(Array));
+    Array   *sub_ar;
+    NutState status = array_new_like(ar, e - b + 1, &sub_ar);
 
-    if (!sub_ar)
-        return NUT_ERR_MALLOC;
+    if (status != NUT_OK)
+        return status;
 
-    /* Try to allocate the buffer */
-    if (!(sub_ar->buffer = nut_mem_alloc(ar->capacity * sizeof(void*)))) {
-        nut_mem_free(sub_ar);
-        return NUT_ERR_MALLOC;
-    }
-/*
-    sub_ar->mem_alloc  = ar->mem_alloc;
-    sub_ar->mem_calloc = ar->mem_calloc;
-    sub_ar->mem_free   = ar->mem_free;
-    */
-    sub_ar->size       = e - b + 1;
-    sub_ar->capacity   = sub_ar->size;
+    sub_ar->size = e - b + 1;
 
     memcpy(sub_ar->buffer,
-           &(ar->buffer[b]),
-           sub_ar->size * sizeof(void*));
+           ELEM(ar, b),
+           sub_ar->size * ar->elem_size);
 
     *out = sub_ar;
     return NUT_OK;
@@ -483,8 +718,16 @@ NutState nut_array_subarray(Array *ar, size_t b, size_t e, Array **out)
  * Creates a shallow copy of the specified Array. A shallow copy is a copy of
  * the Array structure, but not the elements it holds.
  *
+ * The copy shares the buffer of the original Array, so it is created in
+ * constant time. The buffer is copied only once either Array is modified
+ * while the other one still holds it, by the first modifying call. A
+ * modifying call that returns no status leaves its Array unchanged if that
+ * copy cannot be allocated. The share count is updated atomically, so a
+ * copy may be read and destroyed in another thread than the original.
+ *
  * @note The new Array is allocated using the original Array's allocators
- *       and it also inherits the configuration of the original array.
+ *       and it also inherits the configuration of the original array. The
+ *       copy of an Array in caller memory gets its own buffer right away.
  *
  * @param[in] ar the array to be copied
  * @param[out] out pointer to where the newly created copy is stored
@@ -494,28 +737,33 @@ NutState nut_array_subarray(Array *ar, size_t b, size_t e, Array **out)
  */
 NutState nut_array_copy_shallow(Array *ar, Array **out)
 {
-    Array *copy = nut_mem_alloc(sizeof(Array));
+    /* The caller's buffer cannot be shared past the life of the array */
+    if (ar->fixed) {
+        NutState status = array_new_like(ar, ar->capacity, out);
+
+        if (status == NUT_OK) {
+            memcpy((*out)->buffer, ar->buffer, ar->size * ar->elem_size);
+            (*out)->size = ar->size;
+        }
+        return status;
+    }
+
+    Array *copy = ar->mem_alloc(sizeof(Array));
 
     if (!copy)
         return NUT_ERR_MALLOC;
 
-    if (!(copy->buffer = nut_mem_calloc(ar->capacity, sizeof(void*)))) {
-        nut_mem_free(copy);
-        return NUT_ERR_MALLOC;
+    if (!ar->refs) {
+        if (!(ar->refs = ar->mem_alloc(sizeof(size_t)))) {
+            ar->mem_free(copy);
+            return NUT_ERR_MALLOC;
+        }
+        *ar->refs = 1;
     }
-    copy->exp_factor = ar->exp_factor;
-    copy->size       = ar->size;
-    copy->capacity   = ar->capacity;
-    /*
-    copy->mem_alloc  = ar->mem_alloc;
-    copy->mem_calloc = ar->mem_calloc;
-    copy->mem_free   = ar->mem_free;
-*/
-    memcpy(copy->buffer,
-           ar->buffer,
-           copy->size * sizeof(void*));
+    NUT_REF_INC(ar->refs);
 
-    *out = copy;
+    *copy = *ar;
+    *out  = copy;
     return NUT_OK;
 }
 
@@ -536,24 +784,14 @@ NutState nut_array_copy_shallow(Array *ar, Array **out)
  */
 NutState nut_array_copy_deep(Array *ar, void *(*cp) (void *), Array **out)
 {
-    Array *copy = nut_mem_alloc(sizeof(Array));
+    Array   *copy;
+    NutState status = array_new_like(ar, ar->capacity, &copy);
 
-    if (!copy)
-        return NUT_ERR_MALLOC;
+    if (status != NUT_OK)
+        return status;
 
-    if (!(copy->buffer = nut_mem_calloc(ar->capacity, sizeof(void*)))) {
-        nut_mem_free(copy);
-        return NUT_ERR_MALLOC;
-    }
+    copy->size = ar->size;
 
-    copy->exp_factor = ar->exp_factor;
-    copy->size       = ar->size;
-    copy->capacity   = ar->capacity;
-    /*
-    copy->mem_alloc  = ar->mem_alloc;
-    copy->mem_calloc = ar->mem_calloc;
-    copy->mem_free   = ar->mem_free;
-*/
     size_t i;
     for (i = 0; i < copy->size; i++)
         copy->buffer[i] = cp(ar->buffer[i]);
@@ -579,6 +817,9 @@ NutState nut_array_filter_mut(Array *ar, bool (*pred) (const void*))
     if (ar->size == 0)
         return NUT_ERR_OUT_RANGE;
 
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
     size_t rm   = 0;
     size_t keep = 0;
 
@@ -632,24 +873,12 @@ NutState nut_array_filter(Array *ar, bool (*pred) (const void*), Array **out)
     if (ar->size == 0)
         return NUT_ERR_OUT_RANGE;
 
-    Array *filtered = nut_mem_alloc(sizeof(Array));
+    Array   *filtered;
+    NutState status = array_new_like(ar, ar->capacity, &filtered);
 
-    if (!filtered)
-        return NUT_ERR_MALLOC;
-
-    if (!(filtered->buffer = nut_mem_calloc(ar->capacity, sizeof(void*)))) {
-        nut_mem_free(filtered);
-        return NUT_ERR_MALLOC;
-    }
+    if (status != NUT_OK)
+        return status;
 
-    filtered->exp_factor = ar->exp_factor;
-    filtered->size       = 0;
-    filtered->capacity   = ar->capacity;
-/*
-    filtered->mem_alloc  = ar->mem_alloc;
-    filtered->mem_calloc = ar->mem_calloc;
-    filtered->mem_free   = ar->mem_free;
-*/
     size_t f = 0;
     for (size_t i = 0; i < ar->size; i++) {
         if (pred(ar->buffer[i])) {
@@ -669,19 +898,22 @@ NutState nut_array_filter(Array *ar, bool (*pred) (const void*), Array **out)
  */
 void nut_array_reverse(Array *ar)
 {
+    if (ar->size < 2)
+        return;
+
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return;
+
     size_t i;
     size_t j;
-    for (i = 0, j = ar->size - 1; i < (ar->size - 1) / 2; i++, j--) {
-        void *tmp = ar->buffer[i];
-        ar->buffer[i] = ar->buffer[j];
-        ar->buffer[j] = tmp;
-    }
+    for (i = 0, j = ar->size - 1; i < j; i++, j--)
+        swap_bytes(ELEM(ar, i), ELEM(ar, j), ar->elem_size);
 }
 
 /**
  * Trims the array's capacity, in other words, it shrinks the capacity to match
  * the number of elements in the Array, however the capacity will never shrink
- * below 1.
+ * below 1. An Array in caller memory is left as it is.
  *
  * @param[in] ar array whose capacity is being trimmed
  *
@@ -690,21 +922,55 @@ void nut_array_reverse(Array *ar)
  */
 NutState nut_array_trim_capacity(Array *ar)
 {
-    if (ar->size == ar->capacity)
+    size_t size = ar->size < 1 ? 1 : ar->size;
+
+    if (size == ar->capacity || ar->fixed)
         return NUT_OK;
 
-    void **new_buff = nut_mem_calloc(ar->size, sizeof(void*));
+    void **new_buff = ar->mem_alloc(size * ar->elem_size);
 
     if (!new_buff)
         return NUT_ERR_MALLOC;
 
-    size_t size = ar->size < 1 ? 1 : ar->size;
+    memcpy(new_buff, ar->buffer, ar->size * ar->elem_size);
+    array_release(ar);
+
+    ar->buffer   = new_buff;
+    ar->capacity = size;
+
+    return NUT_OK;
+}
+
+/**
+ * Makes sure that the Array can hold at least capacity elements without
+ * expanding, so that a known number of additions costs at most one
+ * allocation. The capacity is never reduced.
+ *
+ * @param[in] ar the array whose capacity is being reserved
+ * @param[in] capacity the number of elements the array must be able to hold
+ *
+ * @return NUT_OK if the capacity was reserved, NUT_ERR_MALLOC if the memory
+ * allocation for the new buffer failed, or NUT_ERR_MAX_CAPACITY if the
+ * capacity exceeds the maximum capacity or the Array cannot grow.
+ */
+NutState nut_array_reserve(Array *ar, size_t capacity)
+{
+    if (capacity <= ar->capacity)
+        return NUT_OK;
+
+    if (capacity > NUT_MAX_ELEMENTS / ar->elem_size || ar->fixed)
+        return NUT_ERR_MAX_CAPACITY;
+
+    void **new_buff = ar->mem_alloc(capacity * ar->elem_size);
+
+    if (!new_buff)
+        return NUT_ERR_MALLOC;
 
-    memcpy(new_buff, ar->buffer, size * sizeof(void*));
-    nut_mem_free(ar->buffer);
+    memcpy(new_buff, ar->buffer, ar->size * ar->elem_size);
+    array_release(ar);
 
     ar->buffer   = new_buff;
-    ar->capacity = ar->size;
+    ar->capacity = capacity;
 
     return NUT_OK;
 }
@@ -719,7 +985,7 @@ NutState nut_array_trim_capacity(Array *ar)
  */
 size_t nut_array_contains(Array *ar, void *element)
 {
-    return nut_array_contains_value(ar, element, nut_common_cmp_ptr);
+    return nut_common_ptr_count(ar->buffer, ar->size, element);
 }
 
 /**
@@ -802,83 +1068,979 @@ size_t nut_array_capacity(Array *ar)
  */
 void nut_array_sort(Array *ar, int (*cmp) (const void*, const void*))
 {
-    qsort(ar->buffer, ar->size, sizeof(void*), cmp);
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return;
+
+    array_ptr_sort(cmp, ar->buffer, ar->size);
 }
 
 /**
- * Expands the Array capacity. This might fail if the the new buffer
- * cannot be allocated. In case the expansion would overflow the index
- * range, a maximum capacity buffer is allocated instead. If the capacity
- * is already at the maximum capacity, no new buffer is allocated.
+ * Sorts the elements of the Array in ascending order of a 32 bit key with
+ * an LSD radix sort. The key of each element is extracted exactly once and
+ * the sort then moves (key, element) pairs, so the elements themselves are
+ * never dereferenced while sorting. The sort is stable.
  *
- * @param[in] ar array whose capacity is being expanded
+ * The key function receives a pointer to the element within the buffer,
+ * the same as the comparator of nut_array_sort(), so for a pointer array
+ * it is a pointer to a (void*). Signed keys sort correctly if the key
+ * function flips their sign bit.
  *
- * @return NUT_OK if the buffer was expanded successfully, NUT_ERR_MALLOC if
- * the memory allocation for the new buffer failed, or CC_ERR_MAX_CAPACITY
- * if the array is already at maximum capacity.
+ * @code
+ * uint32_t mykey(const void *e) {
+ *     return (*((const MyType**) e))->id;
+ * }
+ *
+ * ...
+ *
+ * nut_array_sort_radix32(array, mykey);
+ * @endcode
+ *
+ * @param[in] ar  array to be sorted
+ * @param[in] key the key extractor function
+ *
+ * @return NUT_OK if the array was sorted, or NUT_ERR_MALLOC if the memory
+ * allocation for the temporary buffers failed, in which case the array is
+ * left unchanged.
  */
-static NutState expand_capacity(Array *ar)
+NutState nut_array_sort_radix32(Array *ar, uint32_t (*key) (const void *e))
 {
-    if (ar->capacity == NUT_MAX_ELEMENTS)
-        return NUT_ERR_MAX_CAPACITY;
-
-    size_t new_capacity = ar->capacity * ar->exp_factor;
-
-    /* As long as the capacity is greater that the expansion factor
-     * at the point of overflow, this is check is valid. */
-    if (new_capacity <= ar->capacity)
-        ar->capacity = NUT_MAX_ELEMENTS;
-    else
-        ar->capacity = new_capacity;
+    RadixPair *pairs;
 
-    void **new_buff = nut_mem_alloc(new_capacity * sizeof(void*));
+    if (ar->size < 2)
+        return NUT_OK;
 
-    if (!new_buff)
+    if (ar->refs && array_unshare(ar) != NUT_OK)
         return NUT_ERR_MALLOC;
 
-    memcpy(new_buff, ar->buffer, ar->size * sizeof(void*));
+    NutState status = radix_pairs_new(ar, &pairs);
+
+    if (status != NUT_OK)
+        return status;
 
-    nut_mem_free(ar->buffer);
-    ar->buffer = new_buff;
+    size_t i;
+    for (i = 0; i < ar->size; i++)
+        pairs[i].key = key(pairs[i].e);
 
+    radix_sort(ar, pairs, sizeof(uint32_t));
     return NUT_OK;
 }
 
 /**
- * Applies the function fn to each element of the Array.
+ * Sorts the elements of the Array in ascending order of a 64 bit key with
+ * an LSD radix sort. Works the same way as nut_array_sort_radix32().
  *
- * @param[in] ar array on which this operation is performed
- * @param[in] fn operation function that is to be invoked on each Array
- *               element
+ * @param[in] ar  array to be sorted
+ * @param[in] key the key extractor function
+ *
+ * @return NUT_OK if the array was sorted, or NUT_ERR_MALLOC if the memory
+ * allocation for the temporary buffers failed, in which case the array is
+ * left unchanged.
  */
-void nut_array_map(Array *ar, void (*fn) (void *e))
+NutState nut_array_sort_radix64(Array *ar, uint64_t (*key) (const void *e))
 {
+    RadixPair *pairs;
+
+    if (ar->size < 2)
+        return NUT_OK;
+
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    NutState status = radix_pairs_new(ar, &pairs);
+
+    if (status != NUT_OK)
+        return status;
+
     size_t i;
     for (i = 0; i < ar->size; i++)
-        fn(ar->buffer[i]);
+        pairs[i].key = key(pairs[i].e);
+
+    radix_sort(ar, pairs, sizeof(uint64_t));
+    return NUT_OK;
 }
 
 /**
- * A fold/reduce function that collects all of the elements in the array
- * together. For example, if we have an array of [a,b,c...] the end result
- * will be (...((a+b)+c)+...).
+ * Appends a copy of the value to the Array. The value must point to
+ * element_size bytes, or to a pointer if this is a pointer array.
  *
- * @param[in] ar the array on which this operation is performed
- * @param[in] fn the operation function that is to be invoked on each array
- *               element
- * @param[in] result the pointer which will collect the end result
+ * @param[in] ar the array to which the value is being added
+ * @param[in] value pointer to the value that is being copied into the array
+ *
+ * @return NUT_OK if the value was successfully added, NUT_ERR_MALLOC if the
+ * memory allocation for the new buffer failed, or NUT_ERR_MAX_CAPACITY if the
+ * array is already at maximum capacity.
  */
-void nut_array_reduce(Array *ar, void (*fn) (void*, void*, void*), void *result)
+NutState nut_array_add_value(Array *ar, const void *value)
 {
-    if (ar->size == 1) {
-        fn(ar->buffer[0], NULL, result);
-        return;
+    if (ar->size >= ar->capacity) {
+        NutState status = expand_capacity(ar);
+        if (status != NUT_OK)
+            return status;
     }
-    if (ar->size > 1)
-        fn(ar->buffer[0], ar->buffer[1], result);
 
-    for (size_t i = 2; i < ar->size; i++)
-        fn(result, ar->buffer[i], result);
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    memcpy(ELEM(ar, ar->size), value, ar->elem_size);
+    ar->size++;
+
+    return NUT_OK;
+}
+
+/**
+ * Inserts a copy of the value at the specified position by shifting all
+ * subsequent elements by one. The index may be equal to the size of the
+ * Array, in which case the value is appended.
+ *
+ * @param[in] ar the array to which the value is being added
+ * @param[in] value pointer to the value that is being copied into the array
+ * @param[in] index the position at which the value is being added
+ *
+ * @return NUT_OK if the value was successfully added, NUT_ERR_OUT_RANGE if
+ * the index was out of range, NUT_ERR_MALLOC if the memory allocation for the
+ * new buffer failed, or NUT_ERR_MAX_CAPACITY if the array is already at
+ * maximum capacity.
+ */
+NutState nut_array_add_value_at(Array *ar, const void *value, size_t index)
+{
+    if (index > ar->size)
+        return NUT_ERR_OUT_RANGE;
+
+    if (ar->size >= ar->capacity) {
+        NutState status = expand_capacity(ar);
+        if (status != NUT_OK)
+            return status;
+    }
+
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    memmove(ELEM(ar, index + 1),
+            ELEM(ar, index),
+            (ar->size - index) * ar->elem_size);
+
+    memcpy(ELEM(ar, index), value, ar->elem_size);
+    ar->size++;
+
+    return NUT_OK;
+}
+
+/**
+ * Copies the element at the specified index into the memory pointed to by
+ * out.
+ *
+ * @param[in] ar the array from which the element is being copied
+ * @param[in] index the index of the element
+ * @param[out] out pointer to element_size bytes where the element is copied
+ *
+ * @return NUT_OK if the element was found, or NUT_ERR_OUT_RANGE if the index
+ * was out of range.
+ */
+NutState nut_array_get_value_at(Array *ar, size_t index, void *out)
+{
+    if (index >= ar->size)
+        return NUT_ERR_OUT_RANGE;
+
+    memcpy(out, ELEM(ar, index), ar->elem_size);
+    return NUT_OK;
+}
+
+/**
+ * Removes the element at the specified index and optionally copies it into
+ * the memory pointed to by out.
+ *
+ * @param[in] ar the array from which the element is being removed
+ * @param[in] index the index of the element being removed
+ * @param[out] out pointer to element_size bytes where the removed element is
+ *                 copied, or NULL if it is to be ignored
+ *
+ * @return NUT_OK if the element was successfully removed, or NUT_ERR_OUT_RANGE
+ * if the index was out of range.
+ */
+NutState nut_array_remove_value_at(Array *ar, size_t index, void *out)
+{
+    if (index >= ar->size)
+        return NUT_ERR_OUT_RANGE;
+
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    if (out)
+        memcpy(out, ELEM(ar, index), ar->elem_size);
+
+    memmove(ELEM(ar, index),
+            ELEM(ar, index + 1),
+            (ar->size - index - 1) * ar->elem_size);
+
+    ar->size--;
+
+    return NUT_OK;
+}
+
+/**
+ * Sorts the elements of the Array in place. The comparator receives pointers
+ * to the elements within the buffer.
+ *
+ * @param[in] ar  array to be sorted
+ * @param[in] cmp the comparator function that returns < 0 if the first element
+ *                goes before the second, 0 if the elements are equal and > 0
+ *                if the second goes before the first
+ */
+void nut_array_sort_values(Array *ar, int (*cmp) (const void*, const void*))
+{
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return;
+
+    qsort(ar->buffer, ar->size, ar->elem_size, cmp);
+}
+
+/**
+ * Applies the function fn to each element of the Array. The function receives
+ * a pointer to the element within the buffer and may modify it in place.
+ *
+ * @param[in] ar array on which this operation is performed
+ * @param[in] fn operation function that is to be invoked on each element
+ */
+void nut_array_map_values(Array *ar, void (*fn) (void *e))
+{
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return;
+
+    size_t i;
+    for (i = 0; i < ar->size; i++)
+        fn(ELEM(ar, i));
+}
+
+/**
+ * Filters the Array in place by removing all elements for which pred returns
+ * false. The kept elements are compacted in a single pass.
+ *
+ * @param[in] ar   array that is to be filtered
+ * @param[in] pred predicate function which receives a pointer to the element
+ *                 and returns true if the element should be kept
+ */
+void nut_array_filter_values_mut(Array *ar, bool (*pred) (const void*))
+{
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return;
+
+    size_t keep = 0;
+    size_t i;
+
+    for (i = 0; i < ar->size; i++) {
+        if (!pred(ELEM(ar, i)))
+            continue;
+
+        if (keep != i)
+            memcpy(ELEM(ar, keep), ELEM(ar, i), ar->elem_size);
+        keep++;
+    }
+    ar->size = keep;
+}
+
+/**
+ * Creates a new Array that holds copies of all elements for which pred
+ * returns true, without modifying the original Array.
+ *
+ * @param[in] ar   array that is to be filtered
+ * @param[in] pred predicate function which receives a pointer to the element
+ *                 and returns true if the element should be kept
+ * @param[out] out pointer to where the new filtered Array is to be stored
+ *
+ * @return NUT_OK if the Array was filtered successfully, or NUT_ERR_MALLOC if
+ * the memory allocation for the new Array failed.
+ */
+NutState nut_array_filter_values(Array *ar, bool (*pred) (const void*), Array **out)
+{
+    Array   *filtered;
+    NutState status = array_new_like(ar, ar->size, &filtered);
+
+    if (status != NUT_OK)
+        return status;
+
+    size_t i;
+    for (i = 0; i < ar->size; i++) {
+        if (pred(ELEM(ar, i))) {
+            memcpy(ELEM(filtered, filtered->size), ELEM(ar, i), ar->elem_size);
+            filtered->size++;
+        }
+    }
+    *out = filtered;
+
+    return NUT_OK;
+}
+
+/**
+ * Returns the size of a single element of the Array in bytes. This is
+ * sizeof(void*) for pointer arrays.
+ *
+ * @param[in] ar array whose element size is being returned
+ *
+ * @return the size of an element in bytes.
+ */
+size_t nut_array_element_size(Array *ar)
+{
+    return ar->elem_size;
+}
+
+/**
+ * Expands the Array capacity. This might fail if the the new buffer
+ * cannot be allocated. In case the expansion would overflow the index
+ * range, a maximum capacity buffer is allocated instead. If the capacity
+ * is already at the maximum capacity, or the buffer is the caller's, no new
+ * buffer is allocated.
+ *
+ * @param[in] ar array whose capacity is being expanded
+ *
+ * @return NUT_OK if the buffer was expanded successfully, NUT_ERR_MALLOC if
+ * the memory allocation for the new buffer failed, or CC_ERR_MAX_CAPACITY
+ * if the array is already at maximum capacity or cannot grow.
+ */
+static NutState expand_capacity(Array *ar)
+{
+    const size_t max_elements = NUT_MAX_ELEMENTS / ar->elem_size;
+
+    if (ar->capacity >= max_elements || ar->fixed)
+        return NUT_ERR_MAX_CAPACITY;
+
+    size_t new_capacity = ar->capacity * ar->exp_factor;
+
+    /* As long as the capacity is greater that the expansion factor
+     * at the point of overflow, this is check is valid. */
+    if (new_capacity <= ar->capacity || new_capacity > max_elements)
+        new_capacity = max_elements;
+
+    void **new_buff = ar->mem_alloc(new_capacity * ar->elem_size);
+
+    if (!new_buff)
+        return NUT_ERR_MALLOC;
+
+    memcpy(new_buff, ar->buffer, ar->size * ar->elem_size);
+
+    array_release(ar);
+    ar->buffer   = new_buff;
+    ar->capacity = new_capacity;
+
+    return NUT_OK;
+}
+
+/**
+ * Makes room for n more elements. The buffer grows by the expansion factor,
+ * or to exactly the required size if that is larger.
+ *
+ * @param[in] ar array whose capacity is being ensured
+ * @param[in] n the number of elements that are about to be added
+ *
+ * @return NUT_OK if there is room for the elements, NUT_ERR_MALLOC if the
+ * memory allocation for the new buffer failed, or NUT_ERR_MAX_CAPACITY if
+ * the array would exceed its maximum capacity.
+ */
+static NutState ensure_capacity(Array *ar, size_t n)
+{
+    const size_t max_elements = NUT_MAX_ELEMENTS / ar->elem_size;
+
+    if (n <= ar->capacity - ar->size)
+        return NUT_OK;
+
+    if (n > max_elements - ar->size)
+        return NUT_ERR_MAX_CAPACITY;
+
+    size_t needed       = ar->size + n;
+    size_t new_capacity = max_elements;
+
+    if (ar->capacity < max_elements / ar->exp_factor)
+        new_capacity = ar->capacity * ar->exp_factor;
+
+    if (new_capacity < needed)
+        new_capacity = needed;
+
+    return nut_array_reserve(ar, new_capacity);
+}
+
+/**
+ * Gives the Array a private copy of a buffer that it shares with other
+ * copies. If the other copies have all let go of the buffer in the
+ * meantime, the Array simply takes it over.
+ *
+ * @param[in] ar array whose buffer is shared
+ *
+ * @return NUT_OK if the Array owns its buffer, or NUT_ERR_MALLOC if the
+ * memory allocation for the copy failed.
+ */
+static NutState array_unshare(Array *ar)
+{
+    if (NUT_REF_GET(ar->refs) > 1) {
+        void **new_buff = ar->mem_alloc(ar->capacity * ar->elem_size);
+
+        if (!new_buff)
+            return NUT_ERR_MALLOC;
+
+        memcpy(new_buff, ar->buffer, ar->size * ar->elem_size);
+        array_release(ar);
+        ar->buffer = new_buff;
+    } else {
+        ar->mem_free(ar->refs);
+        ar->refs = NULL;
+    }
+    return NUT_OK;
+}
+
+/**
+ * Lets go of the buffer of the Array before it is replaced or the Array is
+ * destroyed. The buffer is freed unless another copy still shares it.
+ *
+ * @param[in] ar array whose buffer is being released
+ */
+static void array_release(Array *ar)
+{
+    if (ar->refs) {
+        if (NUT_REF_DEC(ar->refs) != 0) {
+            ar->refs = NULL;
+            return;
+        }
+        ar->mem_free(ar->refs);
+        ar->refs = NULL;
+    }
+    ar->mem_free(ar->buffer);
+}
+
+/**
+ * Creates an empty Array with the configuration and the allocators of the
+ * specified Array and room for capacity elements.
+ */
+static NutState array_new_like(Array *ar, size_t capacity, Array **out)
+{
+    Array *copy = ar->mem_calloc(1, sizeof(Array));
+
+    if (!copy)
+        return NUT_ERR_MALLOC;
+
+    if (capacity == 0)
+        capacity = 1;
+
+    if (!(copy->buffer = ar->mem_alloc(capacity * ar->elem_size))) {
+        ar->mem_free(copy);
+        return NUT_ERR_MALLOC;
+    }
+    copy->size       = 0;
+    copy->capacity   = capacity;
+    copy->exp_factor = ar->exp_factor;
+    copy->elem_size  = ar->elem_size;
+    copy->mem_alloc  = ar->mem_alloc;
+    copy->mem_calloc = ar->mem_calloc;
+    copy->mem_free   = ar->mem_free;
+
+    *out = copy;
+    return NUT_OK;
+}
+
+/**
+ * Allocates the working memory of a radix sort: two arrays of (key,
+ * element) pairs, the digit histograms and room for a copy of the elements.
+ * The element of each pair in the first array is set to the address of the
+ * element within the buffer. The working memory is released by
+ * radix_sort().
+ */
+static NutState radix_pairs_new(Array *ar, RadixPair **out)
+{
+    const size_t hist = RADIX_DIGITS * RADIX_BUCKETS * sizeof(size_t);
+    const size_t per  = 2 * sizeof(RadixPair) + ar->elem_size;
+
+    if (ar->size > (NUT_MAX_ELEMENTS - hist) / per)
+        return NUT_ERR_MALLOC;
+
+    RadixPair *pairs = ar->mem_alloc(ar->size * per + hist);
+
+    if (!pairs)
+        return NUT_ERR_MALLOC;
+
+    size_t i;
+    for (i = 0; i < ar->size; i++)
+        pairs[i].e = ELEM(ar, i);
+
+    *out = pairs;
+    return NUT_OK;
+}
+
+/**
+ * Sorts the pairs by the low key_bytes bytes of their keys, one byte per
+ * pass starting with the least significant one, and writes the elements
+ * back into the array in that order. The histograms of all the digits are
+ * counted in a single pass and digits that are the same in every key are
+ * skipped.
+ */
+static void radix_sort(Array *ar, RadixPair *pairs, size_t key_bytes)
+{
+    const size_t n   = ar->size;
+    RadixPair   *src = pairs;
+    RadixPair   *dst = pairs + n;
+    size_t     (*count)[RADIX_BUCKETS] = (size_t (*)[RADIX_BUCKETS]) (pairs + 2 * n);
+    uint8_t     *values = (uint8_t*) (count + RADIX_DIGITS);
+
+    size_t i, b;
+
+    memset(count, 0, key_bytes * sizeof(*count));
+
+    for (i = 0; i < n; i++) {
+        uint64_t k = src[i].key;
+        for (b = 0; b < key_bytes; b++) {
+            count[b][k & (RADIX_BUCKETS - 1)]++;
+            k >>= RADIX_BITS;
+        }
+    }
+
+    for (b = 0; b < key_bytes; b++) {
+        const unsigned shift = b * RADIX_BITS;
+
+        if (count[b][(src[0].key >> shift) & (RADIX_BUCKETS - 1)] == n)
+            continue;
+
+        size_t sum = 0;
+        for (i = 0; i < RADIX_BUCKETS; i++) {
+            size_t c    = count[b][i];
+            count[b][i] = sum;
+            sum        += c;
+        }
+        for (i = 0; i < n; i++)
+            dst[count[b][(src[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = src[i];
+
+        RadixPair *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    /* The pairs point into the buffer, so the elements are gathered into
+     * the copy first */
+    if (ar->elem_size == sizeof(void*)) {
+        for (i = 0; i < n; i++)
+            ((void**) values)[i] = *(void**) src[i].e;
+    } else {
+        for (i = 0; i < n; i++)
+            memcpy(values + i * ar->elem_size, src[i].e, ar->elem_size);
+    }
+    memcpy(ar->buffer, values, n * ar->elem_size);
+
+    ar->mem_free(pairs);
+}
+
+/**
+ * Returns the number of chunks to split n elements into for the executor:
+ * a few per worker for load balancing, but none smaller than
+ * PAR_MIN_CHUNK.
+ */
+static size_t par_chunks(Executor *ex, size_t n)
+{
+    size_t chunks = ex->workers * 4;
+
+    if (chunks > n / PAR_MIN_CHUNK)
+        chunks = n / PAR_MIN_CHUNK;
+
+    return chunks ? chunks : 1;
+}
+
+/**
+ * Returns the start of chunk i when n elements are split into chunks
+ * chunks that differ in size by at most one element.
+ */
+static size_t par_bound(size_t n, size_t chunks, size_t i)
+{
+    size_t rem = n % chunks;
+    return (n / chunks) * i + (i < rem ? i : rem);
+}
+
+static void par_sort_task(void *p, size_t i)
+{
+    ParJob *job   = p;
+    size_t  begin = par_bound(job->ar->size, job->chunks, i);
+    size_t  end   = par_bound(job->ar->size, job->chunks, i + 1);
+
+    array_ptr_sort(job->cmp, job->src + begin, end - begin);
+}
+
+/**
+ * Produces piece i of a merge round. The round merges pairs of sorted runs
+ * of job->width chunks each, and every pair merge is split into 2 * width
+ * pieces of the output, so that a round always has job->chunks pieces.
+ */
+static void par_merge_task(void *p, size_t i)
+{
+    ParJob *job   = p;
+    size_t  n     = job->ar->size;
+    size_t  w     = job->width;
+    size_t  pair  = i / (2 * w);
+    size_t  piece = i % (2 * w);
+
+    size_t begin = par_bound(n, job->chunks, pair * 2 * w);
+    size_t mid   = par_bound(n, job->chunks, pair * 2 * w + w);
+    size_t end   = par_bound(n, job->chunks, pair * 2 * w + 2 * w);
+
+    void **a = job->src + begin;
+    void **b = job->src + mid;
+    size_t m = mid - begin;
+    size_t l = end - mid;
+
+    size_t d0 = par_bound(m + l, 2 * w, piece);
+    size_t d1 = par_bound(m + l, 2 * w, piece + 1);
+    size_t ai = par_corank(job->cmp, d0, a, m, b, l);
+    size_t ae = par_corank(job->cmp, d1, a, m, b, l);
+    size_t bi = d0 - ai;
+    size_t be = d1 - ae;
+
+    void **dst = job->dst + begin + d0;
+
+    while (ai < ae && bi < be) {
+        if (job->cmp(&b[bi], &a[ai]) < 0)
+            *dst++ = b[bi++];
+        else
+            *dst++ = a[ai++];
+    }
+    memcpy(dst, &a[ai], (ae - ai) * sizeof(void*));
+    dst += ae - ai;
+    memcpy(dst, &b[bi], (be - bi) * sizeof(void*));
+}
+
+/**
+ * Returns how many of the first d elements of the merge of the sorted runs
+ * a and b come from a. Equal elements are taken from a first.
+ */
+static size_t par_corank(ArrayCmp cmp, size_t d, void **a, size_t m, void **b, size_t l)
+{
+    size_t lo = d > l ? d - l : 0;
+    size_t hi = d < m ? d : m;
+
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2;
+
+        if (cmp(&b[d - i - 1], &a[i]) < 0)
+            hi = i;
+        else
+            lo = i + 1;
+    }
+    return lo;
+}
+
+static void par_map_task(void *p, size_t i)
+{
+    ParJob *job = p;
+    size_t  end = par_bound(job->ar->size, job->chunks, i + 1);
+    size_t  j;
+
+    for (j = par_bound(job->ar->size, job->chunks, i); j < end; j++)
+        job->map(job->ar->buffer[j]);
+}
+
+/**
+ * Reduces chunk i into its partial result. Chunks have at least
+ * PAR_MIN_CHUNK elements, so fn always gets two of them first.
+ */
+static void par_reduce_task(void *p, size_t i)
+{
+    ParJob *job    = p;
+    void  **buffer = job->ar->buffer;
+    void   *result = job->partial + i * job->partial_size;
+    size_t  begin  = par_bound(job->ar->size, job->chunks, i);
+    size_t  end    = par_bound(job->ar->size, job->chunks, i + 1);
+    size_t  j;
+
+    job->reduce(buffer[begin], buffer[begin + 1], result);
+
+    for (j = begin + 2; j < end; j++)
+        job->reduce(result, buffer[j], result);
+}
+
+/**
+ * Folds the partial result step chunks to the right into partial result
+ * 2 * step * i.
+ */
+static void par_combine_task(void *p, size_t i)
+{
+    ParJob *job   = p;
+    size_t  left  = 2 * job->step * i;
+    size_t  right = left + job->step;
+
+    if (right >= job->chunks)
+        return;
+
+    void *result = job->partial + left * job->partial_size;
+    job->reduce(result, job->partial + right * job->partial_size, result);
+}
+
+static void par_count_task(void *p, size_t i)
+{
+    ParJob *job   = p;
+    size_t  end   = par_bound(job->ar->size, job->chunks, i + 1);
+    size_t  count = 0;
+    size_t  j;
+
+    for (j = par_bound(job->ar->size, job->chunks, i); j < end; j++) {
+        job->keep[j] = job->pred(job->ar->buffer[j]);
+        count       += job->keep[j];
+    }
+    job->count[i] = count;
+}
+
+static void par_gather_task(void *p, size_t i)
+{
+    ParJob *job = p;
+    void  **dst = job->out->buffer + job->count[i];
+    size_t  end = par_bound(job->ar->size, job->chunks, i + 1);
+    size_t  j;
+
+    for (j = par_bound(job->ar->size, job->chunks, i); j < end; j++) {
+        if (job->keep[j])
+            *dst++ = job->ar->buffer[j];
+    }
+}
+
+/**
+ * Swaps two non overlapping blocks of n bytes.
+ */
+static void swap_bytes(uint8_t *a, uint8_t *b, size_t n)
+{
+    while (n--) {
+        uint8_t tmp = *a;
+        *a++ = *b;
+        *b++ = tmp;
+    }
+}
+
+/**
+ * Applies the function fn to each element of the Array.
+ *
+ * @param[in] ar array on which this operation is performed
+ * @param[in] fn operation function that is to be invoked on each Array
+ *               element
+ */
+void nut_array_map(Array *ar, void (*fn) (void *e))
+{
+    size_t i;
+    for (i = 0; i < ar->size; i++)
+        fn(ar->buffer[i]);
+}
+
+/**
+ * A fold/reduce function that collects all of the elements in the array
+ * together. For example, if we have an array of [a,b,c...] the end result
+ * will be (...((a+b)+c)+...).
+ *
+ * @param[in] ar the array on which this operation is performed
+ * @param[in] fn the operation function that is to be invoked on each array
+ *               element
+ * @param[in] result the pointer which will collect the end result
+ */
+void nut_array_reduce(Array *ar, void (*fn) (void*, void*, void*), void *result)
+{
+    if (ar->size == 1) {
+        fn(ar->buffer[0], NULL, result);
+        return;
+    }
+    if (ar->size > 1)
+        fn(ar->buffer[0], ar->buffer[1], result);
+
+    for (size_t i = 2; i < ar->size; i++)
+        fn(result, ar->buffer[i], result);
+}
+
+/**
+ * Sorts the elements of the Array in place using the workers of the
+ * executor. The work is split into chunks that are sorted concurrently and
+ * then merged pairwise, with every merge split again across the workers.
+ * The comparator is the same as for nut_array_sort() and must be safe to
+ * call from several threads at once. Small arrays are sorted in the
+ * calling thread.
+ *
+ * @param[in] ar  array to be sorted
+ * @param[in] cmp the comparator function
+ * @param[in] ex  the executor that runs the tasks
+ *
+ * @return NUT_OK if the array was sorted, or NUT_ERR_MALLOC if the memory
+ * allocation for the merge buffer failed, in which case the array is left
+ * unchanged.
+ */
+NutState nut_array_sort_par(Array *ar, int (*cmp) (const void*, const void*), Executor *ex)
+{
+    size_t limit  = par_chunks(ex, ar->size);
+    size_t chunks = 1;
+
+    while (chunks * 2 <= limit && chunks * 2 <= ex->workers * 2)
+        chunks *= 2;
+
+    if (chunks == 1) {
+        nut_array_sort(ar, cmp);
+        return NUT_OK;
+    }
+
+    if (ar->refs && array_unshare(ar) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    void **tmp = ar->mem_alloc(ar->capacity * sizeof(void*));
+
+    if (!tmp)
+        return NUT_ERR_MALLOC;
+
+    ParJob job = {
+        .ar     = ar,
+        .chunks = chunks,
+        .cmp    = cmp,
+        .src    = ar->buffer,
+        .dst    = tmp,
+    };
+    ex->run(ex, chunks, par_sort_task, &job);
+
+    for (job.width = 1; job.width < chunks; job.width *= 2) {
+        ex->run(ex, chunks, par_merge_task, &job);
+
+        void **t = job.src;
+        job.src  = job.dst;
+        job.dst  = t;
+    }
+
+    /* Both buffers have room for capacity elements, so the sorted one
+     * simply becomes the buffer of the array. The caller's buffer of an
+     * Array in caller memory is kept and the result is copied into it. */
+    if (ar->fixed && job.src != ar->buffer) {
+        memcpy(ar->buffer, job.src, ar->size * sizeof(void*));
+        ar->mem_free(job.src);
+    } else {
+        ar->buffer = job.src;
+        ar->mem_free(job.dst);
+    }
+
+    return NUT_OK;
+}
+
+/**
+ * Applies the function fn to each element of the Array using the workers
+ * of the executor. The function is called concurrently on different
+ * elements and in no particular order.
+ *
+ * @param[in] ar array on which this operation is performed
+ * @param[in] fn operation function that is to be invoked on each Array
+ *               element
+ * @param[in] ex the executor that runs the tasks
+ */
+void nut_array_map_par(Array *ar, void (*fn) (void *e), Executor *ex)
+{
+    ParJob job = {
+        .ar     = ar,
+        .chunks = par_chunks(ex, ar->size),
+        .map    = fn,
+    };
+    ex->run(ex, job.chunks, par_map_task, &job);
+}
+
+/**
+ * A fold/reduce function like nut_array_reduce() that reduces chunks of the
+ * Array concurrently and then combines the partial results pairwise. The
+ * result is the same as that of nut_array_reduce() as long as fn is
+ * associative. Every partial result is result_size bytes large and is
+ * passed to fn the same way as the result.
+ *
+ * @param[in] ar the array on which this operation is performed
+ * @param[in] fn the operation function that is to be invoked on each array
+ *               element
+ * @param[in] result the pointer which will collect the end result
+ * @param[in] result_size the size of the result in bytes
+ * @param[in] ex the executor that runs the tasks
+ *
+ * @return NUT_OK if the reduction was successful, or NUT_ERR_MALLOC if the
+ * memory allocation for the partial results failed.
+ */
+NutState nut_array_reduce_par(Array *ar, void (*fn) (void*, void*, void*), void *result,
+                              size_t result_size, Executor *ex)
+{
+    size_t chunks = par_chunks(ex, ar->size);
+
+    if (chunks == 1) {
+        nut_array_reduce(ar, fn, result);
+        return NUT_OK;
+    }
+
+    uint8_t *partial = ar->mem_alloc(chunks * result_size);
+
+    if (!partial)
+        return NUT_ERR_MALLOC;
+
+    ParJob job = {
+        .ar           = ar,
+        .chunks       = chunks,
+        .reduce       = fn,
+        .partial      = partial,
+        .partial_size = result_size,
+    };
+    ex->run(ex, chunks, par_reduce_task, &job);
+
+    for (job.step = 1; job.step < chunks; job.step *= 2)
+        ex->run(ex, (chunks + 2 * job.step - 1) / (2 * job.step), par_combine_task, &job);
+
+    memcpy(result, partial, result_size);
+    ar->mem_free(partial);
+
+    return NUT_OK;
+}
+
+/**
+ * Filters the Array like nut_array_filter() using the workers of the
+ * executor. The predicate is evaluated concurrently on chunks of the
+ * Array, after which the kept elements of every chunk are copied to their
+ * place in the new Array, also concurrently. The order of the elements is
+ * preserved.
+ *
+ * @param[in] ar   array that is to be filtered
+ * @param[in] pred predicate function which returns true if the element should
+ *                 be kept in the filtered array
+ * @param[out] out pointer to where the new filtered Array is to be stored
+ * @param[in] ex   the executor that runs the tasks
+ *
+ * @return NUT_OK if the Array was filtered successfully, NUT_ERR_OUT_RANGE
+ * if the Array is empty, or NUT_ERR_MALLOC if the memory allocation for the
+ * new Array failed.
+ */
+NutState nut_array_filter_par(Array *ar, bool (*pred) (const void*), Array **out, Executor *ex)
+{
+    size_t chunks = par_chunks(ex, ar->size);
+
+    if (chunks == 1)
+        return nut_array_filter(ar, pred, out);
+
+    Array   *filtered;
+    NutState status = array_new_like(ar, ar->capacity, &filtered);
+
+    if (status != NUT_OK)
+        return status;
+
+    size_t *count = ar->mem_alloc(chunks * sizeof(size_t) + ar->size);
+
+    if (!count) {
+        nut_array_destroy(filtered);
+        return NUT_ERR_MALLOC;
+    }
+
+    ParJob job = {
+        .ar     = ar,
+        .chunks = chunks,
+        .pred   = pred,
+        .keep   = (uint8_t*) (count + chunks),
+        .count  = count,
+        .out    = filtered,
+    };
+    ex->run(ex, chunks, par_count_task, &job);
+
+    /* Turn the counts into the offsets of the chunks in the output */
+    size_t i;
+    size_t sum = 0;
+    for (i = 0; i < chunks; i++) {
+        size_t c = count[i];
+        count[i] = sum;
+        sum     += c;
+    }
+    filtered->size = sum;
+
+    ex->run(ex, chunks, par_gather_task, &job);
+    ar->mem_free(count);
+
+    *out = filtered;
+    return NUT_OK;
 }
 
 /**
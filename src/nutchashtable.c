@@ -0,0 +1,590 @@
+#include "nutconf.h"
+#include "nutport.h"
+#include "nutmem.h"
+
+#include "nutchashtable.h"
+
+#define DEFAULT_CAPACITY 64
+#define DEFAULT_LOAD_FACTOR 0.75f
+#define DEFAULT_STRIPES 16
+
+/*
+ * Every bucket is guarded by the stripe (bucket index & stripe_mask). Both
+ * the capacity and the number of stripes are powers of two and the capacity
+ * is never smaller than the number of stripes, so the stripe of a key is
+ * (hash & stripe_mask) regardless of the capacity. A key therefore stays in
+ * the same stripe when the table grows, and a bucket can be migrated to the
+ * new bucket array while holding only the lock of its own stripe.
+ */
+typedef struct chashtable_stripe_s {
+    NutMutex lock;
+    size_t   size;
+} Stripe;
+
+struct chashtable_s {
+    size_t       capacity;
+    size_t       threshold;
+    uint32_t     hash_seed;
+    int          key_len;
+    float        load_factor;
+    TableEntry **buckets;
+
+    /* Bucket array that is being migrated by a resize, or NULL */
+    TableEntry **old_buckets;
+    size_t       old_capacity;
+
+    Stripe      *stripes;
+    size_t       stripe_count;
+    size_t       stripe_mask;
+
+    /* Held by the thread that resizes the table */
+    NutMutex     resize_lock;
+
+    size_t  (*hash)       (const void *key, int l, uint32_t seed);
+    int     (*key_cmp)    (const void *k1, const void *k2);
+    void   *(*mem_alloc)  (size_t size);
+    void   *(*mem_calloc) (size_t blocks, size_t size);
+    void    (*mem_free)   (void *block);
+};
+
+static size_t      round_pow_two   (size_t n);
+static void        lock_all        (CHashTable *t);
+static void        unlock_all      (CHashTable *t);
+static void        resize          (CHashTable *t);
+static TableEntry *find_entry      (CHashTable *t, void *key, size_t hash);
+static bool        key_eq          (CHashTable *t, const void *stored, void *key);
+
+/**
+ * Creates a new CHashTable and returns a status code.
+ *
+ * @note The newly created CHashTable will work with string keys.
+ *
+ * @param[out] out Pointer to where the newly created CHashTable is to be stored
+ *
+ * @return NUT_OK if the creation was successful, or NUT_ERR_MALLOC if the
+ * memory allocation for the new CHashTable failed.
+ */
+NutState nut_chashtable_new(CHashTable **out)
+{
+    CHashTableConf conf;
+    nut_chashtable_conf_init(&conf);
+    return nut_chashtable_new_conf(&conf, out);
+}
+
+/**
+ * Creates a new CHashTable based on the specified CHashTableConf struct and
+ * returns a status code.
+ *
+ * The table is allocated using the memory allocators specified in the
+ * CHashTableConf struct.
+ *
+ * @param[in] conf the CHashTable conf structure
+ * @param[out] out Pointer to where the newly created CHashTable is to be stored
+ *
+ * @return NUT_OK if the creation was successful, or NUT_ERR_MALLOC if the
+ * memory allocation for the new CHashTable structure or one of its locks
+ * failed.
+ */
+NutState nut_chashtable_new_conf(CHashTableConf const * const conf, CHashTable **out)
+{
+    CHashTable *table = conf->mem_calloc(1, sizeof(CHashTable));
+
+    if (!table)
+        return NUT_ERR_MALLOC;
+
+    table->hash         = conf->hash;
+    table->key_cmp      = conf->key_compare;
+    table->load_factor  = conf->load_factor;
+    table->hash_seed    = conf->hash_seed;
+    table->key_len      = conf->key_length;
+    table->mem_alloc    = conf->mem_alloc;
+    table->mem_calloc   = conf->mem_calloc;
+    table->mem_free     = conf->mem_free;
+    table->stripe_count = round_pow_two(conf->stripes);
+    table->stripe_mask  = table->stripe_count - 1;
+    table->capacity     = round_pow_two(conf->initial_capacity);
+
+    if (table->capacity < table->stripe_count)
+        table->capacity = table->stripe_count;
+
+    table->threshold = table->capacity * table->load_factor;
+    table->buckets   = conf->mem_calloc(table->capacity, sizeof(TableEntry*));
+    table->stripes   = conf->mem_calloc(table->stripe_count, sizeof(Stripe));
+
+    if (!table->buckets || !table->stripes)
+        goto err_alloc;
+
+    if (!nut_mutex_init(&table->resize_lock))
+        goto err_alloc;
+
+    size_t i;
+    for (i = 0; i < table->stripe_count; i++) {
+        if (!nut_mutex_init(&table->stripes[i].lock))
+            break;
+    }
+    if (i < table->stripe_count) {
+        while (i--)
+            nut_mutex_destroy(&table->stripes[i].lock);
+        nut_mutex_destroy(&table->resize_lock);
+        goto err_alloc;
+    }
+
+    *out = table;
+    return NUT_OK;
+
+err_alloc:
+    conf->mem_free(table->buckets);
+    conf->mem_free(table->stripes);
+    conf->mem_free(table);
+    return NUT_ERR_MALLOC;
+}
+
+/**
+ * Initializes the CHashTableConf structs fields to default values.
+ *
+ * @param[in] conf the struct that is being initialized
+ */
+void nut_chashtable_conf_init(CHashTableConf *conf)
+{
+    conf->hash             = FAST_HASH;
+    conf->key_compare      = nut_common_cmp_str;
+    conf->initial_capacity = DEFAULT_CAPACITY;
+    conf->load_factor      = DEFAULT_LOAD_FACTOR;
+    conf->stripes          = DEFAULT_STRIPES;
+    conf->key_length       = KEY_LENGTH_VARIABLE;
+    conf->hash_seed        = 0;
+    conf->mem_alloc        = &nut_mem_malloc;
+    conf->mem_calloc       = &nut_mem_calloc;
+    conf->mem_free         = &nut_mem_free;
+}
+
+/**
+ * Destroys the specified CHashTable structure without destroying the data
+ * contained within it. The table must no longer be in use by any other
+ * thread.
+ *
+ * @param[in] table CHashTable to be destroyed
+ */
+void nut_chashtable_destroy(CHashTable *table)
+{
+    TableEntry **arrays[2] = { table->buckets, table->old_buckets };
+    size_t       sizes[2]  = { table->capacity, table->old_capacity };
+    size_t       a;
+    size_t       i;
+
+    for (a = 0; a < 2; a++) {
+        for (i = 0; arrays[a] && i < sizes[a]; i++) {
+            TableEntry *next = arrays[a][i];
+
+            while (next) {
+                TableEntry *tmp = next->next;
+                table->mem_free(next);
+                next = tmp;
+            }
+        }
+        table->mem_free(arrays[a]);
+    }
+
+    for (i = 0; i < table->stripe_count; i++)
+        nut_mutex_destroy(&table->stripes[i].lock);
+
+    nut_mutex_destroy(&table->resize_lock);
+
+    table->mem_free(table->stripes);
+    table->mem_free(table);
+}
+
+/**
+ * Creates a new key-value mapping in the specified CHashTable. If the unique
+ * key is already mapped to a value in this table, that value is replaced with
+ * the new value. This operation may fail if the space allocation for the new
+ * entry fails.
+ *
+ * The thread that pushes the table over its load factor also resizes it,
+ * after it has released the lock of its stripe.
+ *
+ * @param[in] table the table to which this new key-value mapping is being added
+ * @param[in] key a hash table key used to access the specified value
+ * @param[in] val a value that is being stored in the table
+ *
+ * @return NUT_OK if the mapping was successfully added, or NUT_ERR_MALLOC if the
+ * memory allocation failed.
+ */
+NutState nut_chashtable_add(CHashTable *table, void *key, void *val)
+{
+    const size_t hash   = key ? table->hash(key, table->key_len, table->hash_seed) : 0;
+    Stripe      *stripe = &table->stripes[hash & table->stripe_mask];
+
+    nut_mutex_lock(&stripe->lock);
+
+    TableEntry *entry = find_entry(table, key, hash);
+
+    if (entry) {
+        entry->value = val;
+        nut_mutex_unlock(&stripe->lock);
+        return NUT_OK;
+    }
+
+    entry = table->mem_alloc(sizeof(TableEntry));
+
+    if (!entry) {
+        nut_mutex_unlock(&stripe->lock);
+        return NUT_ERR_MALLOC;
+    }
+
+    TableEntry **bucket = &table->buckets[hash & (table->capacity - 1)];
+
+    entry->key   = key;
+    entry->value = val;
+    entry->hash  = hash;
+    entry->next  = *bucket;
+    *bucket      = entry;
+
+    stripe->size++;
+
+    bool grow = stripe->size > table->threshold / table->stripe_count;
+
+    nut_mutex_unlock(&stripe->lock);
+
+    if (grow)
+        resize(table);
+
+    return NUT_OK;
+}
+
+/**
+ * Gets a value associated with the specified key and sets the out
+ * parameter to it. Nothing keeps the value alive once the call returns, so
+ * the caller must synchronize with the threads that remove it.
+ *
+ * @param[in] table the table from which the mapping is being returned
+ * @param[in] key   the key that is being looked up
+ * @param[out] out  pointer to where the value is stored
+ *
+ * @return NUT_OK if the key was found, or NUT_ERR_KEY_NOT_FOUND if not.
+ */
+NutState nut_chashtable_get(CHashTable *table, void *key, void **out)
+{
+    const size_t hash   = key ? table->hash(key, table->key_len, table->hash_seed) : 0;
+    Stripe      *stripe = &table->stripes[hash & table->stripe_mask];
+
+    nut_mutex_lock(&stripe->lock);
+
+    TableEntry *entry = find_entry(table, key, hash);
+
+    if (entry)
+        *out = entry->value;
+
+    nut_mutex_unlock(&stripe->lock);
+
+    return entry ? NUT_OK : NUT_ERR_KEY_NOT_FOUND;
+}
+
+/**
+ * Removes a key-value mapping from the specified CHashTable and sets the out
+ * parameter to value.
+ *
+ * @param[in] table the table from which the key-value pair is being removed
+ * @param[in] key the key of the value being returned
+ * @param[out] out pointer to where the removed value is stored, or NULL
+ *                 if it is to be ignored
+ *
+ * @return NUT_OK if the mapping was successfully removed, or NUT_ERR_KEY_NOT_FOUND
+ * if the key was not found.
+ */
+NutState nut_chashtable_remove(CHashTable *table, void *key, void **out)
+{
+    const size_t hash   = key ? table->hash(key, table->key_len, table->hash_seed) : 0;
+    Stripe      *stripe = &table->stripes[hash & table->stripe_mask];
+
+    nut_mutex_lock(&stripe->lock);
+
+    TableEntry **arrays[2] = { table->buckets, table->old_buckets };
+    size_t       sizes[2]  = { table->capacity, table->old_capacity };
+    size_t       a;
+
+    for (a = 0; a < 2 && arrays[a]; a++) {
+        TableEntry **link = &arrays[a][hash & (sizes[a] - 1)];
+
+        while (*link) {
+            TableEntry *e = *link;
+
+            if (e->hash == hash && key_eq(table, e->key, key)) {
+                *link = e->next;
+                stripe->size--;
+                nut_mutex_unlock(&stripe->lock);
+
+                if (out)
+                    *out = e->value;
+
+                table->mem_free(e);
+                return NUT_OK;
+            }
+            link = &e->next;
+        }
+    }
+    nut_mutex_unlock(&stripe->lock);
+
+    return NUT_ERR_KEY_NOT_FOUND;
+}
+
+/**
+ * Checks whether or not the CHashTable contains the specified key.
+ *
+ * @param[in] table the table on which the search is being performed
+ * @param[in] key the key that is being searched for
+ *
+ * @return true if the table contains the key.
+ */
+bool nut_chashtable_contains_key(CHashTable *table, void *key)
+{
+    const size_t hash   = key ? table->hash(key, table->key_len, table->hash_seed) : 0;
+    Stripe      *stripe = &table->stripes[hash & table->stripe_mask];
+
+    nut_mutex_lock(&stripe->lock);
+    bool found = find_entry(table, key, hash) != NULL;
+    nut_mutex_unlock(&stripe->lock);
+
+    return found;
+}
+
+/**
+ * Returns the number of key-value mappings in the specified CHashTable. The
+ * stripes are counted one after the other, so the result is only exact if
+ * the table is not modified concurrently.
+ *
+ * @param[in] table the table whose size is being returned
+ *
+ * @return the size of the table.
+ */
+size_t nut_chashtable_size(CHashTable *table)
+{
+    size_t size = 0;
+    size_t i;
+
+    for (i = 0; i < table->stripe_count; i++) {
+        nut_mutex_lock(&table->stripes[i].lock);
+        size += table->stripes[i].size;
+        nut_mutex_unlock(&table->stripes[i].lock);
+    }
+    return size;
+}
+
+/**
+ * Returns the current capacity of the table.
+ *
+ * @param[in] table the table whose capacity is being returned
+ *
+ * @return the capacity of the table.
+ */
+size_t nut_chashtable_capacity(CHashTable *table)
+{
+    nut_mutex_lock(&table->stripes[0].lock);
+    size_t capacity = table->capacity;
+    nut_mutex_unlock(&table->stripes[0].lock);
+
+    return capacity;
+}
+
+/**
+ * Applies the function fn to each key-value pair of the CHashTable. The
+ * stripes are visited one at a time while holding their lock, so the
+ * function must not call back into the table.
+ *
+ * @param[in] table the table on which this operation is being performed
+ * @param[in] op the operation function that is invoked on each key and value
+ */
+void nut_chashtable_foreach(CHashTable *table, void (*op) (const void *, void *))
+{
+    size_t s;
+
+    for (s = 0; s < table->stripe_count; s++) {
+        nut_mutex_lock(&table->stripes[s].lock);
+
+        TableEntry **arrays[2] = { table->buckets, table->old_buckets };
+        size_t       sizes[2]  = { table->capacity, table->old_capacity };
+        size_t       a;
+        size_t       i;
+
+        for (a = 0; a < 2 && arrays[a]; a++) {
+            for (i = s; i < sizes[a]; i += table->stripe_count) {
+                TableEntry *e = arrays[a][i];
+
+                while (e) {
+                    op(e->key, e->value);
+                    e = e->next;
+                }
+            }
+        }
+        nut_mutex_unlock(&table->stripes[s].lock);
+    }
+}
+
+/**
+ * Looks up the entry of the key in the new and, while a resize is in
+ * progress, in the old bucket array. Must be called with the stripe of the
+ * hash locked.
+ */
+static TableEntry *find_entry(CHashTable *t, void *key, size_t hash)
+{
+    TableEntry *e = t->buckets[hash & (t->capacity - 1)];
+
+    while (e) {
+        if (e->hash == hash && key_eq(t, e->key, key))
+            return e;
+        e = e->next;
+    }
+
+    if (!t->old_buckets)
+        return NULL;
+
+    e = t->old_buckets[hash & (t->old_capacity - 1)];
+
+    while (e) {
+        if (e->hash == hash && key_eq(t, e->key, key))
+            return e;
+        e = e->next;
+    }
+    return NULL;
+}
+
+/**
+ * Doubles the capacity of the table. Only the publication of the new bucket
+ * array and the release of the old one take every stripe lock, and both are
+ * constant time. The buckets themselves are migrated one at a time under the
+ * lock of their own stripe, so readers and writers of other stripes are never
+ * blocked by the migration.
+ *
+ * If another thread is already resizing the table, this call returns at once.
+ */
+static void resize(CHashTable *t)
+{
+    if (!nut_mutex_trylock(&t->resize_lock))
+        return;
+
+    /* Only the thread holding resize_lock changes the bucket arrays, so it
+     * may read them without a stripe lock. */
+    if (t->capacity >= MAX_POW_TWO) {
+        nut_mutex_unlock(&t->resize_lock);
+        return;
+    }
+
+    size_t       new_capacity = t->capacity << 1;
+    TableEntry **new_buckets  = t->mem_calloc(new_capacity, sizeof(TableEntry*));
+
+    if (!new_buckets) {
+        nut_mutex_unlock(&t->resize_lock);
+        return;
+    }
+
+    lock_all(t);
+
+    /* Another thread may have resized the table in the meantime. */
+    size_t s;
+    for (s = 0; s < t->stripe_count; s++) {
+        if (t->stripes[s].size > t->threshold / t->stripe_count)
+            break;
+    }
+    if (s == t->stripe_count) {
+        unlock_all(t);
+        nut_mutex_unlock(&t->resize_lock);
+        t->mem_free(new_buckets);
+        return;
+    }
+
+    t->old_buckets  = t->buckets;
+    t->old_capacity = t->capacity;
+    t->buckets      = new_buckets;
+    t->capacity     = new_capacity;
+    t->threshold    = new_capacity * t->load_factor;
+
+    unlock_all(t);
+
+    size_t i;
+    for (i = 0; i < t->old_capacity; i++) {
+        Stripe *stripe = &t->stripes[i & t->stripe_mask];
+
+        nut_mutex_lock(&stripe->lock);
+
+        TableEntry *e = t->old_buckets[i];
+
+        while (e) {
+            TableEntry  *next   = e->next;
+            TableEntry **bucket = &t->buckets[e->hash & (t->capacity - 1)];
+
+            e->next = *bucket;
+            *bucket = e;
+            e       = next;
+        }
+        t->old_buckets[i] = NULL;
+
+        nut_mutex_unlock(&stripe->lock);
+    }
+
+    lock_all(t);
+    TableEntry **old_buckets = t->old_buckets;
+    t->old_buckets  = NULL;
+    t->old_capacity = 0;
+    unlock_all(t);
+
+    t->mem_free(old_buckets);
+
+    nut_mutex_unlock(&t->resize_lock);
+}
+
+/**
+ * Locks every stripe in ascending order. Only the resizing thread holds more
+ * than one stripe at a time, so a fixed order is enough to avoid deadlocks.
+ */
+static void lock_all(CHashTable *t)
+{
+    size_t i;
+    for (i = 0; i < t->stripe_count; i++)
+        nut_mutex_lock(&t->stripes[i].lock);
+}
+
+static void unlock_all(CHashTable *t)
+{
+    size_t i = t->stripe_count;
+    while (i--)
+        nut_mutex_unlock(&t->stripes[i].lock);
+}
+
+/**
+ * Checks whether the stored key matches the key being looked up. A NULL key
+ * is a valid key that only matches itself.
+ */
+static INLINE bool key_eq(CHashTable *t, const void *stored, void *key)
+{
+    if (!key)
+        return stored == NULL;
+
+    return stored && t->key_cmp(stored, key) == 0;
+}
+
+/**
+ * Rounds the integer to the next power of two. If the number is already a
+ * power of two, the same number is returned.
+ *
+ * @param[in] n the number that is being rounded
+ *
+ * @return the next power of two
+ */
+static INLINE size_t round_pow_two(size_t n)
+{
+    if (n >= MAX_POW_TWO)
+        return MAX_POW_TWO;
+
+    if (n == 0)
+        return 2;
+
+    n--;
+    n |= n >> 1;
+    n |= n >> 2;
+    n |= n >> 4;
+    n |= n >> 8;
+    n |= n >> 16;
+    n++;
+
+    return n;
+}
@@ -1,6 +1,24 @@
 
 #include "nutcommon.h"
 
+/*
+ * Vector units used by the pointer scans. AVX2 and SSE2 are used on x86,
+ * NEON on ARM cores that have it. Everything else, including Cortex-M,
+ * takes the scalar loop.
+ */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SCAN_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCAN_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SCAN_NEON 1
+#endif
+
+#define PTR64 (UINTPTR_MAX > 0xFFFFFFFFu)
+
 
 /**
  * String comparator function.
@@ -31,3 +49,155 @@ int nut_common_cmp_ptr(const void *ptr1, const void *ptr2)
         return 1;
     return 0;
 }
+
+/*******************************************************************************
+ *
+ *
+ *  Pointer scans
+ *
+ *
+ ******************************************************************************/
+
+#if defined(SCAN_AVX2)
+
+/* Number of pointers in a vector */
+#define SCAN_LANES (32 / sizeof(void*))
+
+/* Bit mask of the lanes of the vector at p that hold the key */
+static INLINE unsigned scan_mask(void * const *p, __m256i key)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i*) p);
+
+#if PTR64
+    return (unsigned) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, key)));
+#else
+    return (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, key)));
+#endif
+}
+
+#define SCAN_VECTOR __m256i
+#if PTR64
+#define SCAN_SET(ptr) _mm256_set1_epi64x((long long) (uintptr_t) (ptr))
+#else
+#define SCAN_SET(ptr) _mm256_set1_epi32((int) (uintptr_t) (ptr))
+#endif
+
+#elif defined(SCAN_SSE2)
+
+#define SCAN_LANES (16 / sizeof(void*))
+
+static INLINE unsigned scan_mask(void * const *p, __m128i key)
+{
+    __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) p), key);
+
+#if PTR64
+    /* SSE2 has no 64 bit compare. A pointer matches if both halves do */
+    eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (unsigned) _mm_movemask_pd(_mm_castsi128_pd(eq));
+#else
+    return (unsigned) _mm_movemask_ps(_mm_castsi128_ps(eq));
+#endif
+}
+
+#define SCAN_VECTOR __m128i
+#if PTR64
+#define SCAN_SET(ptr) _mm_set1_epi64x((long long) (uintptr_t) (ptr))
+#else
+#define SCAN_SET(ptr) _mm_set1_epi32((int) (uintptr_t) (ptr))
+#endif
+
+#elif defined(SCAN_NEON)
+
+#define SCAN_LANES (16 / sizeof(void*))
+
+static INLINE unsigned scan_mask(void * const *p, uint32x4_t key)
+{
+#if PTR64
+    uint64x2_t eq = vceqq_u64(vld1q_u64((const uint64_t*) p), vreinterpretq_u64_u32(key));
+    return (unsigned) (vgetq_lane_u64(eq, 0) & 1)
+         | (unsigned) (vgetq_lane_u64(eq, 1) & 2);
+#else
+    uint32x4_t eq = vceqq_u32(vld1q_u32((const uint32_t*) p), key);
+    return (unsigned) (vgetq_lane_u32(eq, 0) & 1)
+         | (unsigned) (vgetq_lane_u32(eq, 1) & 2)
+         | (unsigned) (vgetq_lane_u32(eq, 2) & 4)
+         | (unsigned) (vgetq_lane_u32(eq, 3) & 8);
+#endif
+}
+
+#define SCAN_VECTOR uint32x4_t
+#if PTR64
+#define SCAN_SET(ptr) vreinterpretq_u32_u64(vdupq_n_u64((uint64_t) (uintptr_t) (ptr)))
+#else
+#define SCAN_SET(ptr) vdupq_n_u32((uint32_t) (uintptr_t) (ptr))
+#endif
+
+#endif
+
+/**
+ * Returns the number of pointers in the buffer that are equal to ptr. The
+ * buffer is scanned with vector compares where the target has a vector
+ * unit.
+ *
+ * @param[in] buffer the buffer of n pointers
+ * @param[in] n the number of pointers in the buffer
+ * @param[in] ptr the pointer being counted
+ *
+ * @return the number of occurrences of ptr.
+ */
+size_t nut_common_ptr_count(void * const *buffer, size_t n, const void *ptr)
+{
+    size_t count = 0;
+    size_t i     = 0;
+
+#ifdef SCAN_LANES
+    SCAN_VECTOR key = SCAN_SET(ptr);
+
+    for (; i + SCAN_LANES <= n; i += SCAN_LANES)
+        count += (size_t) __builtin_popcount(scan_mask(buffer + i, key));
+#endif
+
+    for (; i < n; i++)
+        count += buffer[i] == ptr;
+
+    return count;
+}
+
+/**
+ * Returns the index of the first pointer in the buffer that is equal to
+ * ptr. The buffer is scanned with vector compares where the target has a
+ * vector unit.
+ *
+ * @param[in] buffer the buffer of n pointers
+ * @param[in] n the number of pointers in the buffer
+ * @param[in] ptr the pointer being looked up
+ *
+ * @return the index of ptr, or n if the buffer does not contain it.
+ */
+size_t nut_common_ptr_find(void * const *buffer, size_t n, const void *ptr)
+{
+    size_t i = 0;
+
+#ifdef SCAN_LANES
+    SCAN_VECTOR key = SCAN_SET(ptr);
+
+    /* Two vectors per step keep more loads in flight */
+    for (; i + 2 * SCAN_LANES <= n; i += 2 * SCAN_LANES) {
+        unsigned m = scan_mask(buffer + i, key)
+                   | scan_mask(buffer + i + SCAN_LANES, key) << SCAN_LANES;
+        if (m)
+            return i + (size_t) __builtin_ctz(m);
+    }
+    for (; i + SCAN_LANES <= n; i += SCAN_LANES) {
+        unsigned m = scan_mask(buffer + i, key);
+        if (m)
+            return i + (size_t) __builtin_ctz(m);
+    }
+#endif
+
+    for (; i < n; i++) {
+        if (buffer[i] == ptr)
+            return i;
+    }
+    return n;
+}
@@ -15,15 +15,32 @@ struct nut_deque_s {
     size_t   last;
     void   **buffer;
 
-    void *(*mem_alloc)  (size_t size);
-    void *(*mem_calloc) (size_t blocks, size_t size);
-    void  (*mem_free)   (void *block);
+    /* Share count of the buffer while it is shared with the copies made by
+     * nut_deque_copy_shallow(), or NULL while the deque owns it alone */
+    size_t  *refs;
+
+    /* Set if the structure and the buffer are the caller's memory, given to
+     * nut_deque_new_static(). Such a deque never grows or frees either. */
+    bool     fixed;
+
+    void *(*mem_alloc)   (size_t size);
+    void *(*mem_calloc)  (size_t blocks, size_t size);
+    void  (*mem_free)    (void *block);
+    void *(*mem_realloc) (void *block, size_t size);
 };
 
+_Static_assert(sizeof(Deque) <= sizeof(DequeStatic), "DequeStatic is too small");
+
 static size_t upper_pow_two (size_t);
 static void   copy_buffer   (Deque const * const deque, void **buff, void *(*cp) (void*));
 
 static NutState expand_capacity (Deque *deque);
+static NutState deque_grow      (Deque *deque, size_t capacity);
+static NutState deque_unshare   (Deque *deque);
+static void     deque_release   (Deque *deque);
+static size_t   deque_head_span (Deque const * const deque);
+static void     ring_move       (Deque *deque, size_t dst, size_t src, size_t n);
+static void     ring_write      (Deque *deque, size_t index, void * const *elements, size_t n);
 
 /**
  * Creates a new empty deque and returns a status code.
@@ -62,15 +79,18 @@ NutState nut_deque_new_conf(DequeConf const * const conf, Deque **d)
     if (!deque)
         return NUT_ERR_MALLOC;
 
-    if (!(deque->buffer = conf->mem_alloc(conf->capacity * sizeof(void*)))) {
+    size_t capacity = upper_pow_two(conf->capacity);
+
+    if (!(deque->buffer = conf->mem_alloc(capacity * sizeof(void*)))) {
         conf->mem_free(deque);
         return NUT_ERR_MALLOC;
     }
 
-    deque->mem_alloc  = conf->mem_alloc;
-    deque->mem_calloc = conf->mem_calloc;
-    deque->mem_free   = conf->mem_free;
-    deque->capacity   = upper_pow_two(conf->capacity);
+    deque->mem_alloc   = conf->mem_alloc;
+    deque->mem_calloc  = conf->mem_calloc;
+    deque->mem_free    = conf->mem_free;
+    deque->mem_realloc = conf->mem_realloc;
+    deque->capacity    = capacity;
     deque->first      = 0;
     deque->last       = 0;
     deque->size       = 0;
@@ -79,6 +99,48 @@ NutState nut_deque_new_conf(DequeConf const * const conf, Deque **d)
     return NUT_OK;
 }
 
+/**
+ * Creates a new empty Deque in caller supplied memory and returns a status
+ * code. Neither the structure nor the buffer is allocated, and the Deque
+ * never grows: an addition that does not fit returns NUT_ERR_MAX_CAPACITY.
+ * The memory must outlive the Deque, and nut_deque_destroy() only detaches
+ * the Deque from it.
+ *
+ * Copies and filtered deques made from the Deque are ordinary Deques on
+ * the default allocators.
+ *
+ * @param[in] buffer the buffer of capacity pointers that holds the elements
+ * @param[in] capacity the number of elements the buffer can hold. Must be a
+ *                     power of two.
+ * @param[in] storage the memory in which the Deque structure is placed
+ * @param[out] out pointer to where the newly created Deque is to be stored
+ *
+ * @return NUT_OK if the creation was successful, or NUT_ERR_INVALID_CAPACITY
+ * if the capacity is 0, too large or not a power of two.
+ */
+NutState nut_deque_new_static(void **buffer, size_t capacity, DequeStatic *storage, Deque **out)
+{
+    if (capacity == 0 || capacity > MAX_POW_TWO || (capacity & (capacity - 1)))
+        return NUT_ERR_INVALID_CAPACITY;
+
+    Deque *deque = (Deque*) storage;
+
+    deque->buffer     = buffer;
+    deque->refs       = NULL;
+    deque->fixed      = true;
+    deque->mem_alloc   = &nut_mem_malloc;
+    deque->mem_calloc  = &nut_mem_calloc;
+    deque->mem_free    = &nut_mem_free;
+    deque->mem_realloc = NULL;
+    deque->capacity    = capacity;
+    deque->first      = 0;
+    deque->last       = 0;
+    deque->size       = 0;
+
+    *out = deque;
+    return NUT_OK;
+}
+
 /**
  * Initializes the fields of the DequeConf struct to default values.
  *
@@ -86,10 +148,11 @@ NutState nut_deque_new_conf(DequeConf const * const conf, Deque **d)
  */
 void nut_deque_conf_init(DequeConf *conf)
 {
-    conf->capacity   = DEFAULT_CAPACITY;
-    conf->mem_alloc  = &nut_mem_malloc;
-    conf->mem_calloc = &nut_mem_calloc;
-    conf->mem_free   = &nut_mem_free;
+    conf->capacity    = DEFAULT_CAPACITY;
+    conf->mem_alloc   = &nut_mem_malloc;
+    conf->mem_calloc  = &nut_mem_calloc;
+    conf->mem_free    = &nut_mem_free;
+    conf->mem_realloc = NULL;
 }
 
 /**
@@ -99,7 +162,10 @@ void nut_deque_conf_init(DequeConf *conf)
  */
 void nut_deque_destroy(Deque *deque)
 {
-    deque->mem_free(deque->buffer);
+    if (deque->fixed)
+        return;
+
+    deque_release(deque);
     deque->mem_free(deque);
 }
 
@@ -139,12 +205,18 @@ NutState nut_deque_add(Deque *deque, void *element)
  * @param[in] deque Deque to which the element is being added
  * @param[in] element element that is being added
  *
- * @return NUT_OK if the element was successfully added, or NUT_ERR_MALLOC if the
- * memory allocation for the new element has failed.
+ * @return NUT_OK if the element was successfully added, NUT_ERR_MALLOC if the
+ * memory allocation for the new element has failed, or NUT_ERR_MAX_CAPACITY
+ * if the Deque is full and cannot grow.
  */
 NutState nut_deque_add_first(Deque *deque, void *element)
 {
-    if (deque->size >= deque->capacity && expand_capacity(deque) != NUT_OK)
+    NutState status;
+
+    if (deque->size >= deque->capacity && (status = expand_capacity(deque)) != NUT_OK)
+        return status;
+
+    if (deque->refs && deque_unshare(deque) != NUT_OK)
         return NUT_ERR_MALLOC;
 
     deque->first = (deque->first - 1) & (deque->capacity - 1);
@@ -160,12 +232,18 @@ NutState nut_deque_add_first(Deque *deque, void *element)
  * @param[in] deque the Deque to which the element is being added
  * @param[in] element the element that is being added
  *
- * @return NUT_OK if the element was successfully added, or NUT_ERR_MALLOC if the
- * memory allocation for the new element has failed.
+ * @return NUT_OK if the element was successfully added, NUT_ERR_MALLOC if the
+ * memory allocation for the new element has failed, or NUT_ERR_MAX_CAPACITY
+ * if the Deque is full and cannot grow.
  */
 NutState nut_deque_add_last(Deque *deque, void *element)
 {
-    if (deque->capacity == deque->size && expand_capacity(deque) != NUT_OK)
+    NutState status;
+
+    if (deque->capacity == deque->size && (status = expand_capacity(deque)) != NUT_OK)
+        return status;
+
+    if (deque->refs && deque_unshare(deque) != NUT_OK)
         return NUT_ERR_MALLOC;
 
     deque->buffer[deque->last] = element;
@@ -175,6 +253,74 @@ NutState nut_deque_add_last(Deque *deque, void *element)
     return NUT_OK;
 }
 
+/**
+ * Appends n elements to the back of the Deque. The elements are copied
+ * into the buffer in at most two blocks and the capacity is grown at most
+ * once.
+ *
+ * @param[in] deque Deque to which the elements are being added
+ * @param[in] elements the elements that are being added
+ * @param[in] n the number of elements
+ *
+ * @return NUT_OK if the elements were successfully added, NUT_ERR_MALLOC if
+ * the memory allocation for the new buffer failed, or NUT_ERR_MAX_CAPACITY
+ * if the Deque would exceed its maximum capacity.
+ */
+NutState nut_deque_add_all(Deque *deque, void * const *elements, size_t n)
+{
+    return nut_deque_add_all_at(deque, elements, n, deque->size);
+}
+
+/**
+ * Inserts n elements into the Deque at the specified index. The elements
+ * before or after the index are shifted by n, whichever side is shorter.
+ * The index may be equal to the size of the Deque, in which case the
+ * elements are appended.
+ *
+ * @param[in] deque Deque to which the elements are being added
+ * @param[in] elements the elements that are being added
+ * @param[in] n the number of elements
+ * @param[in] index position within the Deque at which the first element is
+ *                  being added
+ *
+ * @return NUT_OK if the elements were successfully added, NUT_ERR_OUT_OF_RANGE
+ * if the index was out of range, NUT_ERR_MALLOC if the memory allocation for
+ * the new buffer failed, or NUT_ERR_MAX_CAPACITY if the Deque would exceed
+ * its maximum capacity.
+ */
+NutState nut_deque_add_all_at(Deque *deque, void * const *elements, size_t n, size_t index)
+{
+    if (index > deque->size)
+        return NUT_ERR_OUT_OF_RANGE;
+
+    if (n > MAX_POW_TWO - deque->size)
+        return NUT_ERR_MAX_CAPACITY;
+
+    NutState status = nut_deque_reserve(deque, deque->size + n);
+
+    if (status != NUT_OK)
+        return status;
+
+    if (deque->refs && deque_unshare(deque) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    const size_t c = deque->capacity - 1;
+
+    if (index < deque->size - index) {
+        /* Open the gap by moving the front elements n slots down */
+        deque->first = (deque->first - n) & c;
+        ring_move(deque, 0, n, index);
+    } else {
+        ring_move(deque, index + n, index, deque->size - index);
+    }
+    ring_write(deque, index, elements, n);
+
+    deque->size += n;
+    deque->last  = (deque->first + deque->size) & c;
+
+    return NUT_OK;
+}
+
 /**
  * Inserts a new element at the specified index within the deque. The index
  * must be within the range of the Deque.
@@ -185,15 +331,21 @@ NutState nut_deque_add_last(Deque *deque, void *element)
  *                  is being added
  *
  * @return NUT_OK if the element was successfully added, NUT_ERR_OUT_OF_RANGE if
- * the specified index was not in range, or NUT_ERR_MALLOC if the memory
- * allocation for the new element failed.
+ * the specified index was not in range, NUT_ERR_MALLOC if the memory
+ * allocation for the new element failed, or NUT_ERR_MAX_CAPACITY if the
+ * Deque is full and cannot grow.
  */
 NutState nut_deque_add_at(Deque *deque, void *element, size_t index)
 {
     if (index >= deque->size)
         return NUT_ERR_OUT_OF_RANGE;
 
-    if (deque->capacity == deque->size && expand_capacity(deque) != NUT_OK)
+    NutState status;
+
+    if (deque->capacity == deque->size && (status = expand_capacity(deque)) != NUT_OK)
+        return status;
+
+    if (deque->refs && deque_unshare(deque) != NUT_OK)
         return NUT_ERR_MALLOC;
 
     const size_t c = deque->capacity - 1;
@@ -292,6 +444,9 @@ NutState nut_deque_replace_at(Deque *deque, void *element, size_t index, void **
     if (index >= deque->size)
         return NUT_ERR_OUT_OF_RANGE;
 
+    if (deque->refs && deque_unshare(deque) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
     size_t i = (deque->first + index) & (deque->capacity - 1);
 
     if (out)
@@ -343,6 +498,9 @@ NutState nut_deque_remove_at(Deque *deque, size_t index, void **out)
     if (index >= deque->size)
         return NUT_ERR_OUT_OF_RANGE;
 
+    if (deque->refs && deque_unshare(deque) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
     const size_t c = deque->capacity - 1;
     const size_t l = deque->last & c;
     const size_t f = deque->first & c;
@@ -548,8 +706,15 @@ NutState nut_deque_get_last(Deque const * const deque, void **out)
  * Creates a shallow copy of the specified Deque. A shallow copy is a copy of
  * the deque structure, but not the elements it holds.
  *
+ * The copy shares the buffer of the original Deque, so it is created in
+ * constant time. The buffer is copied only once either Deque is modified
+ * while the other one still holds it, by the first modifying call. A
+ * modifying call that returns no status leaves its Deque unchanged if that
+ * copy cannot be allocated.
+ *
  * @note The new Deque is allocated using the original Deques's allocators
- *       and it also inherits the configuration of the original Deque.
+ *       and it also inherits the configuration of the original Deque. The
+ *       copy of a Deque in caller memory gets its own buffer right away.
  *
  * @param[in] deque Deque to be copied
  * @param[out] out Pointer to where the newly created copy is stored
@@ -559,27 +724,28 @@ NutState nut_deque_get_last(Deque const * const deque, void **out)
  */
 NutState nut_deque_copy_shallow(Deque const * const deque, Deque **out)
 {
-    Deque *copy = deque->mem_alloc(sizeof(Deque));
+    /* The caller's buffer cannot be shared past the life of the deque */
+    if (deque->fixed)
+        return nut_deque_copy_deep(deque, NULL, out);
+
+    /* The share count is not part of the contents of the deque */
+    Deque *d    = (Deque*) deque;
+    Deque *copy = d->mem_alloc(sizeof(Deque));
 
     if (!copy)
         return NUT_ERR_MALLOC;
 
-    if (!(copy->buffer = deque->mem_alloc(deque->capacity * sizeof(void*)))) {
-        deque->mem_free(copy);
-        return NUT_ERR_MALLOC;
+    if (!d->refs) {
+        if (!(d->refs = d->mem_alloc(sizeof(size_t)))) {
+            d->mem_free(copy);
+            return NUT_ERR_MALLOC;
+        }
+        *d->refs = 1;
     }
-    copy->size       = deque->size;
-    copy->capacity   = deque->capacity;
-    copy->mem_alloc  = deque->mem_alloc;
-    copy->mem_calloc = deque->mem_calloc;
-    copy->mem_free   = deque->mem_free;
-
-    copy_buffer(deque, copy->buffer, NULL);
+    NUT_REF_INC(d->refs);
 
-    copy->first = 0;
-    copy->last  = copy->size;
-
-    *out = copy;
+    *copy = *d;
+    *out  = copy;
     return NUT_OK;
 }
 
@@ -612,32 +778,98 @@ NutState nut_deque_copy_deep(Deque const * const deque, void *(*cp) (void*), Deq
 
     copy->size       = deque->size;
     copy->capacity   = deque->capacity;
-    copy->mem_alloc  = deque->mem_alloc;
-    copy->mem_calloc = deque->mem_calloc;
-    copy->mem_free   = deque->mem_free;
+    copy->refs       = NULL;
+    copy->fixed      = false;
+    copy->mem_alloc   = deque->mem_alloc;
+    copy->mem_calloc  = deque->mem_calloc;
+    copy->mem_free    = deque->mem_free;
+    copy->mem_realloc = deque->mem_realloc;
 
     copy_buffer(deque, copy->buffer, cp);
 
     copy->first = 0;
-    copy->last  = copy->size;
+    copy->last  = copy->size & (copy->capacity - 1);
 
     *out = copy;
 
     return NUT_OK;
 }
 
+/**
+ * Removes the elements in the range from index <code>b</code> (inclusive) to
+ * index <code>e</code> (inclusive). The elements before or after the range
+ * are shifted to close the gap, whichever side is shorter. The elements
+ * themselves are not freed.
+ *
+ * @param[in] deque Deque from which the elements are being removed
+ * @param[in] b the beginning index (inclusive) of the range
+ * @param[in] e the end index (inclusive) of the range that must be within
+ *              the bounds of the Deque and must be greater or equal to the
+ *              beginning index
+ *
+ * @return NUT_OK if the elements were removed, or NUT_ERR_INVALID_RANGE if
+ * the specified index range is invalid.
+ */
+NutState nut_deque_remove_range(Deque *deque, size_t b, size_t e)
+{
+    if (b > e || e >= deque->size)
+        return NUT_ERR_INVALID_RANGE;
+
+    if (deque->refs && deque_unshare(deque) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    const size_t c = deque->capacity - 1;
+    const size_t n = e - b + 1;
+
+    if (b < deque->size - e - 1) {
+        ring_move(deque, n, 0, b);
+        deque->first = (deque->first + n) & c;
+    } else {
+        ring_move(deque, b, e + 1, deque->size - e - 1);
+    }
+    deque->size -= n;
+    deque->last  = (deque->first + deque->size) & c;
+
+    return NUT_OK;
+}
+
+/**
+ * Makes sure that the Deque can hold at least capacity elements without
+ * expanding. The capacity is rounded up to a power of two and is never
+ * reduced.
+ *
+ * @param[in] deque Deque whose capacity is being reserved
+ * @param[in] capacity the number of elements the Deque must be able to hold
+ *
+ * @return NUT_OK if the capacity was reserved, NUT_ERR_MALLOC if the memory
+ * allocation for the new buffer failed, or NUT_ERR_MAX_CAPACITY if the
+ * capacity exceeds the maximum capacity or the Deque cannot grow.
+ */
+NutState nut_deque_reserve(Deque *deque, size_t capacity)
+{
+    if (capacity <= deque->capacity)
+        return NUT_OK;
+
+    if (capacity > MAX_POW_TWO || deque->fixed)
+        return NUT_ERR_MAX_CAPACITY;
+
+    return deque_grow(deque, upper_pow_two(capacity));
+}
+
 /**
  * Trims the capacity of the deque to a power of 2 that is the nearest
- * upper power of 2 to the number of elements in the deque.
+ * upper power of 2 to the number of elements in the deque. A Deque in caller
+ * memory is left as it is.
  *
  * @param[in] deque Deque whose capacity is being trimmed
  *
  * @return NUT_OK if the capacity was trimmed successfully, or NUT_ERR_MALLOC if
- * the reallocation failed.
+ * the allocation of the new buffer failed. With a reallocator the trim always
+ * succeeds, since a block that cannot shrink is simply kept.
  */
 NutState nut_deque_trim_capacity(Deque *deque)
 {
-    if (deque->capacity == deque->size)
+    if (deque->capacity == deque->size || deque->fixed)
         return NUT_OK;
 
     size_t new_size = upper_pow_two(deque->size);
@@ -645,17 +877,47 @@ NutState nut_deque_trim_capacity(Deque *deque)
     if (new_size == deque->capacity)
         return NUT_OK;
 
+    if (deque->mem_realloc && !deque->refs) {
+        const size_t span = deque_head_span(deque);
+
+        /* Bring the elements within the first new_size slots, where the
+         * smaller mask expects them. Only the segment at the end of the
+         * buffer is moved, against the end of the new capacity. */
+        if (span < deque->size) {
+            memmove(&(deque->buffer[new_size - span]),
+                    &(deque->buffer[deque->first]),
+                    span * sizeof(void*));
+            deque->first = new_size - span;
+        } else if (deque->first >= new_size || deque->first + deque->size > new_size) {
+            memmove(deque->buffer,
+                    &(deque->buffer[deque->first]),
+                    deque->size * sizeof(void*));
+            deque->first = 0;
+        }
+        deque->capacity = new_size;
+        deque->last     = (deque->first + deque->size) & (new_size - 1);
+
+        void **new_buff = deque->mem_realloc(deque->buffer, sizeof(void*) * new_size);
+
+        /* The elements are already in place, so if the block cannot shrink
+         * the deque simply keeps using it and only the spare memory stays */
+        if (new_buff)
+            deque->buffer = new_buff;
+
+        return NUT_OK;
+    }
+
     void **new_buff = deque->mem_alloc(sizeof(void*) * new_size);
 
     if (!new_buff)
         return NUT_ERR_MALLOC;
 
     copy_buffer(deque, new_buff, NULL);
-    deque->mem_free(deque->buffer);
+    deque_release(deque);
 
     deque->buffer   = new_buff;
     deque->first    = 0;
-    deque->last     = deque->size;
+    deque->last     = deque->size & (new_size - 1);
     deque->capacity = new_size;
     return NUT_OK;
 }
@@ -672,6 +934,9 @@ void nut_deque_reverse(Deque *deque)
     size_t s = deque->size;
     size_t c = deque->capacity - 1;
 
+    if (deque->refs && deque_unshare(deque) != NUT_OK)
+        return;
+
     size_t first = deque->first;
 
     for (i = 0, j = s - 1; i < (s - 1) / 2; i++, j--) {
@@ -694,7 +959,10 @@ void nut_deque_reverse(Deque *deque)
  */
 size_t nut_deque_contains(Deque const * const deque, const void *element)
 {
-    return nut_deque_contains_value(deque, element, nut_common_cmp_ptr);
+    size_t head = deque_head_span(deque);
+
+    return nut_common_ptr_count(deque->buffer + deque->first, head, element)
+         + nut_common_ptr_count(deque->buffer, deque->size - head, element);
 }
 
 /**
@@ -733,16 +1001,17 @@ size_t nut_deque_contains_value(Deque const * const deque, const void *element,
  */
 NutState nut_deque_index_of(Deque const * const deque, const void *element, size_t *index)
 {
-    size_t i;
+    size_t head = deque_head_span(deque);
+    size_t i    = nut_common_ptr_find(deque->buffer + deque->first, head, element);
 
-    for (i = 0; i < deque->size; i++) {
-        size_t p = (deque->first + i) & (deque->capacity - 1);
-        if (deque->buffer[p] == element) {
-            *index = i;
-            return NUT_OK;
-        }
-    }
-    return NUT_ERR_OUT_OF_RANGE;
+    if (i == head)
+        i = head + nut_common_ptr_find(deque->buffer, deque->size - head, element);
+
+    if (i == deque->size)
+        return NUT_ERR_OUT_OF_RANGE;
+
+    *index = i;
+    return NUT_OK;
 }
 
 /**
@@ -786,6 +1055,226 @@ const void* const *nut_deque_get_buffer(Deque const * const deque)
     return (const void* const*) deque->buffer;
 }
 
+/**
+ * Sets the out parameters to the elements of the Deque as at most two
+ * contiguous runs of the buffer, in order: the first run starts at the
+ * first element and the second one, if the elements wrap around the end
+ * of the buffer, starts at the beginning of the buffer. A run that is not
+ * needed has a length of 0.
+ *
+ * The runs are views into the buffer and stay valid until the Deque is
+ * modified. They are normally followed by nut_deque_consume().
+ *
+ * @param[in] deque the deque whose elements are being returned
+ * @param[out] span1 pointer to where the first run is stored
+ * @param[out] n1 pointer to where the length of the first run is stored
+ * @param[out] span2 pointer to where the second run is stored
+ * @param[out] n2 pointer to where the length of the second run is stored
+ *
+ * @return the number of elements in the two runs, which is the size of the
+ * Deque.
+ */
+size_t nut_deque_peek_spans(Deque const * const deque, void * const **span1, size_t *n1,
+                            void * const **span2, size_t *n2)
+{
+    const size_t e = deque_head_span(deque);
+
+    *span1 = &(deque->buffer[deque->first]);
+    *n1    = e;
+    *span2 = deque->buffer;
+    *n2    = deque->size - e;
+
+    return deque->size;
+}
+
+/**
+ * Removes the first n elements of the Deque at once, without returning
+ * them. Used after the elements have been processed in place through
+ * nut_deque_peek_spans().
+ *
+ * @param[in] deque the deque from which the elements are being removed
+ * @param[in] n the number of elements being removed
+ *
+ * @return NUT_OK if the elements were removed, or NUT_ERR_OUT_OF_RANGE if
+ * the Deque holds fewer than n elements.
+ */
+NutState nut_deque_consume(Deque *deque, size_t n)
+{
+    if (n > deque->size)
+        return NUT_ERR_OUT_OF_RANGE;
+
+    deque->first = (deque->first + n) & (deque->capacity - 1);
+    deque->size -= n;
+
+    /* An empty deque can restart at the start of the buffer, which keeps
+     * the next batch in a single run */
+    if (deque->size == 0) {
+        deque->first = 0;
+        deque->last  = 0;
+    }
+    return NUT_OK;
+}
+
+/**
+ * Makes room for n elements at the back of the Deque and sets the out
+ * parameters to the free slots as at most two contiguous runs of the
+ * buffer, in order. The slots are filled in place and then appended with
+ * nut_deque_commit(). A run that is not needed has a length of 0.
+ *
+ * The runs stay valid until the Deque is modified by anything other than
+ * nut_deque_commit().
+ *
+ * @param[in] deque the deque to which the elements are going to be added
+ * @param[in] n the number of slots being reserved
+ * @param[out] span1 pointer to where the first run is stored
+ * @param[out] n1 pointer to where the length of the first run is stored
+ * @param[out] span2 pointer to where the second run is stored
+ * @param[out] n2 pointer to where the length of the second run is stored
+ *
+ * @return NUT_OK if the slots were reserved, NUT_ERR_MALLOC if the memory
+ * allocation for the new buffer failed, or NUT_ERR_MAX_CAPACITY if the
+ * Deque would exceed its maximum capacity or cannot grow.
+ */
+NutState nut_deque_reserve_spans(Deque *deque, size_t n, void ***span1, size_t *n1,
+                                 void ***span2, size_t *n2)
+{
+    if (n > MAX_POW_TWO - deque->size)
+        return NUT_ERR_MAX_CAPACITY;
+
+    NutState status = nut_deque_reserve(deque, deque->size + n);
+
+    if (status != NUT_OK)
+        return status;
+
+    if (deque->refs && deque_unshare(deque) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    /* The free slots run from last up to first, wrapping at most once */
+    const size_t e = deque->capacity - deque->last;
+
+    *span1 = &(deque->buffer[deque->last]);
+    *n1    = n < e ? n : e;
+    *span2 = deque->buffer;
+    *n2    = n - *n1;
+
+    return NUT_OK;
+}
+
+/**
+ * Appends the first n slots reserved by nut_deque_reserve_spans() to the
+ * back of the Deque. The slots must have been filled by the caller.
+ *
+ * @param[in] deque the deque to which the elements are being added
+ * @param[in] n the number of elements being added
+ *
+ * @return NUT_OK if the elements were added, or NUT_ERR_OUT_OF_RANGE if n
+ * exceeds the free capacity of the Deque.
+ */
+NutState nut_deque_commit(Deque *deque, size_t n)
+{
+    if (n > deque->capacity - deque->size)
+        return NUT_ERR_OUT_OF_RANGE;
+
+    deque->last  = (deque->last + n) & (deque->capacity - 1);
+    deque->size += n;
+
+    return NUT_OK;
+}
+
+/**
+ * Removes the last n elements of the Deque at once, without returning them.
+ * Works the same way as nut_deque_consume(), but at the back of the Deque.
+ *
+ * @param[in] deque the deque from which the elements are being removed
+ * @param[in] n the number of elements being removed
+ *
+ * @return NUT_OK if the elements were removed, or NUT_ERR_OUT_OF_RANGE if
+ * the Deque holds fewer than n elements.
+ */
+NutState nut_deque_consume_last(Deque *deque, size_t n)
+{
+    if (n > deque->size)
+        return NUT_ERR_OUT_OF_RANGE;
+
+    deque->last  = (deque->last - n) & (deque->capacity - 1);
+    deque->size -= n;
+
+    if (deque->size == 0) {
+        deque->first = 0;
+        deque->last  = 0;
+    }
+    return NUT_OK;
+}
+
+/**
+ * Makes room for n elements at the front of the Deque and sets the out
+ * parameters to the n free slots right before the first element as at most
+ * two contiguous runs of the buffer, in order. The slots are filled in
+ * place and then prepended with nut_deque_commit_first(). A run that is not
+ * needed has a length of 0.
+ *
+ * The runs stay valid until the Deque is modified by anything other than
+ * nut_deque_commit_first().
+ *
+ * @param[in] deque the deque to which the elements are going to be added
+ * @param[in] n the number of slots being reserved
+ * @param[out] span1 pointer to where the first run is stored
+ * @param[out] n1 pointer to where the length of the first run is stored
+ * @param[out] span2 pointer to where the second run is stored
+ * @param[out] n2 pointer to where the length of the second run is stored
+ *
+ * @return NUT_OK if the slots were reserved, NUT_ERR_MALLOC if the memory
+ * allocation for the new buffer failed, or NUT_ERR_MAX_CAPACITY if the
+ * Deque would exceed its maximum capacity or cannot grow.
+ */
+NutState nut_deque_reserve_spans_first(Deque *deque, size_t n, void ***span1, size_t *n1,
+                                       void ***span2, size_t *n2)
+{
+    if (n > MAX_POW_TWO - deque->size)
+        return NUT_ERR_MAX_CAPACITY;
+
+    NutState status = nut_deque_reserve(deque, deque->size + n);
+
+    if (status != NUT_OK)
+        return status;
+
+    if (deque->refs && deque_unshare(deque) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    /* The reserved slots end right before first, wrapping at most once */
+    const size_t start = (deque->first - n) & (deque->capacity - 1);
+    const size_t e     = deque->capacity - start;
+
+    *span1 = &(deque->buffer[start]);
+    *n1    = n < e ? n : e;
+    *span2 = deque->buffer;
+    *n2    = n - *n1;
+
+    return NUT_OK;
+}
+
+/**
+ * Prepends the last n slots reserved by nut_deque_reserve_spans_first(),
+ * which are the n slots right before the first element, to the front of
+ * the Deque. The slots must have been filled by the caller.
+ *
+ * @param[in] deque the deque to which the elements are being added
+ * @param[in] n the number of elements being added
+ *
+ * @return NUT_OK if the elements were added, or NUT_ERR_OUT_OF_RANGE if n
+ * exceeds the free capacity of the Deque.
+ */
+NutState nut_deque_commit_first(Deque *deque, size_t n)
+{
+    if (n > deque->capacity - deque->size)
+        return NUT_ERR_OUT_OF_RANGE;
+
+    deque->first = (deque->first - n) & (deque->capacity - 1);
+    deque->size += n;
+
+    return NUT_OK;
+}
+
 /**
  * Applies the function fn to each element of the Deque.
  *
@@ -886,22 +1375,15 @@ NutState nut_deque_filter(Deque *deque, bool (*pred) (const void*), Deque **out)
 static void copy_buffer(Deque const * const deque, void **buff, void *(*cp) (void *))
 {
     if (cp == NULL) {
-        if (deque->last > deque->first) {
-            memcpy(buff,
-                   &(deque->buffer[deque->first]),
-                   deque->size * sizeof(void*));
-        } else {
-            size_t l = deque->last;
-            size_t e = deque->capacity - deque->first;
+        size_t e = deque_head_span(deque);
 
-            memcpy(buff,
-                   &(deque->buffer[deque->first]),
-                   e * sizeof(void*));
+        memcpy(buff,
+               &(deque->buffer[deque->first]),
+               e * sizeof(void*));
 
-            memcpy(&(buff[e]),
-                   deque->buffer,
-                   l * sizeof(void*));
-        }
+        memcpy(&(buff[e]),
+               deque->buffer,
+               (deque->size - e) * sizeof(void*));
     } else {
         size_t i;
         for (i = 0; i < deque->size; i++) {
@@ -913,37 +1395,203 @@ static void copy_buffer(Deque const * const deque, void **buff, void *(*cp) (voi
 
 /**
  * Expands the deque capacity. This operation might fail if the new buffer
- * cannot be allocated. If the capacity is already the maximum capacity,
- * no new buffer is allocated.
+ * cannot be allocated. If the capacity is already the maximum capacity, or
+ * the buffer is the caller's, no new buffer is allocated.
  *
  * @param[in] deque the deque whose capacity is being expanded
  *
  * @return NUT_OK if the buffer was expanded successfully, NUT_ERR_MALLOC if
  * the memory allocation for the new buffer failed, or NUT_ERR_MAX_CAPACITY
- * if the Deque is already at maximum capacity.
+ * if the Deque is already at maximum capacity or cannot grow.
  */
 static NutState expand_capacity(Deque *deque)
 {
-    if (deque->capacity == MAX_POW_TWO)
+    if (deque->capacity == MAX_POW_TWO || deque->fixed)
         return NUT_ERR_MAX_CAPACITY;
 
-    size_t new_capacity = deque->capacity << 1;
-    void **new_buffer = deque->mem_calloc(new_capacity, sizeof(void*));
+    return deque_grow(deque, deque->capacity << 1);
+}
+
+/**
+ * Grows the buffer of the deque to the specified capacity, which must be a
+ * larger power of two.
+ *
+ * With a reallocator the buffer is grown in place. The elements that wrap
+ * around to the start of the old buffer are then either moved up past its
+ * end, or the elements at its end are moved up against the end of the new
+ * buffer, whichever are fewer. A shared buffer, or one without a
+ * reallocator, is copied to a new buffer instead.
+ *
+ * @param[in] deque the deque whose buffer is being grown
+ * @param[in] capacity the new capacity
+ *
+ * @return NUT_OK if the buffer was grown, or NUT_ERR_MALLOC if the memory
+ * allocation for the buffer failed.
+ */
+static NutState deque_grow(Deque *deque, size_t capacity)
+{
+    if (deque->mem_realloc && !deque->refs) {
+        void **new_buffer = deque->mem_realloc(deque->buffer, capacity * sizeof(void*));
+
+        if (!new_buffer)
+            return NUT_ERR_MALLOC;
+
+        const size_t span = deque_head_span(deque);
+        const size_t wrap = deque->size - span;
+
+        if (wrap > 0 && wrap <= span) {
+            memcpy(&(new_buffer[deque->capacity]),
+                   new_buffer,
+                   wrap * sizeof(void*));
+        } else if (wrap > 0) {
+            memcpy(&(new_buffer[capacity - span]),
+                   &(new_buffer[deque->first]),
+                   span * sizeof(void*));
+            deque->first = capacity - span;
+        }
+        deque->buffer   = new_buffer;
+        deque->capacity = capacity;
+        deque->last     = (deque->first + deque->size) & (capacity - 1);
+
+        return NUT_OK;
+    }
+
+    void **new_buffer = deque->mem_alloc(capacity * sizeof(void*));
 
     if (!new_buffer)
         return NUT_ERR_MALLOC;
 
     copy_buffer(deque, new_buffer, NULL);
-    deque->mem_free(deque->buffer);
+    deque_release(deque);
 
     deque->first    = 0;
-    deque->last     = deque->size;
-    deque->capacity = new_capacity;
+    deque->last     = deque->size & (capacity - 1);
+    deque->capacity = capacity;
     deque->buffer   = new_buffer;
 
     return NUT_OK;
 }
 
+/**
+ * Gives the deque a private copy of a buffer that it shares with other
+ * copies. If the other copies have all let go of the buffer in the
+ * meantime, the deque simply takes it over.
+ *
+ * @param[in] deque the deque whose buffer is shared
+ *
+ * @return NUT_OK if the deque owns its buffer, or NUT_ERR_MALLOC if the
+ * memory allocation for the copy failed.
+ */
+static NutState deque_unshare(Deque *deque)
+{
+    if (NUT_REF_GET(deque->refs) > 1) {
+        void **new_buffer = deque->mem_alloc(deque->capacity * sizeof(void*));
+
+        if (!new_buffer)
+            return NUT_ERR_MALLOC;
+
+        copy_buffer(deque, new_buffer, NULL);
+        deque_release(deque);
+
+        deque->first  = 0;
+        deque->last   = deque->size & (deque->capacity - 1);
+        deque->buffer = new_buffer;
+    } else {
+        deque->mem_free(deque->refs);
+        deque->refs = NULL;
+    }
+    return NUT_OK;
+}
+
+/**
+ * Lets go of the buffer of the deque before it is replaced or the deque is
+ * destroyed. The buffer is freed unless another copy still shares it.
+ *
+ * @param[in] deque the deque whose buffer is being released
+ */
+static void deque_release(Deque *deque)
+{
+    if (deque->refs) {
+        if (NUT_REF_DEC(deque->refs) != 0) {
+            deque->refs = NULL;
+            return;
+        }
+        deque->mem_free(deque->refs);
+        deque->refs = NULL;
+    }
+    deque->mem_free(deque->buffer);
+}
+
+/**
+ * Returns the number of elements from the first element up to the end of
+ * the buffer. The remaining size - span elements, if any, wrap around to
+ * the start of the buffer.
+ */
+static size_t deque_head_span(Deque const * const deque)
+{
+    size_t span = deque->capacity - deque->first;
+    return deque->size < span ? deque->size : span;
+}
+
+/**
+ * Moves n elements from the logical index src to the logical index dst. The
+ * ranges may overlap and either of them may wrap around the end of the
+ * buffer, so the move is done in contiguous blocks, starting from the end
+ * that does not overwrite elements that are still to be moved.
+ */
+static void ring_move(Deque *deque, size_t dst, size_t src, size_t n)
+{
+    const size_t c   = deque->capacity - 1;
+    void       **buf = deque->buffer;
+
+    if (dst < src) {
+        while (n > 0) {
+            size_t s = (deque->first + src) & c;
+            size_t d = (deque->first + dst) & c;
+            size_t k = n;
+
+            if (k > deque->capacity - s)
+                k = deque->capacity - s;
+            if (k > deque->capacity - d)
+                k = deque->capacity - d;
+
+            memmove(&buf[d], &buf[s], k * sizeof(void*));
+            src += k;
+            dst += k;
+            n   -= k;
+        }
+    } else if (dst > src) {
+        while (n > 0) {
+            size_t s = (deque->first + src + n - 1) & c;
+            size_t d = (deque->first + dst + n - 1) & c;
+            size_t k = n;
+
+            if (k > s + 1)
+                k = s + 1;
+            if (k > d + 1)
+                k = d + 1;
+
+            memmove(&buf[d + 1 - k], &buf[s + 1 - k], k * sizeof(void*));
+            n -= k;
+        }
+    }
+}
+
+/**
+ * Copies n elements into the buffer starting at the logical index.
+ */
+static void ring_write(Deque *deque, size_t index, void * const *elements, size_t n)
+{
+    size_t p    = (deque->first + index) & (deque->capacity - 1);
+    size_t head = deque->capacity - p;
+
+    if (head > n)
+        head = n;
+
+    memcpy(&deque->buffer[p], elements, head * sizeof(void*));
+    memcpy(deque->buffer, elements + head, (n - head) * sizeof(void*));
+}
+
 /**
  * Rounds the integer to the nearest upper power of two.
  *
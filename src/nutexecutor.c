@@ -0,0 +1,229 @@
+#include "nutconf.h"
+#include "nutport.h"
+#include "nutmem.h"
+
+#include "nutexecutor.h"
+
+#ifdef OS_POSIX
+#include <unistd.h>
+#endif
+
+static void serial_run(Executor *ex, size_t tasks, void (*task) (void*, size_t), void *arg);
+
+static Executor serial = { 1, serial_run };
+
+
+/**
+ * Returns the executor that runs every task in the calling thread, one
+ * after the other. It is always available and needs no cleanup.
+ *
+ * @return the serial executor
+ */
+Executor *nut_executor_serial(void)
+{
+    return &serial;
+}
+
+static void serial_run(Executor *ex, size_t tasks, void (*task) (void*, size_t), void *arg)
+{
+    (void) ex;
+
+    size_t i;
+    for (i = 0; i < tasks; i++)
+        task(arg, i);
+}
+
+
+#ifdef OS_POSIX
+
+/*******************************************************************************
+ *
+ *
+ *  Thread pool
+ *
+ *
+ ******************************************************************************/
+
+/*
+ * The pool threads sleep on the start condition until a new batch is
+ * published, which bumps the generation. The threads and the caller then
+ * claim task indices one at a time under the lock until the batch is
+ * exhausted. The caller returns once the finished count reaches the number
+ * of tasks, so no thread touches the batch after run has returned.
+ */
+typedef struct pool_s {
+    Executor         base;
+
+    pthread_t       *threads;
+    size_t           thread_count;
+
+    pthread_mutex_t  lock;
+    pthread_cond_t   start;
+    pthread_cond_t   done;
+
+    /* Serializes the callers of run */
+    pthread_mutex_t  run_lock;
+
+    void           (*task) (void*, size_t);
+    void            *arg;
+    size_t           tasks;
+    size_t           next;
+    size_t           finished;
+    unsigned long    generation;
+    bool             stop;
+} Pool;
+
+static void  pool_run    (Executor *ex, size_t tasks, void (*task) (void*, size_t), void *arg);
+static void *pool_worker (void *p);
+static void  pool_drain  (Pool *pool);
+
+
+/**
+ * Creates a new executor backed by a pool of threads. The calling thread of
+ * run works on the tasks too, so the pool starts threads - 1 threads.
+ *
+ * @param[in] threads the number of threads that run tasks, or 0 for the
+ *                    number of online processors
+ * @param[out] out pointer to where the new executor is to be stored
+ *
+ * @return NUT_OK if the creation was successful, or NUT_ERR_MALLOC if the
+ * memory allocation or the creation of a thread failed.
+ */
+NutState nut_executor_pool_new(size_t threads, Executor **out)
+{
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (size_t) cpus : 1;
+    }
+
+    Pool *pool = nut_mem_malloc(sizeof(Pool));
+
+    if (!pool)
+        return NUT_ERR_MALLOC;
+
+    memset(pool, 0, sizeof(Pool));
+
+    pool->threads = nut_mem_malloc(threads * sizeof(pthread_t));
+
+    if (!pool->threads) {
+        nut_mem_free(pool);
+        return NUT_ERR_MALLOC;
+    }
+    pool->base.workers = threads;
+    pool->base.run     = pool_run;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_mutex_init(&pool->run_lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (; pool->thread_count < threads - 1; pool->thread_count++) {
+        if (pthread_create(&pool->threads[pool->thread_count], NULL, pool_worker, pool) != 0) {
+            nut_executor_pool_destroy(&pool->base);
+            return NUT_ERR_MALLOC;
+        }
+    }
+
+    *out = &pool->base;
+    return NUT_OK;
+}
+
+/**
+ * Stops the threads of the pool and destroys the executor. The executor
+ * must not be running a batch.
+ *
+ * @param[in] ex the executor created by nut_executor_pool_new()
+ */
+void nut_executor_pool_destroy(Executor *ex)
+{
+    Pool  *pool = (Pool*) ex;
+    size_t i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->thread_count; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->run_lock);
+    pthread_mutex_destroy(&pool->lock);
+
+    nut_mem_free(pool->threads);
+    nut_mem_free(pool);
+}
+
+static void pool_run(Executor *ex, size_t tasks, void (*task) (void*, size_t), void *arg)
+{
+    Pool *pool = (Pool*) ex;
+
+    if (tasks <= 1 || pool->thread_count == 0) {
+        serial_run(ex, tasks, task, arg);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->run_lock);
+    pthread_mutex_lock(&pool->lock);
+
+    pool->task     = task;
+    pool->arg      = arg;
+    pool->tasks    = tasks;
+    pool->next     = 0;
+    pool->finished = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+
+    pool_drain(pool);
+
+    while (pool->finished < pool->tasks)
+        pthread_cond_wait(&pool->done, &pool->lock);
+
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->run_lock);
+}
+
+static void *pool_worker(void *p)
+{
+    Pool          *pool = p;
+    unsigned long  seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && seen == pool->generation)
+            pthread_cond_wait(&pool->start, &pool->lock);
+
+        if (pool->stop)
+            break;
+
+        seen = pool->generation;
+        pool_drain(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/**
+ * Runs tasks of the current batch until none are left. Called and returns
+ * with the pool lock held.
+ */
+static void pool_drain(Pool *pool)
+{
+    while (pool->next < pool->tasks) {
+        void (*task) (void*, size_t) = pool->task;
+        void  *arg = pool->arg;
+        size_t i   = pool->next++;
+
+        pthread_mutex_unlock(&pool->lock);
+        task(arg, i);
+        pthread_mutex_lock(&pool->lock);
+
+        if (++pool->finished == pool->tasks)
+            pthread_cond_broadcast(&pool->done);
+    }
+}
+
+#endif /* OS_POSIX */
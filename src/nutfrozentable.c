@@ -0,0 +1,505 @@
+#include "nutconf.h"
+#include "nutport.h"
+#include "nutmem.h"
+
+#include "nutfrozentable.h"
+#include "nuthash_internal.h"
+
+#define FROZEN_MAGIC 0x4E555446u /* 'NUTF' */
+
+/* Average number of keys per displacement bucket */
+#define KEYS_PER_BUCKET 3
+
+/* A displacement with this bit set stores the slot of a single key bucket */
+#define DISP_DIRECT 0x80000000u
+
+/* Displacements tried per bucket before the build is restarted with a new seed */
+#define MAX_DISPLACEMENT (1u << 16)
+
+/* Seeds tried before the build gives up */
+#define MAX_SEEDS 32
+
+#define GOLDEN 0x9E3779B9u
+
+/*
+ * The frozen table is a single block laid out as follows, each part aligned
+ * to 4 bytes and the value array aligned to 8 bytes:
+ *
+ *   struct frozen_table_s   header
+ *   uint32_t                disp[buckets]
+ *   FrozenSlot              slots[size]
+ *   uint8_t                 values[size * value_stride]
+ *   uint8_t                 keys[]
+ *
+ * The bucket of a key is taken from the high bits of its hash. The
+ * displacement of the bucket either names the slot directly, if the bucket
+ * holds a single key, or is mixed into the hash to select the slot.
+ */
+struct frozen_table_s {
+    uint32_t magic;
+    uint32_t total_size;
+    uint32_t size;
+    uint32_t buckets;
+    uint32_t seed;
+    int32_t  key_len;
+    uint32_t value_size;
+    uint32_t value_stride;
+};
+
+/*
+ * Placed in front of a table built by nut_hashtable_freeze(), outside of
+ * the block returned by nut_frozentable_data(), so that the block itself
+ * stays free of pointers. The union keeps the table 8 byte aligned.
+ */
+typedef union frozen_owner_u {
+    void   (*mem_free) (void *block);
+    uint64_t align;
+} FrozenOwner;
+
+typedef struct frozen_slot_s {
+    uint32_t hash;
+    uint32_t key_offset;
+    uint32_t key_len;
+} FrozenSlot;
+
+/* A key of the source table while the frozen table is being built */
+typedef struct freeze_key_s {
+    const void *key;
+    void       *value;
+    uint32_t    len;
+    uint32_t    hash;
+    uint32_t    slot;
+} FreezeKey;
+
+static bool     place_keys     (FreezeKey *keys, uint32_t n, uint32_t r, uint32_t seed,
+                                uint32_t *disp, uint8_t *taken, uint32_t *order,
+                                uint32_t *start);
+static uint32_t slot_of        (uint32_t hash, uint32_t disp, uint32_t size);
+
+/**
+ * Offsets of the parts of a frozen table with the given dimensions.
+ */
+static INLINE size_t disp_offset(void)
+{
+    return sizeof(FrozenTable);
+}
+
+static INLINE size_t slots_offset(uint32_t buckets)
+{
+    return disp_offset() + (size_t) buckets * sizeof(uint32_t);
+}
+
+static INLINE size_t values_offset(uint32_t buckets, uint32_t size)
+{
+    size_t off = slots_offset(buckets) + (size_t) size * sizeof(FrozenSlot);
+    return (off + 7) & ~((size_t) 7);
+}
+
+static INLINE size_t keys_offset(uint32_t buckets, uint32_t size, uint32_t stride)
+{
+    return values_offset(buckets, size) + (size_t) size * stride;
+}
+
+/**
+ * Multiplies the two 32bit numbers and returns the high half, which maps
+ * x uniformly onto [0, range) without a division.
+ */
+static INLINE uint32_t reduce(uint32_t x, uint32_t range)
+{
+    return (uint32_t) (((uint64_t) x * range) >> 32);
+}
+
+static INLINE uint32_t fmix32(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+
+    return h;
+}
+
+/**
+ * Builds an immutable FrozenTable from the contents of the specified
+ * HashTable. The HashTable is not modified and may be destroyed once the
+ * frozen table is built.
+ *
+ * If value_size is 0 the values are stored as pointers, so the frozen table
+ * is only meaningful within the image that built it. Otherwise value_size
+ * bytes are copied from each value pointer into the table, which makes it
+ * self contained and suitable for generating offline. A NULL value is
+ * stored as value_size zero bytes.
+ *
+ * The table and the memory used while building it are allocated with the
+ * allocators of the source table.
+ *
+ * @note The table may not contain a NULL key.
+ *
+ * @param[in] table the table whose entries are being frozen
+ * @param[in] value_size the number of bytes copied from each value, or 0 if
+ *                       the value pointers are stored as they are
+ * @param[out] out pointer to where the newly built FrozenTable is stored
+ *
+ * @return NUT_OK if the table was built, NUT_ERR_MALLOC if a memory
+ * allocation failed, NUT_ERR_MAX_CAPACITY if the table does not fit in the
+ * 32bit layout, or NUT_ERR if the table contains a NULL key or no perfect
+ * hash could be found because two keys share a hash for every seed.
+ */
+NutState nut_hashtable_freeze(HashTable *table, size_t value_size, FrozenTable **out)
+{
+    const size_t n       = nut_hashtable_size(table);
+    const int    key_len = nut_hashtable_key_length(table);
+
+    if (n > UINT32_MAX / KEYS_PER_BUCKET || value_size > UINT32_MAX / 2)
+        return NUT_ERR_MAX_CAPACITY;
+
+    const uint32_t size    = (uint32_t) n;
+    const uint32_t buckets = (size + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET;
+    const uint32_t stride  = value_size ? (uint32_t) ((value_size + 3) & ~((size_t) 3))
+                                        : (uint32_t) sizeof(void*);
+
+    HashTableConf mem;
+    nut_hashtable_mem_conf(table, &mem);
+
+    FreezeKey *keys  = mem.mem_alloc((n + 1) * sizeof(FreezeKey));
+    uint32_t  *disp  = mem.mem_alloc((buckets + 1) * sizeof(uint32_t));
+    uint32_t  *order = mem.mem_alloc((n + 1) * sizeof(uint32_t));
+    uint32_t  *start = mem.mem_alloc((buckets + 1) * sizeof(uint32_t));
+    uint8_t   *taken = mem.mem_alloc(n + 1);
+
+    NutState    status = NUT_OK;
+    FrozenTable *ft    = NULL;
+
+    if (!keys || !disp || !order || !start || !taken) {
+        status = NUT_ERR_MALLOC;
+        goto out;
+    }
+
+    size_t        key_bytes = 0;
+    size_t        i         = 0;
+    HashTableIter iter;
+    TableEntry   *entry;
+
+    nut_hashtable_iter_init(&iter, table);
+    while (nut_hashtable_iter_next(&iter, &entry) != NUT_ITER_END) {
+        if (!entry->key) {
+            status = NUT_ERR;
+            goto out;
+        }
+        size_t len = key_len < 0 ? strlen(entry->key) : (size_t) key_len;
+
+        keys[i].key   = entry->key;
+        keys[i].value = entry->value;
+        keys[i].len   = (uint32_t) len;
+        key_bytes    += len;
+        i++;
+    }
+
+    size_t total = keys_offset(buckets, size, stride) + key_bytes;
+
+    if (total > UINT32_MAX || key_bytes > UINT32_MAX) {
+        status = NUT_ERR_MAX_CAPACITY;
+        goto out;
+    }
+
+    uint32_t seed;
+    for (seed = 0; seed < MAX_SEEDS; seed++) {
+        if (place_keys(keys, size, buckets, seed, disp, taken, order, start))
+            break;
+    }
+    if (seed == MAX_SEEDS) {
+        status = NUT_ERR;
+        goto out;
+    }
+
+    FrozenOwner *owner = mem.mem_alloc(sizeof(FrozenOwner) + total);
+
+    if (!owner) {
+        status = NUT_ERR_MALLOC;
+        goto out;
+    }
+    owner->mem_free = mem.mem_free;
+    ft = (FrozenTable*) (owner + 1);
+
+    uint8_t    *base  = (uint8_t*) ft;
+    FrozenSlot *slots = (FrozenSlot*) (base + slots_offset(buckets));
+    uint8_t    *vals  = base + values_offset(buckets, size);
+    uint8_t    *kdata = base + keys_offset(buckets, size, stride);
+
+    memset(base, 0, keys_offset(buckets, size, stride));
+
+    ft->magic        = FROZEN_MAGIC;
+    ft->total_size   = (uint32_t) total;
+    ft->size         = size;
+    ft->buckets      = buckets;
+    ft->seed         = seed;
+    ft->key_len      = key_len;
+    ft->value_size   = (uint32_t) value_size;
+    ft->value_stride = stride;
+
+    memcpy(base + disp_offset(), disp, (size_t) buckets * sizeof(uint32_t));
+
+    uint32_t koff = 0;
+    for (i = 0; i < n; i++) {
+        FrozenSlot *s = &slots[keys[i].slot];
+
+        s->hash       = keys[i].hash;
+        s->key_offset = koff;
+        s->key_len    = keys[i].len;
+
+        memcpy(kdata + koff, keys[i].key, keys[i].len);
+        koff += keys[i].len;
+
+        /* A NULL value is left zero filled */
+        if (value_size && keys[i].value)
+            memcpy(vals + (size_t) keys[i].slot * stride, keys[i].value, value_size);
+        else if (!value_size)
+            memcpy(vals + (size_t) keys[i].slot * stride, &keys[i].value, sizeof(void*));
+    }
+
+    *out = ft;
+
+out:
+    mem.mem_free(keys);
+    mem.mem_free(disp);
+    mem.mem_free(order);
+    mem.mem_free(start);
+    mem.mem_free(taken);
+
+    return status;
+}
+
+/**
+ * Destroys a FrozenTable built by nut_hashtable_freeze(). Tables obtained
+ * from nut_frozentable_from_data() are owned by the caller and must not be
+ * passed to this function.
+ *
+ * @param[in] table the table that is being destroyed
+ */
+void nut_frozentable_destroy(FrozenTable *table)
+{
+    FrozenOwner *owner = (FrozenOwner*) table - 1;
+    owner->mem_free(owner);
+}
+
+/**
+ * Gets the value associated with the specified key and sets the out
+ * parameter to it. If the table was frozen with a value_size, the out
+ * parameter points to the copy of the value inside the table.
+ *
+ * @param[in] table the table from which the value is being returned
+ * @param[in] key the key that is being looked up
+ * @param[out] out pointer to where the value is stored
+ *
+ * @return NUT_OK if the key was found, or NUT_ERR_KEY_NOT_FOUND if not.
+ */
+NutState nut_frozentable_get(const FrozenTable *table, const void *key, void **out)
+{
+    if (!key || table->size == 0)
+        return NUT_ERR_KEY_NOT_FOUND;
+
+    const uint8_t *base = (const uint8_t*) table;
+    const size_t   len  = table->key_len < 0 ? strlen(key) : (size_t) table->key_len;
+    const uint32_t hash = (uint32_t) nut_hashtable_hash_wy(key, (int) len, table->seed);
+
+    const uint32_t   *disp = (const uint32_t*) (base + disp_offset());
+    const FrozenSlot *s    = (const FrozenSlot*) (base + slots_offset(table->buckets));
+    const uint32_t    slot = slot_of(hash, disp[reduce(hash, table->buckets)], table->size);
+
+    s += slot;
+
+    if (s->hash != hash || s->key_len != len)
+        return NUT_ERR_KEY_NOT_FOUND;
+
+    const uint8_t *kdata = base + keys_offset(table->buckets, table->size, table->value_stride);
+
+    if (memcmp(kdata + s->key_offset, key, len) != 0)
+        return NUT_ERR_KEY_NOT_FOUND;
+
+    const uint8_t *val = base + values_offset(table->buckets, table->size)
+        + (size_t) slot * table->value_stride;
+
+    if (table->value_size)
+        *out = (void*) val;
+    else
+        memcpy(out, val, sizeof(void*));
+
+    return NUT_OK;
+}
+
+/**
+ * Checks whether or not the FrozenTable contains the specified key.
+ *
+ * @param[in] table the table on which the search is being performed
+ * @param[in] key the key that is being searched for
+ *
+ * @return true if the table contains the key.
+ */
+bool nut_frozentable_contains_key(const FrozenTable *table, const void *key)
+{
+    void *val;
+    return nut_frozentable_get(table, key, &val) == NUT_OK;
+}
+
+/**
+ * Returns the number of key-value mappings in the FrozenTable.
+ *
+ * @param[in] table the table whose size is being returned
+ *
+ * @return the size of the table.
+ */
+size_t nut_frozentable_size(const FrozenTable *table)
+{
+    return table->size;
+}
+
+/**
+ * Returns the memory block of the FrozenTable so that it can be stored,
+ * and sets the size parameter to its length in bytes.
+ *
+ * @param[in] table the table whose data is being returned
+ * @param[out] size pointer to where the size of the block is stored
+ *
+ * @return the memory block of the table.
+ */
+const void *nut_frozentable_data(const FrozenTable *table, size_t *size)
+{
+    *size = table->total_size;
+    return table;
+}
+
+/**
+ * Uses a memory block previously returned by nut_frozentable_data() as a
+ * FrozenTable. The block is used in place and is not copied, so it may
+ * reside in read-only memory. It must be aligned to 8 bytes and must stay
+ * valid for as long as the table is used.
+ *
+ * @param[in] data the memory block of the table
+ * @param[in] size the size of the memory block in bytes
+ * @param[out] out pointer to where the table is stored
+ *
+ * @return NUT_OK if the block holds a valid table, or NUT_ERR if the block
+ * is misaligned, truncated, or was built for a different byte order or
+ * pointer size.
+ */
+NutState nut_frozentable_from_data(const void *data, size_t size, const FrozenTable **out)
+{
+    const FrozenTable *table = data;
+
+    if (((uintptr_t) data & 7) != 0 || size < sizeof(FrozenTable))
+        return NUT_ERR;
+
+    if (table->magic != FROZEN_MAGIC || table->total_size > size)
+        return NUT_ERR;
+
+    if (table->value_size == 0 && table->value_stride != sizeof(void*))
+        return NUT_ERR;
+
+    if (keys_offset(table->buckets, table->size, table->value_stride) > table->total_size)
+        return NUT_ERR;
+
+    *out = table;
+    return NUT_OK;
+}
+
+/**
+ * Returns the slot of a hash given the displacement of its bucket.
+ */
+static INLINE uint32_t slot_of(uint32_t hash, uint32_t disp, uint32_t size)
+{
+    if (disp & DISP_DIRECT)
+        return disp & ~DISP_DIRECT;
+
+    return reduce(fmix32(hash ^ (disp * GOLDEN)), size);
+}
+
+/**
+ * Tries to find a displacement for every bucket with the given seed. The
+ * buckets are placed from the largest to the smallest while the table is
+ * still mostly empty, and the buckets with a single key are then assigned
+ * the remaining free slots directly.
+ *
+ * @return true if every key was given a distinct slot.
+ */
+static bool place_keys(FreezeKey *keys, uint32_t n, uint32_t r, uint32_t seed,
+                       uint32_t *disp, uint8_t *taken, uint32_t *order,
+                       uint32_t *start)
+{
+    uint32_t i;
+    uint32_t b;
+
+    memset(taken, 0, n);
+    memset(start, 0, ((size_t) r + 1) * sizeof(uint32_t));
+
+    /* Group the keys by bucket */
+    for (i = 0; i < n; i++) {
+        keys[i].hash = (uint32_t) nut_hashtable_hash_wy(keys[i].key, (int) keys[i].len, seed);
+        start[reduce(keys[i].hash, r) + 1]++;
+    }
+    uint32_t max = 0;
+    for (b = 0; b < r; b++) {
+        if (start[b + 1] > max)
+            max = start[b + 1];
+        start[b + 1] += start[b];
+    }
+    for (i = 0; i < n; i++)
+        disp[reduce(keys[i].hash, r)] = 0;
+    for (i = 0; i < n; i++) {
+        b = reduce(keys[i].hash, r);
+        order[start[b] + disp[b]++] = i;
+    }
+
+    /* Place the buckets with several keys, largest first */
+    uint32_t len;
+    for (len = max; len > 1; len--) {
+        for (b = 0; b < r; b++) {
+            if (start[b + 1] - start[b] != len)
+                continue;
+
+            const uint32_t *bk = &order[start[b]];
+            uint32_t        d;
+
+            for (d = 0; d < MAX_DISPLACEMENT; d++) {
+                uint32_t k;
+
+                for (k = 0; k < len; k++) {
+                    uint32_t s = slot_of(keys[bk[k]].hash, d, n);
+
+                    if (taken[s])
+                        break;
+                    taken[s]         = 2;
+                    keys[bk[k]].slot = s;
+                }
+                if (k == len)
+                    break;
+
+                while (k--)
+                    taken[keys[bk[k]].slot] = 0;
+            }
+            if (d == MAX_DISPLACEMENT)
+                return false;
+
+            for (i = 0; i < len; i++)
+                taken[keys[bk[i]].slot] = 1;
+
+            disp[b] = d;
+        }
+    }
+
+    /* Give the single key buckets the remaining slots */
+    uint32_t free_slot = 0;
+    for (b = 0; b < r; b++) {
+        if (start[b + 1] - start[b] == 0) {
+            disp[b] = 0;
+        } else if (start[b + 1] - start[b] == 1) {
+            while (taken[free_slot])
+                free_slot++;
+
+            taken[free_slot]           = 1;
+            keys[order[start[b]]].slot = free_slot;
+            disp[b]                    = DISP_DIRECT | free_slot;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,281 @@
+#ifndef __NUTHASH_INTERNAL_H__
+#define __NUTHASH_INTERNAL_H__
+
+/*
+ * Internal to the hash containers in src/. Not installed and not part of
+ * the public API.
+ */
+
+#include <stddef.h>
+
+#include "nutcommon.h"
+#include "nuthashtable.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NUT_HASH_SSE2 1
+#endif
+
+
+void nut_hashtable_mem_conf(HashTable const *table, HashTableConf *conf);
+
+
+/*******************************************************************************
+ *
+ *
+ *  Open addressing control bytes
+ *
+ *
+ ******************************************************************************/
+
+/*
+ * Shared by the open addressing layout of the HashTable and by the HashSet.
+ * Every slot has a control byte that is either EMPTY, DELETED or the low 7
+ * bits of the hash (H2) if the slot is full. Control bytes are matched a
+ * whole group at a time. The control array has capacity + GROUP_WIDTH
+ * bytes: the first GROUP_WIDTH bytes are mirrored past the end so that a
+ * group can be loaded from any slot without wrapping around.
+ */
+#define CTRL_EMPTY   ((uint8_t) 0x80)
+#define CTRL_DELETED ((uint8_t) 0xFE)
+
+#define H1(hash) ((hash) >> 7)
+#define H2(hash) ((uint8_t) ((hash) & 0x7F))
+
+/* Returned by ctrl_probe_next() once the probe sequence is exhausted */
+#define CTRL_PROBE_END ((size_t) -1)
+
+#ifdef NUT_HASH_SSE2
+#define GROUP_WIDTH 16
+#define GROUP_SHIFT 0
+typedef uint32_t GroupMask;
+#else
+#define GROUP_WIDTH 8
+#define GROUP_SHIFT 3
+typedef uint64_t GroupMask;
+#endif
+
+/* State of a probe for the candidate slots of one hash */
+typedef struct ctrl_probe_s {
+    const uint8_t *ctrl;
+    size_t         mask;
+    size_t         pos;
+    size_t         step;
+    GroupMask      match;
+    uint8_t        h2;
+} CtrlProbe;
+
+
+#ifdef NUT_HASH_SSE2
+
+static INLINE GroupMask group_match(const uint8_t *ctrl, uint8_t h2)
+{
+    __m128i g = _mm_loadu_si128((const __m128i*) ctrl);
+    return (GroupMask) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char) h2), g));
+}
+
+static INLINE GroupMask group_match_empty(const uint8_t *ctrl)
+{
+    __m128i g = _mm_loadu_si128((const __m128i*) ctrl);
+    return (GroupMask) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char) CTRL_EMPTY), g));
+}
+
+/* Both EMPTY and DELETED are the only control bytes with the high bit set */
+static INLINE GroupMask group_match_free(const uint8_t *ctrl)
+{
+    return (GroupMask) _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) ctrl));
+}
+
+#else
+
+/*
+ * Portable SWAR fallback that treats eight control bytes as one 64bit word.
+ * The match may report a false positive when a byte differs from h2 only in
+ * its lowest bit, which is harmless since every candidate is compared
+ * against the key anyway.
+ */
+#define SWAR_LSBS ((uint64_t) 0x0101010101010101ULL)
+#define SWAR_MSBS ((uint64_t) 0x8080808080808080ULL)
+
+static INLINE uint64_t group_load(const uint8_t *ctrl)
+{
+    uint64_t g;
+    memcpy(&g, ctrl, sizeof(g));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    g = __builtin_bswap64(g);
+#endif
+    return g;
+}
+
+static INLINE GroupMask group_match(const uint8_t *ctrl, uint8_t h2)
+{
+    uint64_t x = group_load(ctrl) ^ (SWAR_LSBS * h2);
+    return (x - SWAR_LSBS) & ~x & SWAR_MSBS;
+}
+
+static INLINE GroupMask group_match_empty(const uint8_t *ctrl)
+{
+    uint64_t g = group_load(ctrl);
+    return (g & (~g << 6)) & SWAR_MSBS;
+}
+
+static INLINE GroupMask group_match_free(const uint8_t *ctrl)
+{
+    uint64_t g = group_load(ctrl);
+    return (g & ~(g << 7)) & SWAR_MSBS;
+}
+
+#endif /* NUT_HASH_SSE2 */
+
+/**
+ * Returns the position within the group of the lowest set bit of the mask.
+ */
+static INLINE size_t group_mask_first(GroupMask mask)
+{
+#if defined(__GNUC__)
+    return (size_t) __builtin_ctzll((unsigned long long) mask) >> GROUP_SHIFT;
+#else
+    size_t i = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        i++;
+    }
+    return i >> GROUP_SHIFT;
+#endif
+}
+
+/**
+ * Allocates a control array for the specified capacity with every slot
+ * marked as empty.
+ *
+ * @return the control array, or NULL if the allocation failed.
+ */
+static INLINE uint8_t *ctrl_alloc(size_t capacity, void *(*mem_alloc) (size_t size))
+{
+    uint8_t *ctrl = mem_alloc(capacity + GROUP_WIDTH);
+
+    if (ctrl)
+        memset(ctrl, CTRL_EMPTY, capacity + GROUP_WIDTH);
+
+    return ctrl;
+}
+
+/**
+ * Marks every slot as empty.
+ */
+static INLINE void ctrl_clear(uint8_t *ctrl, size_t capacity)
+{
+    memset(ctrl, CTRL_EMPTY, capacity + GROUP_WIDTH);
+}
+
+/**
+ * Sets the control byte of the slot i and of its mirror.
+ */
+static INLINE void ctrl_set(uint8_t *ctrl, size_t capacity, size_t i, uint8_t c)
+{
+    ctrl[i] = c;
+    if (i < GROUP_WIDTH)
+        ctrl[capacity + i] = c;
+}
+
+/**
+ * Returns the index of the first full slot at or after the index from, or
+ * the capacity if there are no more full slots.
+ */
+static INLINE size_t ctrl_next_full(const uint8_t *ctrl, size_t capacity, size_t from)
+{
+    size_t i;
+    for (i = from; i < capacity; i++) {
+        if (!(ctrl[i] & CTRL_EMPTY))
+            return i;
+    }
+    return capacity;
+}
+
+/**
+ * Returns the index of the first empty or deleted slot on the probe sequence
+ * of the specified hash. The probe sequence visits whole groups of slots in
+ * triangular steps.
+ */
+static INLINE size_t ctrl_find_free(const uint8_t *ctrl, size_t capacity, size_t hash)
+{
+    const size_t mask = capacity - 1;
+
+    size_t pos  = H1(hash) & mask;
+    size_t step = 0;
+
+    for (;;) {
+        GroupMask avail = group_match_free(&(ctrl[pos]));
+
+        if (avail)
+            return (pos + group_mask_first(avail)) & mask;
+
+        step += GROUP_WIDTH;
+        pos   = (pos + step) & mask;
+    }
+}
+
+/**
+ * Starts a probe for the slots whose control byte matches the hash.
+ */
+static INLINE void ctrl_probe_init(CtrlProbe *p, const uint8_t *ctrl, size_t capacity, size_t hash)
+{
+    p->ctrl  = ctrl;
+    p->mask  = capacity - 1;
+    p->pos   = H1(hash) & p->mask;
+    p->step  = 0;
+    p->h2    = H2(hash);
+    p->match = group_match(&(ctrl[p->pos]), p->h2);
+}
+
+/**
+ * Returns the next candidate slot of the probe. The probe ends at the first
+ * group that contains an empty slot, since the key cannot be stored past it.
+ *
+ * @return the index of the candidate slot, or CTRL_PROBE_END.
+ */
+static INLINE size_t ctrl_probe_next(CtrlProbe *p)
+{
+    for (;;) {
+        if (p->match) {
+            size_t i = (p->pos + group_mask_first(p->match)) & p->mask;
+            p->match &= p->match - 1;
+            return i;
+        }
+        if (group_match_empty(&(p->ctrl[p->pos])))
+            return CTRL_PROBE_END;
+
+        p->step += GROUP_WIDTH;
+        p->pos   = (p->pos + p->step) & p->mask;
+        p->match = group_match(&(p->ctrl[p->pos]), p->h2);
+    }
+}
+
+/**
+ * Moves the full slots of an old control and slot array into a new, empty
+ * pair. The slots are slot_size bytes large and hold their hash as a size_t
+ * at hash_offset, so the hash function is not called.
+ */
+static INLINE void ctrl_rehash(const uint8_t *old_ctrl, const void *old_slots, size_t old_capacity,
+                               uint8_t *ctrl, void *slots, size_t capacity,
+                               size_t slot_size, size_t hash_offset)
+{
+    const uint8_t *src = old_slots;
+    uint8_t       *dst = slots;
+
+    size_t i;
+    for (i = 0; i < old_capacity; i++) {
+        if (old_ctrl[i] & CTRL_EMPTY)
+            continue;
+
+        size_t hash;
+        memcpy(&hash, src + i * slot_size + hash_offset, sizeof(hash));
+
+        size_t j = ctrl_find_free(ctrl, capacity, hash);
+        ctrl_set(ctrl, capacity, j, old_ctrl[i]);
+        memcpy(dst + j * slot_size, src + i * slot_size, slot_size);
+    }
+}
+
+
+#endif
@@ -2,18 +2,50 @@
 #include "nutport.h"
 #include "nutmem.h"
 
-
 #include "nuthashset.h"
+#include "nuthash_internal.h"
+
+/* The control bytes and the group probing are shared with the open
+ * addressing layout of the HashTable through nuthash_internal.h. */
+#define MAX_LOAD_FACTOR 0.875f
+
+/* A set element and its hash. There is no value and no chain pointer. */
+typedef struct set_slot_s {
+    void   *element;
+    size_t  hash;
+} SetSlot;
 
 struct nut_hashset_s {
-    HashTable *table;
-    int       *dummy;
+    size_t    capacity;
+    size_t    size;
+    size_t    deleted;
+    size_t    threshold;
+    uint32_t  hash_seed;
+    int       key_len;
+    float     load_factor;
+    uint8_t  *ctrl;
+    SetSlot  *slots;
 
-    void *(*mem_alloc)  (size_t size);
-    void *(*mem_calloc) (size_t blocks, size_t size);
-    void  (*mem_free)   (void *block);
+    size_t (*hash)       (const void *key, int l, uint32_t seed);
+    int    (*cmp)        (const void *k1, const void *k2);
+    void  *(*mem_alloc)  (size_t size);
+    void  *(*mem_calloc) (size_t blocks, size_t size);
+    void   (*mem_free)   (void *block);
 };
 
+static NutState  set_alloc     (HashSet *set, size_t capacity);
+static NutState  set_resize    (HashSet *set, size_t new_capacity);
+static SetSlot  *set_find      (HashSet *set, void *element, size_t hash);
+static size_t    set_next_full (HashSet *set, size_t from);
+static size_t    round_pow_two (size_t n);
+static NutState  set_add       (HashSet *set, void *element, size_t hash);
+static void      set_erase     (HashSet *set, SetSlot *slot);
+static NutState  set_new_like  (HashSet *set, size_t capacity, HashSet **out);
+static NutState  set_copy      (HashSet *set, HashSet **out);
+static void      set_swap      (HashSet *a, HashSet *b);
+static size_t    capacity_for  (HashSet *set, size_t n);
+static size_t    hash_in       (HashSet *dst, HashSet *src, SetSlot *slot);
+
 /**
  * Initializes the fields of the HashSetConf struct to default values.
  *
@@ -49,7 +81,7 @@ NutState nut_hashset_new(HashSet **hs)
  * @param[in] conf The hashset configuration object. All fields must be initialized.
  * @param[out] out Pointer to where the newly created HashSet is stored
  *
- * @return NUT_OK if the creation was successful, or CC_ERR_ALLOC if the memory
+ * @return NUT_OK if the creation was successful, or NUT_ERR_MALLOC if the memory
  * allocation for the new HashSet structure failed.
  */
 NutState nut_hashset_new_conf(HashSetConf const * const conf, HashSet **hs)
@@ -59,22 +91,27 @@ NutState nut_hashset_new_conf(HashSetConf const * const conf, HashSet **hs)
     if (!set)
         return NUT_ERR_MALLOC;
 
-    HashTable *table;
-    NutState stat = nut_hashtable_new_conf(conf, &table);
+    set->hash        = conf->hash;
+    set->cmp         = conf->key_compare;
+    set->hash_seed   = conf->hash_seed;
+    set->key_len     = conf->key_length;
+    set->load_factor = conf->load_factor;
+    set->mem_alloc   = conf->mem_alloc;
+    set->mem_calloc  = conf->mem_calloc;
+    set->mem_free    = conf->mem_free;
 
-    if (stat != NUT_OK) {
-        conf->mem_free(set);
-        return stat;
-    }
+    if (set->load_factor > MAX_LOAD_FACTOR)
+        set->load_factor = MAX_LOAD_FACTOR;
 
-    set->table      = table;
-    set->mem_alloc  = conf->mem_alloc;
-    set->mem_calloc = conf->mem_calloc;
-    set->mem_free   = conf->mem_free;
+    size_t capacity = round_pow_two(conf->initial_capacity);
 
-    /* A dummy pointer that is never actually dereferenced
-    *  that must not be null.*/
-    set->dummy = (int*) 1;
+    if (capacity < GROUP_WIDTH)
+        capacity = GROUP_WIDTH;
+
+    if (set_alloc(set, capacity) != NUT_OK) {
+        conf->mem_free(set);
+        return NUT_ERR_MALLOC;
+    }
     *hs = set;
     return NUT_OK;
 }
@@ -87,7 +124,8 @@ NutState nut_hashset_new_conf(HashSetConf const * const conf, HashSet **hs)
  */
 void nut_hashset_destroy(HashSet *set)
 {
-    nut_hashtable_destroy(set->table);
+    set->mem_free(set->ctrl);
+    set->mem_free(set->slots);
     set->mem_free(set);
 }
 
@@ -97,29 +135,42 @@ void nut_hashset_destroy(HashSet *set)
  * @param[in] set the set to which the element is being added
  * @param[in] element the element being added
  *
- * @return NUT_OK if the element was successfully added, or CC_ERR_ALLOC
- * if the memory allocation failed.
+ * @return NUT_OK if the element was successfully added, NUT_ERR_MALLOC
+ * if the memory allocation failed, or NUT_ERR_MAX_CAPACITY if the set
+ * has reached its maximum capacity.
  */
 NutState nut_hashset_add(HashSet *set, void *element)
 {
-    return nut_hashtable_add(set->table, element, set->dummy);
+    const size_t hash = element ? set->hash(element, set->key_len, set->hash_seed) : 0;
+    return set_add(set, element, hash);
 }
 
 /**
  * Removes the specified element from the HashSet and sets the out
- * parameter to its value.
+ * parameter to the removed element.
  *
  * @param[in] set the set from which the element is being removed
  * @param[in] element the element being removed
- * @param[out] out Pointer to where the removed value is stored, or NULL
+ * @param[out] out Pointer to where the removed element is stored, or NULL
  *                 if it is to be ignored
  *
- * @return NUT_OK if the element was successfully removed, or CC_ERR_VALUE_NOT_FOUND
+ * @return NUT_OK if the element was successfully removed, or NUT_ERR_VALUE_NOT_FOUND
  * if the value was not found.
  */
 NutState nut_hashset_remove(HashSet *set, void *element, void **out)
 {
-    return nut_hashtable_remove(set->table, element, out);
+    const size_t hash = element ? set->hash(element, set->key_len, set->hash_seed) : 0;
+    SetSlot     *slot = set_find(set, element, hash);
+
+    if (!slot)
+        return NUT_ERR_VALUE_NOT_FOUND;
+
+    if (out)
+        *out = slot->element;
+
+    set_erase(set, slot);
+
+    return NUT_OK;
 }
 
 /**
@@ -129,7 +180,9 @@ NutState nut_hashset_remove(HashSet *set, void *element, void **out)
  */
 void nut_hashset_remove_all(HashSet *set)
 {
-    nut_hashtable_remove_all(set->table);
+    ctrl_clear(set->ctrl, set->capacity);
+    set->size    = 0;
+    set->deleted = 0;
 }
 
 /**
@@ -142,7 +195,8 @@ void nut_hashset_remove_all(HashSet *set)
  */
 bool nut_hashset_contains(HashSet *set, void *element)
 {
-    return nut_hashtable_contains_key(set->table, element);
+    const size_t hash = element ? set->hash(element, set->key_len, set->hash_seed) : 0;
+    return set_find(set, element, hash) != NULL;
 }
 
 /**
@@ -154,7 +208,7 @@ bool nut_hashset_contains(HashSet *set, void *element)
  */
 size_t nut_hashset_size(HashSet *set)
 {
-    return nut_hashtable_size(set->table);
+    return set->size;
 }
 
 /**
@@ -166,7 +220,7 @@ size_t nut_hashset_size(HashSet *set)
  */
 size_t nut_hashset_capacity(HashSet *set)
 {
-    return nut_hashtable_capacity(set->table);
+    return set->capacity;
 }
 
 /**
@@ -178,7 +232,252 @@ size_t nut_hashset_capacity(HashSet *set)
  */
 void nut_hashset_foreach(HashSet *set, void (*fn) (const void *e))
 {
-    nut_hashtable_foreach_key(set->table, fn);
+    size_t i;
+    for (i = set_next_full(set, 0); i < set->capacity; i = set_next_full(set, i + 1))
+        fn(set->slots[i].element);
+}
+
+/**
+ * Adds all elements of the other set to the set. Elements that are already
+ * part of the set are kept.
+ *
+ * @note Both sets must compare their elements the same way.
+ *
+ * @param[in] set the set to which the elements are being added
+ * @param[in] other the set whose elements are being added
+ *
+ * @return NUT_OK if the operation was successful, NUT_ERR_MALLOC if the memory
+ * allocation failed, or NUT_ERR_MAX_CAPACITY if the set has reached its
+ * maximum capacity.
+ */
+NutState nut_hashset_union_mut(HashSet *set, HashSet *other)
+{
+    size_t i;
+    for (i = set_next_full(other, 0); i < other->capacity; i = set_next_full(other, i + 1)) {
+        SetSlot *s    = &(other->slots[i]);
+        NutState stat = set_add(set, s->element, hash_in(set, other, s));
+
+        if (stat != NUT_OK)
+            return stat;
+    }
+    return NUT_OK;
+}
+
+/**
+ * Creates a new set that holds the elements of both sets. The new set is
+ * created with the configuration of set1, and an element that is part of
+ * both sets is taken from set1.
+ *
+ * @note Both sets must compare their elements the same way.
+ *
+ * @param[in] set1 the first set
+ * @param[in] set2 the second set
+ * @param[out] out pointer to where the new set is stored
+ *
+ * @return NUT_OK if the operation was successful, NUT_ERR_MALLOC if the memory
+ * allocation failed, or NUT_ERR_MAX_CAPACITY if the set has reached its
+ * maximum capacity.
+ */
+NutState nut_hashset_union(HashSet *set1, HashSet *set2, HashSet **out)
+{
+    HashSet *u;
+    NutState stat = set_copy(set1, &u);
+
+    if (stat != NUT_OK)
+        return stat;
+
+    if ((stat = nut_hashset_union_mut(u, set2)) != NUT_OK) {
+        nut_hashset_destroy(u);
+        return stat;
+    }
+    *out = u;
+    return NUT_OK;
+}
+
+/**
+ * Creates a new set that holds the elements that are part of both sets. The
+ * elements of the smaller set are looked up in the larger one. The new set is
+ * created with the configuration of set1 and holds the elements of set1.
+ *
+ * @note Both sets must compare their elements the same way.
+ *
+ * @param[in] set1 the first set
+ * @param[in] set2 the second set
+ * @param[out] out pointer to where the new set is stored
+ *
+ * @return NUT_OK if the operation was successful, or NUT_ERR_MALLOC if the
+ * memory allocation failed.
+ */
+NutState nut_hashset_intersection(HashSet *set1, HashSet *set2, HashSet **out)
+{
+    HashSet *small = set1->size <= set2->size ? set1 : set2;
+    HashSet *large = small == set1 ? set2 : set1;
+    HashSet *r;
+    NutState stat  = set_new_like(set1, capacity_for(set1, small->size), &r);
+
+    if (stat != NUT_OK)
+        return stat;
+
+    size_t i;
+    for (i = set_next_full(small, 0); i < small->capacity; i = set_next_full(small, i + 1)) {
+        SetSlot *s = &(small->slots[i]);
+        SetSlot *m = set_find(large, s->element, hash_in(large, small, s));
+
+        if (!m)
+            continue;
+
+        /* Keep the element and the hash of set1 */
+        if (small == set2)
+            s = m;
+
+        if ((stat = set_add(r, s->element, s->hash)) != NUT_OK) {
+            nut_hashset_destroy(r);
+            return stat;
+        }
+    }
+    *out = r;
+    return NUT_OK;
+}
+
+/**
+ * Removes all elements from the set that are not part of the other set. If
+ * the other set is smaller, the intersection is built from it and replaces
+ * the storage of the set.
+ *
+ * @note Both sets must compare their elements the same way.
+ *
+ * @param[in] set the set from which the elements are being removed
+ * @param[in] other the set that is being intersected with
+ *
+ * @return NUT_OK if the operation was successful, or NUT_ERR_MALLOC if the
+ * memory allocation failed, in which case the set is left unchanged.
+ */
+NutState nut_hashset_intersection_mut(HashSet *set, HashSet *other)
+{
+    if (other->size < set->size) {
+        HashSet *r;
+        NutState stat = nut_hashset_intersection(set, other, &r);
+
+        if (stat != NUT_OK)
+            return stat;
+
+        set_swap(set, r);
+        nut_hashset_destroy(r);
+        return NUT_OK;
+    }
+
+    size_t i;
+    for (i = set_next_full(set, 0); i < set->capacity; i = set_next_full(set, i + 1)) {
+        SetSlot *s = &(set->slots[i]);
+
+        if (!set_find(other, s->element, hash_in(other, set, s)))
+            set_erase(set, s);
+    }
+    return NUT_OK;
+}
+
+/**
+ * Removes all elements from the set that are part of the other set. The
+ * elements of the smaller of the two sets are looked up in the other one.
+ *
+ * @note Both sets must compare their elements the same way.
+ *
+ * @param[in] set the set from which the elements are being removed
+ * @param[in] other the set whose elements are being removed
+ */
+void nut_hashset_difference_mut(HashSet *set, HashSet *other)
+{
+    size_t i;
+
+    if (other->size < set->size) {
+        for (i = set_next_full(other, 0); i < other->capacity; i = set_next_full(other, i + 1)) {
+            SetSlot *s = &(other->slots[i]);
+            SetSlot *m = set_find(set, s->element, hash_in(set, other, s));
+
+            if (m)
+                set_erase(set, m);
+        }
+        return;
+    }
+
+    for (i = set_next_full(set, 0); i < set->capacity; i = set_next_full(set, i + 1)) {
+        SetSlot *s = &(set->slots[i]);
+
+        if (set_find(other, s->element, hash_in(other, set, s)))
+            set_erase(set, s);
+    }
+}
+
+/**
+ * Creates a new set that holds the elements of set1 that are not part of
+ * set2. The new set is created with the configuration of set1.
+ *
+ * @note Both sets must compare their elements the same way.
+ *
+ * @param[in] set1 the set whose elements are being kept
+ * @param[in] set2 the set whose elements are being left out
+ * @param[out] out pointer to where the new set is stored
+ *
+ * @return NUT_OK if the operation was successful, or NUT_ERR_MALLOC if the
+ * memory allocation failed.
+ */
+NutState nut_hashset_difference(HashSet *set1, HashSet *set2, HashSet **out)
+{
+    HashSet *r;
+    NutState stat;
+
+    if (set2->size < set1->size) {
+        if ((stat = set_copy(set1, &r)) != NUT_OK)
+            return stat;
+
+        nut_hashset_difference_mut(r, set2);
+        *out = r;
+        return NUT_OK;
+    }
+
+    if ((stat = set_new_like(set1, capacity_for(set1, set1->size), &r)) != NUT_OK)
+        return stat;
+
+    size_t i;
+    for (i = set_next_full(set1, 0); i < set1->capacity; i = set_next_full(set1, i + 1)) {
+        SetSlot *s = &(set1->slots[i]);
+
+        if (set_find(set2, s->element, hash_in(set2, set1, s)))
+            continue;
+
+        if ((stat = set_add(r, s->element, s->hash)) != NUT_OK) {
+            nut_hashset_destroy(r);
+            return stat;
+        }
+    }
+    *out = r;
+    return NUT_OK;
+}
+
+/**
+ * Checks whether every element of the set is also an element of the other
+ * set.
+ *
+ * @note Both sets must compare their elements the same way.
+ *
+ * @param[in] set the set that is being tested
+ * @param[in] other the set that is being tested against
+ *
+ * @return true if the set is a subset of the other set.
+ */
+bool nut_hashset_is_subset(HashSet *set, HashSet *other)
+{
+    if (set->size > other->size)
+        return false;
+
+    size_t i;
+    for (i = set_next_full(set, 0); i < set->capacity; i = set_next_full(set, i + 1)) {
+        SetSlot *s = &(set->slots[i]);
+
+        if (!set_find(other, s->element, hash_in(other, set, s)))
+            return false;
+    }
+    return true;
 }
 
 /**
@@ -189,7 +488,9 @@ void nut_hashset_foreach(HashSet *set, void (*fn) (const void *e))
  */
 void nut_hashset_iter_init(HashSetIter *iter, HashSet *set)
 {
-    nut_hashtable_iter_init(&(iter->iter), set->table);
+    iter->set   = set;
+    iter->index = set->capacity;
+    iter->next  = set_next_full(set, 0);
 }
 
 /**
@@ -199,19 +500,19 @@ void nut_hashset_iter_init(HashSetIter *iter, HashSet *set)
  * @param[in] iter the iterator that is being advanced
  * @param[out] out Pointer to where the next element is set
  *
- * @return NUT_OK if the iterator was advanced, or CC_ITER_END if the
+ * @return NUT_OK if the iterator was advanced, or NUT_ITER_END if the
  * end of the HashSet has been reached.
  */
 NutState nut_hashset_iter_next(HashSetIter *iter, void **out)
 {
-    TableEntry *entry;
-    NutState status = nut_hashtable_iter_next(&(iter->iter), &entry);
+    if (iter->next >= iter->set->capacity)
+        return NUT_ITER_END;
 
-    if (status != NUT_OK)
-        return status;
+    iter->index = iter->next;
+    iter->next  = set_next_full(iter->set, iter->index + 1);
 
     if (out)
-        *out = entry->key;
+        *out = iter->set->slots[iter->index].element;
 
     return NUT_OK;
 }
@@ -229,9 +530,281 @@ NutState nut_hashset_iter_next(HashSetIter *iter, void **out)
  *                 if it is to be ignored
  *
  * @return NUT_OK if the entry was successfully removed, or
- * CC_ERR_VALUE_NOT_FOUND.
+ * NUT_ERR_VALUE_NOT_FOUND.
  */
 NutState nut_hashset_iter_remove(HashSetIter *iter, void **out)
 {
-    return nut_hashtable_iter_remove(&(iter->iter), out);
+    HashSet *set = iter->set;
+
+    if (iter->index >= set->capacity || (set->ctrl[iter->index] & CTRL_EMPTY))
+        return NUT_ERR_VALUE_NOT_FOUND;
+
+    if (out)
+        *out = set->slots[iter->index].element;
+
+    set_erase(set, &(set->slots[iter->index]));
+
+    return NUT_OK;
+}
+
+
+/*******************************************************************************
+ *
+ *
+ *  Slot array
+ *
+ *
+ ******************************************************************************/
+
+/**
+ * Allocates an empty control and slot array of the specified capacity and
+ * makes them the set storage. The capacity must be a power of two that is
+ * not smaller than GROUP_WIDTH.
+ */
+static NutState set_alloc(HashSet *set, size_t capacity)
+{
+    uint8_t *ctrl  = ctrl_alloc(capacity, set->mem_alloc);
+    SetSlot *slots = set->mem_alloc(capacity * sizeof(SetSlot));
+
+    if (!ctrl || !slots) {
+        if (ctrl)
+            set->mem_free(ctrl);
+        if (slots)
+            set->mem_free(slots);
+        return NUT_ERR_MALLOC;
+    }
+
+    set->ctrl      = ctrl;
+    set->slots     = slots;
+    set->capacity  = capacity;
+    set->deleted   = 0;
+    set->threshold = set->load_factor * capacity;
+
+    /* At least one slot must always stay empty to terminate the probing */
+    if (set->threshold >= capacity)
+        set->threshold = capacity - 1;
+
+    return NUT_OK;
+}
+
+/**
+ * Returns the index of the first full slot at or after the index from, or
+ * the set capacity if there are no more full slots.
+ */
+static INLINE size_t set_next_full(HashSet *set, size_t from)
+{
+    return ctrl_next_full(set->ctrl, set->capacity, from);
+}
+
+/**
+ * Probes the set for the slot holding the specified element. A NULL element
+ * only ever matches itself.
+ *
+ * @return the slot of the element, or NULL if the element was not found.
+ */
+static SetSlot *set_find(HashSet *set, void *element, size_t hash)
+{
+    CtrlProbe probe;
+    size_t    i;
+
+    ctrl_probe_init(&probe, set->ctrl, set->capacity, hash);
+
+    while ((i = ctrl_probe_next(&probe)) != CTRL_PROBE_END) {
+        SetSlot *s = &(set->slots[i]);
+
+        if (s->hash == hash) {
+            if (!element ? s->element == NULL
+                         : s->element && set->cmp(s->element, element) == 0)
+                return s;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Adds the element with the specified hash unless it is already part of the
+ * set, growing the slot array if needed.
+ */
+static NutState set_add(HashSet *set, void *element, size_t hash)
+{
+    if (set_find(set, element, hash))
+        return NUT_OK;
+
+    if (set->size + set->deleted >= set->threshold) {
+        /* If most of the load are tombstones, rehashing in place is enough */
+        size_t   new_capacity = set->size >= set->threshold / 2 ? set->capacity << 1 : set->capacity;
+        NutState stat;
+
+        if (set->capacity == MAX_POW_TWO && new_capacity != set->capacity)
+            return NUT_ERR_MAX_CAPACITY;
+
+        if ((stat = set_resize(set, new_capacity)) != NUT_OK)
+            return stat;
+    }
+
+    size_t i = ctrl_find_free(set->ctrl, set->capacity, hash);
+
+    if (set->ctrl[i] == CTRL_DELETED)
+        set->deleted--;
+
+    ctrl_set(set->ctrl, set->capacity, i, H2(hash));
+
+    set->slots[i].element = element;
+    set->slots[i].hash    = hash;
+    set->size++;
+
+    return NUT_OK;
+}
+
+
+/**
+ * Marks the slot as deleted. The slot contents are left untouched so that
+ * an iteration that is positioned on it stays valid.
+ */
+static void set_erase(HashSet *set, SetSlot *slot)
+{
+    ctrl_set(set->ctrl, set->capacity, (size_t) (slot - set->slots), CTRL_DELETED);
+    set->size--;
+    set->deleted++;
+}
+
+/**
+ * Returns the hash of the element of a src slot as computed by the dst set.
+ * The stored hash is reused if both sets hash the same way.
+ */
+static INLINE size_t hash_in(HashSet *dst, HashSet *src, SetSlot *slot)
+{
+    if (dst->hash == src->hash && dst->hash_seed == src->hash_seed && dst->key_len == src->key_len)
+        return slot->hash;
+
+    return slot->element ? dst->hash(slot->element, dst->key_len, dst->hash_seed) : 0;
+}
+
+/**
+ * Returns the capacity at which n elements fit into the set without a resize.
+ */
+static size_t capacity_for(HashSet *set, size_t n)
+{
+    size_t capacity = round_pow_two((size_t) (n / set->load_factor) + 1);
+
+    return capacity < GROUP_WIDTH ? GROUP_WIDTH : capacity;
+}
+
+/**
+ * Creates an empty set with the same configuration as the specified set.
+ */
+static NutState set_new_like(HashSet *set, size_t capacity, HashSet **out)
+{
+    HashSet *r = set->mem_calloc(1, sizeof(HashSet));
+
+    if (!r)
+        return NUT_ERR_MALLOC;
+
+    r->hash        = set->hash;
+    r->cmp         = set->cmp;
+    r->hash_seed   = set->hash_seed;
+    r->key_len     = set->key_len;
+    r->load_factor = set->load_factor;
+    r->mem_alloc   = set->mem_alloc;
+    r->mem_calloc  = set->mem_calloc;
+    r->mem_free    = set->mem_free;
+
+    if (set_alloc(r, capacity) != NUT_OK) {
+        set->mem_free(r);
+        return NUT_ERR_MALLOC;
+    }
+    *out = r;
+    return NUT_OK;
+}
+
+/**
+ * Creates a copy of the set by copying its control and slot arrays.
+ */
+static NutState set_copy(HashSet *set, HashSet **out)
+{
+    HashSet *r;
+    NutState stat = set_new_like(set, set->capacity, &r);
+
+    if (stat != NUT_OK)
+        return stat;
+
+    memcpy(r->ctrl, set->ctrl, set->capacity + GROUP_WIDTH);
+    memcpy(r->slots, set->slots, set->capacity * sizeof(SetSlot));
+
+    r->size    = set->size;
+    r->deleted = set->deleted;
+
+    *out = r;
+    return NUT_OK;
+}
+
+/**
+ * Swaps the storage of two sets that share the same configuration.
+ */
+static void set_swap(HashSet *a, HashSet *b)
+{
+    HashSet tmp = *a;
+
+    a->capacity  = b->capacity;
+    a->size      = b->size;
+    a->deleted   = b->deleted;
+    a->threshold = b->threshold;
+    a->ctrl      = b->ctrl;
+    a->slots     = b->slots;
+
+    b->capacity  = tmp.capacity;
+    b->size      = tmp.size;
+    b->deleted   = tmp.deleted;
+    b->threshold = tmp.threshold;
+    b->ctrl      = tmp.ctrl;
+    b->slots     = tmp.slots;
+}
+
+/**
+ * Moves all elements into a new slot array of the specified capacity, which
+ * may be equal to the current one to clear out the deleted slots. The stored
+ * hashes are reused, so the hash function is not called.
+ */
+static NutState set_resize(HashSet *set, size_t new_capacity)
+{
+    if (new_capacity < set->capacity || new_capacity > MAX_POW_TWO)
+        return NUT_ERR_MAX_CAPACITY;
+
+    uint8_t *old_ctrl     = set->ctrl;
+    SetSlot *old_slots    = set->slots;
+    size_t   old_capacity = set->capacity;
+
+    if (set_alloc(set, new_capacity) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    ctrl_rehash(old_ctrl, old_slots, old_capacity, set->ctrl, set->slots, set->capacity,
+                sizeof(SetSlot), offsetof(SetSlot, hash));
+
+    set->mem_free(old_ctrl);
+    set->mem_free(old_slots);
+
+    return NUT_OK;
+}
+
+/**
+ * Rounds the integer to the next power of two. If the number is already a
+ * power of two, the same number is returned.
+ */
+static INLINE size_t round_pow_two(size_t n)
+{
+    if (n >= MAX_POW_TWO)
+        return MAX_POW_TWO;
+
+    if (n == 0)
+        return 2;
+
+    n--;
+    n |= n >> 1;
+    n |= n >> 2;
+    n |= n >> 4;
+    n |= n >> 8;
+    n |= n >> 16;
+    n++;
+
+    return n;
 }
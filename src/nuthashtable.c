@@ -4,9 +4,36 @@
 #include "nutmem.h"
 
 #include "nuthashtable.h"
+#include "nuthash_internal.h"
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
 
 #define DEFAULT_CAPACITY 16
 #define DEFAULT_LOAD_FACTOR 0.75f
+#define DEFAULT_SLAB_ENTRIES 32
+
+/* Number of keys whose cache misses are overlapped by nut_hashtable_get_batch() */
+#define BATCH_SIZE 16
+
+#if defined(__GNUC__)
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr) ((void) (addr))
+#endif
+
+/* Open addressing layout parameters. The control bytes and the group probing
+ * are shared with the HashSet through nuthash_internal.h. */
+#define OPEN_MAX_LOAD_FACTOR 0.875f
+
+/* A block of table entries. Chained entries are carved out of slabs and
+ * recycled through an intrusive free list that is linked through the
+ * next field of the free entries. */
+typedef struct entry_slab_s {
+    struct entry_slab_s *next;
+    TableEntry           entries[];
+} EntrySlab;
 
 struct hashtable_s {
     size_t       capacity;
@@ -17,6 +44,26 @@ struct hashtable_s {
     float        load_factor;
     TableEntry **buckets;
 
+    /* Incremental resize state. While old_buckets is set, the buckets of the
+     * old array from rehash_index onwards have not been migrated yet. */
+    TableEntry **old_buckets;
+    size_t       old_capacity;
+    size_t       rehash_index;
+    size_t       rehash_step;
+
+    /* Entry slabs. slab_used is the number of entries of the newest
+     * slab that have been handed out. */
+    EntrySlab   *slabs;
+    TableEntry  *free_entries;
+    size_t       slab_entries;
+    size_t       slab_used;
+
+    /* Open addressing layout */
+    HashTableLayout layout;
+    size_t       deleted;
+    uint8_t     *ctrl;
+    TableEntry  *slots;
+
     size_t  (*hash)       (const void *key, int l, uint32_t seed);
     int     (*key_cmp)    (const void *k1, const void *k2);
     void   *(*mem_alloc)  (size_t size);
@@ -29,10 +76,25 @@ NutState  get_null_key    (HashTable *table, void **out);
 NutState  add_null_key    (HashTable *table, void *val);
 NutState  remove_null_key (HashTable *table, void **out);
 
-static size_t get_table_index  (HashTable *table, void *key);
-static size_t round_pow_two    (size_t n);
-static void   move_entries     (TableEntry **src_bucket, TableEntry **dest_bucket,
-                                 size_t src_size, size_t dest_size);
+static size_t       round_pow_two    (size_t n);
+static void         move_entries     (TableEntry **src_bucket, TableEntry **dest_bucket,
+                                      size_t src_size, size_t dest_size);
+static void         rehash_buckets   (HashTable *t, size_t n);
+static TableEntry **get_bucket       (HashTable *t, size_t hash);
+static size_t       bucket_count     (HashTable *t);
+static TableEntry  *bucket_at        (HashTable *t, size_t i);
+static NutState     chain_remove     (HashTable *t, void *key, size_t hash, void **out);
+static TableEntry  *entry_alloc      (HashTable *t);
+static void         entry_free       (HashTable *t, TableEntry *e);
+static void         entry_free_all   (HashTable *t);
+static bool         key_eq           (HashTable *t, const void *stored, void *key);
+
+static NutState    open_alloc      (HashTable *t, size_t capacity);
+static NutState    open_resize     (HashTable *t, size_t new_capacity);
+static TableEntry *open_find       (HashTable *t, void *key, size_t hash);
+static NutState    open_add        (HashTable *t, void *key, void *val, size_t hash);
+static NutState    open_remove     (HashTable *t, void *key, size_t hash, void **out);
+static size_t      open_next_full  (HashTable *t, size_t from);
 
 /**
  * Creates a new HashTable and returns a status code.
@@ -71,24 +133,44 @@ NutState nut_hashtable_new_conf(HashTableConf const * const conf, HashTable **ou
     if (!table)
         return NUT_ERR_MALLOC;
 
-    table->capacity = round_pow_two(conf->initial_capacity);
-    table->buckets  = conf->mem_calloc(table->capacity, sizeof(TableEntry *));
-
-    if (!table->buckets) {
-        conf->mem_free(table);
-        return NUT_ERR_MALLOC;
-    }
-
     table->hash        = conf->hash;
     table->key_cmp     = conf->key_compare;
     table->load_factor = conf->load_factor;
     table->hash_seed   = conf->hash_seed;
     table->key_len     = conf->key_length;
+    table->layout      = conf->layout;
+    table->rehash_step = conf->rehash_step;
+    table->slab_entries = conf->slab_entries;
     table->size        = 0;
     table->mem_alloc   = conf->mem_alloc;
     table->mem_calloc  = conf->mem_calloc;
     table->mem_free    = conf->mem_free;
-    table->threshold   = table->capacity * table->load_factor;
+
+    if (table->layout == HASHTABLE_OPEN) {
+        size_t capacity = round_pow_two(conf->initial_capacity);
+
+        if (capacity < GROUP_WIDTH)
+            capacity = GROUP_WIDTH;
+
+        if (table->load_factor > OPEN_MAX_LOAD_FACTOR)
+            table->load_factor = OPEN_MAX_LOAD_FACTOR;
+
+        if (open_alloc(table, capacity) != NUT_OK) {
+            conf->mem_free(table);
+            return NUT_ERR_MALLOC;
+        }
+        *out = table;
+        return NUT_OK;
+    }
+
+    table->capacity = round_pow_two(conf->initial_capacity);
+    table->buckets  = conf->mem_calloc(table->capacity, sizeof(TableEntry *));
+
+    if (!table->buckets) {
+        conf->mem_free(table);
+        return NUT_ERR_MALLOC;
+    }
+    table->threshold = table->capacity * table->load_factor;
 
     *out = table;
     return NUT_OK;
@@ -101,12 +183,15 @@ NutState nut_hashtable_new_conf(HashTableConf const * const conf, HashTable **ou
  */
 void nut_hashtable_conf_init(HashTableConf *conf)
 {
-    conf->hash             = STRING_HASH;
+    conf->hash             = FAST_HASH;
     conf->key_compare      = nut_common_cmp_str;
     conf->initial_capacity = DEFAULT_CAPACITY;
     conf->load_factor      = DEFAULT_LOAD_FACTOR;
     conf->key_length       = KEY_LENGTH_VARIABLE;
     conf->hash_seed        = 0;
+    conf->layout           = HASHTABLE_CHAINED;
+    conf->rehash_step      = 0;
+    conf->slab_entries     = DEFAULT_SLAB_ENTRIES;
     conf->mem_alloc        = &nut_mem_malloc;
     conf->mem_calloc       = &nut_mem_calloc;
     conf->mem_free         = &nut_mem_free;
@@ -121,16 +206,18 @@ void nut_hashtable_conf_init(HashTableConf *conf)
  */
 void nut_hashtable_destroy(HashTable *table)
 {
-    size_t i;
-    for (i = 0; i < table->capacity; i++) {
-        TableEntry *next = table->buckets[i];
-
-        while (next) {
-            TableEntry *tmp = next->next;
-            table->mem_free(next);
-            next = tmp;
-        }
+    if (table->layout == HASHTABLE_OPEN) {
+        table->mem_free(table->ctrl);
+        table->mem_free(table->slots);
+        table->mem_free(table);
+        return;
     }
+
+    entry_free_all(table);
+
+    if (table->old_buckets)
+        table->mem_free(table->old_buckets);
+
     table->mem_free(table->buckets);
     table->mem_free(table);
 }
@@ -150,7 +237,31 @@ void nut_hashtable_destroy(HashTable *table)
  */
 NutState nut_hashtable_add(HashTable *table, void *key, void *val)
 {
+    return nut_hashtable_add_hashed(table, key, val, nut_hashtable_hash_key(table, key));
+}
+
+/**
+ * Same as <code>nut_hashtable_add()</code>, but uses the specified hash
+ * instead of hashing the key.
+ *
+ * @param[in] table the table to which this new key-value mapping is being added
+ * @param[in] key a hash table key used to access the specified value
+ * @param[in] val a value that is being stored in the table
+ * @param[in] hash the hash of the key as returned by <code>
+ *                 nut_hashtable_hash_key()</code> for this table
+ *
+ * @return NUT_OK if the mapping was successfully added, or NUT_ERR_ALLOC if the
+ * memory allocation failed.
+ */
+NutState nut_hashtable_add_hashed(HashTable *table, void *key, void *val, size_t hash)
+{
+    if (table->layout == HASHTABLE_OPEN)
+        return open_add(table, key, val, hash);
+
     NutState stat;
+    if (table->old_buckets)
+        rehash_buckets(table, table->rehash_step);
+
     if (table->size >= table->threshold) {
         if ((stat = resize(table, table->capacity << 1)) != NUT_OK)
             return stat;
@@ -159,21 +270,19 @@ NutState nut_hashtable_add(HashTable *table, void *key, void *val)
     if (!key)
         return add_null_key(table, val);
 
-    const size_t hash = table->hash(key, table->key_len, table->hash_seed);
-    const size_t i    = hash & (table->capacity - 1);
-
-    TableEntry *replace = table->buckets[i];
+    TableEntry **bucket  = get_bucket(table, hash);
+    TableEntry  *replace = *bucket;
 
     while (replace) {
         void *rk = replace->key;
-        if (rk && table->key_cmp(rk, key) == 0) {
+        if (replace->hash == hash && rk && table->key_cmp(rk, key) == 0) {
             replace->value = val;
             return NUT_OK;
         }
         replace = replace->next;
     }
 
-    TableEntry *new_entry = table->mem_alloc(sizeof(TableEntry));
+    TableEntry *new_entry = entry_alloc(table);
 
     if (!new_entry)
         return NUT_ERR_MALLOC;
@@ -181,9 +290,9 @@ NutState nut_hashtable_add(HashTable *table, void *key, void *val)
     new_entry->key   = key;
     new_entry->value = val;
     new_entry->hash  = hash;
-    new_entry->next  = table->buckets[i];
+    new_entry->next  = *bucket;
 
-    table->buckets[i] = new_entry;
+    *bucket = new_entry;
     table->size++;
 
     return NUT_OK;
@@ -201,7 +310,8 @@ NutState nut_hashtable_add(HashTable *table, void *key, void *val)
  */
 NutState  add_null_key(HashTable *table, void *val)
 {
-    TableEntry *replace = table->buckets[0];
+    TableEntry **bucket  = get_bucket(table, 0);
+    TableEntry  *replace = *bucket;
 
     while (replace) {
         if (!replace->key) {
@@ -211,7 +321,7 @@ NutState  add_null_key(HashTable *table, void *val)
         replace = replace->next;
     }
 
-    TableEntry *new_entry = table->mem_alloc(sizeof(TableEntry));
+    TableEntry *new_entry = entry_alloc(table);
 
     if (!new_entry)
         return NUT_ERR_MALLOC;
@@ -219,9 +329,9 @@ NutState  add_null_key(HashTable *table, void *val)
     new_entry->key   = NULL;
     new_entry->value = val;
     new_entry->hash  = 0;
-    new_entry->next  = table->buckets[0];
+    new_entry->next  = *bucket;
 
-    table->buckets[0] = new_entry;
+    *bucket = new_entry;
     table->size++;
 
     return NUT_OK;
@@ -239,14 +349,43 @@ NutState  add_null_key(HashTable *table, void *val)
  */
 NutState nut_hashtable_get(HashTable *table, void *key, void **out)
 {
+    return nut_hashtable_get_hashed(table, key, nut_hashtable_hash_key(table, key), out);
+}
+
+/**
+ * Same as <code>nut_hashtable_get()</code>, but uses the specified hash
+ * instead of hashing the key.
+ *
+ * @param[in] table the table from which the mapping is being returned
+ * @param[in] key   the key that is being looked up
+ * @param[in] hash  the hash of the key as returned by <code>
+ *                  nut_hashtable_hash_key()</code> for this table
+ * @param[out] out  pointer to where the value is stored
+ *
+ * @return NUT_OK if the key was found, or NUT_ERR_KEY_NOT_FOUND if not.
+ */
+NutState nut_hashtable_get_hashed(HashTable *table, void *key, size_t hash, void **out)
+{
+    if (table->layout == HASHTABLE_OPEN) {
+        TableEntry *entry = open_find(table, key, hash);
+
+        if (!entry)
+            return NUT_ERR_KEY_NOT_FOUND;
+
+        *out = entry->value;
+        return NUT_OK;
+    }
+
+    if (table->old_buckets)
+        rehash_buckets(table, table->rehash_step);
+
     if (!key)
         return get_null_key(table, out);
 
-    size_t      index  = get_table_index(table, key);
-    TableEntry *bucket = table->buckets[index];
+    TableEntry *bucket = *get_bucket(table, hash);
 
     while (bucket) {
-        if (bucket->key && table->key_cmp(bucket->key, key) == 0) {
+        if (bucket->hash == hash && bucket->key && table->key_cmp(bucket->key, key) == 0) {
             *out = bucket->value;
             return NUT_OK;
         }
@@ -255,6 +394,83 @@ NutState nut_hashtable_get(HashTable *table, void *key, void **out)
     return NUT_ERR_KEY_NOT_FOUND;
 }
 
+/**
+ * Looks up n keys at once and stores the value of each key in the matching
+ * position of the out array. The hashes of a whole batch of keys are
+ * computed first and their buckets are prefetched before any of the chains
+ * are walked, so that the cache misses of independent lookups overlap
+ * instead of being paid one after another.
+ *
+ * @param[in] table  the table from which the values are being returned
+ * @param[in] keys   the keys that are being looked up
+ * @param[in] n      the number of keys
+ * @param[out] out   array of n elements to where the values are stored. The
+ *                   elements of keys that were not found are left untouched
+ * @param[out] status array of n elements to where the status of each lookup
+ *                   (NUT_OK or NUT_ERR_KEY_NOT_FOUND) is stored, or NULL if
+ *                   it is to be ignored
+ *
+ * @return the number of keys that were found.
+ */
+size_t nut_hashtable_get_batch(HashTable *table, void **keys, size_t n,
+                               void **out, NutState *status)
+{
+    size_t      hashes[BATCH_SIZE];
+    TableEntry *heads[BATCH_SIZE];
+    size_t      found = 0;
+    size_t      b;
+
+    if (table->old_buckets)
+        rehash_buckets(table, table->rehash_step);
+
+    for (b = 0; b < n; b += BATCH_SIZE) {
+        const size_t m = n - b < BATCH_SIZE ? n - b : BATCH_SIZE;
+        size_t j;
+
+        for (j = 0; j < m; j++) {
+            void *key = keys[b + j];
+
+            hashes[j] = nut_hashtable_hash_key(table, key);
+
+            if (table->layout == HASHTABLE_OPEN) {
+                size_t pos = H1(hashes[j]) & (table->capacity - 1);
+                PREFETCH(&(table->ctrl[pos]));
+                PREFETCH(&(table->slots[pos]));
+            } else {
+                PREFETCH(get_bucket(table, hashes[j]));
+            }
+        }
+
+        if (table->layout == HASHTABLE_CHAINED) {
+            for (j = 0; j < m; j++) {
+                heads[j] = *get_bucket(table, hashes[j]);
+                PREFETCH(heads[j]);
+            }
+        }
+
+        for (j = 0; j < m; j++) {
+            void       *key   = keys[b + j];
+            TableEntry *entry;
+
+            if (table->layout == HASHTABLE_OPEN) {
+                entry = open_find(table, key, hashes[j]);
+            } else {
+                entry = heads[j];
+                while (entry && !(entry->hash == hashes[j] && key_eq(table, entry->key, key)))
+                    entry = entry->next;
+            }
+
+            if (entry) {
+                out[b + j] = entry->value;
+                found++;
+            }
+            if (status)
+                status[b + j] = entry ? NUT_OK : NUT_ERR_KEY_NOT_FOUND;
+        }
+    }
+    return found;
+}
+
 /**
  * Returns a value associated with the NULL key and sets the out parameter
  * to it.
@@ -267,7 +483,7 @@ NutState nut_hashtable_get(HashTable *table, void *key, void **out)
  */
 NutState  get_null_key(HashTable *table, void **out)
 {
-    TableEntry *bucket = table->buckets[0];
+    TableEntry *bucket = *get_bucket(table, 0);
 
     while (bucket) {
         if (bucket->key == NULL) {
@@ -292,28 +508,63 @@ NutState  get_null_key(HashTable *table, void **out)
  * if the key was not found.
  */
 NutState nut_hashtable_remove(HashTable *table, void *key, void **out)
+{
+    return nut_hashtable_remove_hashed(table, key, nut_hashtable_hash_key(table, key), out);
+}
+
+/**
+ * Same as <code>nut_hashtable_remove()</code>, but uses the specified hash
+ * instead of hashing the key.
+ *
+ * @param[in] table the table from which the key-value pair is being removed
+ * @param[in] key the key of the value being returned
+ * @param[in] hash the hash of the key as returned by <code>
+ *                 nut_hashtable_hash_key()</code> for this table
+ * @param[out] out pointer to where the removed value is stored, or NULL
+ *                 if it is to be ignored
+ *
+ * @return NUT_OK if the mapping was successfully removed, or NUT_ERR_KEY_NOT_FOUND
+ * if the key was not found.
+ */
+NutState nut_hashtable_remove_hashed(HashTable *table, void *key, size_t hash, void **out)
+{
+    if (table->layout == HASHTABLE_OPEN)
+        return open_remove(table, key, hash, out);
+
+    if (table->old_buckets)
+        rehash_buckets(table, table->rehash_step);
+
+    return chain_remove(table, key, hash, out);
+}
+
+/**
+ * Chained layout variant of nut_hashtable_remove() that does not advance an
+ * ongoing incremental resize, so that it can be used by the iterator without
+ * moving the entries under it.
+ */
+static NutState chain_remove(HashTable *table, void *key, size_t hash, void **out)
 {
     if (!key)
         return remove_null_key(table, out);
 
-    const size_t i = get_table_index(table, key);
+    TableEntry **bucket = get_bucket(table, hash);
 
-    TableEntry *e    = table->buckets[i];
+    TableEntry *e    = *bucket;
     TableEntry *prev = NULL;
     TableEntry *next = NULL;
 
     while (e) {
         next = e->next;
 
-        if (e->key && table->key_cmp(key, e->key) == 0) {
+        if (e->hash == hash && e->key && table->key_cmp(key, e->key) == 0) {
             void *value = e->value;
 
             if (!prev)
-                table->buckets[i] = next;
+                *bucket = next;
             else
                 prev->next = next;
 
-            table->mem_free(e);
+            entry_free(table, e);
             table->size--;
             if (out)
                 *out = value;
@@ -338,7 +589,8 @@ NutState nut_hashtable_remove(HashTable *table, void *key, void **out)
  */
 NutState remove_null_key(HashTable *table, void **out)
 {
-    TableEntry *e = table->buckets[0];
+    TableEntry **bucket = get_bucket(table, 0);
+    TableEntry  *e      = *bucket;
 
     TableEntry *prev = NULL;
     TableEntry *next = NULL;
@@ -350,11 +602,11 @@ NutState remove_null_key(HashTable *table, void **out)
             void *value = e->value;
 
             if (!prev)
-                table->buckets[0] = next;
+                *bucket = next;
             else
                 prev->next = next;
 
-            table->mem_free(e);
+            entry_free(table, e);
             table->size--;
             if (out)
                 *out = value;
@@ -373,16 +625,21 @@ NutState remove_null_key(HashTable *table, void **out)
  */
 void nut_hashtable_remove_all(HashTable *table)
 {
-    size_t i;
-    for (i = 0; i < table->capacity; i++) {
-        TableEntry *entry = table->buckets[i];
-        while (entry) {
-            TableEntry *next = entry->next;
-            table->mem_free(entry);
-            table->size--;
-            entry = next;
-        }
-        table->buckets[i] = NULL;
+    if (table->layout == HASHTABLE_OPEN) {
+        ctrl_clear(table->ctrl, table->capacity);
+        table->size    = 0;
+        table->deleted = 0;
+        return;
+    }
+
+    entry_free_all(table);
+
+    table->size = 0;
+    memset(table->buckets, 0, table->capacity * sizeof(TableEntry *));
+
+    if (table->old_buckets) {
+        table->mem_free(table->old_buckets);
+        table->old_buckets = NULL;
     }
 }
 
@@ -402,6 +659,11 @@ NutState  resize(HashTable *t, size_t new_capacity)
     if (t->capacity == MAX_POW_TWO)
         return NUT_ERR_MAX_CAPACITY;
 
+    /* The table has outgrown the new array before the previous
+     * migration has finished, so it is completed first. */
+    if (t->old_buckets)
+        rehash_buckets(t, t->old_capacity);
+
     TableEntry **new_buckets = t->mem_calloc(new_capacity, sizeof(TableEntry *));
 
     if (!new_buckets)
@@ -409,6 +671,18 @@ NutState  resize(HashTable *t, size_t new_capacity)
 
     TableEntry **old_buckets = t->buckets;
 
+    if (t->rehash_step) {
+        t->old_buckets  = old_buckets;
+        t->old_capacity = t->capacity;
+        t->rehash_index = 0;
+        t->buckets      = new_buckets;
+        t->capacity     = new_capacity;
+        t->threshold    = t->load_factor * new_capacity;
+
+        rehash_buckets(t, t->rehash_step);
+        return NUT_OK;
+    }
+
     move_entries(old_buckets, new_buckets, t->capacity, new_capacity);
 
     t->buckets   = new_buckets;
@@ -479,6 +753,144 @@ move_entries(TableEntry **src_bucket, TableEntry **dest_bucket,
     }
 }
 
+/**
+ * Migrates up to n buckets of the old bucket array into the current one and
+ * releases the old array once all of its buckets have been migrated.
+ *
+ * @param[in] t the table whose incremental resize is being advanced
+ * @param[in] n the maximum number of old buckets to migrate
+ */
+static void rehash_buckets(HashTable *t, size_t n)
+{
+    size_t end = t->rehash_index + n;
+
+    if (end > t->old_capacity || end < t->rehash_index)
+        end = t->old_capacity;
+
+    move_entries(&(t->old_buckets[t->rehash_index]), t->buckets,
+                 end - t->rehash_index, t->capacity);
+
+    memset(&(t->old_buckets[t->rehash_index]), 0,
+           (end - t->rehash_index) * sizeof(TableEntry *));
+
+    t->rehash_index = end;
+
+    if (t->rehash_index == t->old_capacity) {
+        t->mem_free(t->old_buckets);
+        t->old_buckets = NULL;
+    }
+}
+
+/**
+ * Returns the bucket that holds the entries with the specified hash. While an
+ * incremental resize is in progress, this is the old bucket if it has not
+ * been migrated yet.
+ */
+static INLINE TableEntry **get_bucket(HashTable *t, size_t hash)
+{
+    if (t->old_buckets) {
+        size_t i = hash & (t->old_capacity - 1);
+
+        if (i >= t->rehash_index)
+            return &(t->old_buckets[i]);
+    }
+    return &(t->buckets[hash & (t->capacity - 1)]);
+}
+
+/**
+ * Returns the number of buckets that may hold entries. During an incremental
+ * resize the buckets of the old array are counted after the current ones.
+ */
+static INLINE size_t bucket_count(HashTable *t)
+{
+    return t->old_buckets ? t->capacity + t->old_capacity : t->capacity;
+}
+
+/**
+ * Returns the head of the bucket at the position i as counted by
+ * <code>bucket_count()</code>.
+ */
+static INLINE TableEntry *bucket_at(HashTable *t, size_t i)
+{
+    return i < t->capacity ? t->buckets[i] : t->old_buckets[i - t->capacity];
+}
+
+/**
+ * Returns a new uninitialized table entry. The entry is taken from the free
+ * list, or carved out of the newest slab, and a new slab is only allocated
+ * once both are exhausted. If slabs are disabled, each entry is allocated
+ * on its own.
+ *
+ * @return the new entry, or NULL if the memory allocation failed.
+ */
+static TableEntry *entry_alloc(HashTable *t)
+{
+    if (!t->slab_entries)
+        return t->mem_alloc(sizeof(TableEntry));
+
+    TableEntry *e = t->free_entries;
+
+    if (e) {
+        t->free_entries = e->next;
+        return e;
+    }
+
+    if (!t->slabs || t->slab_used == t->slab_entries) {
+        EntrySlab *slab = t->mem_alloc(sizeof(EntrySlab) + t->slab_entries * sizeof(TableEntry));
+
+        if (!slab)
+            return NULL;
+
+        slab->next   = t->slabs;
+        t->slabs     = slab;
+        t->slab_used = 0;
+    }
+    return &(t->slabs->entries[t->slab_used++]);
+}
+
+/**
+ * Returns the entry to the free list of the table, or frees it if slabs are
+ * disabled.
+ */
+static INLINE void entry_free(HashTable *t, TableEntry *e)
+{
+    if (!t->slab_entries) {
+        t->mem_free(e);
+        return;
+    }
+    e->next = t->free_entries;
+    t->free_entries = e;
+}
+
+/**
+ * Frees all entries of the table at once without unlinking them from the
+ * buckets.
+ */
+static void entry_free_all(HashTable *t)
+{
+    if (t->slab_entries) {
+        while (t->slabs) {
+            EntrySlab *next = t->slabs->next;
+            t->mem_free(t->slabs);
+            t->slabs = next;
+        }
+        t->free_entries = NULL;
+        t->slab_used    = 0;
+        return;
+    }
+
+    size_t i;
+    for (i = 0; i < bucket_count(t); i++) {
+        TableEntry *entry = bucket_at(t, i);
+
+        while (entry) {
+            TableEntry *next = entry->next;
+            t->mem_free(entry);
+            entry = next;
+        }
+    }
+}
+
 /**
  * Returns the size of the specified HashTable. Size of a HashTable represents
  * the number of key-value mappings within the table.
@@ -505,6 +917,35 @@ size_t nut_hashtable_capacity(HashTable *table)
     return table->capacity;
 }
 
+/**
+ * Returns the key length the table was configured with.
+ *
+ * @param[in] table the table whose key length is being returned
+ *
+ * @return the length of the keys, or KEY_LENGTH_VARIABLE if the keys are
+ * NUL terminated strings.
+ */
+int nut_hashtable_key_length(HashTable *table)
+{
+    return table->key_len;
+}
+
+/**
+ * Copies the allocators of the table into the mem_alloc, mem_calloc and
+ * mem_free fields of the conf, so that memory derived from the table can be
+ * managed the same way as the table itself. The other fields are left as
+ * they are.
+ *
+ * @param[in] table the table whose allocators are being copied
+ * @param[out] conf the conf that receives the allocators
+ */
+void nut_hashtable_mem_conf(HashTable const *table, HashTableConf *conf)
+{
+    conf->mem_alloc  = table->mem_alloc;
+    conf->mem_calloc = table->mem_calloc;
+    conf->mem_free   = table->mem_free;
+}
+
 /**
  * Checks whether or not the HashTable contains the specified key.
  *
@@ -515,10 +956,29 @@ size_t nut_hashtable_capacity(HashTable *table)
  */
 bool nut_hashtable_contains_key(HashTable *table, void *key)
 {
-    TableEntry *entry = table->buckets[get_table_index(table, key)];
+    return nut_hashtable_contains_key_hashed(table, key, nut_hashtable_hash_key(table, key));
+}
+
+/**
+ * Same as <code>nut_hashtable_contains_key()</code>, but uses the specified
+ * hash instead of hashing the key.
+ *
+ * @param[in] table the table on which the search is being performed
+ * @param[in] key the key that is being searched for
+ * @param[in] hash the hash of the key as returned by <code>
+ *                 nut_hashtable_hash_key()</code> for this table
+ *
+ * @return true if the table contains the key.
+ */
+bool nut_hashtable_contains_key_hashed(HashTable *table, void *key, size_t hash)
+{
+    if (table->layout == HASHTABLE_OPEN)
+        return open_find(table, key, hash) != NULL;
+
+    TableEntry *entry = *get_bucket(table, hash);
 
     while (entry) {
-        if (table->key_cmp(key, entry->key) == 0)
+        if (entry->hash == hash && key_eq(table, entry->key, key))
             return true;
 
         entry = entry->next;
@@ -526,6 +986,23 @@ bool nut_hashtable_contains_key(HashTable *table, void *key)
     return false;
 }
 
+/**
+ * Returns the hash of the key as computed by the table, using the hash
+ * function, key length and seed of the table. The hash can be passed to the
+ * <code>_hashed</code> functions of this table, or of any other table with
+ * the same hash configuration, so that a key that is used repeatedly is only
+ * hashed once.
+ *
+ * @param[in] table the table whose hash configuration is being used
+ * @param[in] key the key that is being hashed
+ *
+ * @return the hash of the key.
+ */
+size_t nut_hashtable_hash_key(HashTable *table, const void *key)
+{
+    return key ? table->hash(key, table->key_len, table->hash_seed) : 0;
+}
+
 /**
  * Returns an Array of hashtable values. The returned Array is allocated
  * using the same memory allocators used by the HashTable.
@@ -552,8 +1029,19 @@ NutState nut_hashtable_get_values(HashTable *table, Array **out)
         return stat;
 
     size_t i;
-    for (i = 0; i <table->capacity; i++) {
-        TableEntry *entry = table->buckets[i];
+    if (table->layout == HASHTABLE_OPEN) {
+        for (i = open_next_full(table, 0); i < table->capacity; i = open_next_full(table, i + 1)) {
+            if ((stat = nut_array_add(values, table->slots[i].value)) != NUT_OK) {
+                nut_array_destroy(values);
+                return stat;
+            }
+        }
+        *out = values;
+        return NUT_OK;
+    }
+
+    for (i = 0; i < bucket_count(table); i++) {
+        TableEntry *entry = bucket_at(table, i);
 
         while (entry) {
             if ((stat = nut_array_add(values, entry->value)) == NUT_OK) {
@@ -594,8 +1082,19 @@ NutState nut_hashtable_get_keys(HashTable *table, Array **out)
         return stat;
 
     size_t i;
-    for (i = 0; i < table->capacity; i++) {
-        TableEntry *entry = table->buckets[i];
+    if (table->layout == HASHTABLE_OPEN) {
+        for (i = open_next_full(table, 0); i < table->capacity; i = open_next_full(table, i + 1)) {
+            if ((stat = nut_array_add(keys, table->slots[i].key)) != NUT_OK) {
+                nut_array_destroy(keys);
+                return stat;
+            }
+        }
+        *out = keys;
+        return NUT_OK;
+    }
+
+    for (i = 0; i < bucket_count(table); i++) {
+        TableEntry *entry = bucket_at(table, i);
 
         while (entry) {
             if ((stat = nut_array_add(keys, entry->key)) == NUT_OK) {
@@ -610,15 +1109,6 @@ NutState nut_hashtable_get_keys(HashTable *table, Array **out)
     return NUT_OK;
 }
 
-/**
- * Returns the bucket index that maps to the specified key.
- */
-static INLINE size_t get_table_index(HashTable *table, void *key)
-{
-    size_t hash = table->hash(key, table->key_len, table->hash_seed);
-    return hash & (table->capacity - 1);
-}
-
 /**
  * Applies the function fn to each key of the HashTable.
  *
@@ -631,8 +1121,14 @@ static INLINE size_t get_table_index(HashTable *table, void *key)
 void nut_hashtable_foreach_key(HashTable *table, void (*fn) (const void *key))
 {
     size_t i;
-    for (i = 0; i <table->capacity; i++) {
-        TableEntry *entry = table->buckets[i];
+    if (table->layout == HASHTABLE_OPEN) {
+        for (i = open_next_full(table, 0); i < table->capacity; i = open_next_full(table, i + 1))
+            fn(table->slots[i].key);
+        return;
+    }
+
+    for (i = 0; i < bucket_count(table); i++) {
+        TableEntry *entry = bucket_at(table, i);
 
         while (entry) {
             fn(entry->key);
@@ -651,8 +1147,14 @@ void nut_hashtable_foreach_key(HashTable *table, void (*fn) (const void *key))
 void nut_hashtable_foreach_value(HashTable *table, void (*fn) (void *val))
 {
     size_t i;
-    for (i = 0; i <table->capacity; i++) {
-        TableEntry *entry = table->buckets[i];
+    if (table->layout == HASHTABLE_OPEN) {
+        for (i = open_next_full(table, 0); i < table->capacity; i = open_next_full(table, i + 1))
+            fn(table->slots[i].value);
+        return;
+    }
+
+    for (i = 0; i < bucket_count(table); i++) {
+        TableEntry *entry = bucket_at(table, i);
 
         while (entry) {
             fn(entry->value);
@@ -665,17 +1167,32 @@ void nut_hashtable_foreach_value(HashTable *table, void (*fn) (void *val))
  * Initializes the HashTableIter structure.
  *
  * @note The order at which the entries are returned is unspecified.
+ * @note While an incremental resize is in progress, add, get and remove
+ * migrate entries between buckets, so only the iterator functions may be
+ * used to modify the table during iteration.
  *
  * @param[in] iter the iterator that is being initialized
  * @param[in] table the table over whose entries the iterator is going to iterate
  */
 void nut_hashtable_iter_init(HashTableIter *iter, HashTable *table)
 {
-    iter->table = table;
+    iter->table        = table;
+    iter->bucket_index = 0;
+    iter->prev_entry   = NULL;
+    iter->next_entry   = NULL;
 
     size_t i;
-    for (i = 0; i < table->capacity; i++) {
-        TableEntry *e = table->buckets[i];
+    if (table->layout == HASHTABLE_OPEN) {
+        i = open_next_full(table, 0);
+        if (i < table->capacity) {
+            iter->bucket_index = i;
+            iter->next_entry   = &(table->slots[i]);
+        }
+        return;
+    }
+
+    for (i = 0; i < bucket_count(table); i++) {
+        TableEntry *e = bucket_at(table, i);
         if (e) {
             iter->bucket_index = i;
             iter->next_entry   = e;
@@ -701,6 +1218,19 @@ NutState nut_hashtable_iter_next(HashTableIter *iter, TableEntry **te)
         return NUT_ITER_END;
 
     iter->prev_entry = iter->next_entry;
+
+    if (iter->table->layout == HASHTABLE_OPEN) {
+        size_t i = open_next_full(iter->table, iter->bucket_index + 1);
+
+        iter->next_entry = NULL;
+        if (i < iter->table->capacity) {
+            iter->bucket_index = i;
+            iter->next_entry   = &(iter->table->slots[i]);
+        }
+        *te = iter->prev_entry;
+        return NUT_OK;
+    }
+
     iter->next_entry = iter->next_entry->next;
 
     /* Iterate through the list */
@@ -711,8 +1241,8 @@ NutState nut_hashtable_iter_next(HashTableIter *iter, TableEntry **te)
 
     /* Find the next list and return the first element*/
     size_t i;
-    for (i = iter->bucket_index + 1; i < iter->table->capacity; i++) {
-        iter->next_entry = iter->table->buckets[i];
+    for (i = iter->bucket_index + 1; i < bucket_count(iter->table); i++) {
+        iter->next_entry = bucket_at(iter->table, i);
 
         if (iter->next_entry) {
             iter->bucket_index = i;
@@ -741,7 +1271,190 @@ NutState nut_hashtable_iter_next(HashTableIter *iter, TableEntry **te)
  */
 NutState nut_hashtable_iter_remove(HashTableIter *iter, void **out)
 {
-    return nut_hashtable_remove(iter->table, iter->prev_entry->key, out);
+    if (iter->table->layout == HASHTABLE_OPEN)
+        return open_remove(iter->table, iter->prev_entry->key, iter->prev_entry->hash, out);
+
+    return chain_remove(iter->table, iter->prev_entry->key, iter->prev_entry->hash, out);
+}
+
+
+/*******************************************************************************
+ *
+ *
+ *  Open addressing layout
+ *
+ *
+ ******************************************************************************/
+
+/**
+ * Compares a stored key against the key that is being looked up. The NULL
+ * key only ever matches itself.
+ */
+static INLINE bool key_eq(HashTable *t, const void *stored, void *key)
+{
+    if (!key)
+        return stored == NULL;
+
+    return stored && t->key_cmp(stored, key) == 0;
+}
+
+/**
+ * Allocates an empty control and slot array of the specified capacity and
+ * makes them the table storage. The capacity must be a power of two that
+ * is not smaller than GROUP_WIDTH.
+ */
+static NutState open_alloc(HashTable *t, size_t capacity)
+{
+    uint8_t    *ctrl  = ctrl_alloc(capacity, t->mem_alloc);
+    TableEntry *slots = t->mem_alloc(capacity * sizeof(TableEntry));
+
+    if (!ctrl || !slots) {
+        if (ctrl)
+            t->mem_free(ctrl);
+        if (slots)
+            t->mem_free(slots);
+        return NUT_ERR_MALLOC;
+    }
+
+    t->ctrl      = ctrl;
+    t->slots     = slots;
+    t->capacity  = capacity;
+    t->deleted   = 0;
+    t->threshold = t->load_factor * capacity;
+
+    /* At least one slot must always stay empty to terminate the probing */
+    if (t->threshold >= capacity)
+        t->threshold = capacity - 1;
+
+    return NUT_OK;
+}
+
+/**
+ * Returns the index of the first full slot at or after the index from, or
+ * the table capacity if there are no more full slots.
+ */
+static INLINE size_t open_next_full(HashTable *t, size_t from)
+{
+    return ctrl_next_full(t->ctrl, t->capacity, from);
+}
+
+/**
+ * Probes the table for the entry with the specified key. The probe sequence
+ * visits whole groups of slots in triangular steps and terminates at the
+ * first group that contains an empty slot.
+ *
+ * @return the entry with the matching key, or NULL if the key was not found.
+ */
+static TableEntry *open_find(HashTable *t, void *key, size_t hash)
+{
+    CtrlProbe probe;
+    size_t    i;
+
+    ctrl_probe_init(&probe, t->ctrl, t->capacity, hash);
+
+    while ((i = ctrl_probe_next(&probe)) != CTRL_PROBE_END) {
+        TableEntry *e = &(t->slots[i]);
+
+        if (e->hash == hash && key_eq(t, e->key, key))
+            return e;
+    }
+    return NULL;
+}
+
+/**
+ * Rehashes all entries into a new slot array of the specified capacity. The
+ * new capacity may be equal to the current one, in which case the resize
+ * only clears out the deleted slots. Entries keep their stored hash, so the
+ * hash function is not called.
+ *
+ * @return NUT_OK if the resize was successful, NUT_ERR_MAX_CAPACITY if maximum
+ * capacity has been reached, or NUT_ERR_MALLOC if the memory allocation for
+ * the new slot array failed.
+ */
+static NutState open_resize(HashTable *t, size_t new_capacity)
+{
+    if (new_capacity < t->capacity || new_capacity > MAX_POW_TWO)
+        return NUT_ERR_MAX_CAPACITY;
+
+    uint8_t    *old_ctrl     = t->ctrl;
+    TableEntry *old_slots    = t->slots;
+    size_t      old_capacity = t->capacity;
+
+    if (open_alloc(t, new_capacity) != NUT_OK)
+        return NUT_ERR_MALLOC;
+
+    ctrl_rehash(old_ctrl, old_slots, old_capacity, t->ctrl, t->slots, t->capacity,
+                sizeof(TableEntry), offsetof(TableEntry, hash));
+
+    t->mem_free(old_ctrl);
+    t->mem_free(old_slots);
+
+    return NUT_OK;
+}
+
+/**
+ * Open addressing variant of nut_hashtable_add().
+ */
+static NutState open_add(HashTable *t, void *key, void *val, size_t hash)
+{
+    TableEntry *entry = open_find(t, key, hash);
+
+    if (entry) {
+        entry->value = val;
+        return NUT_OK;
+    }
+
+    if (t->size + t->deleted >= t->threshold) {
+        /* If most of the load are tombstones, rehashing in place is enough */
+        size_t   new_capacity = t->size >= t->threshold / 2 ? t->capacity << 1 : t->capacity;
+        NutState stat;
+
+        if (t->capacity == MAX_POW_TWO && new_capacity != t->capacity)
+            return NUT_ERR_MAX_CAPACITY;
+
+        if ((stat = open_resize(t, new_capacity)) != NUT_OK)
+            return stat;
+    }
+
+    size_t i = ctrl_find_free(t->ctrl, t->capacity, hash);
+
+    if (t->ctrl[i] == CTRL_DELETED)
+        t->deleted--;
+
+    ctrl_set(t->ctrl, t->capacity, i, H2(hash));
+
+    entry        = &(t->slots[i]);
+    entry->key   = key;
+    entry->value = val;
+    entry->hash  = hash;
+    entry->next  = NULL;
+
+    t->size++;
+
+    return NUT_OK;
+}
+
+/**
+ * Open addressing variant of nut_hashtable_remove(). The slot is marked as
+ * deleted rather than emptied so that the probe sequences passing through it
+ * stay intact. The slot contents are left untouched, which keeps an iterator
+ * that is positioned on it valid.
+ */
+static NutState open_remove(HashTable *t, void *key, size_t hash, void **out)
+{
+    TableEntry *entry = open_find(t, key, hash);
+
+    if (!entry)
+        return NUT_ERR_KEY_NOT_FOUND;
+
+    ctrl_set(t->ctrl, t->capacity, (size_t) (entry - t->slots), CTRL_DELETED);
+    t->size--;
+    t->deleted++;
+
+    if (out)
+        *out = entry->value;
+
+    return NUT_OK;
 }
 
 
@@ -755,15 +1468,212 @@ NutState nut_hashtable_iter_remove(HashTableIter *iter, void **out)
 
 size_t nut_hashtable_hash_string(const void *key, int len, uint32_t seed)
 {
-    const    char   *str  = key;
-    register size_t  hash = seed + 5381 + len + 1; /* Suppress the unused param warning */
+    const    unsigned char *str  = key;
+    register size_t         hash = seed + 5381 + len + 1; /* Suppress the unused param warning */
+    unsigned char           c;
 
-    while (*str++)
-        hash = ((hash << 5) + hash) ^ *str;
+    while ((c = *str++))
+        hash = ((hash << 5) + hash) ^ c;
 
     return hash;
 }
 
+/*******************************************************************************
+ *
+ *
+ *  wyhash-style hash
+ *
+ *
+ ******************************************************************************/
+
+/*
+ * A seeded 64bit hash in the style of wyhash. The key is consumed eight
+ * bytes at a time and mixed with a folded 64x64->128bit multiplication.
+ * The 64bit result does not depend on the byte order, so tables can be
+ * generated offline, as long as the generating host has the same size_t
+ * width as the target; a 32bit size_t keeps only the low half.
+ */
+
+static const uint64_t wy_secret[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+static INLINE void wy_mum(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t) *a * *b;
+
+    *a = (uint64_t) r;
+    *b = (uint64_t) (r >> 64);
+#else
+    uint64_t ha = *a >> 32, la = (uint32_t) *a;
+    uint64_t hb = *b >> 32, lb = (uint32_t) *b;
+
+    uint64_t rh  = ha * hb;
+    uint64_t rm0 = ha * lb;
+    uint64_t rm1 = hb * la;
+    uint64_t rl  = la * lb;
+
+    uint64_t t  = rl + (rm0 << 32);
+    uint64_t c  = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+
+    c += lo < t;
+
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static INLINE uint64_t wy_mix(uint64_t a, uint64_t b)
+{
+    wy_mum(&a, &b);
+    return a ^ b;
+}
+
+static INLINE uint64_t wy_read8(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static INLINE uint64_t wy_read4(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+/**
+ * Hashes len bytes of the key. If len is KEY_LENGTH_VARIABLE the key is
+ * treated as a NUL terminated string.
+ */
+size_t nut_hashtable_hash_wy(const void *key, int len, uint32_t seed)
+{
+    const uint8_t *p = key;
+    const size_t   n = len < 0 ? strlen(key) : (size_t) len;
+
+    uint64_t s = wy_mix(seed ^ wy_secret[0], wy_secret[1]);
+    uint64_t a;
+    uint64_t b;
+
+    if (n <= 16) {
+        if (n >= 4) {
+            const size_t q = (n >> 3) << 2;
+
+            a = (wy_read4(p) << 32) | wy_read4(p + q);
+            b = (wy_read4(p + n - 4) << 32) | wy_read4(p + n - 4 - q);
+        } else if (n > 0) {
+            a = ((uint64_t) p[0] << 16) | ((uint64_t) p[n >> 1] << 8) | p[n - 1];
+            b = 0;
+        } else {
+            a = 0;
+            b = 0;
+        }
+    } else {
+        size_t i = n;
+
+        if (i > 48) {
+            uint64_t s1 = s;
+            uint64_t s2 = s;
+            do {
+                s  = wy_mix(wy_read8(p)      ^ wy_secret[1], wy_read8(p + 8)  ^ s);
+                s1 = wy_mix(wy_read8(p + 16) ^ wy_secret[2], wy_read8(p + 24) ^ s1);
+                s2 = wy_mix(wy_read8(p + 32) ^ wy_secret[3], wy_read8(p + 40) ^ s2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            s ^= s1 ^ s2;
+        }
+        while (i > 16) {
+            s  = wy_mix(wy_read8(p) ^ wy_secret[1], wy_read8(p + 8) ^ s);
+            p += 16;
+            i -= 16;
+        }
+        a = wy_read8(p + i - 16);
+        b = wy_read8(p + i - 8);
+    }
+    a ^= wy_secret[1];
+    b ^= s;
+    wy_mum(&a, &b);
+
+    return (size_t) wy_mix(a ^ wy_secret[0] ^ n, b ^ wy_secret[1]);
+}
+
+/*******************************************************************************
+ *
+ *
+ *  CRC32C hash
+ *
+ *
+ ******************************************************************************/
+
+/*
+ * CRC32C (Castagnoli) of the key, finished with a multiplicative mix that
+ * spreads the 32 CRC bits over the whole hash. SSE4.2 builds use the crc32
+ * instruction; the portable path uses a 16 entry nibble table so that it
+ * stays cheap on flash. Both produce the same hash.
+ */
+
+#if !defined(__SSE4_2__)
+static const uint32_t crc32c_nibble[16] = {
+    0x00000000, 0x105ec76f, 0x20bd8ede, 0x30e349b1,
+    0x417b1dbc, 0x5125dad3, 0x61c69362, 0x7198540d,
+    0x82f63b78, 0x92a8fc17, 0xa24bb5a6, 0xb21572c9,
+    0xc38d26c4, 0xd3d3e1ab, 0xe330a81a, 0xf36e6f75
+};
+#endif
+
+/**
+ * Hashes len bytes of the key. If len is KEY_LENGTH_VARIABLE the key is
+ * treated as a NUL terminated string.
+ */
+size_t nut_hashtable_hash_crc32(const void *key, int len, uint32_t seed)
+{
+    const uint8_t *p   = key;
+    size_t         n   = len < 0 ? strlen(key) : (size_t) len;
+    const size_t   l   = n;
+    uint32_t       crc = ~seed;
+
+#if defined(__SSE4_2__)
+#if defined(__x86_64__) || defined(_M_X64)
+    while (n >= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        crc = (uint32_t) _mm_crc32_u64(crc, v);
+        p += 8;
+        n -= 8;
+    }
+#endif
+    while (n >= 4) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        crc = _mm_crc32_u32(crc, v);
+        p += 4;
+        n -= 4;
+    }
+    while (n--)
+        crc = _mm_crc32_u8(crc, *p++);
+#else
+    while (n--) {
+        crc ^= *p++;
+        crc  = (crc >> 4) ^ crc32c_nibble[crc & 0x0f];
+        crc  = (crc >> 4) ^ crc32c_nibble[crc & 0x0f];
+    }
+#endif
+    uint64_t h = ((uint64_t) ~crc << 32 | (uint32_t) l) * 0x9e3779b97f4a7c15ULL;
+
+    return (size_t) (h ^ (h >> 29));
+}
+
 /*******************************************************************************
  *
  *
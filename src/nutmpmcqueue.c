@@ -0,0 +1,402 @@
+#include "nutconf.h"
+#include "nutport.h"
+#include "nutmem.h"
+
+#include <stdatomic.h>
+
+#include "nutmpmcqueue.h"
+
+/*
+ * Bounded queue after Dmitry Vyukov. Both positions are free running
+ * counters and position p maps to cell p & mask. A cell whose sequence
+ * number equals p is free for the producer that claims position p; once
+ * that producer has stored the element it sets the sequence to p + 1, which
+ * makes the cell full for the consumer that claims position p. The consumer
+ * in turn sets it to p + capacity, freeing the cell for the next lap.
+ *
+ * A position is claimed with a compare-and-swap, after which the cell
+ * belongs to the claiming thread alone. A sequence number that is behind
+ * the position means the queue is full (or empty, for a consumer); one that
+ * is ahead means another thread claimed the position first.
+ */
+#define QUEUE_LINE 64
+
+#define DEFAULT_CAPACITY 16
+
+typedef struct cell_s {
+    atomic_size_t seq;
+    void         *data;
+} Cell;
+
+/*
+ * The producer position, the consumer position and the sleeper counts each
+ * get a cache line of their own. The allocator gives no such alignment, so
+ * the structure is placed at the first aligned address of a larger block.
+ */
+struct nut_mpmcqueue_s {
+    /* Read only after creation */
+    size_t         capacity;
+    size_t         mask;
+    Cell          *cells;
+    bool           blocking;
+    NutSem         items;
+    NutSem         slots;
+    void          *block;
+    void         (*mem_free) (void *block);
+
+    _Alignas(QUEUE_LINE)
+    atomic_size_t  enqueue_pos;
+
+    _Alignas(QUEUE_LINE)
+    atomic_size_t  dequeue_pos;
+
+    /* Threads asleep in poll_wait and enqueue_wait */
+    _Alignas(QUEUE_LINE)
+    atomic_size_t  poll_sleepers;
+    atomic_size_t  enqueue_sleepers;
+};
+
+static NutState queue_push    (MpmcQueue *queue, void *element);
+static NutState queue_pop     (MpmcQueue *queue, void **out);
+static void     queue_wake    (atomic_size_t *sleepers, NutSem *sem);
+static size_t   upper_pow_two (size_t n);
+
+
+/**
+ * Initializes the fields of the MpmcQueueConf struct to default values.
+ *
+ * @param[in, out] conf MpmcQueueConf structure that is being initialized
+ */
+void nut_mpmcqueue_conf_init(MpmcQueueConf *conf)
+{
+    conf->capacity   = DEFAULT_CAPACITY;
+    conf->blocking   = false;
+    conf->mem_alloc  = nut_mem_malloc;
+    conf->mem_calloc = nut_mem_calloc;
+    conf->mem_free   = nut_mem_free;
+}
+
+/**
+ * Creates a new empty, non-blocking MpmcQueue that can hold at least
+ * capacity elements and returns a status code.
+ *
+ * @param[in] capacity the number of elements the queue can hold
+ * @param[out] out pointer to where the newly created MpmcQueue is to be stored
+ *
+ * @return NUT_OK if the creation was successful, NUT_ERR_INVALID_CAPACITY if
+ * the capacity is 0 or too large, or NUT_ERR_MALLOC if the memory allocation
+ * for the new MpmcQueue failed.
+ */
+NutState nut_mpmcqueue_new(size_t capacity, MpmcQueue **out)
+{
+    MpmcQueueConf conf;
+    nut_mpmcqueue_conf_init(&conf);
+    conf.capacity = capacity;
+    return nut_mpmcqueue_new_conf(&conf, out);
+}
+
+/**
+ * Creates a new empty MpmcQueue based on the specified MpmcQueueConf struct
+ * and returns a status code.
+ *
+ * @param[in] conf MpmcQueue configuration structure. All fields must be
+ *                 initialized with appropriate values.
+ * @param[out] out pointer to where the newly created MpmcQueue is to be stored
+ *
+ * @return NUT_OK if the creation was successful, NUT_ERR_INVALID_CAPACITY if
+ * the capacity is 0 or too large, or NUT_ERR_MALLOC if the memory allocation
+ * for the new MpmcQueue or its semaphores failed.
+ */
+NutState nut_mpmcqueue_new_conf(MpmcQueueConf const * const conf, MpmcQueue **out)
+{
+    if (conf->capacity == 0 ||
+        conf->capacity > MAX_POW_TWO ||
+        conf->capacity > NUT_MAX_ELEMENTS / sizeof(Cell))
+        return NUT_ERR_INVALID_CAPACITY;
+
+    size_t capacity = upper_pow_two(conf->capacity);
+    void  *block    = conf->mem_alloc(sizeof(MpmcQueue) + QUEUE_LINE - 1);
+
+    if (!block)
+        return NUT_ERR_MALLOC;
+
+    MpmcQueue *queue = (MpmcQueue*) (((uintptr_t) block + QUEUE_LINE - 1) & ~(uintptr_t) (QUEUE_LINE - 1));
+
+    if (!(queue->cells = conf->mem_alloc(capacity * sizeof(Cell)))) {
+        conf->mem_free(block);
+        return NUT_ERR_MALLOC;
+    }
+    queue->blocking = conf->blocking;
+
+    if (queue->blocking) {
+        unsigned max = capacity > UINT_MAX ? UINT_MAX : (unsigned) capacity;
+
+        if (!nut_sem_init(&queue->items, max)) {
+            conf->mem_free(queue->cells);
+            conf->mem_free(block);
+            return NUT_ERR_MALLOC;
+        }
+        if (!nut_sem_init(&queue->slots, max)) {
+            nut_sem_destroy(&queue->items);
+            conf->mem_free(queue->cells);
+            conf->mem_free(block);
+            return NUT_ERR_MALLOC;
+        }
+    }
+    for (size_t i = 0; i < capacity; i++)
+        atomic_init(&queue->cells[i].seq, i);
+
+    queue->capacity = capacity;
+    queue->mask     = capacity - 1;
+    queue->block    = block;
+    queue->mem_free = conf->mem_free;
+
+    atomic_init(&queue->enqueue_pos, 0);
+    atomic_init(&queue->dequeue_pos, 0);
+    atomic_init(&queue->poll_sleepers, 0);
+    atomic_init(&queue->enqueue_sleepers, 0);
+
+    *out = queue;
+    return NUT_OK;
+}
+
+/**
+ * Destroys the MpmcQueue. No thread may be using the queue at that point.
+ *
+ * @param[in] queue the queue that is being destroyed
+ */
+void nut_mpmcqueue_destroy(MpmcQueue *queue)
+{
+    if (queue->blocking) {
+        nut_sem_destroy(&queue->items);
+        nut_sem_destroy(&queue->slots);
+    }
+    queue->mem_free(queue->cells);
+    queue->mem_free(queue->block);
+}
+
+/**
+ * Adds an element to the back of the queue without blocking. May be called
+ * by any number of threads at once.
+ *
+ * @param[in] queue the queue to which the element is being added
+ * @param[in] element the element that is being added
+ *
+ * @return NUT_OK if the element was added, or NUT_ERR_MAX_CAPACITY if the
+ * queue is full.
+ */
+NutState nut_mpmcqueue_enqueue(MpmcQueue *queue, void *element)
+{
+    if (queue_push(queue, element) != NUT_OK)
+        return NUT_ERR_MAX_CAPACITY;
+
+    if (queue->blocking)
+        queue_wake(&queue->poll_sleepers, &queue->items);
+
+    return NUT_OK;
+}
+
+/**
+ * Adds an element to the back of the queue, sleeping while the queue is
+ * full. On a queue that was not created with the blocking option this is
+ * the same as nut_mpmcqueue_enqueue().
+ *
+ * @param[in] queue the queue to which the element is being added
+ * @param[in] element the element that is being added
+ *
+ * @return NUT_OK if the element was added, or NUT_ERR_MAX_CAPACITY if the
+ * queue is full and does not block.
+ */
+NutState nut_mpmcqueue_enqueue_wait(MpmcQueue *queue, void *element)
+{
+    if (!queue->blocking)
+        return nut_mpmcqueue_enqueue(queue, element);
+
+    while (nut_mpmcqueue_enqueue(queue, element) != NUT_OK) {
+        /* Announce the sleep before the last try, so that a consumer that
+         * frees a slot after the try is bound to see it and post. */
+        atomic_fetch_add(&queue->enqueue_sleepers, 1);
+
+        if (nut_mpmcqueue_enqueue(queue, element) == NUT_OK) {
+            atomic_fetch_sub(&queue->enqueue_sleepers, 1);
+            break;
+        }
+        nut_sem_wait(&queue->slots);
+        atomic_fetch_sub(&queue->enqueue_sleepers, 1);
+    }
+    return NUT_OK;
+}
+
+/**
+ * Removes the element at the front of the queue without blocking and sets
+ * the out parameter to its value. May be called by any number of threads
+ * at once.
+ *
+ * @param[in] queue the queue from which the element is being removed
+ * @param[out] out pointer to where the removed element is stored
+ *
+ * @return NUT_OK if an element was removed, or NUT_ERR_OUT_OF_RANGE if the
+ * queue is empty.
+ */
+NutState nut_mpmcqueue_poll(MpmcQueue *queue, void **out)
+{
+    if (queue_pop(queue, out) != NUT_OK)
+        return NUT_ERR_OUT_OF_RANGE;
+
+    if (queue->blocking)
+        queue_wake(&queue->enqueue_sleepers, &queue->slots);
+
+    return NUT_OK;
+}
+
+/**
+ * Removes the element at the front of the queue, sleeping while the queue
+ * is empty. On a queue that was not created with the blocking option this
+ * is the same as nut_mpmcqueue_poll().
+ *
+ * @param[in] queue the queue from which the element is being removed
+ * @param[out] out pointer to where the removed element is stored
+ *
+ * @return NUT_OK if an element was removed, or NUT_ERR_OUT_OF_RANGE if the
+ * queue is empty and does not block.
+ */
+NutState nut_mpmcqueue_poll_wait(MpmcQueue *queue, void **out)
+{
+    if (!queue->blocking)
+        return nut_mpmcqueue_poll(queue, out);
+
+    while (nut_mpmcqueue_poll(queue, out) != NUT_OK) {
+        atomic_fetch_add(&queue->poll_sleepers, 1);
+
+        if (nut_mpmcqueue_poll(queue, out) == NUT_OK) {
+            atomic_fetch_sub(&queue->poll_sleepers, 1);
+            break;
+        }
+        nut_sem_wait(&queue->items);
+        atomic_fetch_sub(&queue->poll_sleepers, 1);
+    }
+    return NUT_OK;
+}
+
+/**
+ * Returns the number of elements in the queue. While other threads are
+ * using the queue the result is only a snapshot that may already be out of
+ * date.
+ *
+ * @param[in] queue the queue whose size is being returned
+ *
+ * @return the number of elements in the queue.
+ */
+size_t nut_mpmcqueue_size(MpmcQueue *queue)
+{
+    size_t head = atomic_load_explicit(&queue->dequeue_pos, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&queue->enqueue_pos, memory_order_acquire);
+
+    /* The consumers may have moved past the loaded tail */
+    if (tail - head > queue->capacity)
+        return tail < head ? 0 : queue->capacity;
+
+    return tail - head;
+}
+
+/**
+ * Returns the number of elements the queue can hold.
+ *
+ * @param[in] queue the queue whose capacity is being returned
+ *
+ * @return the capacity of the queue.
+ */
+size_t nut_mpmcqueue_capacity(MpmcQueue *queue)
+{
+    return queue->capacity;
+}
+
+/**
+ * Claims the next producer position and stores the element in its cell.
+ *
+ * @return NUT_OK on success, or NUT_ERR_MAX_CAPACITY if the queue is full.
+ */
+static NutState queue_push(MpmcQueue *queue, void *element)
+{
+    size_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    Cell  *cell;
+
+    for (;;) {
+        cell = &queue->cells[pos & queue->mask];
+
+        size_t   seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        } else if (dif < 0) {
+            return NUT_ERR_MAX_CAPACITY;
+        } else {
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        }
+    }
+    cell->data = element;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    return NUT_OK;
+}
+
+/**
+ * Claims the next consumer position and takes the element out of its cell.
+ *
+ * @return NUT_OK on success, or NUT_ERR_OUT_OF_RANGE if the queue is empty.
+ */
+static NutState queue_pop(MpmcQueue *queue, void **out)
+{
+    size_t pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+    Cell  *cell;
+
+    for (;;) {
+        cell = &queue->cells[pos & queue->mask];
+
+        size_t   seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t) seq - (intptr_t) (pos + 1);
+
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        } else if (dif < 0) {
+            return NUT_ERR_OUT_OF_RANGE;
+        } else {
+            pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+        }
+    }
+    *out = cell->data;
+    atomic_store_explicit(&cell->seq, pos + queue->mask + 1, memory_order_release);
+    return NUT_OK;
+}
+
+/**
+ * Wakes a thread sleeping on sem, if there is any. The fence orders the
+ * cell update that was just published before the load of the sleeper count,
+ * pairing with the increment a sleeper makes before its last try.
+ */
+static void queue_wake(atomic_size_t *sleepers, NutSem *sem)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load_explicit(sleepers, memory_order_relaxed))
+        nut_sem_post(sem);
+}
+
+/**
+ * Rounds n up to the nearest power of two.
+ */
+static size_t upper_pow_two(size_t n)
+{
+    size_t p = 1;
+
+    while (p < n)
+        p <<= 1;
+
+    return p;
+}
@@ -7,9 +7,9 @@
 #include "nutpqueue.h"
 
 
-#define NUT_PARENT(x) (x - 1) / 2
-#define NUT_LEFT(x)    2 * x + 1
-#define NUT_RIGHT(x)   2 * x + 2
+#define NUT_PARENT(x) (((x) - 1) / 2)
+#define NUT_LEFT(x)   (2 * (x) + 1)
+#define NUT_RIGHT(x)  (2 * (x) + 2)
 
 
 #define DEFAULT_CAPACITY 8
@@ -32,7 +32,9 @@ struct nut_pqueue_s {
 };
 
 
-static void nut_pqueue_heapify(PQueue *pqueue, size_t index);
+static void     nut_pqueue_heapify (PQueue *pqueue, size_t index);
+static NutState reserve_capacity   (PQueue *pq, size_t capacity);
+static void     sift_up            (PQueue *pq, size_t index);
 
 
 /**
@@ -167,29 +169,19 @@ void nut_pqueue_destroy_cb(PQueue *pq, void (*cb) (void*))
  */
 static NutState expand_capacity(PQueue *pq)
 {
-    if (pq->capacity == NUT_MAX_ELEMENTS)
+    const size_t max_elements = NUT_MAX_ELEMENTS / sizeof(void*);
+
+    if (pq->capacity >= max_elements)
         return NUT_ERR_MAX_CAPACITY;
 
     size_t new_capacity = pq->capacity * pq->exp_factor;
 
     /* As long as the capacity is greater that the expansion factor
      * at the point of overflow, this is check is valid. */
-    if (new_capacity <= pq->capacity)
-        pq->capacity = NUT_MAX_ELEMENTS;
-    else
-        pq->capacity = new_capacity;
-
-    void **new_buff = pq->mem_alloc(new_capacity * sizeof(void*));
-
-    if (!new_buff)
-        return NUT_ERR_MALLOC;
-
-    memcpy(new_buff, pq->buffer, pq->size * sizeof(void*));
-
-    pq->mem_free(pq->buffer);
-    pq->buffer = new_buff;
+    if (new_capacity <= pq->capacity || new_capacity > max_elements)
+        new_capacity = max_elements;
 
-    return NUT_OK;
+    return reserve_capacity(pq, new_capacity);
 }
 
 /**
@@ -214,20 +206,58 @@ NutState nut_pqueue_push(PQueue *pq, void *element)
     pq->buffer[i] = element;
     pq->size++;
 
-    if (i == 0)
-        return NUT_OK;
+    sift_up(pq, i);
+    return NUT_OK;
+}
+
+/**
+ * Pushes n elements into the PQueue at once. The elements are appended to
+ * the heap with a single copy. If the batch is at least as large as the
+ * PQueue, the heap is then rebuilt bottom-up in O(size) time, otherwise
+ * every new element is sifted up on its own.
+ *
+ * @param[in] pq the priority queue in which the elements are to be pushed
+ * @param[in] elements the elements that are being pushed
+ * @param[in] n the number of elements
+ *
+ * @return NUT_OK if the elements were successfully pushed, NUT_ERR_MALLOC
+ * if the memory allocation for the new buffer failed, or
+ * NUT_ERR_MAX_CAPACITY if the PQueue would exceed its maximum capacity.
+ */
+NutState nut_pqueue_push_all(PQueue *pq, void * const *elements, size_t n)
+{
+    const size_t max_elements = NUT_MAX_ELEMENTS / sizeof(void*);
+
+    if (n > max_elements - pq->size)
+        return NUT_ERR_MAX_CAPACITY;
+
+    if (pq->size + n > pq->capacity) {
+        size_t capacity = max_elements;
+
+        if (pq->capacity < max_elements / pq->exp_factor)
+            capacity = pq->capacity * pq->exp_factor;
+
+        if (capacity < pq->size + n)
+            capacity = pq->size + n;
+
+        NutState status = reserve_capacity(pq, capacity);
+
+        if (status != NUT_OK)
+            return status;
+    }
 
-    void *child  = pq->buffer[i];
-    void *parent = pq->buffer[NUT_PARENT(i)];
+    size_t old_size = pq->size;
 
-    while (i != 0 && pq->cmp(child, parent) > 0) {
-        void *tmp = pq->buffer[i];
-        pq->buffer[i] = pq->buffer[NUT_PARENT(i)];
-        pq->buffer[NUT_PARENT(i)] = tmp;
+    memcpy(&pq->buffer[pq->size], elements, n * sizeof(void*));
+    pq->size += n;
 
-        i      = NUT_PARENT(i);
-        child  = pq->buffer[i];
-        parent = pq->buffer[NUT_PARENT(i)];
+    size_t i;
+    if (n >= old_size) {
+        for (i = pq->size / 2; i > 0; i--)
+            nut_pqueue_heapify(pq, i - 1);
+    } else {
+        for (i = old_size; i < pq->size; i++)
+            sift_up(pq, i);
     }
     return NUT_OK;
 }
@@ -278,42 +308,78 @@ NutState nut_pqueue_pop(PQueue *pq, void **out)
 }
 
 /**
- * Maintains the heap property of the PQueue
+ * Maintains the heap property of the PQueue by sifting the element at the
+ * index down until neither of its children has a higher priority.
  *
  * @param[in] pq the PQueue structure whose heap property is to be maintained
  * @param[in] index the index from where we need to apply this operation
  */
 static void nut_pqueue_heapify(PQueue *pq, size_t index)
 {
-    if (pq->size <= 1)
-        return;
+    for (;;) {
+        size_t L    = NUT_LEFT(index);
+        size_t R    = NUT_RIGHT(index);
+        size_t next = index;
 
-    size_t L   = CC_LEFT(index);
-    size_t R   = CC_RIGHT(index);
-    size_t tmp = index;
+        if (L < pq->size && pq->cmp(pq->buffer[next], pq->buffer[L]) < 0)
+            next = L;
 
-    void *left     = pq->buffer[L];
-    void *right    = pq->buffer[R];
-    void *indexPtr = pq->buffer[index];
+        if (R < pq->size && pq->cmp(pq->buffer[next], pq->buffer[R]) < 0)
+            next = R;
 
-    if (L >= pq->size || R >= pq->size)
-        return;
+        if (next == index)
+            return;
 
-    if (pq->cmp(indexPtr, left) < 0) {
-        indexPtr = left;
-        index = L;
-    }
+        void *swap_tmp     = pq->buffer[index];
+        pq->buffer[index]  = pq->buffer[next];
+        pq->buffer[next]   = swap_tmp;
 
-    if (pq->cmp(indexPtr, right) < 0) {
-        indexPtr = right;
-        index = R;
+        index = next;
     }
+}
 
-    if (index != tmp) {
-        void *swap_tmp = pq->buffer[tmp];
-        pq->buffer[tmp] = pq->buffer[index];
-        pq->buffer[index] = swap_tmp;
+/**
+ * Moves the element at the index up the heap until its parent has a
+ * priority that is not lower.
+ *
+ * @param[in] pq the PQueue structure whose heap property is to be maintained
+ * @param[in] index the index of the element that is being moved
+ */
+static void sift_up(PQueue *pq, size_t index)
+{
+    while (index != 0 && pq->cmp(pq->buffer[index], pq->buffer[NUT_PARENT(index)]) > 0) {
+        void *tmp = pq->buffer[index];
+        pq->buffer[index] = pq->buffer[NUT_PARENT(index)];
+        pq->buffer[NUT_PARENT(index)] = tmp;
 
-        nut_pqueue_heapify(pq, index);
+        index = NUT_PARENT(index);
     }
 }
+
+/**
+ * Makes sure that the PQueue can hold at least capacity elements.
+ *
+ * @param[in] pq the PQueue whose capacity is being reserved
+ * @param[in] capacity the number of elements the PQueue must be able to hold
+ *
+ * @return NUT_OK if the capacity was reserved, or NUT_ERR_MALLOC if the
+ * memory allocation for the new buffer failed.
+ */
+static NutState reserve_capacity(PQueue *pq, size_t capacity)
+{
+    if (capacity <= pq->capacity)
+        return NUT_OK;
+
+    void **new_buff = pq->mem_alloc(capacity * sizeof(void*));
+
+    if (!new_buff)
+        return NUT_ERR_MALLOC;
+
+    memcpy(new_buff, pq->buffer, pq->size * sizeof(void*));
+
+    pq->mem_free(pq->buffer);
+    pq->buffer   = new_buff;
+    pq->capacity = capacity;
+
+    return NUT_OK;
+}
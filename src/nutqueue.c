@@ -8,11 +8,16 @@
 struct nut_queue_s {
     Deque *d;
 
+    /* Set if the queue lives in caller memory given to nut_queue_new_static() */
+    bool   fixed;
+
     void *(*mem_alloc)  (size_t size);
     void *(*mem_calloc) (size_t blocks, size_t size);
     void  (*mem_free)   (void *block);
 };
 
+_Static_assert(sizeof(Queue) <= sizeof(((QueueStatic*) 0)->reserved), "QueueStatic is too small");
+
 /**
  * Initializes the fields of the QueueConf struct to default values.
  *
@@ -77,6 +82,39 @@ NutState nut_queue_new_conf(QueueConf const * const conf, Queue **q)
     return NUT_OK;
 }
 
+/**
+ * Creates a new empty Queue in caller supplied memory and returns a status
+ * code. Nothing is allocated, and the Queue never grows: enqueueing onto a
+ * full Queue returns NUT_ERR_MAX_CAPACITY. The memory must outlive the
+ * Queue, and nut_queue_destroy() only detaches the Queue from it.
+ *
+ * @param[in] buffer the buffer of capacity pointers that holds the elements
+ * @param[in] capacity the number of elements the buffer can hold. Must be a
+ *                     power of two.
+ * @param[in] storage the memory in which the Queue structure is placed
+ * @param[out] out pointer to where the newly created Queue is to be stored
+ *
+ * @return NUT_OK if the creation was successful, or NUT_ERR_INVALID_CAPACITY
+ * if the capacity is 0, too large or not a power of two.
+ */
+NutState nut_queue_new_static(void **buffer, size_t capacity, QueueStatic *storage, Queue **q)
+{
+    Queue   *queue = (Queue*) storage->reserved;
+    NutState status = nut_deque_new_static(buffer, capacity, &storage->deque, &queue->d);
+
+    if (status != NUT_OK)
+        return status;
+
+    queue->fixed      = true;
+    queue->mem_alloc  = &nut_mem_malloc;
+    queue->mem_calloc = &nut_mem_calloc;
+    queue->mem_free   = &nut_mem_free;
+
+    *q = queue;
+
+    return NUT_OK;
+}
+
 /**
  * Destroys the queue structure, but leaves the data it used to hold intact.
  *
@@ -85,7 +123,9 @@ NutState nut_queue_new_conf(QueueConf const * const conf, Queue **q)
 void nut_queue_destroy(Queue *queue)
 {
     nut_deque_destroy(queue->d);
-    queue->mem_free(queue);
+
+    if (!queue->fixed)
+        queue->mem_free(queue);
 }
 
 /**
@@ -99,7 +139,9 @@ void nut_queue_destroy(Queue *queue)
 void nut_queue_destroy_cb(Queue *queue, void (*cb) (void*))
 {
     nut_deque_destroy_cb(queue->d, cb);
-    free(queue);
+
+    if (!queue->fixed)
+        queue->mem_free(queue);
 }
 
 /**
@@ -139,14 +181,93 @@ NutState nut_queue_poll(Queue *queue, void **out)
  * @param[in] queue the queue on which this operation is performed
  * @param[in] element the element being enqueued
  *
- * @return CC_OK if the element was successfully added, or NUT_ERR_MALLOC
- * if the memory allocation for the new element failed.
+ * @return CC_OK if the element was successfully added, NUT_ERR_MALLOC if the
+ * memory allocation for the new element failed, or NUT_ERR_MAX_CAPACITY if
+ * the queue is full and cannot grow.
  */
 NutState nut_queue_enqueue(Queue *queue, void *element)
 {
     return nut_deque_add_first(queue->d, element);
 }
 
+/**
+ * Sets the out parameters to the elements of the queue as at most two
+ * contiguous runs of pointers. The queue keeps its newest element first, so
+ * the runs list the elements from the back of the queue to the front and
+ * the front of the queue is the last pointer of the runs. The runs are
+ * views into the queue and stay valid until the queue is modified. A run
+ * that is not needed has a length of 0.
+ *
+ * @param[in] queue the queue whose elements are being returned
+ * @param[out] span1 pointer to where the first run is stored
+ * @param[out] n1 pointer to where the length of the first run is stored
+ * @param[out] span2 pointer to where the second run is stored
+ * @param[out] n2 pointer to where the length of the second run is stored
+ *
+ * @return the number of elements in the two runs, which is the size of the
+ * queue.
+ */
+size_t nut_queue_peek_spans(Queue const * const queue, void * const **span1, size_t *n1,
+                            void * const **span2, size_t *n2)
+{
+    return nut_deque_peek_spans(queue->d, span1, n1, span2, n2);
+}
+
+/**
+ * Removes the n elements at the front of the queue at once, without
+ * returning them. These are the last n pointers of the runs returned by
+ * nut_queue_peek_spans().
+ *
+ * @param[in] queue the queue on which this operation is performed
+ * @param[in] n the number of elements being removed
+ *
+ * @return CC_OK if the elements were removed, or CC_ERR_OUT_OF_RANGE if the
+ * queue holds fewer than n elements.
+ */
+NutState nut_queue_consume(Queue *queue, size_t n)
+{
+    return nut_deque_consume_last(queue->d, n);
+}
+
+/**
+ * Makes room for n elements at the back of the queue and sets the out
+ * parameters to the free slots as at most two contiguous runs. The slots
+ * are filled in place and then enqueued with nut_queue_commit(). The runs
+ * are in the same back to front order as the ones of nut_queue_peek_spans(),
+ * so the element that is enqueued first goes into the last slot.
+ *
+ * @param[in] queue the queue on which this operation is performed
+ * @param[in] n the number of slots being reserved
+ * @param[out] span1 pointer to where the first run is stored
+ * @param[out] n1 pointer to where the length of the first run is stored
+ * @param[out] span2 pointer to where the second run is stored
+ * @param[out] n2 pointer to where the length of the second run is stored
+ *
+ * @return CC_OK if the slots were reserved, NUT_ERR_MALLOC if the memory
+ * allocation for the new buffer failed, or NUT_ERR_MAX_CAPACITY if the
+ * queue cannot grow.
+ */
+NutState nut_queue_reserve_spans(Queue *queue, size_t n, void ***span1, size_t *n1,
+                                 void ***span2, size_t *n2)
+{
+    return nut_deque_reserve_spans_first(queue->d, n, span1, n1, span2, n2);
+}
+
+/**
+ * Enqueues the last n slots reserved by nut_queue_reserve_spans(), which
+ * must have been filled by the caller. The last slot is enqueued first.
+ *
+ * @param[in] queue the queue on which this operation is performed
+ * @param[in] n the number of elements being enqueued
+ *
+ * @return CC_OK if the elements were enqueued, or CC_ERR_OUT_OF_RANGE if n
+ * exceeds the free capacity of the queue.
+ */
+NutState nut_queue_commit(Queue *queue, size_t n)
+{
+    return nut_deque_commit_first(queue->d, n);
+}
+
 /**
  * Returns the size of the specified queue. The size of the queue is
  * the number of elements contained within the queue.
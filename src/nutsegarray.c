@@ -0,0 +1,932 @@
+#include "nutconf.h"
+#include "nutport.h"
+#include "nutmem.h"
+
+#include "nutsegarray.h"
+
+#define DEFAULT_CAPACITY   8
+#define DEFAULT_CHUNK_SIZE 32
+
+/* Number of entries of the first chunk directory */
+#define DEFAULT_DIR_SIZE   4
+
+/*
+ * Element i lives in chunk i >> shift at offset i & mask. The chunks
+ * [0, chunks) are allocated, so the capacity is chunks << shift. Growth
+ * only ever reallocates the directory, which holds one pointer per chunk.
+ */
+struct nut_segarray_s {
+    size_t    size;
+
+    /* Size of an element in bytes. Pointer arrays store void* elements,
+     * value arrays store the elements themselves. */
+    size_t    elem_size;
+    size_t    shift;
+    size_t    mask;
+
+    uint8_t **dir;
+    size_t    dir_size;
+    size_t    chunks;
+
+    void *(*mem_alloc)  (size_t size);
+    void *(*mem_calloc) (size_t blocks, size_t size);
+    void  (*mem_free)   (void *block);
+};
+
+/* Address of the element at index i */
+#define SLOT(sa, i) ((sa)->dir[(size_t) (i) >> (sa)->shift] + \
+                     ((size_t) (i) & (sa)->mask) * (sa)->elem_size)
+
+static NutState seg_make_room  (SegArray *sa);
+static NutState seg_grow       (SegArray *sa, size_t chunks);
+static size_t   seg_chunk_len  (SegArray *sa, size_t c);
+static void     seg_shift_up   (SegArray *sa, size_t index);
+static void     seg_shift_down (SegArray *sa, size_t index);
+static void     swap_bytes     (uint8_t *a, uint8_t *b, size_t n);
+
+
+/**
+ * Initializes the fields of the SegArrayConf struct to default values.
+ *
+ * @param[in, out] conf SegArrayConf structure that is being initialized
+ */
+void nut_segarray_conf_init(SegArrayConf *conf)
+{
+    conf->capacity     = DEFAULT_CAPACITY;
+    conf->chunk_size   = DEFAULT_CHUNK_SIZE;
+    conf->element_size = 0;
+    conf->mem_alloc    = nut_mem_malloc;
+    conf->mem_calloc   = nut_mem_calloc;
+    conf->mem_free     = nut_mem_free;
+}
+
+/**
+ * Creates a new empty SegArray and returns a status code.
+ *
+ * @param[out] out pointer to where the newly created SegArray is to be stored
+ *
+ * @return NUT_OK if the creation was successful, or NUT_ERR_MALLOC if the
+ * memory allocation for the new SegArray structure failed.
+ */
+NutState nut_segarray_new(SegArray **out)
+{
+    SegArrayConf conf;
+    nut_segarray_conf_init(&conf);
+    return nut_segarray_new_conf(&conf, out);
+}
+
+/**
+ * Creates a new empty SegArray based on the specified SegArrayConf struct
+ * and returns a status code.
+ *
+ * @param[in] conf SegArray configuration structure. All fields must be
+ *                 initialized with appropriate values.
+ * @param[out] out pointer to where the newly created SegArray is to be stored
+ *
+ * @return NUT_OK if the creation was successful, NUT_ERR_INVALID_CAPACITY if
+ * the chunk size is 0 or too large, or NUT_ERR_MALLOC if the memory
+ * allocation for the new SegArray structure failed.
+ */
+NutState nut_segarray_new_conf(SegArrayConf const * const conf, SegArray **out)
+{
+    size_t elem_size = conf->element_size ? conf->element_size : sizeof(void*);
+    size_t shift     = 0;
+
+    if (conf->chunk_size == 0 ||
+        conf->chunk_size > MAX_POW_TWO ||
+        conf->chunk_size > NUT_MAX_ELEMENTS / 2 / elem_size)
+        return NUT_ERR_INVALID_CAPACITY;
+
+    while (((size_t) 1 << shift) < conf->chunk_size)
+        shift++;
+
+    SegArray *sa = conf->mem_calloc(1, sizeof(SegArray));
+
+    if (!sa)
+        return NUT_ERR_MALLOC;
+
+    sa->elem_size  = elem_size;
+    sa->shift      = shift;
+    sa->mask       = ((size_t) 1 << shift) - 1;
+    sa->mem_alloc  = conf->mem_alloc;
+    sa->mem_calloc = conf->mem_calloc;
+    sa->mem_free   = conf->mem_free;
+
+    NutState status = nut_segarray_reserve(sa, conf->capacity);
+
+    if (status != NUT_OK) {
+        nut_segarray_destroy(sa);
+        return status;
+    }
+
+    *out = sa;
+    return NUT_OK;
+}
+
+/**
+ * Destroys the SegArray structure, but leaves the data it used to hold
+ * intact.
+ *
+ * @param[in] sa the array that is to be destroyed
+ */
+void nut_segarray_destroy(SegArray *sa)
+{
+    size_t c;
+    for (c = 0; c < sa->chunks; c++)
+        sa->mem_free(sa->dir[c]);
+
+    if (sa->dir)
+        sa->mem_free(sa->dir);
+    sa->mem_free(sa);
+}
+
+/**
+ * Destroys the SegArray structure along with all the data it holds.
+ *
+ * @note
+ * This function should not be called on an array that has some of its
+ * elements allocated on the stack.
+ *
+ * @param[in] sa the array that is being destroyed
+ * @param[in] cb the function that is called on every element
+ */
+void nut_segarray_destroy_cb(SegArray *sa, void (*cb) (void*))
+{
+    nut_segarray_map(sa, cb);
+    nut_segarray_destroy(sa);
+}
+
+/**
+ * Adds a new element to the end of the SegArray. If the last chunk is
+ * full a new chunk is allocated; the existing elements are never moved.
+ *
+ * @param[in] sa the array to which the element is being added
+ * @param[in] element the element that is being added
+ *
+ * @return NUT_OK if the element was successfully added, NUT_ERR_MALLOC if
+ * the memory allocation for a new chunk failed, or NUT_ERR_MAX_CAPACITY if
+ * the array is already at maximum capacity.
+ */
+NutState nut_segarray_add(SegArray *sa, void *element)
+{
+    NutState status = seg_make_room(sa);
+
+    if (status != NUT_OK)
+        return status;
+
+    *(void**) SLOT(sa, sa->size) = element;
+    sa->size++;
+
+    return NUT_OK;
+}
+
+/**
+ * Adds a new element to the SegArray at the specified position by shifting
+ * all subsequent elements by one. The index may be equal to the size of the
+ * array, in which case the element is appended.
+ *
+ * @param[in] sa the array to which the element is being added
+ * @param[in] element the element that is being added
+ * @param[in] index the position in the array at which the element is being
+ *                  added
+ *
+ * @return NUT_OK if the element was successfully added, NUT_ERR_OUT_RANGE if
+ * the index was out of range, NUT_ERR_MALLOC if the memory allocation for a
+ * new chunk failed, or NUT_ERR_MAX_CAPACITY if the array is already at
+ * maximum capacity.
+ */
+NutState nut_segarray_add_at(SegArray *sa, void *element, size_t index)
+{
+    return nut_segarray_add_value_at(sa, &element, index);
+}
+
+/**
+ * Replaces the element at the specified index and optionally sets the out
+ * parameter to the value of the replaced element.
+ *
+ * @param[in] sa the array whose element is being replaced
+ * @param[in] element the replacement element
+ * @param[in] index the index of the element that is being replaced
+ * @param[out] out pointer to where the replaced element is stored, or NULL
+ *                 if it is to be ignored
+ *
+ * @return NUT_OK if the element was successfully replaced, or
+ * NUT_ERR_OUT_RANGE if the index was out of range.
+ */
+NutState nut_segarray_replace_at(SegArray *sa, void *element, size_t index, void **out)
+{
+    if (index >= sa->size)
+        return NUT_ERR_OUT_RANGE;
+
+    void **slot = (void**) SLOT(sa, index);
+
+    if (out)
+        *out = *slot;
+
+    *slot = element;
+
+    return NUT_OK;
+}
+
+/**
+ * Swaps the elements at the specified indices. Both indices must be within
+ * the bounds of the SegArray.
+ *
+ * @param[in] sa the array whose elements are being swapped
+ * @param[in] index1 index of the first element
+ * @param[in] index2 index of the second element
+ *
+ * @return NUT_OK if the elements were swapped, or NUT_ERR_OUT_RANGE if one
+ * of the indices was out of range.
+ */
+NutState nut_segarray_swap_at(SegArray *sa, size_t index1, size_t index2)
+{
+    if (index1 >= sa->size || index2 >= sa->size)
+        return NUT_ERR_OUT_RANGE;
+
+    if (index1 != index2)
+        swap_bytes(SLOT(sa, index1), SLOT(sa, index2), sa->elem_size);
+
+    return NUT_OK;
+}
+
+/**
+ * Removes the first occurrence of the specified element from the SegArray
+ * and optionally sets the out parameter to the value of the removed
+ * element.
+ *
+ * @param[in] sa the array from which the element is being removed
+ * @param[in] element the element being removed
+ * @param[out] out pointer to where the removed value is stored, or NULL
+ *                 if it is to be ignored
+ *
+ * @return NUT_OK if the element was successfully removed, or
+ * NUT_ERR_NOT_FIND if the element was not found.
+ */
+NutState nut_segarray_remove(SegArray *sa, void *element, void **out)
+{
+    size_t index;
+
+    if (nut_segarray_index_of(sa, element, &index) != NUT_OK)
+        return NUT_ERR_NOT_FIND;
+
+    return nut_segarray_remove_at(sa, index, out);
+}
+
+/**
+ * Removes the element at the specified index by shifting all subsequent
+ * elements down by one, and optionally sets the out parameter to the value
+ * of the removed element.
+ *
+ * @param[in] sa the array from which the element is being removed
+ * @param[in] index the index of the element being removed
+ * @param[out] out pointer to where the removed value is stored, or NULL if
+ *                 it is to be ignored
+ *
+ * @return NUT_OK if the element was successfully removed, or
+ * NUT_ERR_OUT_RANGE if the index was out of range.
+ */
+NutState nut_segarray_remove_at(SegArray *sa, size_t index, void **out)
+{
+    return nut_segarray_remove_value_at(sa, index, out);
+}
+
+/**
+ * Removes the last element of the SegArray and optionally sets the out
+ * parameter to the value of the removed element.
+ *
+ * @param[in] sa the array whose last element is being removed
+ * @param[out] out pointer to where the removed value is stored, or NULL if
+ *                 it is to be ignored
+ *
+ * @return NUT_OK if the element was successfully removed, or
+ * NUT_ERR_OUT_RANGE if the array is already empty.
+ */
+NutState nut_segarray_remove_last(SegArray *sa, void **out)
+{
+    if (sa->size == 0)
+        return NUT_ERR_OUT_RANGE;
+
+    sa->size--;
+
+    if (out)
+        *out = *(void**) SLOT(sa, sa->size);
+
+    return NUT_OK;
+}
+
+/**
+ * Removes all elements from the SegArray. The chunks are kept for reuse.
+ *
+ * @param[in] sa the array from which all elements are to be removed
+ */
+void nut_segarray_remove_all(SegArray *sa)
+{
+    sa->size = 0;
+}
+
+/**
+ * Removes and frees all elements from the SegArray. The chunks are kept for
+ * reuse.
+ *
+ * @param[in] sa the array from which all elements are to be removed
+ */
+void nut_segarray_remove_all_free(SegArray *sa)
+{
+    nut_segarray_map(sa, sa->mem_free);
+    nut_segarray_remove_all(sa);
+}
+
+/**
+ * Gets the element at the specified index and sets the out parameter to
+ * its value.
+ *
+ * @param[in] sa the array from which the element is being retrieved
+ * @param[in] index the index of the element
+ * @param[out] out pointer to where the element is stored
+ *
+ * @return NUT_OK if the element was found, or NUT_ERR_OUT_RANGE if the index
+ * was out of range.
+ */
+NutState nut_segarray_get_at(SegArray *sa, size_t index, void **out)
+{
+    if (index >= sa->size)
+        return NUT_ERR_OUT_RANGE;
+
+    *out = *(void**) SLOT(sa, index);
+    return NUT_OK;
+}
+
+/**
+ * Gets the last element of the SegArray and sets the out parameter to its
+ * value.
+ *
+ * @param[in] sa the array whose last element is being returned
+ * @param[out] out pointer to where the element is stored
+ *
+ * @return NUT_OK if the element was found, or NUT_ERR_OUT_RANGE if the
+ * array is empty.
+ */
+NutState nut_segarray_get_last(SegArray *sa, void **out)
+{
+    if (sa->size == 0)
+        return NUT_ERR_OUT_RANGE;
+
+    return nut_segarray_get_at(sa, sa->size - 1, out);
+}
+
+/**
+ * Returns the address of the slot that holds the element at the specified
+ * index. Adding elements to the end of the array never moves a slot, so
+ * the address stays valid until an element is added or removed in front of
+ * it, or its chunk is released by nut_segarray_trim_capacity().
+ *
+ * @param[in] sa the array that holds the element
+ * @param[in] index the index of the element
+ *
+ * @return the address of the element within its chunk, or NULL if the
+ * index was out of range.
+ */
+void *nut_segarray_get_slot(SegArray *sa, size_t index)
+{
+    if (index >= sa->size)
+        return NULL;
+
+    return SLOT(sa, index);
+}
+
+/**
+ * Releases the chunks at the end of the SegArray that hold no elements.
+ * The chunk directory is kept.
+ *
+ * @param[in] sa the array whose capacity is being trimmed
+ *
+ * @return NUT_OK.
+ */
+NutState nut_segarray_trim_capacity(SegArray *sa)
+{
+    size_t keep = (sa->size + sa->mask) >> sa->shift;
+
+    while (sa->chunks > keep)
+        sa->mem_free(sa->dir[--sa->chunks]);
+
+    return NUT_OK;
+}
+
+/**
+ * Makes sure that the SegArray can hold at least capacity elements without
+ * allocating, by allocating all of the missing chunks at once.
+ *
+ * @param[in] sa the array whose capacity is being reserved
+ * @param[in] capacity the number of elements the array must be able to hold
+ *
+ * @return NUT_OK if the capacity was reserved, NUT_ERR_MALLOC if the memory
+ * allocation for a chunk or the directory failed, or NUT_ERR_MAX_CAPACITY if
+ * the capacity exceeds the maximum capacity.
+ */
+NutState nut_segarray_reserve(SegArray *sa, size_t capacity)
+{
+    if (capacity <= sa->chunks << sa->shift)
+        return NUT_OK;
+
+    if (capacity > NUT_MAX_ELEMENTS / sa->elem_size)
+        return NUT_ERR_MAX_CAPACITY;
+
+    return seg_grow(sa, ((capacity - 1) >> sa->shift) + 1);
+}
+
+/**
+ * Returns the number of occurrences of the element within the SegArray.
+ * Each chunk is scanned with nut_common_ptr_count().
+ *
+ * @param[in] sa the array that is being searched
+ * @param[in] element the element that is being searched for
+ *
+ * @return the number of occurrences of the element.
+ */
+size_t nut_segarray_contains(SegArray *sa, void *element)
+{
+    size_t count = 0;
+    size_t c;
+
+    for (c = 0; c << sa->shift < sa->size; c++)
+        count += nut_common_ptr_count((void**) sa->dir[c], seg_chunk_len(sa, c), element);
+
+    return count;
+}
+
+/**
+ * Returns the number of elements in the SegArray.
+ *
+ * @param[in] sa the array whose size is being returned
+ *
+ * @return the number of elements within the SegArray.
+ */
+size_t nut_segarray_size(SegArray *sa)
+{
+    return sa->size;
+}
+
+/**
+ * Returns the number of elements the SegArray can hold before it has to
+ * allocate another chunk.
+ *
+ * @param[in] sa the array whose capacity is being returned
+ *
+ * @return the capacity of the SegArray.
+ */
+size_t nut_segarray_capacity(SegArray *sa)
+{
+    return sa->chunks << sa->shift;
+}
+
+/**
+ * Returns the index of the first occurrence of the specified element.
+ *
+ * @param[in] sa the array that is being searched
+ * @param[in] element the element that is being searched for
+ * @param[out] index pointer to where the index is stored
+ *
+ * @return NUT_OK if the index was found, or NUT_ERR_OUT_RANGE if not.
+ */
+NutState nut_segarray_index_of(SegArray *sa, void *element, size_t *index)
+{
+    size_t c;
+
+    for (c = 0; c << sa->shift < sa->size; c++) {
+        size_t n = seg_chunk_len(sa, c);
+        size_t i = nut_common_ptr_find((void**) sa->dir[c], n, element);
+
+        if (i < n) {
+            *index = (c << sa->shift) + i;
+            return NUT_OK;
+        }
+    }
+    return NUT_ERR_OUT_RANGE;
+}
+
+/**
+ * Applies the function fn to each element of the SegArray.
+ *
+ * @param[in] sa the array on which this operation is performed
+ * @param[in] fn the operation function that is to be invoked on each element
+ */
+void nut_segarray_map(SegArray *sa, void (*fn) (void*))
+{
+    size_t c, i;
+
+    for (c = 0; c << sa->shift < sa->size; c++) {
+        void  **chunk = (void**) sa->dir[c];
+        size_t  n     = seg_chunk_len(sa, c);
+
+        for (i = 0; i < n; i++)
+            fn(chunk[i]);
+    }
+}
+
+/**
+ * A fold/reduce function that collects all of the elements in the array
+ * together, the same way as nut_array_reduce().
+ *
+ * @param[in] sa the array on which this operation is performed
+ * @param[in] fn the operation function that is to be invoked on each element
+ * @param[in] result the pointer which will collect the end result
+ */
+void nut_segarray_reduce(SegArray *sa, void (*fn) (void*, void*, void*), void *result)
+{
+    if (sa->size == 1) {
+        fn(*(void**) SLOT(sa, 0), NULL, result);
+        return;
+    }
+    if (sa->size > 1)
+        fn(*(void**) SLOT(sa, 0), *(void**) SLOT(sa, 1), result);
+
+    size_t i;
+    for (i = 2; i < sa->size; i++)
+        fn(result, *(void**) SLOT(sa, i), result);
+}
+
+/**
+ * Initializes the iterator.
+ *
+ * @param[in] iter the iterator that is being initialized
+ * @param[in] sa the array to iterate over
+ */
+void nut_segarray_iter_init(SegArrayIter *iter, SegArray *sa)
+{
+    iter->sa           = sa;
+    iter->index        = 0;
+    iter->last_removed = false;
+}
+
+/**
+ * Advances the iterator and sets the out parameter to the value of the
+ * next element in the sequence.
+ *
+ * @param[in] iter the iterator that is being advanced
+ * @param[out] out pointer to where the next element is set
+ *
+ * @return NUT_OK if the iterator was advanced, or NUT_ITER_END if the
+ * end of the SegArray has been reached.
+ */
+NutState nut_segarray_iter_next(SegArrayIter *iter, void **out)
+{
+    if (iter->index >= iter->sa->size)
+        return NUT_ITER_END;
+
+    *out = *(void**) SLOT(iter->sa, iter->index);
+
+    iter->index++;
+    iter->last_removed = false;
+
+    return NUT_OK;
+}
+
+/**
+ * Removes the last returned element by <code>nut_segarray_iter_next()</code>
+ * without invalidating the iterator and optionally sets the out parameter
+ * to the value of the removed element.
+ *
+ * @param[in] iter the iterator on which this operation is being performed
+ * @param[out] out pointer to where the removed element is stored, or NULL
+ *                 if it is to be ignored
+ *
+ * @return NUT_OK if the element was successfully removed, or
+ * NUT_ERR_NOT_FIND if it was already removed.
+ */
+NutState nut_segarray_iter_remove(SegArrayIter *iter, void **out)
+{
+    if (iter->last_removed || iter->index == 0)
+        return NUT_ERR_NOT_FIND;
+
+    NutState status = nut_segarray_remove_at(iter->sa, iter->index - 1, out);
+
+    if (status == NUT_OK) {
+        iter->index--;
+        iter->last_removed = true;
+    }
+    return status;
+}
+
+/**
+ * Adds a new element to the SegArray after the last returned element by
+ * <code>nut_segarray_iter_next()</code> without invalidating the iterator.
+ *
+ * @param[in] iter the iterator on which this operation is being performed
+ * @param[in] element the element being added
+ *
+ * @return NUT_OK if the element was successfully added, NUT_ERR_MALLOC if
+ * the memory allocation for a new chunk failed, or NUT_ERR_MAX_CAPACITY if
+ * the array is already at maximum capacity.
+ */
+NutState nut_segarray_iter_add(SegArrayIter *iter, void *element)
+{
+    NutState status = nut_segarray_add_at(iter->sa, element, iter->index);
+
+    if (status == NUT_OK)
+        iter->index++;
+
+    return status;
+}
+
+/**
+ * Replaces the last returned element by <code>nut_segarray_iter_next()</code>
+ * with the specified element and optionally sets the out parameter to the
+ * value of the replaced element.
+ *
+ * @param[in] iter the iterator on which this operation is being performed
+ * @param[in] element the replacement element
+ * @param[out] out pointer to where the replaced element is stored, or NULL
+ *                 if it is to be ignored
+ *
+ * @return NUT_OK if the element was replaced successfully, or
+ * NUT_ERR_OUT_RANGE.
+ */
+NutState nut_segarray_iter_replace(SegArrayIter *iter, void *element, void **out)
+{
+    return nut_segarray_replace_at(iter->sa, element, iter->index - 1, out);
+}
+
+/**
+ * Returns the index of the last returned element by
+ * <code>nut_segarray_iter_next()</code>.
+ *
+ * @param[in] iter the iterator on which this operation is being performed
+ *
+ * @return the index.
+ */
+size_t nut_segarray_iter_index(SegArrayIter *iter)
+{
+    return iter->index - 1;
+}
+
+/**
+ * Appends a copy of the value to the SegArray. The value must point to
+ * element_size bytes, or to a pointer if this is a pointer array.
+ *
+ * @param[in] sa the array to which the value is being added
+ * @param[in] value pointer to the value that is being copied into the array
+ *
+ * @return NUT_OK if the value was successfully added, NUT_ERR_MALLOC if the
+ * memory allocation for a new chunk failed, or NUT_ERR_MAX_CAPACITY if the
+ * array is already at maximum capacity.
+ */
+NutState nut_segarray_add_value(SegArray *sa, const void *value)
+{
+    NutState status = seg_make_room(sa);
+
+    if (status != NUT_OK)
+        return status;
+
+    memcpy(SLOT(sa, sa->size), value, sa->elem_size);
+    sa->size++;
+
+    return NUT_OK;
+}
+
+/**
+ * Inserts a copy of the value at the specified position by shifting all
+ * subsequent elements by one. The index may be equal to the size of the
+ * SegArray, in which case the value is appended.
+ *
+ * @param[in] sa the array to which the value is being added
+ * @param[in] value pointer to the value that is being copied into the array
+ * @param[in] index the position at which the value is being added
+ *
+ * @return NUT_OK if the value was successfully added, NUT_ERR_OUT_RANGE if
+ * the index was out of range, NUT_ERR_MALLOC if the memory allocation for a
+ * new chunk failed, or NUT_ERR_MAX_CAPACITY if the array is already at
+ * maximum capacity.
+ */
+NutState nut_segarray_add_value_at(SegArray *sa, const void *value, size_t index)
+{
+    if (index > sa->size)
+        return NUT_ERR_OUT_RANGE;
+
+    NutState status = seg_make_room(sa);
+
+    if (status != NUT_OK)
+        return status;
+
+    seg_shift_up(sa, index);
+
+    memcpy(SLOT(sa, index), value, sa->elem_size);
+    sa->size++;
+
+    return NUT_OK;
+}
+
+/**
+ * Copies the element at the specified index into the memory pointed to by
+ * out.
+ *
+ * @param[in] sa the array from which the element is being copied
+ * @param[in] index the index of the element
+ * @param[out] out pointer to element_size bytes where the element is copied
+ *
+ * @return NUT_OK if the element was found, or NUT_ERR_OUT_RANGE if the index
+ * was out of range.
+ */
+NutState nut_segarray_get_value_at(SegArray *sa, size_t index, void *out)
+{
+    if (index >= sa->size)
+        return NUT_ERR_OUT_RANGE;
+
+    memcpy(out, SLOT(sa, index), sa->elem_size);
+    return NUT_OK;
+}
+
+/**
+ * Removes the element at the specified index and optionally copies it into
+ * the memory pointed to by out.
+ *
+ * @param[in] sa the array from which the element is being removed
+ * @param[in] index the index of the element being removed
+ * @param[out] out pointer to element_size bytes where the removed element is
+ *                 copied, or NULL if it is to be ignored
+ *
+ * @return NUT_OK if the element was successfully removed, or
+ * NUT_ERR_OUT_RANGE if the index was out of range.
+ */
+NutState nut_segarray_remove_value_at(SegArray *sa, size_t index, void *out)
+{
+    if (index >= sa->size)
+        return NUT_ERR_OUT_RANGE;
+
+    if (out)
+        memcpy(out, SLOT(sa, index), sa->elem_size);
+
+    seg_shift_down(sa, index);
+    sa->size--;
+
+    return NUT_OK;
+}
+
+/**
+ * Applies the function fn to each element of the SegArray. The function
+ * receives a pointer to the element within its chunk and may modify it in
+ * place.
+ *
+ * @param[in] sa the array on which this operation is performed
+ * @param[in] fn the operation function that is to be invoked on each element
+ */
+void nut_segarray_map_values(SegArray *sa, void (*fn) (void*))
+{
+    size_t c, i;
+
+    for (c = 0; c << sa->shift < sa->size; c++) {
+        uint8_t *chunk = sa->dir[c];
+        size_t   n     = seg_chunk_len(sa, c);
+
+        for (i = 0; i < n; i++)
+            fn(chunk + i * sa->elem_size);
+    }
+}
+
+/**
+ * Returns the size of a single element of the SegArray in bytes. This is
+ * sizeof(void*) for pointer arrays.
+ *
+ * @param[in] sa the array whose element size is being returned
+ *
+ * @return the size of an element in bytes.
+ */
+size_t nut_segarray_element_size(SegArray *sa)
+{
+    return sa->elem_size;
+}
+
+/**
+ * Makes sure that there is a free slot at the end of the SegArray by
+ * allocating another chunk if the last one is full.
+ *
+ * @param[in] sa the array that is about to grow by one element
+ *
+ * @return NUT_OK if there is room for the element, NUT_ERR_MALLOC if the
+ * memory allocation failed, or NUT_ERR_MAX_CAPACITY if the array is already
+ * at maximum capacity.
+ */
+static NutState seg_make_room(SegArray *sa)
+{
+    if (sa->size < sa->chunks << sa->shift)
+        return NUT_OK;
+
+    if (sa->size >= NUT_MAX_ELEMENTS / sa->elem_size)
+        return NUT_ERR_MAX_CAPACITY;
+
+    return seg_grow(sa, sa->chunks + 1);
+}
+
+/**
+ * Allocates chunks until there are at least the specified number of them.
+ * The directory is doubled when it runs out of entries, which copies only
+ * the chunk pointers.
+ *
+ * @param[in] sa the array that is being grown
+ * @param[in] chunks the number of chunks the array must have
+ *
+ * @return NUT_OK if the chunks were allocated, or NUT_ERR_MALLOC if the
+ * memory allocation for a chunk or the directory failed. The chunks that
+ * were allocated before the failure are kept.
+ */
+static NutState seg_grow(SegArray *sa, size_t chunks)
+{
+    if (chunks > sa->dir_size) {
+        size_t dir_size = sa->dir_size ? sa->dir_size : DEFAULT_DIR_SIZE;
+
+        while (dir_size < chunks)
+            dir_size *= 2;
+
+        uint8_t **dir = sa->mem_alloc(dir_size * sizeof(uint8_t*));
+
+        if (!dir)
+            return NUT_ERR_MALLOC;
+
+        if (sa->dir) {
+            memcpy(dir, sa->dir, sa->chunks * sizeof(uint8_t*));
+            sa->mem_free(sa->dir);
+        }
+        sa->dir      = dir;
+        sa->dir_size = dir_size;
+    }
+
+    while (sa->chunks < chunks) {
+        uint8_t *chunk = sa->mem_alloc(sa->elem_size << sa->shift);
+
+        if (!chunk)
+            return NUT_ERR_MALLOC;
+
+        sa->dir[sa->chunks++] = chunk;
+    }
+    return NUT_OK;
+}
+
+/**
+ * Returns the number of elements held by chunk c, which must hold at least
+ * one.
+ */
+static size_t seg_chunk_len(SegArray *sa, size_t c)
+{
+    size_t left = sa->size - (c << sa->shift);
+    return left <= sa->mask ? left : sa->mask + 1;
+}
+
+/**
+ * Moves the elements [index, size) up by one slot, so that the slot at
+ * index becomes free. The slot at size must exist. The elements are moved
+ * one chunk at a time, from the last chunk down, carrying the last element
+ * of each chunk over into the first slot of the next one.
+ */
+static void seg_shift_up(SegArray *sa, size_t index)
+{
+    size_t hole = sa->size;
+
+    while (hole > index) {
+        size_t start = hole & ~sa->mask;
+
+        if (start <= index) {
+            memmove(SLOT(sa, index + 1), SLOT(sa, index), (hole - index) * sa->elem_size);
+            return;
+        }
+        if (hole > start)
+            memmove(SLOT(sa, start + 1), SLOT(sa, start), (hole - start) * sa->elem_size);
+        memcpy(SLOT(sa, start), SLOT(sa, start - 1), sa->elem_size);
+
+        hole = start - 1;
+    }
+}
+
+/**
+ * Moves the elements (index, size) down by one slot, overwriting the
+ * element at index. The mirror image of seg_shift_up().
+ */
+static void seg_shift_down(SegArray *sa, size_t index)
+{
+    size_t hole = index;
+    size_t last = sa->size - 1;
+
+    while (hole < last) {
+        size_t end = hole | sa->mask;
+
+        if (end >= last) {
+            memmove(SLOT(sa, hole), SLOT(sa, hole + 1), (last - hole) * sa->elem_size);
+            return;
+        }
+        memmove(SLOT(sa, hole), SLOT(sa, hole + 1), (end - hole) * sa->elem_size);
+        memcpy(SLOT(sa, end), SLOT(sa, end + 1), sa->elem_size);
+
+        hole = end + 1;
+    }
+}
+
+/**
+ * Swaps two non overlapping blocks of n bytes.
+ */
+static void swap_bytes(uint8_t *a, uint8_t *b, size_t n)
+{
+    while (n--) {
+        uint8_t tmp = *a;
+        *a++ = *b;
+        *b++ = tmp;
+    }
+}
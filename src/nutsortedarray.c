@@ -0,0 +1,686 @@
+#include "nutconf.h"
+#include "nutport.h"
+#include "nutmem.h"
+
+#include "nutsortedarray.h"
+
+#define DEFAULT_CAPACITY 8
+#define DEFAULT_BATCH    32
+
+/* Runs shorter than this are sorted with an insertion sort */
+#define INSERTION_SORT_LIMIT 16
+
+/*
+ * The elements [0, sorted) of the array are sorted and distinct. The
+ * elements [sorted, size) are the pending additions in the order they were
+ * added. There are never more than batch pending elements outside of
+ * nut_sortedarray_add_all(), so the scratch buffer always has room for
+ * them when they are merged.
+ */
+struct nut_sorted_array_s {
+    Array   *ar;
+    size_t   sorted;
+    size_t   batch;
+    void   **scratch;
+
+    int   (*cmp)        (const void *e1, const void *e2);
+    void *(*mem_alloc)  (size_t size);
+    void *(*mem_calloc) (size_t blocks, size_t size);
+    void  (*mem_free)   (void *block);
+};
+
+static void   **sa_buffer       (SortedArray *sa);
+static void     sa_merge        (SortedArray *sa, void **scratch);
+static void     sa_sort         (SortedArray *sa, void **a, size_t n, void **tmp);
+static size_t   sa_lower_bound  (SortedArray *sa, const void *element);
+static size_t   sa_upper_bound  (SortedArray *sa, const void *element);
+static void     sa_truncate     (SortedArray *sa, size_t size);
+
+
+/**
+ * Initializes the fields of the SortedArrayConf struct to default values.
+ *
+ * @param[in, out] conf the configuration struct that is being initialized
+ */
+void nut_sortedarray_conf_init(SortedArrayConf *conf)
+{
+    conf->capacity   = DEFAULT_CAPACITY;
+    conf->batch      = DEFAULT_BATCH;
+    conf->cmp        = NULL;
+    conf->mem_alloc  = nut_mem_malloc;
+    conf->mem_calloc = nut_mem_calloc;
+    conf->mem_free   = nut_mem_free;
+}
+
+/**
+ * Creates a new SortedArray and returns a status code.
+ *
+ * @param[in] cmp the comparator function used to order elements
+ * @param[out] out pointer to where the newly created SortedArray is to be
+ *                 stored
+ *
+ * @return NUT_OK if the creation was successful, or NUT_ERR_MALLOC if the
+ * memory allocation for the new SortedArray failed.
+ */
+NutState nut_sortedarray_new(int (*cmp) (const void*, const void*), SortedArray **out)
+{
+    SortedArrayConf conf;
+    nut_sortedarray_conf_init(&conf);
+    conf.cmp = cmp;
+    return nut_sortedarray_new_conf(&conf, out);
+}
+
+/**
+ * Creates a new SortedArray based on the specified SortedArrayConf struct
+ * and returns a status code.
+ *
+ * @param[in] conf SortedArray configuration struct. All fields must be
+ *                 initialized.
+ * @param[out] out pointer to where the newly created SortedArray is to be
+ *                 stored
+ *
+ * @return NUT_OK if the creation was successful, NUT_ERR_INVALID_CAPACITY if
+ * the batch size is 0, or NUT_ERR_MALLOC if the memory allocation for the
+ * new SortedArray failed.
+ */
+NutState nut_sortedarray_new_conf(SortedArrayConf const * const conf, SortedArray **out)
+{
+    if (conf->batch == 0 || conf->batch > NUT_MAX_ELEMENTS / sizeof(void*))
+        return NUT_ERR_INVALID_CAPACITY;
+
+    SortedArray *sa = conf->mem_alloc(sizeof(SortedArray));
+
+    if (!sa)
+        return NUT_ERR_MALLOC;
+
+    sa->scratch = conf->mem_alloc(conf->batch * sizeof(void*));
+
+    if (!sa->scratch) {
+        conf->mem_free(sa);
+        return NUT_ERR_MALLOC;
+    }
+
+    ArrayConf aconf;
+    nut_array_conf_init(&aconf);
+    aconf.capacity   = conf->capacity;
+    aconf.mem_alloc  = conf->mem_alloc;
+    aconf.mem_calloc = conf->mem_calloc;
+    aconf.mem_free   = conf->mem_free;
+
+    NutState status = nut_array_new_conf(&aconf, &sa->ar);
+
+    if (status != NUT_OK) {
+        conf->mem_free(sa->scratch);
+        conf->mem_free(sa);
+        return status;
+    }
+    sa->sorted     = 0;
+    sa->batch      = conf->batch;
+    sa->cmp        = conf->cmp;
+    sa->mem_alloc  = conf->mem_alloc;
+    sa->mem_calloc = conf->mem_calloc;
+    sa->mem_free   = conf->mem_free;
+
+    *out = sa;
+    return NUT_OK;
+}
+
+/**
+ * Destroys the specified SortedArray. The elements are not freed.
+ *
+ * @param[in] sa the SortedArray to be destroyed
+ */
+void nut_sortedarray_destroy(SortedArray *sa)
+{
+    nut_array_destroy(sa->ar);
+    sa->mem_free(sa->scratch);
+    sa->mem_free(sa);
+}
+
+/**
+ * Destroys the specified SortedArray and calls the callback function on
+ * each of its elements. Elements that were replaced by equal elements are
+ * no longer in the array and are not passed to the callback.
+ *
+ * @param[in] sa the SortedArray to be destroyed
+ * @param[in] cb the callback that is invoked on each element
+ */
+void nut_sortedarray_destroy_cb(SortedArray *sa, void (*cb) (void*))
+{
+    nut_sortedarray_flush(sa);
+    nut_array_destroy_cb(sa->ar, cb);
+    sa->mem_free(sa->scratch);
+    sa->mem_free(sa);
+}
+
+/**
+ * Adds a new element to the SortedArray. The element is appended to the
+ * pending batch and merged into the sorted elements once the batch is full
+ * or when the array is queried. If the array already contains an equal
+ * element, that element is replaced on the merge.
+ *
+ * @param[in] sa the SortedArray to which the element is being added
+ * @param[in] element the element being added
+ *
+ * @return NUT_OK if the element was successfully added, NUT_ERR_MALLOC if
+ * the memory allocation for the new buffer failed, or NUT_ERR_MAX_CAPACITY
+ * if the array is already at maximum capacity.
+ */
+NutState nut_sortedarray_add(SortedArray *sa, void *element)
+{
+    NutState status = nut_array_add(sa->ar, element);
+
+    if (status != NUT_OK)
+        return status;
+
+    if (nut_array_size(sa->ar) - sa->sorted >= sa->batch)
+        sa_merge(sa, sa->scratch);
+
+    return NUT_OK;
+}
+
+/**
+ * Adds all elements of the Array to the SortedArray in a single merge. The
+ * Array is not modified. Elements that are equal to each other replace one
+ * another in the order of the Array, so the last one is kept.
+ *
+ * @param[in] sa the SortedArray to which the elements are being added
+ * @param[in] elements the Array of elements that are being added
+ *
+ * @return NUT_OK if the elements were successfully added, NUT_ERR_MALLOC if
+ * a memory allocation failed, or NUT_ERR_MAX_CAPACITY if the array would
+ * exceed its maximum capacity. On failure the SortedArray is left as it
+ * was.
+ */
+NutState nut_sortedarray_add_all(SortedArray *sa, Array *elements)
+{
+    size_t n = nut_array_size(elements);
+
+    nut_sortedarray_flush(sa);
+
+    if (n == 0)
+        return NUT_OK;
+
+    void **scratch = sa->scratch;
+
+    if (n > sa->batch) {
+        if (n > NUT_MAX_ELEMENTS / sizeof(void*))
+            return NUT_ERR_MAX_CAPACITY;
+
+        if (!(scratch = sa->mem_alloc(n * sizeof(void*))))
+            return NUT_ERR_MALLOC;
+    }
+
+    const void * const *src = nut_array_get_buffer(elements);
+
+    size_t i;
+    for (i = 0; i < n; i++) {
+        NutState status = nut_array_add(sa->ar, (void*) src[i]);
+
+        if (status != NUT_OK) {
+            sa_truncate(sa, sa->sorted);
+            if (scratch != sa->scratch)
+                sa->mem_free(scratch);
+            return status;
+        }
+    }
+    sa_merge(sa, scratch);
+
+    if (scratch != sa->scratch)
+        sa->mem_free(scratch);
+
+    return NUT_OK;
+}
+
+/**
+ * Merges the pending additions into the sorted elements. This happens
+ * automatically before every query, but may be called explicitly to move
+ * the cost of the merge out of a later lookup.
+ *
+ * @param[in] sa the SortedArray on which this operation is performed
+ */
+void nut_sortedarray_flush(SortedArray *sa)
+{
+    if (nut_array_size(sa->ar) > sa->sorted)
+        sa_merge(sa, sa->scratch);
+}
+
+/**
+ * Removes the element equal to the specified element from the SortedArray
+ * and sets the out parameter to the removed element.
+ *
+ * @param[in] sa the SortedArray from which the element is being removed
+ * @param[in] element the element that is being looked up
+ * @param[out] out pointer to where the removed element is stored, or NULL
+ *                 if it is to be ignored
+ *
+ * @return NUT_OK if the element was removed, or NUT_ERR_VALUE_NOT_FOUND if
+ * no equal element was found.
+ */
+NutState nut_sortedarray_remove(SortedArray *sa, const void *element, void **out)
+{
+    size_t index;
+
+    if (nut_sortedarray_index_of(sa, element, &index) != NUT_OK)
+        return NUT_ERR_VALUE_NOT_FOUND;
+
+    return nut_sortedarray_remove_at(sa, index, out);
+}
+
+/**
+ * Removes the element at the specified index and sets the out parameter to
+ * the removed element.
+ *
+ * @param[in] sa the SortedArray from which the element is being removed
+ * @param[in] index the index of the element being removed
+ * @param[out] out pointer to where the removed element is stored, or NULL
+ *                 if it is to be ignored
+ *
+ * @return NUT_OK if the element was removed, or NUT_ERR_OUT_RANGE if the
+ * index was out of range.
+ */
+NutState nut_sortedarray_remove_at(SortedArray *sa, size_t index, void **out)
+{
+    nut_sortedarray_flush(sa);
+
+    NutState status = nut_array_remove_at(sa->ar, index, out);
+
+    if (status == NUT_OK)
+        sa->sorted--;
+
+    return status;
+}
+
+/**
+ * Removes all elements from the SortedArray. The elements are not freed
+ * and the capacity is not changed.
+ *
+ * @param[in] sa the SortedArray from which all elements are being removed
+ */
+void nut_sortedarray_remove_all(SortedArray *sa)
+{
+    nut_array_remove_all(sa->ar);
+    sa->sorted = 0;
+}
+
+/**
+ * Gets the element equal to the specified element.
+ *
+ * @param[in] sa the SortedArray on which this operation is performed
+ * @param[in] element the element that is being looked up
+ * @param[out] out pointer to where the found element is stored
+ *
+ * @return NUT_OK if the element was found, or NUT_ERR_VALUE_NOT_FOUND if
+ * not.
+ */
+NutState nut_sortedarray_get(SortedArray *sa, const void *element, void **out)
+{
+    size_t index;
+
+    if (nut_sortedarray_index_of(sa, element, &index) != NUT_OK)
+        return NUT_ERR_VALUE_NOT_FOUND;
+
+    *out = sa_buffer(sa)[index];
+    return NUT_OK;
+}
+
+/**
+ * Gets the element at the specified index. The index is the rank of the
+ * element in the sort order.
+ *
+ * @param[in] sa the SortedArray on which this operation is performed
+ * @param[in] index the index of the element
+ * @param[out] out pointer to where the element is stored
+ *
+ * @return NUT_OK if the element was found, or NUT_ERR_OUT_RANGE if the index
+ * was out of range.
+ */
+NutState nut_sortedarray_get_at(SortedArray *sa, size_t index, void **out)
+{
+    nut_sortedarray_flush(sa);
+    return nut_array_get_at(sa->ar, index, out);
+}
+
+/**
+ * Gets the smallest element of the SortedArray.
+ *
+ * @param[in] sa the SortedArray on which this operation is performed
+ * @param[out] out pointer to where the element is stored
+ *
+ * @return NUT_OK if the element was found, or NUT_ERR_VALUE_NOT_FOUND if the
+ * SortedArray is empty.
+ */
+NutState nut_sortedarray_get_first(SortedArray *sa, void **out)
+{
+    if (nut_sortedarray_get_at(sa, 0, out) != NUT_OK)
+        return NUT_ERR_VALUE_NOT_FOUND;
+
+    return NUT_OK;
+}
+
+/**
+ * Gets the largest element of the SortedArray.
+ *
+ * @param[in] sa the SortedArray on which this operation is performed
+ * @param[out] out pointer to where the element is stored
+ *
+ * @return NUT_OK if the element was found, or NUT_ERR_VALUE_NOT_FOUND if the
+ * SortedArray is empty.
+ */
+NutState nut_sortedarray_get_last(SortedArray *sa, void **out)
+{
+    nut_sortedarray_flush(sa);
+
+    if (nut_array_get_last(sa->ar, out) != NUT_OK)
+        return NUT_ERR_VALUE_NOT_FOUND;
+
+    return NUT_OK;
+}
+
+/**
+ * Gets the smallest element that is greater than the specified element.
+ *
+ * @param[in] sa the SortedArray on which this operation is performed
+ * @param[in] element the element whose successor is being returned
+ * @param[out] out pointer to where the returned element is stored
+ *
+ * @return NUT_OK if the element was found, or NUT_ERR_VALUE_NOT_FOUND if not.
+ */
+NutState nut_sortedarray_get_greater_than(SortedArray *sa, const void *element, void **out)
+{
+    size_t index = nut_sortedarray_upper_bound(sa, element);
+
+    if (index == sa->sorted)
+        return NUT_ERR_VALUE_NOT_FOUND;
+
+    *out = sa_buffer(sa)[index];
+    return NUT_OK;
+}
+
+/**
+ * Gets the largest element that is less than the specified element.
+ *
+ * @param[in] sa the SortedArray on which this operation is performed
+ * @param[in] element the element whose predecessor is being returned
+ * @param[out] out pointer to where the returned element is stored
+ *
+ * @return NUT_OK if the element was found, or NUT_ERR_VALUE_NOT_FOUND if not.
+ */
+NutState nut_sortedarray_get_lesser_than(SortedArray *sa, const void *element, void **out)
+{
+    size_t index = nut_sortedarray_lower_bound(sa, element);
+
+    if (index == 0)
+        return NUT_ERR_VALUE_NOT_FOUND;
+
+    *out = sa_buffer(sa)[index - 1];
+    return NUT_OK;
+}
+
+/**
+ * Gets the index of the element equal to the specified element.
+ *
+ * @param[in] sa the SortedArray on which this operation is performed
+ * @param[in] element the element that is being looked up
+ * @param[out] index pointer to where the index is stored
+ *
+ * @return NUT_OK if the element was found, or NUT_ERR_OUT_RANGE if not.
+ */
+NutState nut_sortedarray_index_of(SortedArray *sa, const void *element, size_t *index)
+{
+    size_t i = nut_sortedarray_lower_bound(sa, element);
+
+    if (i == sa->sorted || sa->cmp(sa_buffer(sa)[i], element) != 0)
+        return NUT_ERR_OUT_RANGE;
+
+    *index = i;
+    return NUT_OK;
+}
+
+/**
+ * Returns the index of the first element that is not less than the
+ * specified element, or the size of the array if there is none.
+ *
+ * @param[in] sa the SortedArray on which this operation is performed
+ * @param[in] element the element that is being looked up
+ *
+ * @return the lower bound of the element.
+ */
+size_t nut_sortedarray_lower_bound(SortedArray *sa, const void *element)
+{
+    nut_sortedarray_flush(sa);
+    return sa_lower_bound(sa, element);
+}
+
+/**
+ * Returns the index of the first element that is greater than the
+ * specified element, or the size of the array if there is none.
+ *
+ * @param[in] sa the SortedArray on which this operation is performed
+ * @param[in] element the element that is being looked up
+ *
+ * @return the upper bound of the element.
+ */
+size_t nut_sortedarray_upper_bound(SortedArray *sa, const void *element)
+{
+    nut_sortedarray_flush(sa);
+    return sa_upper_bound(sa, element);
+}
+
+/**
+ * Finds the elements e for which from <= e < to. The elements are the ones
+ * at the indices [*first, *first + count), where count is the returned
+ * value, and can be read with nut_sortedarray_get_at() or through the
+ * buffer.
+ *
+ * @param[in] sa the SortedArray on which this operation is performed
+ * @param[in] from the inclusive lower end of the range
+ * @param[in] to the exclusive upper end of the range
+ * @param[out] first pointer to where the index of the first element in the
+ *                   range is stored
+ *
+ * @return the number of elements in the range.
+ */
+size_t nut_sortedarray_range(SortedArray *sa, const void *from, const void *to, size_t *first)
+{
+    nut_sortedarray_flush(sa);
+
+    size_t begin = sa_lower_bound(sa, from);
+    size_t end   = sa_lower_bound(sa, to);
+
+    *first = begin;
+    return end > begin ? end - begin : 0;
+}
+
+/**
+ * Checks whether the SortedArray contains an element equal to the specified
+ * element.
+ *
+ * @param[in] sa the SortedArray on which this operation is performed
+ * @param[in] element the element that is being looked up
+ *
+ * @return true if an equal element was found, false if not.
+ */
+bool nut_sortedarray_contains(SortedArray *sa, const void *element)
+{
+    size_t index;
+    return nut_sortedarray_index_of(sa, element, &index) == NUT_OK;
+}
+
+/**
+ * Returns the number of elements in the SortedArray.
+ *
+ * @param[in] sa the SortedArray whose size is being returned
+ *
+ * @return the number of elements in the SortedArray.
+ */
+size_t nut_sortedarray_size(SortedArray *sa)
+{
+    nut_sortedarray_flush(sa);
+    return sa->sorted;
+}
+
+/**
+ * Returns the sorted elements of the SortedArray. The buffer is valid until
+ * the SortedArray is modified.
+ *
+ * @param[in] sa the SortedArray whose buffer is being returned
+ *
+ * @return the buffer of nut_sortedarray_size() elements.
+ */
+const void* const* nut_sortedarray_get_buffer(SortedArray *sa)
+{
+    nut_sortedarray_flush(sa);
+    return nut_array_get_buffer(sa->ar);
+}
+
+/**
+ * Returns the buffer of the underlying Array. The SortedArray owns the
+ * Array, so it is free to write to the buffer.
+ */
+static void **sa_buffer(SortedArray *sa)
+{
+    return (void**) nut_array_get_buffer(sa->ar);
+}
+
+/**
+ * Sorts the pending elements into the scratch buffer and merges them into
+ * the sorted elements from the back, so the merge needs no room beyond the
+ * pending elements. A pending element replaces an equal sorted element, and
+ * among equal pending elements the last one added is kept.
+ */
+static void sa_merge(SortedArray *sa, void **scratch)
+{
+    void  **buff = sa_buffer(sa);
+    size_t  m    = sa->sorted;
+    size_t  size = nut_array_size(sa->ar);
+    size_t  n    = size - m;
+    size_t  i, j;
+
+    /* The tail of the buffer doubles as the temporary buffer of the sort,
+     * since the pending elements are moved to the scratch buffer first */
+    memcpy(scratch, buff + m, n * sizeof(void*));
+    sa_sort(sa, scratch, n, buff + m);
+
+    /* Collapse runs of equal elements to the last of each run */
+    size_t k = 0;
+    for (i = 0; i < n; i++) {
+        if (i + 1 < n && sa->cmp(scratch[i], scratch[i + 1]) == 0)
+            continue;
+        scratch[k++] = scratch[i];
+    }
+
+    size_t w = m + k;
+    i = m;
+    j = k;
+    while (j > 0) {
+        if (i > 0) {
+            int c = sa->cmp(buff[i - 1], scratch[j - 1]);
+
+            if (c > 0) {
+                buff[--w] = buff[--i];
+                continue;
+            }
+            if (c == 0)
+                i--;
+        }
+        buff[--w] = scratch[--j];
+    }
+
+    /* Close the gap left by the replaced elements */
+    if (w > i)
+        memmove(buff + i, buff + w, (m + k - w) * sizeof(void*));
+
+    sa->sorted = m + k - (w - i);
+    sa_truncate(sa, sa->sorted);
+}
+
+/**
+ * Stable merge sort of n elements using tmp as a buffer of n elements.
+ */
+static void sa_sort(SortedArray *sa, void **a, size_t n, void **tmp)
+{
+    size_t i, j, k;
+
+    if (n <= INSERTION_SORT_LIMIT) {
+        for (i = 1; i < n; i++) {
+            void *v = a[i];
+            for (j = i; j > 0 && sa->cmp(v, a[j - 1]) < 0; j--)
+                a[j] = a[j - 1];
+            a[j] = v;
+        }
+        return;
+    }
+    size_t mid = n / 2;
+
+    sa_sort(sa, a, mid, tmp);
+    sa_sort(sa, a + mid, n - mid, tmp);
+
+    if (sa->cmp(a[mid], a[mid - 1]) >= 0)
+        return;
+
+    memcpy(tmp, a, mid * sizeof(void*));
+
+    i = 0;
+    j = mid;
+    k = 0;
+    while (i < mid && j < n) {
+        if (sa->cmp(a[j], tmp[i]) < 0)
+            a[k++] = a[j++];
+        else
+            a[k++] = tmp[i++];
+    }
+    while (i < mid)
+        a[k++] = tmp[i++];
+}
+
+/**
+ * Branchless binary search for the first sorted element that is not less
+ * than the element. The range is halved unconditionally on every step, so
+ * the loop runs the same number of times for every key and the compiler
+ * can turn the comparison into a conditional move.
+ */
+static size_t sa_lower_bound(SortedArray *sa, const void *element)
+{
+    void  **base = sa_buffer(sa);
+    size_t  n    = sa->sorted;
+
+    if (n == 0)
+        return 0;
+
+    while (n > 1) {
+        size_t half = n / 2;
+        base += (sa->cmp(base[half - 1], element) < 0) * half;
+        n    -= half;
+    }
+    return (size_t) (base - sa_buffer(sa)) + (sa->cmp(*base, element) < 0);
+}
+
+/**
+ * Branchless binary search for the first sorted element that is greater
+ * than the element.
+ */
+static size_t sa_upper_bound(SortedArray *sa, const void *element)
+{
+    void  **base = sa_buffer(sa);
+    size_t  n    = sa->sorted;
+
+    if (n == 0)
+        return 0;
+
+    while (n > 1) {
+        size_t half = n / 2;
+        base += (sa->cmp(base[half - 1], element) <= 0) * half;
+        n    -= half;
+    }
+    return (size_t) (base - sa_buffer(sa)) + (sa->cmp(*base, element) <= 0);
+}
+
+/**
+ * Drops the elements past size from the underlying Array.
+ */
+static void sa_truncate(SortedArray *sa, size_t size)
+{
+    while (nut_array_size(sa->ar) > size)
+        nut_array_remove_last(sa->ar, NULL);
+}
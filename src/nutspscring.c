@@ -0,0 +1,365 @@
+#include "nutconf.h"
+#include "nutport.h"
+#include "nutmem.h"
+
+#include "nutspscring.h"
+
+/*
+ * The indices are free running counters: the elements are [head, tail),
+ * slot i lives at buffer[i & mask], and the ring is full when
+ * tail - head == capacity, so no slot is wasted.
+ *
+ * Each side publishes its index with a release store after it is done with
+ * the slots, and reads the index of the other side with an acquire load
+ * before it touches them. Each side also keeps a copy of the other side's
+ * index and only reloads it when the copy says the ring is full or empty,
+ * so in the common case the two sides do not touch each other's cache line.
+ */
+#if defined(__ARM_ARCH_PROFILE) && __ARM_ARCH_PROFILE == 'M'
+
+/* Cortex-M. Aligned word accesses are single copy atomic and the core
+ * is alone, so a DMB on the right side of the index access is all the
+ * ordering that is needed. Only the M7 has a data cache, with 32 byte
+ * lines. */
+#define RING_LINE 32
+
+typedef volatile size_t RingIndex;
+
+static INLINE size_t ring_load_acquire(RingIndex *index)
+{
+    size_t v = *index;
+    __asm volatile ("dmb" ::: "memory");
+    return v;
+}
+
+static INLINE void ring_store_release(RingIndex *index, size_t v)
+{
+    __asm volatile ("dmb" ::: "memory");
+    *index = v;
+}
+
+#define RING_LOAD_RELAXED(index)     (*(index))
+#define RING_LOAD_ACQUIRE(index)     ring_load_acquire(index)
+#define RING_STORE_RELEASE(index, v) ring_store_release(index, v)
+#define RING_INIT(index, v)          (*(index) = (v))
+
+#else
+
+#include <stdatomic.h>
+
+#define RING_LINE 64
+
+typedef atomic_size_t RingIndex;
+
+#define RING_LOAD_RELAXED(index)     atomic_load_explicit(index, memory_order_relaxed)
+#define RING_LOAD_ACQUIRE(index)     atomic_load_explicit(index, memory_order_acquire)
+#define RING_STORE_RELEASE(index, v) atomic_store_explicit(index, v, memory_order_release)
+#define RING_INIT(index, v)          atomic_init(index, v)
+
+#endif
+
+#define DEFAULT_CAPACITY 16
+
+/*
+ * The consumer and the producer fields each get a cache line of their own.
+ * The allocator gives no such alignment, so the structure is placed at the
+ * first aligned address of a larger block.
+ */
+struct nut_spscring_s {
+    /* Read only after creation */
+    size_t     capacity;
+    size_t     mask;
+    void     **buffer;
+    void      *block;
+    void     (*mem_free) (void *block);
+
+    /* Written by the consumer */
+    _Alignas(RING_LINE)
+    RingIndex  head;
+    size_t     tail_cache;
+
+    /* Written by the producer */
+    _Alignas(RING_LINE)
+    RingIndex  tail;
+    size_t     head_cache;
+};
+
+static size_t upper_pow_two (size_t n);
+
+
+/**
+ * Initializes the fields of the SpscRingConf struct to default values.
+ *
+ * @param[in, out] conf SpscRingConf structure that is being initialized
+ */
+void nut_spscring_conf_init(SpscRingConf *conf)
+{
+    conf->capacity   = DEFAULT_CAPACITY;
+    conf->mem_alloc  = nut_mem_malloc;
+    conf->mem_calloc = nut_mem_calloc;
+    conf->mem_free   = nut_mem_free;
+}
+
+/**
+ * Creates a new empty SpscRing that can hold at least capacity elements
+ * and returns a status code.
+ *
+ * @param[in] capacity the number of elements the ring can hold
+ * @param[out] out pointer to where the newly created SpscRing is to be stored
+ *
+ * @return NUT_OK if the creation was successful, NUT_ERR_INVALID_CAPACITY if
+ * the capacity is 0 or too large, or NUT_ERR_MALLOC if the memory allocation
+ * for the new SpscRing failed.
+ */
+NutState nut_spscring_new(size_t capacity, SpscRing **out)
+{
+    SpscRingConf conf;
+    nut_spscring_conf_init(&conf);
+    conf.capacity = capacity;
+    return nut_spscring_new_conf(&conf, out);
+}
+
+/**
+ * Creates a new empty SpscRing based on the specified SpscRingConf struct
+ * and returns a status code.
+ *
+ * @param[in] conf SpscRing configuration structure. All fields must be
+ *                 initialized with appropriate values.
+ * @param[out] out pointer to where the newly created SpscRing is to be stored
+ *
+ * @return NUT_OK if the creation was successful, NUT_ERR_INVALID_CAPACITY if
+ * the capacity is 0 or too large, or NUT_ERR_MALLOC if the memory allocation
+ * for the new SpscRing failed.
+ */
+NutState nut_spscring_new_conf(SpscRingConf const * const conf, SpscRing **out)
+{
+    if (conf->capacity == 0 ||
+        conf->capacity > MAX_POW_TWO ||
+        conf->capacity > NUT_MAX_ELEMENTS / sizeof(void*))
+        return NUT_ERR_INVALID_CAPACITY;
+
+    size_t capacity = upper_pow_two(conf->capacity);
+    void  *block    = conf->mem_alloc(sizeof(SpscRing) + RING_LINE - 1);
+
+    if (!block)
+        return NUT_ERR_MALLOC;
+
+    SpscRing *ring = (SpscRing*) (((uintptr_t) block + RING_LINE - 1) & ~(uintptr_t) (RING_LINE - 1));
+
+    if (!(ring->buffer = conf->mem_alloc(capacity * sizeof(void*)))) {
+        conf->mem_free(block);
+        return NUT_ERR_MALLOC;
+    }
+    ring->capacity   = capacity;
+    ring->mask       = capacity - 1;
+    ring->block      = block;
+    ring->mem_free   = conf->mem_free;
+    ring->tail_cache = 0;
+    ring->head_cache = 0;
+
+    RING_INIT(&ring->head, 0);
+    RING_INIT(&ring->tail, 0);
+
+    *out = ring;
+    return NUT_OK;
+}
+
+/**
+ * Destroys the SpscRing. Neither side may be using the ring at that point.
+ *
+ * @param[in] ring the ring that is being destroyed
+ */
+void nut_spscring_destroy(SpscRing *ring)
+{
+    ring->mem_free(ring->buffer);
+    ring->mem_free(ring->block);
+}
+
+/**
+ * Adds an element to the back of the ring. Must only be called by the
+ * producer.
+ *
+ * @param[in] ring the ring to which the element is being added
+ * @param[in] element the element that is being added
+ *
+ * @return NUT_OK if the element was added, or NUT_ERR_MAX_CAPACITY if the
+ * ring is full.
+ */
+NutState nut_spscring_enqueue(SpscRing *ring, void *element)
+{
+    size_t tail = RING_LOAD_RELAXED(&ring->tail);
+
+    if (tail - ring->head_cache == ring->capacity) {
+        ring->head_cache = RING_LOAD_ACQUIRE(&ring->head);
+
+        if (tail - ring->head_cache == ring->capacity)
+            return NUT_ERR_MAX_CAPACITY;
+    }
+    ring->buffer[tail & ring->mask] = element;
+
+    RING_STORE_RELEASE(&ring->tail, tail + 1);
+    return NUT_OK;
+}
+
+/**
+ * Adds as many of the n elements to the back of the ring as there is room
+ * for, in order, and publishes them to the consumer all at once. Must only
+ * be called by the producer.
+ *
+ * @param[in] ring the ring to which the elements are being added
+ * @param[in] elements the elements that are being added
+ * @param[in] n the number of elements
+ *
+ * @return the number of elements that were added.
+ */
+size_t nut_spscring_enqueue_all(SpscRing *ring, void * const *elements, size_t n)
+{
+    size_t tail = RING_LOAD_RELAXED(&ring->tail);
+    size_t room = ring->capacity - (tail - ring->head_cache);
+
+    if (room < n) {
+        ring->head_cache = RING_LOAD_ACQUIRE(&ring->head);
+        room = ring->capacity - (tail - ring->head_cache);
+    }
+    if (n > room)
+        n = room;
+    if (n == 0)
+        return 0;
+
+    size_t i    = tail & ring->mask;
+    size_t span = ring->capacity - i < n ? ring->capacity - i : n;
+
+    memcpy(&ring->buffer[i], elements, span * sizeof(void*));
+    memcpy(ring->buffer, elements + span, (n - span) * sizeof(void*));
+
+    RING_STORE_RELEASE(&ring->tail, tail + n);
+    return n;
+}
+
+/**
+ * Removes the element at the front of the ring and sets the out parameter
+ * to its value. Must only be called by the consumer.
+ *
+ * @param[in] ring the ring from which the element is being removed
+ * @param[out] out pointer to where the removed element is stored
+ *
+ * @return NUT_OK if an element was removed, or NUT_ERR_OUT_OF_RANGE if the
+ * ring is empty.
+ */
+NutState nut_spscring_poll(SpscRing *ring, void **out)
+{
+    size_t head = RING_LOAD_RELAXED(&ring->head);
+
+    if (head == ring->tail_cache) {
+        ring->tail_cache = RING_LOAD_ACQUIRE(&ring->tail);
+
+        if (head == ring->tail_cache)
+            return NUT_ERR_OUT_OF_RANGE;
+    }
+    *out = ring->buffer[head & ring->mask];
+
+    RING_STORE_RELEASE(&ring->head, head + 1);
+    return NUT_OK;
+}
+
+/**
+ * Removes up to n elements from the front of the ring and copies them to
+ * out, in order, releasing their slots to the producer all at once. Must
+ * only be called by the consumer.
+ *
+ * @param[in] ring the ring from which the elements are being removed
+ * @param[out] out buffer of at least n pointers where the removed elements
+ *                 are stored
+ * @param[in] n the largest number of elements to remove
+ *
+ * @return the number of elements that were removed.
+ */
+size_t nut_spscring_poll_all(SpscRing *ring, void **out, size_t n)
+{
+    size_t head  = RING_LOAD_RELAXED(&ring->head);
+    size_t avail = ring->tail_cache - head;
+
+    if (avail < n) {
+        ring->tail_cache = RING_LOAD_ACQUIRE(&ring->tail);
+        avail = ring->tail_cache - head;
+    }
+    if (n > avail)
+        n = avail;
+    if (n == 0)
+        return 0;
+
+    size_t i    = head & ring->mask;
+    size_t span = ring->capacity - i < n ? ring->capacity - i : n;
+
+    memcpy(out, &ring->buffer[i], span * sizeof(void*));
+    memcpy(out + span, ring->buffer, (n - span) * sizeof(void*));
+
+    RING_STORE_RELEASE(&ring->head, head + n);
+    return n;
+}
+
+/**
+ * Sets the out parameter to the element at the front of the ring without
+ * removing it. Must only be called by the consumer.
+ *
+ * @param[in] ring the ring whose front element is being returned
+ * @param[out] out pointer to where the element is stored
+ *
+ * @return NUT_OK if the element was returned, or NUT_ERR_OUT_OF_RANGE if the
+ * ring is empty.
+ */
+NutState nut_spscring_peek(SpscRing *ring, void **out)
+{
+    size_t head = RING_LOAD_RELAXED(&ring->head);
+
+    if (head == ring->tail_cache) {
+        ring->tail_cache = RING_LOAD_ACQUIRE(&ring->tail);
+
+        if (head == ring->tail_cache)
+            return NUT_ERR_OUT_OF_RANGE;
+    }
+    *out = ring->buffer[head & ring->mask];
+    return NUT_OK;
+}
+
+/**
+ * Returns the number of elements in the ring. While the other side is
+ * active the result is only a snapshot that may already be out of date.
+ *
+ * @param[in] ring the ring whose size is being returned
+ *
+ * @return the number of elements in the ring.
+ */
+size_t nut_spscring_size(SpscRing *ring)
+{
+    size_t head = RING_LOAD_ACQUIRE(&ring->head);
+    size_t tail = RING_LOAD_ACQUIRE(&ring->tail);
+
+    /* The ring may have been drained and refilled between the two loads */
+    return tail - head > ring->capacity ? ring->capacity : tail - head;
+}
+
+/**
+ * Returns the number of elements the ring can hold.
+ *
+ * @param[in] ring the ring whose capacity is being returned
+ *
+ * @return the capacity of the ring.
+ */
+size_t nut_spscring_capacity(SpscRing *ring)
+{
+    return ring->capacity;
+}
+
+/**
+ * Rounds n up to the nearest power of two.
+ */
+static size_t upper_pow_two(size_t n)
+{
+    size_t p = 1;
+
+    while (p < n)
+        p <<= 1;
+
+    return p;
+}
@@ -18,6 +18,7 @@
  * along with Collections-C.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "nutmem.h"
 #include "nutarray.h"
 #include "nutstack.h"
 
@@ -25,11 +26,16 @@
 struct nut_stack_s {
     Array *v;
 
+    /* Set if the stack lives in caller memory given to nut_stack_new_static() */
+    bool   fixed;
+
     void *(*mem_alloc)  (size_t size);
     void *(*mem_calloc) (size_t blocks, size_t size);
     void  (*mem_free)   (void *block);
 };
 
+_Static_assert(sizeof(Stack) <= sizeof(((StackStatic*) 0)->reserved), "StackStatic is too small");
+
 
 /**
  * Initializes the fields of the StackConf struct to default values.
@@ -95,6 +101,37 @@ NutState nut_stack_new_conf(StackConf const * const conf, Stack **out)
     return NUT_OK;
 }
 
+/**
+ * Creates a new empty Stack in caller supplied memory and returns a status
+ * code. Nothing is allocated, and the Stack never grows: pushing onto a
+ * full Stack returns NUT_ERR_MAX_CAPACITY. The memory must outlive the
+ * Stack, and nut_stack_destroy() only detaches the Stack from it.
+ *
+ * @param[in] buffer the buffer of capacity pointers that holds the elements
+ * @param[in] capacity the number of elements the buffer can hold
+ * @param[in] storage the memory in which the Stack structure is placed
+ * @param[out] out pointer to where the newly created Stack is to be stored
+ *
+ * @return NUT_OK if the creation was successful, or NUT_ERR_INVALID_CAPACITY
+ * if the capacity is 0 or too large.
+ */
+NutState nut_stack_new_static(void **buffer, size_t capacity, StackStatic *storage, Stack **out)
+{
+    Stack   *stack  = (Stack*) storage->reserved;
+    NutState status = nut_array_new_static(buffer, capacity, &storage->array, &stack->v);
+
+    if (status != NUT_OK)
+        return status;
+
+    stack->fixed      = true;
+    stack->mem_alloc  = &nut_mem_malloc;
+    stack->mem_calloc = &nut_mem_calloc;
+    stack->mem_free   = &nut_mem_free;
+
+    *out = stack;
+    return NUT_OK;
+}
+
 /**
  * Destroys the specified stack structure, while leaving the data it holds
  * intact.
@@ -104,7 +141,9 @@ NutState nut_stack_new_conf(StackConf const * const conf, Stack **out)
 void nut_stack_destroy(Stack *stack)
 {
     nut_array_destroy(stack->v);
-    stack->mem_free(stack);
+
+    if (!stack->fixed)
+        stack->mem_free(stack);
 }
 
 /**
@@ -118,7 +157,9 @@ void nut_stack_destroy(Stack *stack)
 void nut_stack_destroy_cb(Stack *stack, void (*cb) (void*))
 {
     nut_array_destroy_cb(stack->v, cb);
-    free(stack);
+
+    if (!stack->fixed)
+        stack->mem_free(stack);
 }
 
 /**
@@ -127,8 +168,9 @@ void nut_stack_destroy_cb(Stack *stack, void (*cb) (void*))
  * @param[in] stack the stack on which the element is being pushed onto
  * @param[in] element the element being pushed onto the stack
  *
- * @return NUT_OK if the element was successfully pushed, or CC_ERR_ALLOC
- * if the memory allocation for the new element failed.
+ * @return NUT_OK if the element was successfully pushed, CC_ERR_ALLOC if the
+ * memory allocation for the new element failed, or NUT_ERR_MAX_CAPACITY if
+ * the stack is full and cannot grow.
  */
 NutState nut_stack_push(Stack *stack, void *element)
 {
@@ -5,11 +5,24 @@ struct nut_treeset_s {
     TreeTable *t;
     int       *dummy;
 
+    int   (*cmp)        (const void *e1, const void *e2);
     void *(*mem_alloc)  (size_t size);
     void *(*mem_calloc) (size_t blocks, size_t size);
     void  (*mem_free)   (void *block);
 };
 
+/* Walks a set in ascending order during a merge of two sets */
+typedef struct merge_cursor_s {
+    TreeSetIter iter;
+    void       *element;
+    bool        valid;
+} MergeCursor;
+
+static void     cursor_init   (MergeCursor *c, TreeSet *set);
+static void     cursor_next   (MergeCursor *c);
+static NutState treeset_like  (TreeSet *set, TreeSet **out);
+static NutState treeset_build (TreeSet *set, TreeTableEntry *merged, size_t n, TreeSet **out);
+
 /**
  * Initializes the fields of the TreeSetConf struct to default values.
  *
@@ -66,6 +79,7 @@ NutState nut_treeset_new_conf(TreeSetConf const * const conf, TreeSet **tset)
     }
     set->t          = table;
     set->dummy      = (int*) 1;
+    set->cmp        = conf->cmp;
     set->mem_alloc  = conf->mem_alloc;
     set->mem_calloc = conf->mem_calloc;
     set->mem_free   = conf->mem_free;
@@ -283,3 +297,331 @@ NutState nut_treeset_iter_remove(TreeSetIter *iter, void **out)
 {
     return nut_treetable_iter_remove(&(iter->i), out);
 }
+
+/**
+ * Adds all elements of the other set to the set. Both sets are walked in
+ * order side by side, so only the missing elements are inserted.
+ *
+ * @note Both sets must order their elements the same way.
+ *
+ * @param[in] set the set to which the elements are being added
+ * @param[in] other the set whose elements are being added
+ *
+ * @return NUT_OK if the operation was successful, or NUT_ERR_MALLOC if the
+ * memory allocation for a new element failed.
+ */
+NutState nut_treeset_union_mut(TreeSet *set, TreeSet *other)
+{
+    MergeCursor a;
+    MergeCursor b;
+
+    cursor_init(&a, set);
+    cursor_init(&b, other);
+
+    while (b.valid) {
+        int c = a.valid ? set->cmp(b.element, a.element) : -1;
+
+        if (c < 0) {
+            /* Inserted before the current element of a, so the walk over a
+             * is not affected */
+            NutState stat = nut_treeset_add(set, b.element);
+
+            if (stat != NUT_OK)
+                return stat;
+
+            cursor_next(&b);
+        } else if (c == 0) {
+            cursor_next(&a);
+            cursor_next(&b);
+        } else {
+            cursor_next(&a);
+        }
+    }
+    return NUT_OK;
+}
+
+/**
+ * Creates a new set that holds the elements of both sets. The new set is
+ * created with the configuration of set1, and an element that is part of
+ * both sets is taken from set1.
+ * The sets are merged in order and the new tree is built from the result in
+ * linear time.
+ *
+ * @note Both sets must order their elements the same way.
+ *
+ * @param[in] set1 the first set
+ * @param[in] set2 the second set
+ * @param[out] out pointer to where the new set is stored
+ *
+ * @return NUT_OK if the operation was successful, or NUT_ERR_MALLOC if the
+ * memory allocation failed.
+ */
+NutState nut_treeset_union(TreeSet *set1, TreeSet *set2, TreeSet **out)
+{
+    MergeCursor     a;
+    MergeCursor     b;
+    size_t          n      = 0;
+    TreeTableEntry *merged = set1->mem_alloc((nut_treeset_size(set1) + nut_treeset_size(set2) + 1)
+                                             * sizeof(TreeTableEntry));
+    if (!merged)
+        return NUT_ERR_MALLOC;
+
+    cursor_init(&a, set1);
+    cursor_init(&b, set2);
+
+    while (a.valid || b.valid) {
+        int c = !a.valid ? 1 : !b.valid ? -1 : set1->cmp(a.element, b.element);
+
+        if (c <= 0) {
+            merged[n++].key = a.element;
+            if (c == 0)
+                cursor_next(&b);
+            cursor_next(&a);
+        } else {
+            merged[n++].key = b.element;
+            cursor_next(&b);
+        }
+    }
+    return treeset_build(set1, merged, n, out);
+}
+
+/**
+ * Creates a new set that holds the elements that are part of both sets. The
+ * new set is created with the configuration of set1 and holds the elements
+ * of set1.
+ * The sets are merged in order and the new tree is built from the result in
+ * linear time.
+ *
+ * @note Both sets must order their elements the same way.
+ *
+ * @param[in] set1 the first set
+ * @param[in] set2 the second set
+ * @param[out] out pointer to where the new set is stored
+ *
+ * @return NUT_OK if the operation was successful, or NUT_ERR_MALLOC if the
+ * memory allocation failed.
+ */
+NutState nut_treeset_intersection(TreeSet *set1, TreeSet *set2, TreeSet **out)
+{
+    MergeCursor     a;
+    MergeCursor     b;
+    size_t          n      = 0;
+    size_t          max    = nut_treeset_size(set1) < nut_treeset_size(set2) ?
+                             nut_treeset_size(set1) : nut_treeset_size(set2);
+    TreeTableEntry *merged = set1->mem_alloc((max + 1) * sizeof(TreeTableEntry));
+
+    if (!merged)
+        return NUT_ERR_MALLOC;
+
+    cursor_init(&a, set1);
+    cursor_init(&b, set2);
+
+    while (a.valid && b.valid) {
+        int c = set1->cmp(a.element, b.element);
+
+        if (c == 0) {
+            merged[n++].key = a.element;
+            cursor_next(&a);
+            cursor_next(&b);
+        } else if (c < 0) {
+            cursor_next(&a);
+        } else {
+            cursor_next(&b);
+        }
+    }
+    return treeset_build(set1, merged, n, out);
+}
+
+/**
+ * Removes all elements from the set that are not part of the other set.
+ *
+ * @note Both sets must order their elements the same way.
+ *
+ * @param[in] set the set from which the elements are being removed
+ * @param[in] other the set that is being intersected with
+ */
+void nut_treeset_intersection_mut(TreeSet *set, TreeSet *other)
+{
+    MergeCursor a;
+    MergeCursor b;
+
+    cursor_init(&a, set);
+    cursor_init(&b, other);
+
+    while (a.valid) {
+        int c = b.valid ? set->cmp(a.element, b.element) : -1;
+
+        if (c < 0) {
+            nut_treeset_iter_remove(&a.iter, NULL);
+            cursor_next(&a);
+        } else if (c == 0) {
+            cursor_next(&a);
+            cursor_next(&b);
+        } else {
+            cursor_next(&b);
+        }
+    }
+}
+
+/**
+ * Creates a new set that holds the elements of set1 that are not part of
+ * set2. The new set is created with the configuration of set1.
+ * The sets are merged in order and the new tree is built from the result in
+ * linear time.
+ *
+ * @note Both sets must order their elements the same way.
+ *
+ * @param[in] set1 the set whose elements are being kept
+ * @param[in] set2 the set whose elements are being left out
+ * @param[out] out pointer to where the new set is stored
+ *
+ * @return NUT_OK if the operation was successful, or NUT_ERR_MALLOC if the
+ * memory allocation failed.
+ */
+NutState nut_treeset_difference(TreeSet *set1, TreeSet *set2, TreeSet **out)
+{
+    MergeCursor     a;
+    MergeCursor     b;
+    size_t          n      = 0;
+    TreeTableEntry *merged = set1->mem_alloc((nut_treeset_size(set1) + 1) * sizeof(TreeTableEntry));
+
+    if (!merged)
+        return NUT_ERR_MALLOC;
+
+    cursor_init(&a, set1);
+    cursor_init(&b, set2);
+
+    while (a.valid) {
+        int c = b.valid ? set1->cmp(a.element, b.element) : -1;
+
+        if (c < 0) {
+            merged[n++].key = a.element;
+            cursor_next(&a);
+        } else if (c == 0) {
+            cursor_next(&a);
+            cursor_next(&b);
+        } else {
+            cursor_next(&b);
+        }
+    }
+    return treeset_build(set1, merged, n, out);
+}
+
+/**
+ * Removes all elements from the set that are part of the other set.
+ *
+ * @note Both sets must order their elements the same way.
+ *
+ * @param[in] set the set from which the elements are being removed
+ * @param[in] other the set whose elements are being removed
+ */
+void nut_treeset_difference_mut(TreeSet *set, TreeSet *other)
+{
+    MergeCursor a;
+    MergeCursor b;
+
+    cursor_init(&a, set);
+    cursor_init(&b, other);
+
+    while (a.valid && b.valid) {
+        int c = set->cmp(a.element, b.element);
+
+        if (c == 0) {
+            nut_treeset_iter_remove(&a.iter, NULL);
+            cursor_next(&a);
+            cursor_next(&b);
+        } else if (c < 0) {
+            cursor_next(&a);
+        } else {
+            cursor_next(&b);
+        }
+    }
+}
+
+/**
+ * Checks whether every element of the set is also an element of the other
+ * set.
+ *
+ * @note Both sets must order their elements the same way.
+ *
+ * @param[in] set the set that is being tested
+ * @param[in] other the set that is being tested against
+ *
+ * @return true if the set is a subset of the other set.
+ */
+bool nut_treeset_is_subset(TreeSet *set, TreeSet *other)
+{
+    if (nut_treeset_size(set) > nut_treeset_size(other))
+        return false;
+
+    MergeCursor a;
+    MergeCursor b;
+
+    cursor_init(&a, set);
+    cursor_init(&b, other);
+
+    while (a.valid) {
+        int c = b.valid ? set->cmp(a.element, b.element) : -1;
+
+        if (c < 0)
+            return false;
+
+        if (c == 0)
+            cursor_next(&a);
+
+        cursor_next(&b);
+    }
+    return true;
+}
+
+static void cursor_init(MergeCursor *c, TreeSet *set)
+{
+    nut_treeset_iter_init(&(c->iter), set);
+    cursor_next(c);
+}
+
+static void cursor_next(MergeCursor *c)
+{
+    c->valid = nut_treeset_iter_next(&(c->iter), &(c->element)) == NUT_OK;
+}
+
+/**
+ * Creates an empty set with the same configuration as the specified set.
+ */
+static NutState treeset_like(TreeSet *set, TreeSet **out)
+{
+    TreeSetConf conf;
+
+    conf.cmp        = set->cmp;
+    conf.mem_alloc  = set->mem_alloc;
+    conf.mem_calloc = set->mem_calloc;
+    conf.mem_free   = set->mem_free;
+
+    return nut_treeset_new_conf(&conf, out);
+}
+
+/**
+ * Creates a set with the same configuration as the specified set from the
+ * sorted output of a merge. The tree is built in linear time instead of
+ * inserting the elements one by one. The merge buffer is freed.
+ */
+static NutState treeset_build(TreeSet *set, TreeTableEntry *merged, size_t n, TreeSet **out)
+{
+    TreeSet *r;
+    NutState stat = treeset_like(set, &r);
+
+    if (stat == NUT_OK) {
+        size_t i;
+        for (i = 0; i < n; i++)
+            merged[i].value = r->dummy;
+
+        stat = nut_treetable_add_sorted(r->t, merged, n);
+
+        if (stat != NUT_OK)
+            nut_treeset_destroy(r);
+        else
+            *out = r;
+    }
+    set->mem_free(merged);
+    return stat;
+}
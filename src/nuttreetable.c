@@ -46,6 +46,10 @@ static void rebalance_after_delete (TreeTable *table, RBNode *n);
 static void remove_node            (TreeTable *table, RBNode *z);
 static void tree_destroy           (TreeTable *table, RBNode *s);
 
+static NutState build_sorted       (TreeTable *table, TreeTableEntry const *entries,
+                                    size_t lo, size_t hi, int depth, int red_depth,
+                                    RBNode *parent, RBNode **link);
+
 static INLINE void  transplant     (TreeTable *table, RBNode *u, RBNode *v);
 static INLINE RBNode *tree_min     (TreeTable const * const table, RBNode *n);
 static INLINE RBNode *tree_max     (TreeTable const * const table, RBNode *n);
@@ -113,6 +117,9 @@ NutState nut_treetable_new_conf(TreeTableConf const * const conf, TreeTable **tt
     }
 
     sentinel->color   = RB_BLACK;
+    sentinel->left    = sentinel;
+    sentinel->right   = sentinel;
+    sentinel->parent  = sentinel;
 
     table->size       = 0;
     table->cmp        = conf->cmp;
@@ -416,6 +423,81 @@ NutState nut_treetable_add(TreeTable *table, void *key, void *val)
     return NUT_OK;
 }
 
+/**
+ * Fills an empty table with n entries whose keys are in a strictly ascending
+ * order. The tree is built balanced straight from the entries in linear time,
+ * without comparing any keys or rebalancing.
+ *
+ * @note The keys must be sorted with the comparator of the table and must
+ * not repeat.
+ *
+ * @param[in] table the empty table that is being filled
+ * @param[in] entries the entries in an ascending key order
+ * @param[in] n the number of entries
+ *
+ * @return NUT_OK if the operation was successful, NUT_ERR if the table is not
+ * empty, or NUT_ERR_MALLOC if the memory allocation for a node failed, in
+ * which case the table is left empty.
+ */
+NutState nut_treetable_add_sorted(TreeTable *table, TreeTableEntry const *entries, size_t n)
+{
+    if (table->size != 0)
+        return NUT_ERR;
+
+    /* Every level above red_depth is complete. The nodes of the last,
+     * incomplete level are red, so all paths have the same black height. */
+    int    red_depth = 0;
+    size_t m;
+    for (m = n; m > 0; m = (m - 1) / 2)
+        red_depth++;
+
+    NutState stat = build_sorted(table, entries, 0, n, 0, red_depth,
+                                 table->sentinel, &(table->root));
+
+    if (stat != NUT_OK) {
+        tree_destroy(table, table->root);
+        table->root = table->sentinel;
+        return stat;
+    }
+    table->size = n;
+    return NUT_OK;
+}
+
+/**
+ * Builds the subtree of the entries in the range [lo, hi) around the middle
+ * entry and links it into the parent. The link is made before the children
+ * are built, so the partial tree can be destroyed if an allocation fails.
+ */
+static NutState build_sorted(TreeTable *table, TreeTableEntry const *entries,
+                             size_t lo, size_t hi, int depth, int red_depth,
+                             RBNode *parent, RBNode **link)
+{
+    if (lo >= hi)
+        return NUT_OK;
+
+    RBNode *n = table->mem_alloc(sizeof(RBNode));
+
+    if (!n)
+        return NUT_ERR_MALLOC;
+
+    size_t mid = lo + (hi - lo - 1) / 2;
+
+    n->key    = entries[mid].key;
+    n->value  = entries[mid].value;
+    n->color  = depth == red_depth ? RB_RED : RB_BLACK;
+    n->parent = parent;
+    n->left   = table->sentinel;
+    n->right  = table->sentinel;
+    *link     = n;
+
+    NutState stat = build_sorted(table, entries, lo, mid, depth + 1, red_depth, n, &(n->left));
+
+    if (stat != NUT_OK)
+        return stat;
+
+    return build_sorted(table, entries, mid + 1, hi, depth + 1, red_depth, n, &(n->right));
+}
+
 /**
  * Rebalances the tale after an insert.
  *
@@ -0,0 +1,501 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "nutarray.h"
+#include "nutexecutor.h"
+#include "nuttest.h"
+
+
+typedef struct {
+    int    a;
+    double b;
+    char   c[5];
+} Rec;
+
+typedef struct {
+    uint64_t k;
+    int      id;
+} KeyRec;
+
+
+static int cmp_rec(const void *x, const void *y)
+{
+    return ((const Rec*) x)->a - ((const Rec*) y)->a;
+}
+
+static void inc_rec(void *e)
+{
+    ((Rec*) e)->b += 1;
+}
+
+static bool even_rec(const void *e)
+{
+    return ((const Rec*) e)->a % 2 == 0;
+}
+
+static int cmp_int_ptr(const void *x, const void *y)
+{
+    return **(int* const*) x - **(int* const*) y;
+}
+
+static int cmp_long_ptr(const void *a, const void *b)
+{
+    long x = **(long* const*) a;
+    long y = **(long* const*) b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_intptr(const void *a, const void *b)
+{
+    intptr_t x = *(const intptr_t*) a;
+    intptr_t y = *(const intptr_t*) b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_keyrec_ptr(const void *a, const void *b)
+{
+    const KeyRec *x = *(KeyRec* const*) a;
+    const KeyRec *y = *(KeyRec* const*) b;
+    return (x->k > y->k) - (x->k < y->k);
+}
+
+static uint32_t key32_ptr(const void *e)
+{
+    return (uint32_t) (*(KeyRec* const*) e)->k;
+}
+
+static uint64_t key64_ptr(const void *e)
+{
+    return (*(KeyRec* const*) e)->k;
+}
+
+static uint64_t key64_value(const void *e)
+{
+    return ((const KeyRec*) e)->k;
+}
+
+static uint32_t key32_intptr(const void *e)
+{
+    return (uint32_t) *(const intptr_t*) e;
+}
+
+static void inc_long(void *e)
+{
+    (*(long*) e)++;
+}
+
+static void sum_long(void *a, void *b, void *r)
+{
+    *(long*) r = *(long*) a + (b ? *(long*) b : 0);
+}
+
+static bool even_long(const void *e)
+{
+    return (*(const long*) e & 1) == 0;
+}
+
+
+static void test_values(void)
+{
+    ArrayConf c;
+    Array    *ar;
+    Array    *f;
+    Array    *sub;
+    Rec       o;
+    Rec       r0 = { -1, 0, "x" };
+
+    nut_array_conf_init(&c);
+    c.element_size = sizeof(Rec);
+    NUT_CHECK(nut_array_new_conf(&c, &ar) == NUT_OK);
+
+    for (int i = 0; i < 100000; i++) {
+        Rec r = { (i * 7919) % 100000, i, "abc" };
+        NUT_CHECK(nut_array_add_value(ar, &r) == NUT_OK);
+    }
+    NUT_CHECK(nut_array_add_value_at(ar, &r0, 0) == NUT_OK);
+    NUT_CHECK(nut_array_add_value_at(ar, &r0, nut_array_size(ar)) == NUT_OK);
+    NUT_CHECK(nut_array_remove_value_at(ar, 0, NULL) == NUT_OK);
+    NUT_CHECK(nut_array_remove_value_at(ar, nut_array_size(ar) - 1, &o) == NUT_OK);
+    NUT_CHECK(o.a == -1);
+
+    nut_array_sort_values(ar, cmp_rec);
+    for (size_t i = 0; i < nut_array_size(ar); i++) {
+        nut_array_get_value_at(ar, i, &o);
+        NUT_CHECK(o.a == (int) i);
+    }
+
+    nut_array_map_values(ar, inc_rec);
+    NUT_CHECK(nut_array_filter_values(ar, even_rec, &f) == NUT_OK);
+    nut_array_filter_values_mut(ar, even_rec);
+    NUT_CHECK(nut_array_size(f) == 50000 && nut_array_size(ar) == 50000);
+
+    nut_array_reverse(ar);
+    nut_array_get_value_at(ar, 0, &o);
+    NUT_CHECK(o.a == 99998);
+    nut_array_swap_at(ar, 0, 1);
+    nut_array_get_value_at(ar, 0, &o);
+    NUT_CHECK(o.a == 99996);
+
+    NUT_CHECK(nut_array_subarray(ar, 10, 19, &sub) == NUT_OK);
+    nut_array_get_value_at(sub, 0, &o);
+    NUT_CHECK(nut_array_size(sub) == 10 && o.a == 99998 - 20);
+    NUT_CHECK(nut_array_trim_capacity(sub) == NUT_OK && nut_array_capacity(sub) == 10);
+
+    nut_array_destroy(sub);
+    nut_array_destroy(f);
+    nut_array_destroy(ar);
+}
+
+static void test_pointers(void)
+{
+    Array *p;
+    Array *cp;
+    void  *e;
+    int    v[1000];
+
+    NUT_CHECK(nut_array_new(&p) == NUT_OK);
+    for (int i = 0; i < 1000; i++) {
+        v[i] = 999 - i;
+        nut_array_add(p, &v[i]);
+    }
+    nut_array_sort(p, cmp_int_ptr);
+    nut_array_get_at(p, 0, &e);
+    NUT_CHECK(*(int*) e == 0);
+
+    NUT_CHECK(nut_array_remove(p, &v[5], NULL) == NUT_OK);
+    NUT_CHECK(nut_array_remove_at(p, nut_array_size(p) - 1, NULL) == NUT_OK);
+    NUT_CHECK(nut_array_size(p) == 998);
+    nut_array_reverse(p);
+    nut_array_get_at(p, 0, &e);
+    NUT_CHECK(*(int*) e == 998);
+
+    NUT_CHECK(nut_array_copy_shallow(p, &cp) == NUT_OK);
+    nut_array_destroy(cp);
+    nut_array_destroy(p);
+}
+
+static void test_contains(void)
+{
+    static int objs[16];
+    void      *ref[80];
+
+    srand(9);
+    for (int r = 0; r < 3000; r++) {
+        Array *a;
+        int    n = rand() % 70;
+
+        NUT_CHECK(nut_array_new(&a) == NUT_OK);
+        for (int i = 0; i < n; i++) {
+            ref[i] = &objs[rand() % (1 + r % 16)];
+            nut_array_add(a, ref[i]);
+        }
+        for (int k = 0; k < 16; k++) {
+            size_t c = 0;
+            size_t first = n;
+            size_t ix;
+
+            for (int i = 0; i < n; i++) {
+                if (ref[i] == &objs[k]) {
+                    if (!c++)
+                        first = i;
+                }
+            }
+            NUT_CHECK(nut_array_contains(a, &objs[k]) == c);
+            NutState s = nut_array_index_of(a, &objs[k], &ix);
+            NUT_CHECK((s == NUT_OK) == (c > 0));
+            if (c)
+                NUT_CHECK(ix == first);
+        }
+        nut_array_destroy(a);
+    }
+}
+
+static void test_bulk(void)
+{
+    static long ref[4000];
+    void       *els[64];
+    long        vals[64];
+
+    srand(11);
+    for (int r = 0; r < 1000; r++) {
+        Array    *a;
+        Array    *va;
+        ArrayConf vc;
+        size_t    n = 0;
+        long      next = 1;
+
+        nut_array_conf_init(&vc);
+        vc.element_size = sizeof(long);
+        NUT_CHECK(nut_array_new(&a) == NUT_OK);
+        NUT_CHECK(nut_array_new_conf(&vc, &va) == NUT_OK);
+
+        for (int it = 0; it < 30; it++) {
+            int op = rand() % 4;
+            if (op < 2 && n < 3000) {
+                size_t k = rand() % 60;
+                size_t idx = rand() % (n + 1);
+                for (size_t q = 0; q < k; q++) {
+                    els[q] = (void*) next;
+                    vals[q] = next++;
+                }
+                NUT_CHECK(nut_array_add_all_at(a, els, k, idx) == NUT_OK);
+                NUT_CHECK(nut_array_add_all_at(va, vals, k, idx) == NUT_OK);
+                memmove(ref + idx + k, ref + idx, (n - idx) * sizeof(long));
+                memcpy(ref + idx, vals, k * sizeof(long));
+                n += k;
+            } else if (op == 2 && n) {
+                size_t b = rand() % n;
+                size_t e = b + rand() % (n - b);
+                NUT_CHECK(nut_array_remove_range(a, b, e) == NUT_OK);
+                NUT_CHECK(nut_array_remove_range(va, b, e) == NUT_OK);
+                memmove(ref + b, ref + e + 1, (n - e - 1) * sizeof(long));
+                n -= e - b + 1;
+            } else {
+                NUT_CHECK(nut_array_add_at(a, (void*) next, 0) == NUT_OK);
+                NUT_CHECK(nut_array_add_value_at(va, &next, 0) == NUT_OK);
+                memmove(ref + 1, ref, n * sizeof(long));
+                ref[0] = next++;
+                n++;
+            }
+            NUT_CHECK(nut_array_size(a) == n && nut_array_size(va) == n);
+            for (size_t i = 0; i < n; i++) {
+                void *x;
+                long  y;
+                nut_array_get_at(a, i, &x);
+                nut_array_get_value_at(va, i, &y);
+                NUT_CHECK((long) x == ref[i] && y == ref[i]);
+            }
+        }
+        NUT_CHECK(nut_array_add_all_at(a, NULL, 0, n + 1) == NUT_ERR_OUT_RANGE);
+        NUT_CHECK(nut_array_reserve(a, 5000) == NUT_OK && nut_array_capacity(a) == 5000);
+        nut_array_destroy(a);
+        nut_array_destroy(va);
+    }
+}
+
+static void test_radix(void)
+{
+    srand(3);
+    for (int r = 0; r < 300; r++) {
+        int       n   = r < 100 ? rand() % 200 : rand() % 20000;
+        int       pat = r % 6;
+        bool      w32 = r % 7 == 0;
+        Array    *a, *b, *c;
+        ArrayConf cf;
+        KeyRec   *recs = malloc(sizeof(KeyRec) * (n + 1));
+
+        nut_array_new(&a);
+        nut_array_new(&b);
+        nut_array_conf_init(&cf);
+        cf.element_size = sizeof(KeyRec);
+        nut_array_new_conf(&cf, &c);
+
+        for (int i = 0; i < n; i++) {
+            uint64_t k = pat == 0 ? (uint64_t) (rand() % 10)
+                       : pat == 1 ? (uint64_t) i
+                       : pat == 2 ? (uint64_t) (n - i)
+                       : pat == 3 ? (uint64_t) (i % 50 == 0 ? rand() : i)
+                       : ((uint64_t) rand() << 20) ^ rand();
+            if (w32)
+                k &= 0xffffffff;
+            recs[i].k  = k;
+            recs[i].id = i;
+            nut_array_add(a, &recs[i]);
+            nut_array_add(b, &recs[i]);
+            nut_array_add_value(c, &recs[i]);
+        }
+
+        nut_array_sort(a, cmp_keyrec_ptr);
+        NUT_CHECK((w32 ? nut_array_sort_radix32(b, key32_ptr)
+                       : nut_array_sort_radix64(b, key64_ptr)) == NUT_OK);
+        NUT_CHECK(nut_array_sort_radix64(c, key64_value) == NUT_OK);
+
+        for (int i = 0; i < n; i++) {
+            KeyRec *x, *y, *p;
+            KeyRec  z;
+            nut_array_get_at(a, i, (void**) &x);
+            nut_array_get_at(b, i, (void**) &y);
+            nut_array_get_value_at(c, i, &z);
+            NUT_CHECK(x->k == y->k && z.k == y->k);
+            if (i) {
+                /* Radix sort is stable */
+                nut_array_get_at(b, i - 1, (void**) &p);
+                NUT_CHECK(p->k < y->k || p->id < y->id);
+            }
+        }
+        nut_array_destroy(a);
+        nut_array_destroy(b);
+        nut_array_destroy(c);
+        free(recs);
+    }
+}
+
+static void test_parallel(void)
+{
+    Executor *exs[3];
+
+    NUT_CHECK(nut_executor_pool_new(0, &exs[0]) == NUT_OK);
+    exs[1] = nut_executor_serial();
+    NUT_CHECK(nut_executor_pool_new(3, &exs[2]) == NUT_OK);
+
+    srand(5);
+    for (int r = 0; r < 30; r++) {
+        Executor *ex = exs[r % 3];
+        size_t    n  = r < 10 ? rand() % 5000 : rand() % 200000;
+        long     *v  = malloc(sizeof(long) * (n + 1));
+        Array    *a, *b;
+        long      before = 0;
+        long      after  = 0;
+
+        nut_array_new(&a);
+        nut_array_new(&b);
+        for (size_t i = 0; i < n; i++) {
+            v[i] = r % 4 == 0 ? rand() % 7 : r % 4 == 1 ? (long) i : rand();
+            before += v[i];
+            nut_array_add(a, &v[i]);
+            nut_array_add(b, &v[i]);
+        }
+
+        NUT_CHECK(nut_array_sort_par(a, cmp_long_ptr, ex) == NUT_OK);
+        nut_array_sort(b, cmp_long_ptr);
+        for (size_t i = 0; i < n; i++) {
+            void *x, *y;
+            nut_array_get_at(a, i, &x);
+            nut_array_get_at(b, i, &y);
+            NUT_CHECK(*(long*) x == *(long*) y);
+        }
+
+        if (n) {
+            long   s1 = 0, s2 = 0;
+            Array *f1, *f2;
+
+            nut_array_reduce(b, sum_long, &s1);
+            NUT_CHECK(nut_array_reduce_par(b, sum_long, &s2, sizeof(long), ex) == NUT_OK);
+            NUT_CHECK(s1 == s2);
+
+            NUT_CHECK(nut_array_filter(a, even_long, &f1) == NUT_OK);
+            NUT_CHECK(nut_array_filter_par(a, even_long, &f2, ex) == NUT_OK);
+            NUT_CHECK(nut_array_size(f1) == nut_array_size(f2));
+            for (size_t i = 0; i < nut_array_size(f1); i++) {
+                void *x, *y;
+                nut_array_get_at(f1, i, &x);
+                nut_array_get_at(f2, i, &y);
+                NUT_CHECK(x == y);
+            }
+            nut_array_destroy(f1);
+            nut_array_destroy(f2);
+        }
+
+        nut_array_map_par(a, inc_long, ex);
+        for (size_t i = 0; i < n; i++)
+            after += v[i];
+        NUT_CHECK(after == before + (long) n);
+
+        nut_array_destroy(a);
+        nut_array_destroy(b);
+        free(v);
+    }
+    nut_executor_pool_destroy(exs[0]);
+    nut_executor_pool_destroy(exs[2]);
+}
+
+static void test_copy_on_write(void)
+{
+    Array *a, *s1, *s2, *s3;
+    void  *v;
+
+    nut_array_new(&a);
+    for (intptr_t i = 0; i < 100; i++)
+        nut_array_add(a, (void*) (100 - i));
+
+    NUT_CHECK(nut_array_copy_shallow(a, &s1) == NUT_OK);
+    NUT_CHECK(nut_array_copy_shallow(a, &s2) == NUT_OK);
+    NUT_CHECK(nut_array_get_buffer(a) == nut_array_get_buffer(s1));
+
+    /* Writing to one copy leaves the others alone */
+    nut_array_sort(a, cmp_intptr);
+    nut_array_get_at(a, 0, &v);
+    NUT_CHECK((intptr_t) v == 1);
+    nut_array_get_at(s1, 0, &v);
+    NUT_CHECK((intptr_t) v == 100);
+    NUT_CHECK(nut_array_get_buffer(s1) == nut_array_get_buffer(s2));
+
+    nut_array_destroy(s2);
+    nut_array_add(s1, (void*) 7);
+    nut_array_get_at(s1, 100, &v);
+    NUT_CHECK((intptr_t) v == 7);
+
+    nut_array_copy_shallow(s1, &s3);
+    for (int i = 0; i < 1000; i++)
+        nut_array_add(s3, (void*) 1);
+    NUT_CHECK(nut_array_size(s1) == 101);
+    nut_array_destroy(s1);
+    nut_array_remove_at(s3, 0, NULL);
+    nut_array_destroy(s3);
+    nut_array_destroy(a);
+}
+
+static void test_static(void)
+{
+    static void       *buf[3];
+    static ArrayStatic storage;
+    Array             *a;
+    Array             *c;
+
+    NUT_CHECK(nut_array_new_static(buf, 3, &storage, &a) == NUT_OK);
+    for (uintptr_t i = 1; i <= 3; i++)
+        NUT_CHECK(nut_array_add(a, (void*) i) == NUT_OK);
+    NUT_CHECK(nut_array_add(a, (void*) 4) == NUT_ERR_MAX_CAPACITY);
+    NUT_CHECK(nut_array_reserve(a, 8) == NUT_ERR_MAX_CAPACITY);
+    NUT_CHECK(buf[2] == (void*) 3);
+
+    /* A copy is an ordinary heap array */
+    NUT_CHECK(nut_array_copy_shallow(a, &c) == NUT_OK);
+    NUT_CHECK(nut_array_add(c, (void*) 4) == NUT_OK);
+    NUT_CHECK(nut_array_size(a) == 3 && nut_array_size(c) == 4);
+
+    nut_array_destroy(c);
+    nut_array_destroy(a);
+
+    /* The sorts that work in a second buffer must leave the result in the
+     * caller's buffer */
+    enum { S = 10000 };
+    static void       *big[S];
+    static ArrayStatic big_storage;
+    Executor          *ex;
+
+    NUT_CHECK(nut_executor_pool_new(2, &ex) == NUT_OK);
+    NUT_CHECK(nut_array_new_static(big, S, &big_storage, &a) == NUT_OK);
+
+    srand(9);
+    for (int r = 0; r < 2; r++) {
+        nut_array_remove_all(a);
+        for (int i = 0; i < S; i++)
+            NUT_CHECK(nut_array_add(a, (void*) (intptr_t) (rand() % 100000)) == NUT_OK);
+
+        if (r == 0)
+            NUT_CHECK(nut_array_sort_par(a, cmp_intptr, ex) == NUT_OK);
+        else
+            NUT_CHECK(nut_array_sort_radix32(a, key32_intptr) == NUT_OK);
+
+        NUT_CHECK(nut_array_get_buffer(a) == (const void* const*) big);
+        NUT_CHECK(nut_array_size(a) == S);
+        for (int i = 1; i < S; i++)
+            NUT_CHECK((intptr_t) big[i - 1] <= (intptr_t) big[i]);
+    }
+    nut_array_destroy(a);
+    nut_executor_pool_destroy(ex);
+}
+
+int main(void)
+{
+    test_values();
+    test_pointers();
+    test_contains();
+    test_bulk();
+    test_radix();
+    test_parallel();
+    test_copy_on_write();
+    test_static();
+    return 0;
+}
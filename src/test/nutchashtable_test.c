@@ -0,0 +1,77 @@
+#include <pthread.h>
+#include <stdint.h>
+
+#include "nutchashtable.h"
+#include "nuttest.h"
+
+#define N       20000
+#define THREADS 8
+
+static CHashTable *table;
+static int         keys[THREADS][N];
+static size_t      visited;
+
+
+static size_t hash_int(const void *key, int l, uint32_t seed)
+{
+    (void) l;
+    return nut_hashtable_hash_wy(key, sizeof(int), seed);
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+    int x = *(const int*) a;
+    int y = *(const int*) b;
+    return (x > y) - (x < y);
+}
+
+static void *worker(void *arg)
+{
+    intptr_t id = (intptr_t) arg;
+    void    *o;
+
+    for (int i = 0; i < N; i++) {
+        keys[id][i] = id * N + i;
+        NUT_CHECK(nut_chashtable_add(table, &keys[id][i], &keys[id][i]) == NUT_OK);
+    }
+    for (int i = 0; i < N; i++) {
+        NUT_CHECK(nut_chashtable_get(table, &keys[id][i], &o) == NUT_OK);
+        NUT_CHECK(o == &keys[id][i]);
+    }
+    for (int i = 0; i < N; i += 2)
+        NUT_CHECK(nut_chashtable_remove(table, &keys[id][i], &o) == NUT_OK);
+    for (int i = 0; i < N; i++)
+        NUT_CHECK(nut_chashtable_contains_key(table, &keys[id][i]) == (i & 1));
+    return NULL;
+}
+
+static void visit(const void *k, void *v)
+{
+    NUT_CHECK(k == v && (*(const int*) k & 1));
+    visited++;
+}
+
+int main(void)
+{
+    CHashTableConf conf;
+    pthread_t      th[THREADS];
+
+    nut_chashtable_conf_init(&conf);
+    conf.hash             = hash_int;
+    conf.key_compare      = cmp_int;
+    conf.initial_capacity = 4;
+    conf.stripes          = 8;
+    NUT_CHECK(nut_chashtable_new_conf(&conf, &table) == NUT_OK);
+
+    for (intptr_t i = 0; i < THREADS; i++)
+        pthread_create(&th[i], NULL, worker, (void*) i);
+    for (int i = 0; i < THREADS; i++)
+        pthread_join(th[i], NULL);
+
+    NUT_CHECK(nut_chashtable_size(table) == THREADS * N / 2);
+    nut_chashtable_foreach(table, visit);
+    NUT_CHECK(visited == THREADS * N / 2);
+
+    nut_chashtable_destroy(table);
+    return 0;
+}
@@ -0,0 +1,379 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "nutdeque.h"
+#include "nuttest.h"
+
+static uintptr_t model[100000];
+
+
+static void check(Deque *d, const uintptr_t *m, size_t n)
+{
+    void *v;
+
+    NUT_CHECK(nut_deque_size(d) == n);
+    NUT_CHECK(nut_deque_capacity(d) >= n);
+    for (size_t i = 0; i < n; i++) {
+        NUT_CHECK(nut_deque_get_at(d, i, &v) == NUT_OK);
+        NUT_CHECK((uintptr_t) v == m[i]);
+    }
+    if (n) {
+        nut_deque_get_first(d, &v);
+        NUT_CHECK((uintptr_t) v == m[0]);
+        nut_deque_get_last(d, &v);
+        NUT_CHECK((uintptr_t) v == m[n - 1]);
+    }
+}
+
+/* Randomized check against a flat array, with and without in place growth */
+static void test_model(bool use_realloc, unsigned seed)
+{
+    DequeConf c;
+    Deque    *d;
+    size_t    n = 0;
+    uintptr_t next = 1;
+    void     *v;
+
+    srand(seed);
+    nut_deque_conf_init(&c);
+    c.capacity = 5;
+    if (use_realloc)
+        c.mem_realloc = realloc;
+    NUT_CHECK(nut_deque_new_conf(&c, &d) == NUT_OK);
+
+    for (int it = 0; it < 200000; it++) {
+        int op = rand() % 12;
+
+        if (op < 3) {
+            NUT_CHECK(nut_deque_add_last(d, (void*) next) == NUT_OK);
+            model[n++] = next++;
+        } else if (op < 5) {
+            NUT_CHECK(nut_deque_add_first(d, (void*) next) == NUT_OK);
+            memmove(model + 1, model, n * sizeof(*model));
+            model[0] = next++;
+            n++;
+        } else if (op < 7 && n) {
+            NUT_CHECK(nut_deque_remove_first(d, &v) == NUT_OK && (uintptr_t) v == model[0]);
+            memmove(model, model + 1, --n * sizeof(*model));
+        } else if (op < 8 && n) {
+            NUT_CHECK(nut_deque_remove_last(d, &v) == NUT_OK && (uintptr_t) v == model[--n]);
+        } else if (op < 9) {
+            NUT_CHECK(nut_deque_trim_capacity(d) == NUT_OK);
+        } else if (op < 10) {
+            NUT_CHECK(nut_deque_reserve(d, n + rand() % 40) == NUT_OK);
+        } else if (op < 11 && rand() % 50 == 0) {
+            Deque *cp, *sh;
+            NUT_CHECK(nut_deque_copy_deep(d, NULL, &cp) == NUT_OK);
+            check(cp, model, n);
+            nut_deque_add_last(cp, (void*) 1);
+            nut_deque_destroy(cp);
+
+            /* A shallow copy shares the buffer until either side writes */
+            NUT_CHECK(nut_deque_copy_shallow(d, &sh) == NUT_OK);
+            nut_deque_add_last(sh, (void*) 7);
+            nut_deque_trim_capacity(d);
+            nut_deque_destroy(sh);
+        } else if (n > 0 && rand() % 3 == 0) {
+            while (n > (size_t) (rand() % 3)) {
+                nut_deque_remove_first(d, &v);
+                memmove(model, model + 1, --n * sizeof(*model));
+            }
+        }
+        if (it % 97 == 0)
+            check(d, model, n);
+    }
+    check(d, model, n);
+    nut_deque_destroy(d);
+}
+
+static void *realloc_no_shrink(void *block, size_t size)
+{
+    (void) block;
+    (void) size;
+    return NULL;
+}
+
+/* A reallocator that cannot shrink the block leaves a valid, trimmed deque */
+static void test_trim_no_shrink(void)
+{
+    DequeConf c;
+    Deque    *d;
+    size_t    n = 0;
+    void     *v;
+
+    nut_deque_conf_init(&c);
+    c.capacity    = 64;
+    c.mem_realloc = realloc_no_shrink;
+    NUT_CHECK(nut_deque_new_conf(&c, &d) == NUT_OK);
+
+    /* Wrap the elements around the end of the buffer */
+    for (uintptr_t i = 1; i <= 60; i++)
+        nut_deque_add_last(d, (void*) i);
+    for (int i = 0; i < 55; i++)
+        nut_deque_remove_first(d, &v);
+    for (uintptr_t i = 61; i <= 70; i++)
+        nut_deque_add_last(d, (void*) i);
+    for (uintptr_t i = 56; i <= 70; i++)
+        model[n++] = i;
+
+    NUT_CHECK(nut_deque_trim_capacity(d) == NUT_OK);
+    NUT_CHECK(nut_deque_capacity(d) == 16);
+    check(d, model, n);
+    NUT_CHECK(nut_deque_add_first(d, (void*) 1) == NUT_OK);
+    nut_deque_destroy(d);
+}
+
+static void test_bulk(void)
+{
+    void *els[64];
+
+    srand(11);
+    for (int r = 0; r < 1000; r++) {
+        Deque    *d;
+        size_t    n = 0;
+        uintptr_t next = 1;
+        void     *o;
+
+        NUT_CHECK(nut_deque_new(&d) == NUT_OK);
+        /* Start from a wrapped layout */
+        for (int i = rand() % 20; i > 0; i--) {
+            nut_deque_add_last(d, NULL);
+            nut_deque_remove_first(d, &o);
+        }
+        for (int it = 0; it < 30; it++) {
+            int op = rand() % 4;
+            if (op < 2 && n < 3000) {
+                size_t k = rand() % 60;
+                size_t idx = rand() % (n + 1);
+                for (size_t q = 0; q < k; q++)
+                    els[q] = (void*) (next + q);
+                NUT_CHECK(nut_deque_add_all_at(d, els, k, idx) == NUT_OK);
+                memmove(model + idx + k, model + idx, (n - idx) * sizeof(*model));
+                for (size_t q = 0; q < k; q++)
+                    model[idx + q] = next++;
+                n += k;
+            } else if (op == 2 && n) {
+                size_t b = rand() % n;
+                size_t e = b + rand() % (n - b);
+                NUT_CHECK(nut_deque_remove_range(d, b, e) == NUT_OK);
+                memmove(model + b, model + e + 1, (n - e - 1) * sizeof(*model));
+                n -= e - b + 1;
+            } else {
+                NUT_CHECK(nut_deque_add_first(d, (void*) next) == NUT_OK);
+                memmove(model + 1, model, n * sizeof(*model));
+                model[0] = next++;
+                n++;
+            }
+            check(d, model, n);
+        }
+        NUT_CHECK(nut_deque_remove_range(d, 1, 0) == NUT_ERR_INVALID_RANGE);
+        NUT_CHECK(nut_deque_reserve(d, 5000) == NUT_OK && nut_deque_capacity(d) == 8192);
+        check(d, model, n);
+        nut_deque_destroy(d);
+    }
+}
+
+static void test_contains(void)
+{
+    static int objs[16];
+    void      *ref[80];
+
+    srand(9);
+    for (int r = 0; r < 3000; r++) {
+        Deque *d;
+        int    n = rand() % 70;
+        void  *o;
+
+        NUT_CHECK(nut_deque_new(&d) == NUT_OK);
+        for (int i = rand() % 40; i > 0; i--) {
+            nut_deque_add_last(d, &objs[0]);
+            nut_deque_remove_first(d, &o);
+        }
+        for (int i = 0; i < n; i++) {
+            ref[i] = &objs[rand() % (1 + r % 16)];
+            nut_deque_add_last(d, ref[i]);
+        }
+        for (int k = 0; k < 16; k++) {
+            size_t c = 0;
+            size_t first = n;
+            size_t ix;
+
+            for (int i = 0; i < n; i++) {
+                if (ref[i] == &objs[k]) {
+                    if (!c++)
+                        first = i;
+                }
+            }
+            NUT_CHECK(nut_deque_contains(d, &objs[k]) == c);
+            NutState s = nut_deque_index_of(d, &objs[k], &ix);
+            NUT_CHECK((s == NUT_OK) == (c > 0));
+            if (c)
+                NUT_CHECK(ix == first);
+        }
+        nut_deque_destroy(d);
+    }
+}
+
+static void test_spans(void)
+{
+    Deque    *d;
+    uintptr_t in = 1;
+    uintptr_t out = 1;
+
+    NUT_CHECK(nut_deque_new(&d) == NUT_OK);
+    srand(3);
+    for (int it = 0; it < 20000; it++) {
+        size_t n = rand() % 20;
+
+        if (rand() % 2) {
+            void **s1, **s2;
+            size_t n1, n2;
+            size_t k = rand() % (n + 1);
+
+            NUT_CHECK(nut_deque_reserve_spans(d, n, &s1, &n1, &s2, &n2) == NUT_OK);
+            NUT_CHECK(n1 + n2 == n);
+            for (size_t i = 0; i < k; i++) {
+                if (i < n1)
+                    s1[i] = (void*) in++;
+                else
+                    s2[i - n1] = (void*) in++;
+            }
+            NUT_CHECK(nut_deque_commit(d, k) == NUT_OK);
+        } else {
+            void * const *s1, * const *s2;
+            size_t        n1, n2;
+            size_t        tot = nut_deque_peek_spans(d, &s1, &n1, &s2, &n2);
+            size_t        k   = rand() % (tot + 1);
+
+            NUT_CHECK(tot == n1 + n2 && tot == nut_deque_size(d));
+            for (size_t i = 0; i < k; i++) {
+                uintptr_t v = (uintptr_t) (i < n1 ? s1[i] : s2[i - n1]);
+                NUT_CHECK(v == out++);
+            }
+            NUT_CHECK(nut_deque_consume(d, k) == NUT_OK);
+        }
+    }
+    NUT_CHECK(nut_deque_consume(d, nut_deque_size(d) + 1) == NUT_ERR_OUT_OF_RANGE);
+    NUT_CHECK(nut_deque_commit(d, nut_deque_capacity(d) - nut_deque_size(d) + 1) == NUT_ERR_OUT_OF_RANGE);
+    nut_deque_destroy(d);
+
+    /* The same at the other end: filled at the front, drained from the back */
+    NUT_CHECK(nut_deque_new(&d) == NUT_OK);
+    in  = 1;
+    out = 1;
+    for (int it = 0; it < 20000; it++) {
+        size_t n = rand() % 20;
+
+        if (rand() % 2) {
+            void **s1, **s2;
+            size_t n1, n2;
+            size_t k = rand() % (n + 1);
+
+            NUT_CHECK(nut_deque_reserve_spans_first(d, n, &s1, &n1, &s2, &n2) == NUT_OK);
+            NUT_CHECK(n1 + n2 == n);
+            for (size_t j = 0; j < k; j++) {
+                size_t i = n - 1 - j;
+                if (i < n1)
+                    s1[i] = (void*) in++;
+                else
+                    s2[i - n1] = (void*) in++;
+            }
+            NUT_CHECK(nut_deque_commit_first(d, k) == NUT_OK);
+        } else {
+            void * const *s1, * const *s2;
+            size_t        n1, n2;
+            size_t        tot = nut_deque_peek_spans(d, &s1, &n1, &s2, &n2);
+            size_t        k   = rand() % (tot + 1);
+
+            for (size_t j = 0; j < k; j++) {
+                size_t    i = tot - 1 - j;
+                uintptr_t v = (uintptr_t) (i < n1 ? s1[i] : s2[i - n1]);
+                NUT_CHECK(v == out++);
+            }
+            NUT_CHECK(nut_deque_consume_last(d, k) == NUT_OK);
+        }
+    }
+    NUT_CHECK(nut_deque_consume_last(d, nut_deque_size(d) + 1) == NUT_ERR_OUT_OF_RANGE);
+    NUT_CHECK(nut_deque_commit_first(d, nut_deque_capacity(d) - nut_deque_size(d) + 1) == NUT_ERR_OUT_OF_RANGE);
+    nut_deque_destroy(d);
+}
+
+static void test_copy_on_write(void)
+{
+    Deque *d, *c, *c2;
+    void  *v;
+
+    nut_deque_new(&d);
+    for (intptr_t i = 0; i < 6; i++)
+        nut_deque_add_first(d, (void*) i);
+    for (intptr_t i = 0; i < 6; i++)
+        nut_deque_add_last(d, (void*) (10 + i));
+
+    NUT_CHECK(nut_deque_copy_shallow(d, &c) == NUT_OK);
+    nut_deque_remove_first(c, NULL);
+    nut_deque_add_first(c, (void*) 99);
+    nut_deque_get_first(d, &v);
+    NUT_CHECK((intptr_t) v == 5);
+    nut_deque_get_first(c, &v);
+    NUT_CHECK((intptr_t) v == 99);
+    for (size_t i = 1; i < 12; i++) {
+        void *x, *y;
+        nut_deque_get_at(d, i, &x);
+        nut_deque_get_at(c, i, &y);
+        NUT_CHECK(x == y);
+    }
+
+    NUT_CHECK(nut_deque_copy_shallow(d, &c2) == NUT_OK);
+    nut_deque_destroy(d);
+    nut_deque_add_last(c2, (void*) 1);
+    nut_deque_get_last(c2, &v);
+    NUT_CHECK((intptr_t) v == 1);
+    nut_deque_destroy(c2);
+    nut_deque_destroy(c);
+}
+
+static void test_static(void)
+{
+    static void       *buf[4];
+    static DequeStatic storage;
+    Deque             *d;
+    Deque             *c;
+    void              *arr[2] = { NULL, NULL };
+    void              *x;
+
+    NUT_CHECK(nut_deque_new_static(buf, 3, &storage, &d) == NUT_ERR_INVALID_CAPACITY);
+    NUT_CHECK(nut_deque_new_static(buf, 4, &storage, &d) == NUT_OK);
+    for (uintptr_t i = 1; i <= 4; i++)
+        NUT_CHECK(nut_deque_add_first(d, (void*) i) == NUT_OK);
+    NUT_CHECK(nut_deque_add_last(d, (void*) 9) == NUT_ERR_MAX_CAPACITY);
+    NUT_CHECK(nut_deque_add_at(d, (void*) 9, 1) == NUT_ERR_MAX_CAPACITY);
+    NUT_CHECK(nut_deque_add_all(d, arr, 2) == NUT_ERR_MAX_CAPACITY);
+    NUT_CHECK(nut_deque_reserve(d, 8) == NUT_ERR_MAX_CAPACITY);
+    NUT_CHECK(nut_deque_trim_capacity(d) == NUT_OK && nut_deque_capacity(d) == 4);
+
+    NUT_CHECK(nut_deque_copy_shallow(d, &c) == NUT_OK);
+    NUT_CHECK(nut_deque_add(c, (void*) 5) == NUT_OK);
+    NUT_CHECK(nut_deque_size(c) == 5 && nut_deque_size(d) == 4);
+    nut_deque_get_at(c, 0, &x);
+    NUT_CHECK((uintptr_t) x == 4);
+    nut_deque_get_at(c, 4, &x);
+    NUT_CHECK((uintptr_t) x == 5);
+
+    nut_deque_destroy(c);
+    nut_deque_destroy(d);
+}
+
+int main(void)
+{
+    for (unsigned seed = 1; seed < 6; seed++) {
+        test_model(false, seed);
+        test_model(true, seed);
+    }
+    test_trim_no_shrink();
+    test_bulk();
+    test_contains();
+    test_spans();
+    test_copy_on_write();
+    test_static();
+    return 0;
+}
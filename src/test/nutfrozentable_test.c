@@ -0,0 +1,126 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "nutfrozentable.h"
+#include "nuttest.h"
+
+
+static size_t live_blocks;
+
+static void *counting_alloc(size_t size)
+{
+    live_blocks++;
+    return malloc(size);
+}
+
+static void *counting_calloc(size_t blocks, size_t size)
+{
+    live_blocks++;
+    return calloc(blocks, size);
+}
+
+static void counting_free(void *block)
+{
+    if (block)
+        live_blocks--;
+    free(block);
+}
+
+
+static void test_freeze(HashTableLayout layout, int n)
+{
+    HashTableConf c;
+    HashTable    *t;
+    FrozenTable  *by_value;
+    FrozenTable  *by_ref;
+    const FrozenTable *loaded;
+    char        (*ks)[16] = malloc(16 * (n + 1));
+    int          *vs      = malloc(sizeof(int) * (n + 1));
+    char          b[20];
+    void         *o;
+
+    nut_hashtable_conf_init(&c);
+    c.layout = layout;
+    NUT_CHECK(nut_hashtable_new_conf(&c, &t) == NUT_OK);
+    for (int i = 0; i < n; i++) {
+        sprintf(ks[i], "key%d", i);
+        vs[i] = i * 3;
+        NUT_CHECK(nut_hashtable_add(t, ks[i], &vs[i]) == NUT_OK);
+    }
+
+    NUT_CHECK(nut_hashtable_freeze(t, sizeof(int), &by_value) == NUT_OK);
+    NUT_CHECK(nut_hashtable_freeze(t, 0, &by_ref) == NUT_OK);
+    NUT_CHECK(nut_frozentable_size(by_value) == (size_t) n);
+
+    /* The image is position independent */
+    size_t      sz;
+    const void *d    = nut_frozentable_data(by_value, &sz);
+    void       *copy = malloc(sz);
+    memcpy(copy, d, sz);
+    NUT_CHECK(nut_frozentable_from_data(copy, sz, &loaded) == NUT_OK);
+
+    for (int i = 0; i < n; i++) {
+        NUT_CHECK(nut_frozentable_get(loaded, ks[i], &o) == NUT_OK);
+        NUT_CHECK(*(int*) o == i * 3);
+        NUT_CHECK(nut_frozentable_get(by_ref, ks[i], &o) == NUT_OK);
+        NUT_CHECK(o == &vs[i]);
+    }
+    for (int i = n; i < n + 1000; i++) {
+        sprintf(b, "key%d", i);
+        NUT_CHECK(!nut_frozentable_contains_key(loaded, b));
+        NUT_CHECK(nut_frozentable_get(by_ref, b, &o) == NUT_ERR_KEY_NOT_FOUND);
+    }
+
+    nut_frozentable_destroy(by_value);
+    nut_frozentable_destroy(by_ref);
+    nut_hashtable_destroy(t);
+    free(copy);
+    free(ks);
+    free(vs);
+}
+
+/* The frozen table is allocated and released through the source table's
+ * allocators, and a NULL value is frozen as zero bytes */
+static void test_allocators(void)
+{
+    HashTableConf c;
+    HashTable    *t;
+    FrozenTable  *ft;
+    static char   ks[100][8];
+    int           v = 42;
+    void         *o;
+
+    nut_hashtable_conf_init(&c);
+    c.mem_alloc  = counting_alloc;
+    c.mem_calloc = counting_calloc;
+    c.mem_free   = counting_free;
+    NUT_CHECK(nut_hashtable_new_conf(&c, &t) == NUT_OK);
+
+    for (int i = 0; i < 100; i++) {
+        sprintf(ks[i], "k%d", i);
+        NUT_CHECK(nut_hashtable_add(t, ks[i], i % 2 ? &v : NULL) == NUT_OK);
+    }
+    size_t table_blocks = live_blocks;
+
+    NUT_CHECK(nut_hashtable_freeze(t, sizeof(int), &ft) == NUT_OK);
+    NUT_CHECK(live_blocks == table_blocks + 1);
+    for (int i = 0; i < 100; i++) {
+        NUT_CHECK(nut_frozentable_get(ft, ks[i], &o) == NUT_OK);
+        NUT_CHECK(*(int*) o == (i % 2 ? 42 : 0));
+    }
+    nut_frozentable_destroy(ft);
+    NUT_CHECK(live_blocks == table_blocks);
+
+    nut_hashtable_destroy(t);
+    NUT_CHECK(live_blocks == 0);
+}
+
+int main(void)
+{
+    test_allocators();
+
+    for (int layout = HASHTABLE_CHAINED; layout <= HASHTABLE_OPEN; layout++)
+        for (int n = 0; n < 200000; n = n ? n * 7 : 1)
+            test_freeze(layout, n);
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "nuthashset.h"
+#include "nuttest.h"
+
+#define N 50000
+#define U 300
+
+static char k[N][12];
+static int  v[U];
+
+
+static size_t hash_int(const void *key, int l, uint32_t seed)
+{
+    (void) l;
+    return nut_hashtable_hash_wy(key, sizeof(int), seed);
+}
+
+/* A weak hash, so sets with different hash functions get combined */
+static size_t hash_int_mul(const void *key, int l, uint32_t seed)
+{
+    (void) l;
+    (void) seed;
+    return *(const int*) key * 2654435761u;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+    int x = *(const int*) a;
+    int y = *(const int*) b;
+    return (x > y) - (x < y);
+}
+
+static void test_add_remove(void)
+{
+    HashSet *s;
+    void    *o;
+    char     b[12];
+
+    NUT_CHECK(nut_hashset_new(&s) == NUT_OK);
+    for (int i = 0; i < N; i++) {
+        sprintf(k[i], "e%d", i);
+        NUT_CHECK(nut_hashset_add(s, k[i]) == NUT_OK);
+        nut_hashset_add(s, k[i]);
+    }
+    NUT_CHECK(nut_hashset_size(s) == N);
+
+    for (int i = 0; i < N; i += 3) {
+        sprintf(b, "e%d", i);
+        NUT_CHECK(nut_hashset_remove(s, b, &o) == NUT_OK && o == k[i]);
+    }
+    for (int i = 0; i < N; i++)
+        NUT_CHECK(nut_hashset_contains(s, k[i]) == (i % 3 != 0));
+
+    HashSetIter it;
+    void       *e;
+    size_t      seen = 0;
+    size_t      removed = 0;
+
+    nut_hashset_iter_init(&it, s);
+    while (nut_hashset_iter_next(&it, &e) == NUT_OK) {
+        seen++;
+        if (((char*) e)[1] == '1') {
+            NUT_CHECK(nut_hashset_iter_remove(&it, NULL) == NUT_OK);
+            removed++;
+        }
+    }
+    NUT_CHECK(seen == N - (N + 2) / 3);
+    NUT_CHECK(nut_hashset_size(s) == seen - removed);
+
+    NUT_CHECK(nut_hashset_add(s, NULL) == NUT_OK);
+    NUT_CHECK(nut_hashset_contains(s, NULL));
+
+    for (int i = 0; i < N; i++) {
+        nut_hashset_remove(s, k[i], NULL);
+        nut_hashset_add(s, k[i]);
+    }
+    NUT_CHECK(nut_hashset_size(s) == N + 1);
+
+    nut_hashset_remove_all(s);
+    NUT_CHECK(nut_hashset_size(s) == 0);
+    nut_hashset_destroy(s);
+}
+
+static bool matches(HashSet *s, const int *m)
+{
+    size_t n = 0;
+
+    for (int i = 0; i < U; i++) {
+        n += m[i];
+        if (nut_hashset_contains(s, &v[i]) != m[i])
+            return false;
+    }
+    return nut_hashset_size(s) == n;
+}
+
+static void test_set_ops(void)
+{
+    srand(1);
+    for (int i = 0; i < U; i++)
+        v[i] = i;
+
+    for (int it = 0; it < 300; it++) {
+        int ma[U], mb[U], mu[U], mi[U], md[U];
+        int pa = rand() % 100;
+        int pb = rand() % 100;
+        bool sub = true;
+
+        HashSetConf c1, c2;
+        nut_hashset_conf_init(&c1);
+        c1.hash        = hash_int;
+        c1.key_compare = cmp_int;
+        c2 = c1;
+        if (it & 1)
+            c2.hash = hash_int_mul;
+
+        HashSet *a, *b, *r;
+        NUT_CHECK(nut_hashset_new_conf(&c1, &a) == NUT_OK);
+        NUT_CHECK(nut_hashset_new_conf(&c2, &b) == NUT_OK);
+        for (int i = 0; i < U; i++) {
+            ma[i] = rand() % 100 < pa;
+            mb[i] = rand() % 100 < pb;
+            if (ma[i])
+                nut_hashset_add(a, &v[i]);
+            if (mb[i])
+                nut_hashset_add(b, &v[i]);
+            mu[i] = ma[i] | mb[i];
+            mi[i] = ma[i] & mb[i];
+            md[i] = ma[i] & !mb[i];
+            if (md[i])
+                sub = false;
+        }
+
+        NUT_CHECK(nut_hashset_union(a, b, &r) == NUT_OK && matches(r, mu));
+        nut_hashset_destroy(r);
+        NUT_CHECK(nut_hashset_intersection(a, b, &r) == NUT_OK && matches(r, mi));
+        nut_hashset_destroy(r);
+        NUT_CHECK(nut_hashset_difference(a, b, &r) == NUT_OK && matches(r, md));
+        nut_hashset_destroy(r);
+        NUT_CHECK(nut_hashset_is_subset(a, b) == sub);
+
+        switch (it % 3) {
+        case 0:
+            NUT_CHECK(nut_hashset_union_mut(a, b) == NUT_OK && matches(a, mu));
+            break;
+        case 1:
+            NUT_CHECK(nut_hashset_intersection_mut(a, b) == NUT_OK && matches(a, mi));
+            break;
+        default:
+            nut_hashset_difference_mut(a, b);
+            NUT_CHECK(matches(a, md));
+        }
+        nut_hashset_destroy(a);
+        nut_hashset_destroy(b);
+    }
+}
+
+int main(void)
+{
+    test_add_remove();
+    test_set_ops();
+    return 0;
+}
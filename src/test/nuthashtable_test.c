@@ -0,0 +1,237 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "nuthashtable.h"
+#include "nuttest.h"
+
+#define N 20000
+
+static char keys[2 * N][16];
+
+
+static void make_keys(void)
+{
+    for (int i = 0; i < 2 * N; i++)
+        sprintf(keys[i], "k%d", i);
+}
+
+static size_t count_iter(HashTable *t)
+{
+    HashTableIter it;
+    TableEntry   *e;
+    size_t        n = 0;
+
+    nut_hashtable_iter_init(&it, t);
+    while (nut_hashtable_iter_next(&it, &e) == NUT_OK)
+        n++;
+    return n;
+}
+
+static void test_add_get_remove(HashTableConf *c)
+{
+    HashTable *t;
+    void      *v;
+
+    NUT_CHECK(nut_hashtable_new_conf(c, &t) == NUT_OK);
+
+    for (int i = 0; i < N; i++)
+        NUT_CHECK(nut_hashtable_add(t, keys[i], (void*) (intptr_t) (i + 1)) == NUT_OK);
+    NUT_CHECK(nut_hashtable_size(t) == N);
+
+    for (int i = 0; i < N; i++) {
+        NUT_CHECK(nut_hashtable_get(t, keys[i], &v) == NUT_OK);
+        NUT_CHECK((intptr_t) v == i + 1);
+    }
+    NUT_CHECK(nut_hashtable_get(t, "nothere", &v) == NUT_ERR_KEY_NOT_FOUND);
+
+    for (int i = 0; i < N; i += 2) {
+        NUT_CHECK(nut_hashtable_remove(t, keys[i], &v) == NUT_OK);
+        NUT_CHECK((intptr_t) v == i + 1);
+    }
+    NUT_CHECK(nut_hashtable_size(t) == N / 2);
+    for (int i = 0; i < N; i++)
+        NUT_CHECK(nut_hashtable_contains_key(t, keys[i]) == (i % 2 == 1));
+
+    for (int i = 0; i < N; i += 2)
+        NUT_CHECK(nut_hashtable_add(t, keys[i], (void*) (intptr_t) (i + 1)) == NUT_OK);
+    NUT_CHECK(nut_hashtable_add(t, NULL, (void*) 7) == NUT_OK);
+    NUT_CHECK(nut_hashtable_get(t, NULL, &v) == NUT_OK && v == (void*) 7);
+
+    /* Removing through the iterator must not skip or repeat entries */
+    HashTableIter it;
+    TableEntry   *e;
+    size_t        seen = 0;
+    size_t        left = N + 1;
+
+    nut_hashtable_iter_init(&it, t);
+    while (nut_hashtable_iter_next(&it, &e) == NUT_OK) {
+        seen++;
+        if (e->key && (intptr_t) e->value % 3 == 0) {
+            NUT_CHECK(nut_hashtable_iter_remove(&it, NULL) == NUT_OK);
+            left--;
+        }
+    }
+    NUT_CHECK(seen == N + 1);
+    NUT_CHECK(nut_hashtable_size(t) == left);
+    NUT_CHECK(count_iter(t) == left);
+
+    nut_hashtable_remove_all(t);
+    NUT_CHECK(nut_hashtable_size(t) == 0);
+    NUT_CHECK(count_iter(t) == 0);
+
+    /* Churn leaves no residue behind (tombstones, slab entries) */
+    for (int r = 0; r < 50; r++) {
+        for (int i = 0; i < 1000; i++)
+            nut_hashtable_add(t, keys[i], keys[i]);
+        for (int i = 0; i < 1000; i++)
+            NUT_CHECK(nut_hashtable_remove(t, keys[i], NULL) == NUT_OK);
+    }
+    NUT_CHECK(nut_hashtable_size(t) == 0);
+
+    nut_hashtable_destroy(t);
+}
+
+static void test_growth(HashTableConf *c)
+{
+    HashTable *t;
+    void      *v;
+
+    NUT_CHECK(nut_hashtable_new_conf(c, &t) == NUT_OK);
+
+    for (int i = 0; i < 2 * N; i++) {
+        NUT_CHECK(nut_hashtable_add(t, keys[i], (void*) (intptr_t) (i + 1)) == NUT_OK);
+        if (i % 997 == 0)
+            NUT_CHECK(count_iter(t) == nut_hashtable_size(t));
+        if (i % 13 == 0) {
+            NUT_CHECK(nut_hashtable_get(t, keys[i / 2], &v) == NUT_OK);
+            NUT_CHECK((intptr_t) v == i / 2 + 1);
+        }
+    }
+    for (int i = 0; i < 2 * N; i++) {
+        NUT_CHECK(nut_hashtable_get(t, keys[i], &v) == NUT_OK);
+        NUT_CHECK((intptr_t) v == i + 1);
+    }
+    for (int i = 0; i < 2 * N; i++)
+        NUT_CHECK(nut_hashtable_remove(t, keys[i], NULL) == NUT_OK);
+    NUT_CHECK(nut_hashtable_size(t) == 0);
+
+    nut_hashtable_destroy(t);
+}
+
+static void test_get_batch(HashTableLayout layout)
+{
+    HashTableConf c;
+    HashTable    *t;
+    static void  *kp[2 * N + 1];
+    static void  *out[2 * N + 1];
+    static NutState st[2 * N + 1];
+
+    nut_hashtable_conf_init(&c);
+    c.layout      = layout;
+    c.rehash_step = 2;
+    NUT_CHECK(nut_hashtable_new_conf(&c, &t) == NUT_OK);
+
+    for (int i = 0; i < 2 * N; i++) {
+        kp[i] = keys[i];
+        if (i < N)
+            nut_hashtable_add(t, keys[i], (void*) (intptr_t) (i + 1));
+    }
+    nut_hashtable_add(t, NULL, (void*) 9);
+    kp[2 * N] = NULL;
+
+    NUT_CHECK(nut_hashtable_get_batch(t, kp, 2 * N + 1, out, st) == N + 1);
+    for (int i = 0; i < 2 * N; i++) {
+        if (i < N)
+            NUT_CHECK(st[i] == NUT_OK && (intptr_t) out[i] == i + 1);
+        else
+            NUT_CHECK(st[i] == NUT_ERR_KEY_NOT_FOUND);
+    }
+    NUT_CHECK(st[2 * N] == NUT_OK && out[2 * N] == (void*) 9);
+
+    nut_hashtable_destroy(t);
+}
+
+static void test_hashed(HashTableLayout layout)
+{
+    HashTableConf c;
+    HashTable    *t;
+    void         *v;
+
+    nut_hashtable_conf_init(&c);
+    c.layout = layout;
+    NUT_CHECK(nut_hashtable_new_conf(&c, &t) == NUT_OK);
+
+    for (int i = 0; i < N; i++) {
+        size_t h = nut_hashtable_hash_key(t, keys[i]);
+        NUT_CHECK(nut_hashtable_add_hashed(t, keys[i], keys[i], h) == NUT_OK);
+    }
+    for (int i = 0; i < N; i++) {
+        NUT_CHECK(nut_hashtable_get(t, keys[i], &v) == NUT_OK && v == keys[i]);
+        size_t h = nut_hashtable_hash_key(t, keys[i]);
+        NUT_CHECK(nut_hashtable_contains_key_hashed(t, keys[i], h));
+        if (i % 2)
+            NUT_CHECK(nut_hashtable_remove_hashed(t, keys[i], h, &v) == NUT_OK && v == keys[i]);
+    }
+    for (int i = 0; i < N; i++) {
+        size_t h = nut_hashtable_hash_key(t, keys[i]);
+        NutState s = nut_hashtable_get_hashed(t, keys[i], h, &v);
+        NUT_CHECK((s == NUT_OK) == (i % 2 == 0));
+    }
+    nut_hashtable_destroy(t);
+}
+
+static void test_hashes(void)
+{
+    char buf[200];
+
+    for (int l = 0; l < 150; l++) {
+        for (int i = 0; i < l; i++)
+            buf[i] = 'a' + (i * 7 + l) % 26;
+        buf[l] = 0;
+
+        /* KEY_LENGTH_VARIABLE hashes the string up to its terminator */
+        NUT_CHECK(nut_hashtable_hash_wy(buf, -1, 3) == nut_hashtable_hash_wy(buf, l, 3));
+        NUT_CHECK(nut_hashtable_hash_crc32(buf, -1, 3) == nut_hashtable_hash_crc32(buf, l, 3));
+        if (l > 0) {
+            NUT_CHECK(nut_hashtable_hash_wy(buf, l, 3) != nut_hashtable_hash_wy(buf, l, 4));
+            NUT_CHECK(nut_hashtable_hash_wy(buf, l, 3) != nut_hashtable_hash_wy(buf, l - 1, 3));
+        }
+    }
+    NUT_CHECK(nut_hashtable_hash_string("ab", -1, 0) != nut_hashtable_hash_string("bb", -1, 0));
+
+    /* Offline generated tables rely on these values; a narrower size_t
+     * keeps the low bits */
+    const uint64_t wy  = 0xfd6f4728ac8cc4f9ULL;
+    const uint64_t crc = 0xd38882fee4774324ULL;
+    NUT_CHECK(nut_hashtable_hash_wy("collections", -1, 7) == (size_t) wy);
+    NUT_CHECK(nut_hashtable_hash_crc32("collections", -1, 7) == (size_t) crc);
+}
+
+int main(void)
+{
+    HashTableConf c;
+
+    make_keys();
+
+    for (int layout = HASHTABLE_CHAINED; layout <= HASHTABLE_OPEN; layout++) {
+        nut_hashtable_conf_init(&c);
+        c.layout = layout;
+        test_add_get_remove(&c);
+        test_get_batch(layout);
+        test_hashed(layout);
+    }
+
+    /* Chained layout: stop-the-world and incremental rehash, with and
+     * without the entry slabs */
+    for (size_t step = 0; step <= 8; step += 4) {
+        nut_hashtable_conf_init(&c);
+        c.rehash_step      = step;
+        c.initial_capacity = 4;
+        c.slab_entries     = step == 4 ? 0 : 7;
+        test_growth(&c);
+        test_add_get_remove(&c);
+    }
+
+    test_hashes();
+    return 0;
+}
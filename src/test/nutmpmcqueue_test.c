@@ -0,0 +1,126 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nutmpmcqueue.h"
+#include "nuttest.h"
+
+#define PRODUCERS 4
+#define CONSUMERS 3
+#define N         20000
+
+static MpmcQueue      *queue;
+static bool            blocking;
+static unsigned char   seen[PRODUCERS][N];
+static unsigned long   total;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static void *producer(void *arg)
+{
+    uintptr_t id = (uintptr_t) arg;
+
+    for (uintptr_t i = 0; i < N; i++) {
+        void *e = (void*) (id * N + i + 1);
+        if (blocking)
+            NUT_CHECK(nut_mpmcqueue_enqueue_wait(queue, e) == NUT_OK);
+        else
+            while (nut_mpmcqueue_enqueue(queue, e) != NUT_OK)
+                sched_yield();
+    }
+    return NULL;
+}
+
+/* Runs until it polls NULL. Every element must arrive exactly once and the
+ * elements of one producer must arrive in order. */
+static void *consumer(void *arg)
+{
+    uintptr_t last[PRODUCERS] = { 0 };
+    void     *v;
+
+    (void) arg;
+    for (;;) {
+        if (blocking)
+            NUT_CHECK(nut_mpmcqueue_poll_wait(queue, &v) == NUT_OK);
+        else if (nut_mpmcqueue_poll(queue, &v) != NUT_OK) {
+            sched_yield();
+            continue;
+        }
+        if (!v)
+            break;
+
+        uintptr_t x = (uintptr_t) v - 1;
+        uintptr_t p = x / N;
+        uintptr_t i = x % N;
+
+        NUT_CHECK(!last[p] || i + 1 > last[p]);
+        last[p] = i + 1;
+
+        pthread_mutex_lock(&lock);
+        NUT_CHECK(!seen[p][i]);
+        seen[p][i] = 1;
+        total++;
+        pthread_mutex_unlock(&lock);
+    }
+    return NULL;
+}
+
+static void run(bool block)
+{
+    MpmcQueueConf c;
+    pthread_t     pt[PRODUCERS];
+    pthread_t     ct[CONSUMERS];
+
+    blocking = block;
+    total    = 0;
+    memset(seen, 0, sizeof(seen));
+
+    nut_mpmcqueue_conf_init(&c);
+    c.capacity = block ? 3 : 60;
+    c.blocking = block;
+    NUT_CHECK(nut_mpmcqueue_new_conf(&c, &queue) == NUT_OK);
+
+    for (uintptr_t i = 0; i < CONSUMERS; i++)
+        pthread_create(&ct[i], NULL, consumer, NULL);
+    for (uintptr_t i = 0; i < PRODUCERS; i++)
+        pthread_create(&pt[i], NULL, producer, (void*) i);
+    for (int i = 0; i < PRODUCERS; i++)
+        pthread_join(pt[i], NULL);
+    for (int i = 0; i < CONSUMERS; i++) {
+        if (block)
+            nut_mpmcqueue_enqueue_wait(queue, NULL);
+        else
+            while (nut_mpmcqueue_enqueue(queue, NULL) != NUT_OK)
+                sched_yield();
+    }
+    for (int i = 0; i < CONSUMERS; i++)
+        pthread_join(ct[i], NULL);
+
+    NUT_CHECK(total == (unsigned long) PRODUCERS * N);
+    NUT_CHECK(nut_mpmcqueue_size(queue) == 0);
+    nut_mpmcqueue_destroy(queue);
+}
+
+int main(void)
+{
+    void *v;
+
+    NUT_CHECK(nut_mpmcqueue_new(0, &queue) == NUT_ERR_INVALID_CAPACITY);
+    NUT_CHECK(nut_mpmcqueue_new(5, &queue) == NUT_OK);
+    NUT_CHECK(nut_mpmcqueue_capacity(queue) == 8);
+    NUT_CHECK(nut_mpmcqueue_poll(queue, &v) == NUT_ERR_OUT_OF_RANGE);
+    /* Waiting on a non-blocking queue does not block */
+    NUT_CHECK(nut_mpmcqueue_poll_wait(queue, &v) == NUT_ERR_OUT_OF_RANGE);
+    for (uintptr_t i = 1; i <= 8; i++)
+        NUT_CHECK(nut_mpmcqueue_enqueue(queue, (void*) i) == NUT_OK);
+    NUT_CHECK(nut_mpmcqueue_enqueue(queue, (void*) 9) == NUT_ERR_MAX_CAPACITY);
+    NUT_CHECK(nut_mpmcqueue_size(queue) == 8);
+    for (uintptr_t i = 1; i <= 8; i++)
+        NUT_CHECK(nut_mpmcqueue_poll(queue, &v) == NUT_OK && (uintptr_t) v == i);
+    nut_mpmcqueue_destroy(queue);
+
+    run(false);
+    run(true);
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include <stdint.h>
+
+#include "nutpqueue.h"
+#include "nuttest.h"
+
+
+static int cmp_intptr(const void *a, const void *b)
+{
+    intptr_t x = (intptr_t) a;
+    intptr_t y = (intptr_t) b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_long(const void *a, const void *b)
+{
+    long x = *(const long*) a;
+    long y = *(const long*) b;
+    return (x > y) - (x < y);
+}
+
+int main(void)
+{
+    static long all[2500];
+    void       *els[500];
+
+    srand(11);
+    for (int r = 0; r < 1000; r++) {
+        PQueue *pq;
+        size_t  total = 0;
+        void   *o;
+
+        NUT_CHECK(nut_pqueue_new(&pq, cmp_intptr) == NUT_OK);
+        for (int b = 0; b < 5; b++) {
+            size_t k = rand() % 500;
+            for (size_t q = 0; q < k; q++) {
+                long v = rand() % 1000 + 1;
+                els[q] = (void*) v;
+                all[total++] = v;
+            }
+            if (rand() % 2) {
+                NUT_CHECK(nut_pqueue_push_all(pq, els, k) == NUT_OK);
+            } else {
+                for (size_t q = 0; q < k; q++)
+                    NUT_CHECK(nut_pqueue_push(pq, els[q]) == NUT_OK);
+            }
+        }
+
+        qsort(all, total, sizeof(long), cmp_long);
+        for (size_t i = total; i > 0; i--) {
+            NUT_CHECK(nut_pqueue_pop(pq, &o) == NUT_OK);
+            NUT_CHECK((long) o == all[i - 1]);
+        }
+        NUT_CHECK(nut_pqueue_pop(pq, &o) != NUT_OK);
+        nut_pqueue_destroy(pq);
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <stdint.h>
+
+#include "nutqueue.h"
+#include "nuttest.h"
+
+
+static void test_fifo(void)
+{
+    Queue    *q;
+    QueueIter it;
+    void     *v;
+    uintptr_t expect = 1;
+
+    NUT_CHECK(nut_queue_new(&q) == NUT_OK);
+    for (uintptr_t i = 1; i <= 100; i++)
+        NUT_CHECK(nut_queue_enqueue(q, (void*) i) == NUT_OK);
+    NUT_CHECK(nut_queue_peek(q, &v) == NUT_OK && (uintptr_t) v == 1);
+
+    nut_queue_iter_init(&it, q);
+    while (nut_queue_iter_next(&it, &v) == NUT_OK)
+        NUT_CHECK(v != NULL);
+
+    while (nut_queue_poll(q, &v) == NUT_OK)
+        NUT_CHECK((uintptr_t) v == expect++);
+    NUT_CHECK(expect == 101 && nut_queue_size(q) == 0);
+    nut_queue_destroy(q);
+}
+
+static void test_spans(void)
+{
+    Queue    *q;
+    uintptr_t in = 1;
+    uintptr_t out = 1;
+    void     *v;
+
+    NUT_CHECK(nut_queue_new(&q) == NUT_OK);
+    srand(3);
+    for (int it = 0; it < 20000; it++) {
+        size_t n = rand() % 20;
+
+        if (rand() % 2) {
+            void **s1, **s2;
+            size_t n1, n2;
+            size_t k = rand() % (n + 1);
+
+            NUT_CHECK(nut_queue_reserve_spans(q, n, &s1, &n1, &s2, &n2) == NUT_OK);
+            NUT_CHECK(n1 + n2 == n);
+
+            /* The runs are back to front, the last slot goes in first */
+            for (size_t j = 0; j < k; j++) {
+                size_t i = n - 1 - j;
+                if (i < n1)
+                    s1[i] = (void*) in++;
+                else
+                    s2[i - n1] = (void*) in++;
+            }
+            NUT_CHECK(nut_queue_commit(q, k) == NUT_OK);
+        } else if (rand() % 3) {
+            void * const *s1, * const *s2;
+            size_t        n1, n2;
+            size_t        tot = nut_queue_peek_spans(q, &s1, &n1, &s2, &n2);
+            size_t        k   = rand() % (tot + 1);
+
+            NUT_CHECK(tot == n1 + n2 && tot == nut_queue_size(q));
+            for (size_t j = 0; j < k; j++) {
+                size_t    i = tot - 1 - j;
+                uintptr_t x = (uintptr_t) (i < n1 ? s1[i] : s2[i - n1]);
+                NUT_CHECK(x == out++);
+            }
+            NUT_CHECK(nut_queue_consume(q, k) == NUT_OK);
+        } else {
+            /* Spans and the element wise calls see the same order */
+            if (nut_queue_poll(q, &v) == NUT_OK)
+                NUT_CHECK((uintptr_t) v == out++);
+            NUT_CHECK(nut_queue_enqueue(q, (void*) in++) == NUT_OK);
+        }
+    }
+    NUT_CHECK(nut_queue_consume(q, nut_queue_size(q) + 1) == NUT_ERR_OUT_OF_RANGE);
+    if (nut_queue_peek(q, &v) == NUT_OK)
+        NUT_CHECK((uintptr_t) v == out);
+    nut_queue_destroy(q);
+}
+
+static void test_static(void)
+{
+    static void       *buf[8];
+    static QueueStatic storage;
+    Queue             *q;
+    void              *v;
+    void             **s1, **s2;
+    size_t             n1, n2;
+
+    NUT_CHECK(nut_queue_new_static(buf, 6, &storage, &q) == NUT_ERR_INVALID_CAPACITY);
+    NUT_CHECK(nut_queue_new_static(buf, 8, &storage, &q) == NUT_OK);
+    for (int round = 0; round < 3; round++) {
+        for (uintptr_t i = 1; i <= 8; i++)
+            NUT_CHECK(nut_queue_enqueue(q, (void*) i) == NUT_OK);
+        NUT_CHECK(nut_queue_enqueue(q, (void*) 9) == NUT_ERR_MAX_CAPACITY);
+        for (uintptr_t i = 1; i <= 5; i++)
+            NUT_CHECK(nut_queue_poll(q, &v) == NUT_OK && (uintptr_t) v == i);
+        for (uintptr_t i = 1; i <= 5; i++)
+            NUT_CHECK(nut_queue_enqueue(q, (void*) i) == NUT_OK);
+        NUT_CHECK(nut_queue_enqueue(q, (void*) 9) == NUT_ERR_MAX_CAPACITY);
+        while (nut_queue_poll(q, &v) == NUT_OK);
+    }
+
+    NUT_CHECK(nut_queue_reserve_spans(q, 9, &s1, &n1, &s2, &n2) == NUT_ERR_MAX_CAPACITY);
+    NUT_CHECK(nut_queue_reserve_spans(q, 8, &s1, &n1, &s2, &n2) == NUT_OK);
+    NUT_CHECK(n1 + n2 == 8);
+    NUT_CHECK(nut_queue_commit(q, 9) == NUT_ERR_OUT_OF_RANGE);
+    nut_queue_destroy(q);
+}
+
+int main(void)
+{
+    test_fifo();
+    test_spans();
+    test_static();
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <stdint.h>
+
+#include "nutarray.h"
+#include "nutsegarray.h"
+#include "nuttest.h"
+
+
+/* Randomized check against an Array holding the same elements */
+static void test_model(size_t chunk_size)
+{
+    SegArrayConf conf;
+    SegArray    *s;
+    Array       *a;
+
+    nut_segarray_conf_init(&conf);
+    conf.chunk_size = chunk_size;
+    conf.capacity   = 0;
+    NUT_CHECK(nut_segarray_new_conf(&conf, &s) == NUT_OK);
+    NUT_CHECK(nut_array_new(&a) == NUT_OK);
+
+    for (int it = 0; it < 3000; it++) {
+        int      op = rand() % 5;
+        size_t   n  = nut_array_size(a);
+        intptr_t v  = rand() % 50 + 1;
+        void    *x, *y;
+
+        if (op <= 1) {
+            size_t idx = rand() % (n + 1);
+            NUT_CHECK(nut_segarray_add_at(s, (void*) v, idx) == NUT_OK);
+            nut_array_add_at(a, (void*) v, idx);
+        } else if (op == 2) {
+            NUT_CHECK(nut_segarray_add(s, (void*) v) == NUT_OK);
+            nut_array_add(a, (void*) v);
+        } else if (op == 3 && n) {
+            size_t idx = rand() % n;
+            NUT_CHECK(nut_segarray_remove_at(s, idx, &x) == NUT_OK);
+            nut_array_remove_at(a, idx, &y);
+            NUT_CHECK(x == y);
+        } else if (n) {
+            NutState s1 = nut_segarray_remove(s, (void*) v, &x);
+            NutState s2 = nut_array_remove(a, (void*) v, &y);
+            NUT_CHECK(s1 == s2);
+        }
+
+        NUT_CHECK(nut_segarray_size(s) == nut_array_size(a));
+        for (size_t i = 0; i < nut_array_size(a); i++) {
+            nut_segarray_get_at(s, i, &x);
+            nut_array_get_at(a, i, &y);
+            NUT_CHECK(x == y);
+        }
+        NUT_CHECK(nut_segarray_contains(s, (void*) v) == nut_array_contains(a, (void*) v));
+    }
+
+    /* Growing never moves existing elements */
+    void *p0 = nut_segarray_get_slot(s, 0);
+    for (int i = 0; i < 1000; i++)
+        nut_segarray_add(s, (void*) 1);
+    NUT_CHECK(p0 == nut_segarray_get_slot(s, 0));
+
+    SegArrayIter it;
+    void        *e;
+    size_t       kept = 0;
+
+    nut_segarray_iter_init(&it, s);
+    while (nut_segarray_iter_next(&it, &e) != NUT_ITER_END) {
+        if ((intptr_t) e == 1)
+            NUT_CHECK(nut_segarray_iter_remove(&it, NULL) == NUT_OK);
+        else
+            kept++;
+    }
+    NUT_CHECK(nut_segarray_size(s) == kept);
+    NUT_CHECK(nut_segarray_contains(s, (void*) 1) == 0);
+    NUT_CHECK(nut_segarray_trim_capacity(s) == NUT_OK);
+
+    nut_segarray_destroy(s);
+    nut_array_destroy(a);
+}
+
+static void test_values(void)
+{
+    SegArrayConf conf;
+    SegArray    *s;
+    double       d[3] = { -1, -1, -1 };
+    double       o[3];
+
+    nut_segarray_conf_init(&conf);
+    conf.element_size = sizeof(double) * 3;
+    conf.chunk_size   = 5;
+    NUT_CHECK(nut_segarray_new_conf(&conf, &s) == NUT_OK);
+
+    for (int i = 0; i < 100; i++) {
+        double v[3] = { i, i, i };
+        NUT_CHECK(nut_segarray_add_value(s, v) == NUT_OK);
+    }
+    NUT_CHECK(nut_segarray_add_value_at(s, d, 7) == NUT_OK);
+    NUT_CHECK(nut_segarray_get_value_at(s, 8, o) == NUT_OK && o[0] == 7);
+    NUT_CHECK(nut_segarray_remove_value_at(s, 7, o) == NUT_OK && o[0] == -1);
+    NUT_CHECK(nut_segarray_get_value_at(s, 99, o) == NUT_OK && o[2] == 99);
+    nut_segarray_destroy(s);
+}
+
+int main(void)
+{
+    srand(1);
+    for (size_t cs = 1; cs <= 8; cs *= 2)
+        test_model(cs);
+    test_values();
+    return 0;
+}
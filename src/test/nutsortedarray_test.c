@@ -0,0 +1,149 @@
+#include <string.h>
+
+#include "nutsortedarray.h"
+#include "nuttest.h"
+
+#define KEYS 2000
+
+typedef struct {
+    int k;
+    int ver;
+} Entry;
+
+static Entry pool[400000];
+static int   ref[KEYS];
+static int   has[KEYS];
+
+
+static int cmp_entry(const void *a, const void *b)
+{
+    int x = ((const Entry*) a)->k;
+    int y = ((const Entry*) b)->k;
+    return (x > y) - (x < y);
+}
+
+static size_t count_below(int k)
+{
+    size_t n = 0;
+    for (int q = 0; q < k && q < KEYS; q++)
+        n += has[q];
+    return n;
+}
+
+static void check_bounds(SortedArray *sa, int k)
+{
+    Entry    probe = { k, 0 };
+    Entry    to    = { k + 50, 0 };
+    size_t   first;
+    void    *o;
+    NutState s;
+    int      g;
+
+    NUT_CHECK(nut_sortedarray_lower_bound(sa, &probe) == count_below(k));
+    NUT_CHECK(nut_sortedarray_upper_bound(sa, &probe) == count_below(k) + has[k]);
+    NUT_CHECK(nut_sortedarray_range(sa, &probe, &to, &first) == count_below(k + 50) - count_below(k));
+    NUT_CHECK(first == count_below(k));
+
+    g = -1;
+    for (int q = k + 1; q < KEYS; q++) {
+        if (has[q]) {
+            g = q;
+            break;
+        }
+    }
+    s = nut_sortedarray_get_greater_than(sa, &probe, &o);
+    NUT_CHECK((s == NUT_OK) == (g >= 0));
+    if (g >= 0)
+        NUT_CHECK(((Entry*) o)->k == g);
+
+    g = -1;
+    for (int q = k - 1; q >= 0; q--) {
+        if (has[q]) {
+            g = q;
+            break;
+        }
+    }
+    s = nut_sortedarray_get_lesser_than(sa, &probe, &o);
+    NUT_CHECK((s == NUT_OK) == (g >= 0));
+    if (g >= 0)
+        NUT_CHECK(((Entry*) o)->k == g);
+}
+
+int main(void)
+{
+    srand(7);
+    for (int r = 0; r < 30; r++) {
+        SortedArrayConf c;
+        SortedArray    *sa;
+        int             np = 0;
+
+        nut_sortedarray_conf_init(&c);
+        c.cmp   = cmp_entry;
+        c.batch = 1 + rand() % 64;
+        NUT_CHECK(nut_sortedarray_new_conf(&c, &sa) == NUT_OK);
+        memset(has, 0, sizeof(has));
+
+        for (int it = 0; it < 8000 && np < 390000; it++) {
+            int      op    = rand() % 10;
+            int      k     = rand() % KEYS;
+            Entry    probe = { k, 0 };
+            void    *o;
+            NutState s;
+
+            if (op < 5) {
+                Entry *e = &pool[np++];
+                e->k   = k;
+                e->ver = it;
+                NUT_CHECK(nut_sortedarray_add(sa, e) == NUT_OK);
+                has[k] = 1;
+                ref[k] = it;
+            } else if (op == 5) {
+                s = nut_sortedarray_remove(sa, &probe, &o);
+                NUT_CHECK((s == NUT_OK) == has[k]);
+                if (has[k])
+                    NUT_CHECK(((Entry*) o)->ver == ref[k]);
+                has[k] = 0;
+            } else if (op == 6) {
+                /* Batch insert, with duplicates inside the batch */
+                Array *a;
+                int    cnt = rand() % 300;
+                nut_array_new(&a);
+                for (int q = 0; q < cnt; q++) {
+                    Entry *e = &pool[np++];
+                    e->k   = rand() % KEYS;
+                    e->ver = it * 1000 + q;
+                    nut_array_add(a, e);
+                    has[e->k] = 1;
+                    ref[e->k] = e->ver;
+                }
+                NUT_CHECK(nut_sortedarray_add_all(sa, a) == NUT_OK);
+                nut_array_destroy(a);
+            } else if (op == 7) {
+                s = nut_sortedarray_get(sa, &probe, &o);
+                NUT_CHECK((s == NUT_OK) == has[k]);
+                if (has[k])
+                    NUT_CHECK(((Entry*) o)->ver == ref[k]);
+            } else if (op == 8) {
+                check_bounds(sa, k);
+            } else {
+                NUT_CHECK(nut_sortedarray_size(sa) == count_below(KEYS));
+            }
+        }
+
+        const void * const *b = nut_sortedarray_get_buffer(sa);
+        size_t              n = nut_sortedarray_size(sa);
+        void               *o;
+
+        for (size_t i = 1; i < n; i++)
+            NUT_CHECK(cmp_entry(b[i - 1], b[i]) < 0);
+        if (n) {
+            NUT_CHECK(nut_sortedarray_get_first(sa, &o) == NUT_OK && o == b[0]);
+            NUT_CHECK(nut_sortedarray_get_last(sa, &o) == NUT_OK && o == b[n - 1]);
+        }
+        nut_sortedarray_remove_all(sa);
+        NUT_CHECK(nut_sortedarray_get_first(sa, &o) == NUT_ERR_VALUE_NOT_FOUND);
+        NUT_CHECK(nut_sortedarray_get_last(sa, &o) == NUT_ERR_VALUE_NOT_FOUND);
+        nut_sortedarray_destroy(sa);
+    }
+    return 0;
+}
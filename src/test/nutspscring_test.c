@@ -0,0 +1,70 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+
+#include "nutspscring.h"
+#include "nuttest.h"
+
+#define N 200000
+
+static SpscRing *ring;
+
+
+/* Mixes single and batched enqueues so both paths race the consumer */
+static void *producer(void *arg)
+{
+    uintptr_t i = 1;
+    void     *buf[7];
+
+    (void) arg;
+    while (i <= N) {
+        if (i % 3 == 0) {
+            size_t k = 0;
+            for (; k < 7 && i + k <= N; k++)
+                buf[k] = (void*) (i + k);
+            i += nut_spscring_enqueue_all(ring, buf, k);
+        } else if (nut_spscring_enqueue(ring, (void*) i) == NUT_OK) {
+            i++;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t t;
+    uintptr_t expect = 1;
+    void     *buf[5];
+    void     *v;
+
+    NUT_CHECK(nut_spscring_new(100, &ring) == NUT_OK);
+    NUT_CHECK(nut_spscring_capacity(ring) == 128);
+
+    pthread_create(&t, NULL, producer, NULL);
+    while (expect <= N) {
+        if (expect & 1) {
+            if (nut_spscring_poll(ring, &v) == NUT_OK) {
+                NUT_CHECK((uintptr_t) v == expect);
+                expect++;
+            } else {
+                sched_yield();
+            }
+        } else {
+            size_t m = nut_spscring_poll_all(ring, buf, 5);
+            for (size_t k = 0; k < m; k++)
+                NUT_CHECK((uintptr_t) buf[k] == expect++);
+        }
+    }
+    pthread_join(t, NULL);
+
+    NUT_CHECK(nut_spscring_poll(ring, &v) == NUT_ERR_OUT_OF_RANGE);
+    for (int i = 0; i < 128; i++)
+        NUT_CHECK(nut_spscring_enqueue(ring, (void*) 1) == NUT_OK);
+    NUT_CHECK(nut_spscring_enqueue(ring, (void*) 1) == NUT_ERR_MAX_CAPACITY);
+    NUT_CHECK(nut_spscring_size(ring) == 128);
+
+    nut_spscring_destroy(ring);
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include <stdint.h>
+
+#include "nutstack.h"
+#include "nuttest.h"
+
+
+static void test_lifo(void)
+{
+    Stack    *s;
+    void     *v;
+    uintptr_t expect = 1000;
+
+    NUT_CHECK(nut_stack_new(&s) == NUT_OK);
+    for (uintptr_t i = 1; i <= 1000; i++)
+        NUT_CHECK(nut_stack_push(s, (void*) i) == NUT_OK);
+    NUT_CHECK(nut_stack_peek(s, &v) == NUT_OK && (uintptr_t) v == 1000);
+    while (nut_stack_pop(s, &v) == NUT_OK)
+        NUT_CHECK((uintptr_t) v == expect--);
+    NUT_CHECK(expect == 0 && nut_stack_size(s) == 0);
+    nut_stack_destroy(s);
+}
+
+static void test_static(void)
+{
+    static void       *buf[5];
+    static StackStatic storage;
+    Stack             *s;
+    void              *v;
+
+    NUT_CHECK(nut_stack_new_static(buf, 5, &storage, &s) == NUT_OK);
+    for (uintptr_t i = 1; i <= 5; i++)
+        NUT_CHECK(nut_stack_push(s, (void*) i) == NUT_OK);
+    NUT_CHECK(nut_stack_push(s, (void*) 6) == NUT_ERR_MAX_CAPACITY);
+    NUT_CHECK(nut_stack_pop(s, &v) == NUT_OK && (uintptr_t) v == 5);
+    NUT_CHECK(buf[0] == (void*) 1);
+    nut_stack_destroy(s);
+}
+
+int main(void)
+{
+    test_lifo();
+    test_static();
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include <stdint.h>
+
+#include "nuttemplate.h"
+#include "nuttest.h"
+
+NUT_DEFINE_ARRAY(IntArray, int, NUT_CMP_SCALAR)
+NUT_DEFINE_SMALL_ARRAY(SmallIntArray, int, 8, NUT_CMP_SCALAR)
+NUT_DEFINE_HASHTABLE(IntMap, uint32_t, int, NUT_HASH_U32, NUT_EQ_SCALAR)
+
+#define KEYS 20000
+
+
+static int cmp_int(const void *a, const void *b)
+{
+    return NUT_CMP_SCALAR(*(const int*) a, *(const int*) b);
+}
+
+static void test_array(void)
+{
+    srand(1);
+    for (int round = 0; round < 200; round++) {
+        IntArray ar;
+        int      n   = rand() % 3000;
+        int      mod = round % 3 == 0 ? 5 : 100000;
+        int     *ref = malloc(sizeof(int) * (n + 1));
+
+        NUT_CHECK(IntArray_init(&ar, 0) == NUT_OK);
+        for (int i = 0; i < n; i++) {
+            int v = round % 5 == 1 ? i : round % 5 == 2 ? n - i : rand() % mod;
+            ref[i] = v;
+            NUT_CHECK(IntArray_add(&ar, v) == NUT_OK);
+        }
+        IntArray_sort(&ar);
+        qsort(ref, n, sizeof(int), cmp_int);
+        for (int i = 0; i < n; i++)
+            NUT_CHECK(ar.buffer[i] == ref[i]);
+
+        if (n) {
+            int    x;
+            size_t idx;
+            NUT_CHECK(IntArray_remove_at(&ar, 0, &x) == NUT_OK && x == ref[0]);
+            NUT_CHECK(IntArray_add_at(&ar, x, 0) == NUT_OK);
+            NUT_CHECK(IntArray_index_of(&ar, ref[n - 1], &idx) == NUT_OK);
+            NUT_CHECK(ar.buffer[idx] == ref[n - 1]);
+        }
+        IntArray_destroy(&ar);
+        free(ref);
+    }
+
+    /* A destroyed array can be used again and starts from a small buffer */
+    IntArray ar;
+    NUT_CHECK(IntArray_init(&ar, 4) == NUT_OK);
+    IntArray_destroy(&ar);
+    NUT_CHECK(IntArray_add(&ar, 7) == NUT_OK);
+    NUT_CHECK(ar.capacity == NUT_TEMPLATE_INITIAL_CAPACITY && ar.buffer[0] == 7);
+    IntArray_destroy(&ar);
+}
+
+static void test_small_array(void)
+{
+    SmallIntArray a;
+    int           v;
+
+    SmallIntArray_init(&a);
+    for (int i = 0; i < 8; i++)
+        NUT_CHECK(SmallIntArray_add(&a, 100 - i) == NUT_OK);
+    NUT_CHECK(a.buffer == a.small);
+
+    for (int i = 8; i < 100; i++)
+        NUT_CHECK(SmallIntArray_add(&a, 100 - i) == NUT_OK);
+    NUT_CHECK(a.buffer != a.small);
+
+    SmallIntArray_sort(&a);
+    NUT_CHECK(SmallIntArray_get_at(&a, 0, &v) == NUT_OK && v == 1);
+    NUT_CHECK(SmallIntArray_remove_at(&a, 0, &v) == NUT_OK && v == 1);
+    NUT_CHECK(SmallIntArray_size(&a) == 99);
+    SmallIntArray_destroy(&a);
+
+    NUT_CHECK(SmallIntArray_add(&a, 3) == NUT_OK);
+    NUT_CHECK(SmallIntArray_get_at(&a, 0, &v) == NUT_OK && v == 3);
+    SmallIntArray_destroy(&a);
+}
+
+static void test_hashtable(void)
+{
+    static int  ref[KEYS];
+    static char in[KEYS];
+    IntMap      m;
+    size_t      cnt = 0;
+    size_t      pos = 0;
+    size_t      seen = 0;
+    uint32_t    k;
+    int         v;
+
+    NUT_CHECK(IntMap_init(&m, 0) == NUT_OK);
+    srand(2);
+    for (int it = 0; it < 400000; it++) {
+        int      o = 0;
+        NutState s;
+
+        k = rand() % KEYS;
+        v = rand();
+        switch (rand() % 3) {
+        case 0:
+            NUT_CHECK(IntMap_add(&m, k, v) == NUT_OK);
+            ref[k] = v;
+            in[k]  = 1;
+            break;
+        case 1:
+            s = IntMap_remove(&m, k, &o);
+            NUT_CHECK((s == NUT_OK) == in[k]);
+            if (in[k])
+                NUT_CHECK(o == ref[k]);
+            in[k] = 0;
+            break;
+        default:
+            s = IntMap_get(&m, k, &o);
+            NUT_CHECK((s == NUT_OK) == in[k]);
+            if (in[k])
+                NUT_CHECK(o == ref[k]);
+        }
+    }
+
+    for (int i = 0; i < KEYS; i++)
+        cnt += in[i];
+    NUT_CHECK(IntMap_size(&m) == cnt);
+    while (IntMap_iter_next(&m, &pos, &k, &v) == NUT_OK) {
+        NUT_CHECK(in[k] && ref[k] == v);
+        seen++;
+    }
+    NUT_CHECK(seen == cnt);
+    IntMap_destroy(&m);
+
+    /* 32-bit hashes must not collapse onto a single tag */
+    static char tags[256];
+    int         distinct = 0;
+    for (k = 0; k < KEYS; k++) {
+        uint8_t t = IntMap_tag(NUT_HASH_U32(k));
+        NUT_CHECK(t & 0x80);
+        distinct += !tags[t];
+        tags[t] = 1;
+    }
+    NUT_CHECK(distinct == 128);
+}
+
+int main(void)
+{
+    test_array();
+    test_small_array();
+    test_hashtable();
+    return 0;
+}
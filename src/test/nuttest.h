@@ -0,0 +1,20 @@
+#ifndef __NUTTEST_H__
+#define __NUTTEST_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Unlike assert() this stays armed in release builds, so the checked calls
+ * with side effects are always executed.
+ */
+#define NUT_CHECK(cond)                                                   \
+    do {                                                                  \
+        if (!(cond)) {                                                    \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                  \
+                    __FILE__, __LINE__, #cond);                           \
+            exit(1);                                                      \
+        }                                                                 \
+    } while (0)
+
+#endif
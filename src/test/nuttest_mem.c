@@ -0,0 +1,24 @@
+/*
+ * nut_mem_* backed by the C library allocator, so the containers can be
+ * tested on the host without pvPortMalloc().
+ */
+
+#include <stdlib.h>
+
+#include "nutmem.h"
+
+
+void *nut_mem_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void *nut_mem_calloc(size_t blocks, size_t size)
+{
+    return calloc(blocks, size);
+}
+
+void nut_mem_free(void *block)
+{
+    free(block);
+}
@@ -0,0 +1,115 @@
+#include <stdint.h>
+
+#include "nuttreeset.h"
+#include "nuttest.h"
+
+#define U 300
+
+static int v[U];
+
+
+static int cmp_int(const void *a, const void *b)
+{
+    int x = *(const int*) a;
+    int y = *(const int*) b;
+    return (x > y) - (x < y);
+}
+
+static bool matches(TreeSet *s, const int *m)
+{
+    TreeSetIter it;
+    void       *e;
+    size_t      n = 0;
+    int         prev = -1;
+
+    for (int i = 0; i < U; i++) {
+        n += m[i];
+        if (nut_treeset_contains(s, &v[i]) != m[i])
+            return false;
+    }
+    if (nut_treeset_size(s) != n)
+        return false;
+
+    /* In order, and the first/last lookups agree with the walk */
+    nut_treeset_iter_init(&it, s);
+    while (nut_treeset_iter_next(&it, &e) == NUT_OK) {
+        if (*(int*) e <= prev)
+            return false;
+        prev = *(int*) e;
+        n--;
+    }
+    if (n != 0)
+        return false;
+    if (prev >= 0) {
+        nut_treeset_get_last(s, &e);
+        if (*(int*) e != prev)
+            return false;
+    }
+    return true;
+}
+
+int main(void)
+{
+    srand(1);
+    for (int i = 0; i < U; i++)
+        v[i] = i;
+
+    for (int it = 0; it < 300; it++) {
+        int ma[U], mb[U], mu[U], mi[U], md[U];
+        int pa = rand() % 100;
+        int pb = rand() % 100;
+        bool sub = true;
+
+        TreeSet *a, *b, *r;
+        NUT_CHECK(nut_treeset_new(cmp_int, &a) == NUT_OK);
+        NUT_CHECK(nut_treeset_new(cmp_int, &b) == NUT_OK);
+        for (int i = 0; i < U; i++) {
+            ma[i] = rand() % 100 < pa;
+            mb[i] = rand() % 100 < pb;
+            if (ma[i])
+                nut_treeset_add(a, &v[i]);
+            if (mb[i])
+                nut_treeset_add(b, &v[i]);
+            mu[i] = ma[i] | mb[i];
+            mi[i] = ma[i] & mb[i];
+            md[i] = ma[i] & !mb[i];
+            if (md[i])
+                sub = false;
+        }
+
+        NUT_CHECK(nut_treeset_union(a, b, &r) == NUT_OK && matches(r, mu));
+
+        /* The tree built from the merge keeps working under updates */
+        int mr[U];
+        for (int i = 0; i < U; i++) {
+            mr[i] = i % 3 == 0 ? !mu[i] : mu[i];
+            if (i % 3 == 0 && mu[i])
+                NUT_CHECK(nut_treeset_remove(r, &v[i], NULL) == NUT_OK);
+            else if (i % 3 == 0)
+                NUT_CHECK(nut_treeset_add(r, &v[i]) == NUT_OK);
+        }
+        NUT_CHECK(matches(r, mr));
+        nut_treeset_destroy(r);
+        NUT_CHECK(nut_treeset_intersection(a, b, &r) == NUT_OK && matches(r, mi));
+        nut_treeset_destroy(r);
+        NUT_CHECK(nut_treeset_difference(a, b, &r) == NUT_OK && matches(r, md));
+        nut_treeset_destroy(r);
+        NUT_CHECK(nut_treeset_is_subset(a, b) == sub);
+
+        switch (it % 3) {
+        case 0:
+            NUT_CHECK(nut_treeset_union_mut(a, b) == NUT_OK && matches(a, mu));
+            break;
+        case 1:
+            nut_treeset_intersection_mut(a, b);
+            NUT_CHECK(matches(a, mi));
+            break;
+        default:
+            nut_treeset_difference_mut(a, b);
+            NUT_CHECK(matches(a, md));
+        }
+        nut_treeset_destroy(a);
+        nut_treeset_destroy(b);
+    }
+    return 0;
+}